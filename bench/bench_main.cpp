@@ -0,0 +1,467 @@
+/*!
+ * @file bench_main.cpp
+ * @description
+ * sloc_bench: micro-benchmarks of the line classifier, the file reader,
+ * directory collection and the summary table, run over a synthetic corpus.
+ *
+ * Every benchmark is repeated until it has run for at least `--min-time`
+ * seconds; wall and CPU time per iteration are reported together with the
+ * throughput in MB/s and in items (files, rows) per second, as a table or
+ * as JSON for tracking over time.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "../src/main.hpp"
+#include "../src/file_reader.hpp"
+#include "../src/libsloc.hpp"
+#include "../src/line_index.hpp"
+#include "../src/path_arena.hpp"
+#include "../src/report_writer.hpp"
+#include "../src/scan_simd.hpp"
+#include "../src/thread_pool.hpp"
+#include "corpus_gen.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+//== Harness
+
+/**
+ * @struct Work
+ * @brief What one iteration of a benchmark processed.
+ */
+struct Work {
+  std::uint64_t bytes{ 0 }; //!< Bytes processed (0 if not meaningful).
+  std::uint64_t items{ 0 }; //!< Items processed (files, rows...).
+};
+
+/**
+ * @struct Benchmark
+ * @brief A named benchmark.
+ */
+struct Benchmark {
+  std::string name;                //!< Name, `group/case`.
+  std::string items_label;         //!< What an item is, for the report.
+  std::function<Work()> run;       //!< One iteration.
+};
+
+/**
+ * @struct BenchResult
+ * @brief Measurements of one benchmark.
+ */
+struct BenchResult {
+  std::string name;              //!< Benchmark name.
+  std::string items_label;       //!< What an item is.
+  std::uint64_t iterations{ 0 }; //!< Iterations run.
+  double real_ns{ 0 };           //!< Wall time per iteration.
+  double cpu_ns{ 0 };            //!< Process CPU time per iteration.
+  double mb_per_s{ 0 };          //!< Throughput in MB/s (10^6 bytes, wall time).
+  double items_per_s{ 0 };       //!< Items per second (wall time).
+};
+
+/**
+ * @brief CPU time consumed by the process so far, in nanoseconds.
+ */
+double cpu_now_ns() {
+  timespec ts{};
+  ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return static_cast<double>(ts.tv_sec) * 1e9 + static_cast<double>(ts.tv_nsec);
+}
+
+/**
+ * @brief Run a benchmark for at least min_time seconds.
+ *
+ * @param bench The benchmark.
+ * @param min_time Minimum total wall time, in seconds.
+ *
+ * One untimed iteration warms caches (and the page cache) first.
+ */
+BenchResult measure(const Benchmark& bench, double min_time) {
+  using clock = std::chrono::steady_clock;
+  volatile std::uint64_t sink = bench.run().items; //warm-up
+  (void)sink;
+
+  BenchResult result;
+  result.name = bench.name;
+  result.items_label = bench.items_label;
+  Work total;
+  auto start = clock::now();
+  double cpu_start = cpu_now_ns();
+  double elapsed{ 0 };
+  do {
+    Work w = bench.run();
+    total.bytes += w.bytes;
+    total.items += w.items;
+    ++result.iterations;
+    elapsed = std::chrono::duration<double>(clock::now() - start).count();
+  } while (elapsed < min_time);
+  double cpu = cpu_now_ns() - cpu_start;
+
+  result.real_ns = elapsed * 1e9 / static_cast<double>(result.iterations);
+  result.cpu_ns = cpu / static_cast<double>(result.iterations);
+  result.mb_per_s = static_cast<double>(total.bytes) / 1e6 / elapsed;
+  result.items_per_s = static_cast<double>(total.items) / elapsed;
+  return result;
+}
+
+/**
+ * @brief Quote a string for JSON.
+ */
+std::string json_string(const std::string& s) {
+  std::string out{ "\"" };
+  for (char ch : s) {
+    if (ch == '"' || ch == '\\') {
+      out += '\\';
+      out += ch;
+    } else if (static_cast<unsigned char>(ch) < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", ch);
+      out += buf;
+    } else {
+      out += ch;
+    }
+  }
+  return out + "\"";
+}
+
+/**
+ * @brief Write the results as JSON.
+ */
+void write_json(std::ostream& out,
+                const std::vector<BenchResult>& results,
+                const CorpusSpec& spec,
+                const CorpusStats& corpus) {
+  std::time_t now = std::time(nullptr);
+  char date[32];
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+  out << std::setprecision(6);
+  out << "{\n  \"context\": {\n";
+  out << "    \"date\": " << json_string(date) << ",\n";
+  out << "    \"simd_kernel\": " << json_string(simd_kernel_name()) << ",\n";
+  out << "    \"hardware_threads\": " << default_jobs() << ",\n";
+  out << "    \"corpus\": {\"seed\": " << spec.seed << ", \"files\": " << corpus.files
+      << ", \"directories\": " << corpus.directories << ", \"bytes\": " << corpus.bytes
+      << ", \"lines\": " << corpus.lines << ", \"mean_lines\": " << spec.mean_lines
+      << ", \"size_sigma\": " << spec.size_sigma << ", \"comment_density\": " << spec.comment_density
+      << ", \"doc_density\": " << spec.doc_density << ", \"blank_density\": " << spec.blank_density
+      << ", \"literal_density\": " << spec.literal_density << ", \"line_length\": " << spec.line_length
+      << "}\n";
+  out << "  },\n  \"benchmarks\": [\n";
+  for (std::size_t i{ 0 }; i < results.size(); ++i) {
+    const auto& r = results[i];
+    out << "    {\"name\": " << json_string(r.name) << ", \"iterations\": " << r.iterations
+        << ", \"real_time_ns\": " << r.real_ns << ", \"cpu_time_ns\": " << r.cpu_ns
+        << ", \"mb_per_second\": " << r.mb_per_s << ", \"items_per_second\": " << r.items_per_s
+        << ", \"items\": " << json_string(r.items_label) << "}" << (i + 1 < results.size() ? "," : "")
+        << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+/**
+ * @brief Write the results as a table.
+ */
+void write_table(std::ostream& out, const std::vector<BenchResult>& results) {
+  out << std::left << std::setw(34) << "Benchmark" << std::right << std::setw(12) << "Iterations"
+      << std::setw(16) << "Time (us)" << std::setw(16) << "CPU (us)" << std::setw(12) << "MB/s"
+      << std::setw(16) << "Items/s" << "\n";
+  out << std::string(106, '-') << "\n";
+  out << std::fixed << std::setprecision(1);
+  for (const auto& r : results) {
+    out << std::left << std::setw(34) << r.name << std::right << std::setw(12) << r.iterations
+        << std::setw(16) << r.real_ns / 1e3 << std::setw(16) << r.cpu_ns / 1e3 << std::setw(12)
+        << r.mb_per_s << std::setw(16) << r.items_per_s << " " << r.items_label << "\n";
+  }
+}
+
+//== Benchmarks
+
+/**
+ * @class NullBuffer
+ * @brief Stream buffer that drops everything, to time print_summary without a terminal.
+ */
+class NullBuffer : public std::streambuf {
+protected:
+  int overflow(int ch) override { return ch; }
+  std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+/**
+ * @brief List the files of a corpus.
+ */
+std::vector<std::string> list_corpus(const std::string& root) {
+  std::vector<std::string> files;
+  for (const auto& entry : fs::recursive_directory_iterator(root)) {
+    if (entry.is_regular_file()) files.push_back(entry.path().string());
+  }
+  return files;
+}
+
+/**
+ * @brief Build the list of benchmarks over a generated corpus.
+ *
+ * @param root Corpus directory.
+ * @param spec Shape of the corpus, reused for the in-memory buffers.
+ */
+std::vector<Benchmark> make_benchmarks(const std::string& root, const CorpusSpec& spec) {
+  std::vector<Benchmark> benches;
+  auto files = std::make_shared<std::vector<std::string>>(list_corpus(root));
+
+  //classifier: one 4 MiB in-memory buffer per profile
+  struct Profile {
+    const char* name;
+    double comment, doc, blank, literal;
+  };
+  const Profile profiles[] = { { "mixed", spec.comment_density, spec.doc_density, spec.blank_density, spec.literal_density },
+                               { "code", 0.02, 0.01, 0.05, 0.40 },
+                               { "comments", 0.45, 0.35, 0.05, 0.10 } };
+  for (const auto& profile : profiles) {
+    CorpusSpec buffer_spec = spec;
+    buffer_spec.comment_density = profile.comment;
+    buffer_spec.doc_density = profile.doc;
+    buffer_spec.blank_density = profile.blank;
+    buffer_spec.literal_density = profile.literal;
+    std::string text = generate_source(buffer_spec, 0, 1);
+    for (std::uint64_t seed{ 1 }; text.size() < 4 * 1024 * 1024; ++seed) {
+      text += generate_source(buffer_spec, seed, 500);
+    }
+    auto buffer = std::make_shared<std::string>(std::move(text));
+
+    benches.push_back({ std::string("classifier/lines/") + profile.name, "lines", [buffer] {
+                         CurrentCount ts;
+                         AttributeCount atr;
+                         count_buffer_by_lines(*buffer, ts, atr);
+                         return Work{ buffer->size(), atr.lines };
+                       } });
+    benches.push_back({ std::string("classifier/table/") + profile.name, "lines", [buffer] {
+                         CurrentCount ts;
+                         AttributeCount atr;
+                         count_buffer(*buffer, ts, atr);
+                         return Work{ buffer->size(), atr.lines };
+                       } });
+  }
+
+  //incremental: one-line edits in the middle of a 100k-line file, back and forth
+  auto versions = std::make_shared<std::pair<std::string, std::string>>();
+  versions->first = generate_source(spec, 7, 100000);
+  std::size_t edit_at = versions->first.find('\n', versions->first.size() / 2) + 1;
+  std::size_t edit_length = versions->first.find('\n', edit_at) - edit_at;
+  const std::string edit_line{ "/* edited */ int edited = 0;" };
+  versions->second = versions->first;
+  versions->second.replace(edit_at, edit_length, edit_line);
+  auto index = std::make_shared<LineIndex>(CPP, versions->first);
+  benches.push_back({ "incremental/line_edit", "edits", [versions, index, edit_at, edit_length, edit_line] {
+                       Work w;
+                       for (int i{ 0 }; i < 1000; i += 2) {
+                         w.bytes += index->edit(versions->second, edit_at, edit_length, edit_line.size());
+                         w.bytes += index->edit(versions->first, edit_at, edit_line.size(), edit_length);
+                         w.items += 2;
+                       }
+                       return w;
+                     } });
+
+  benches.push_back({ "reader/FileBuffer", "files", [files] {
+                       Work w;
+                       for (const auto& name : *files) {
+                         FileBuffer file(name);
+                         w.bytes += file.view().size();
+                         ++w.items;
+                       }
+                       return w;
+                     } });
+  benches.push_back({ "reader/process_file", "files", [files] {
+                       Work w;
+                       for (const auto& name : *files) {
+                         w.bytes += fs::file_size(name);
+                         process_file(name);
+                         ++w.items;
+                       }
+                       return w;
+                     } });
+  auto pool = std::make_shared<ThreadPool>(default_jobs());
+  std::uint64_t corpus_bytes{ 0 };
+  for (const auto& name : *files) corpus_bytes += fs::file_size(name);
+  benches.push_back({ "library/count_files", "files", [files, pool, corpus_bytes] {
+                       Work w;
+                       w.bytes = corpus_bytes;
+                       w.items = sloc::count_files(*files, pool.get()).size();
+                       return w;
+                     } });
+
+  for (bool recursive : { false, true }) {
+    benches.push_back({ recursive ? "collect/recursive" : "collect/flat", "files", [root, recursive] {
+                         RunningOpt opt;
+                         opt.recursive = recursive;
+                         opt.directory_list.push_back(root);
+                         collect_files(opt);
+                         return Work{ 0, opt.input_list.size() };
+                       } });
+  }
+
+  //summary: a table the size of a big project, printed into the void
+  auto names = std::make_shared<PathArena>();
+  auto db = std::make_shared<std::vector<FileInfo>>();
+  for (std::size_t i{ 0 }; i < 20000; ++i) {
+    FileInfo info;
+    info.filename = names->intern("src/module" + std::to_string(i % 97) + "/file" + std::to_string(i) + ".cpp").path;
+    info.type = CPP;
+    info.n_lines = 100 + (i * 7919) % 5000;
+    info.n_comments = info.n_lines / 5;
+    info.n_doc_comments = info.n_lines / 10;
+    info.n_blank = info.n_lines / 8;
+    info.n_loc = info.n_lines - info.n_comments - info.n_blank;
+    db->push_back(info);
+  }
+  for (bool sorted : { false, true }) {
+    benches.push_back({ sorted ? "summary/sorted" : "summary/plain", "rows", [db, names, sorted] {
+                         RunningOpt opt;
+                         if (sorted) {
+                           opt.should_sort = true;
+                           opt.sort_descending = true;
+                           opt.sort_fields = { s };
+                         }
+                         NullBuffer null;
+                         std::streambuf* saved = std::cout.rdbuf(&null);
+                         print_summary(*db, opt);
+                         std::cout.rdbuf(saved);
+                         return Work{ 0, db->size() };
+                       } });
+  }
+  for (auto [name, format] : { std::pair<const char*, output_format_e>{ "summary/json", FORMAT_JSON },
+                                { "summary/csv", FORMAT_CSV },
+                                { "summary/bin", FORMAT_BIN } }) {
+    benches.push_back({ name, "rows", [db, names, format] {
+                         NullBuffer null;
+                         std::ostream out(&null);
+                         write_report(out, sorted_records(*db, RunningOpt{}), format);
+                         return Work{ 0, db->size() };
+                       } });
+  }
+  return benches;
+}
+
+/**
+ * @brief Print the command line help.
+ */
+void bench_usage() {
+  std::cout << "USAGE\n"
+               "  sloc_bench [options]                 run the benchmarks\n"
+               "  sloc_bench --generate DIR [options]  only write the corpus to DIR\n\n"
+               "OPTIONS\n"
+               "  --json FILE          write results as JSON to FILE ('-' for stdout)\n"
+               "  --filter TEXT        only run benchmarks whose name contains TEXT\n"
+               "  --min-time SECONDS   minimum run time of each benchmark (default 0.5)\n"
+               "  --corpus DIR         generate the corpus in DIR and keep it\n\n"
+               "CORPUS OPTIONS\n"
+               "  --seed N  --files N  --fanout N  --depth N  --mean-lines N  --size-sigma X\n"
+               "  --comment-density X  --doc-density X  --blank-density X  --literal-density X\n"
+               "  --line-length N\n";
+}
+
+}  // namespace
+
+//== Main entry
+
+/**
+ * @brief Generate a corpus, run the benchmarks and report.
+ */
+int main(int argc, char* argv[]) {
+  CorpusSpec spec;
+  std::string json_path, filter, corpus_dir, generate_dir;
+  double min_time{ 0.5 };
+
+  for (int i{ 1 }; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      bench_usage();
+      return EXIT_SUCCESS;
+    }
+    if (i + 1 >= argc) {
+      std::cerr << "Missing value for \"" << arg << "\"\n";
+      bench_usage();
+      return EXIT_FAILURE;
+    }
+    std::string value = argv[++i];
+    try {
+      if (arg == "--json") json_path = value;
+      else if (arg == "--filter") filter = value;
+      else if (arg == "--min-time") min_time = std::stod(value);
+      else if (arg == "--corpus") corpus_dir = value;
+      else if (arg == "--generate") generate_dir = value;
+      else if (arg == "--seed") spec.seed = std::stoull(value);
+      else if (arg == "--files") spec.files = std::stoul(value);
+      else if (arg == "--fanout") spec.fanout = std::stoul(value);
+      else if (arg == "--depth") spec.depth = std::stoul(value);
+      else if (arg == "--mean-lines") spec.mean_lines = std::stoul(value);
+      else if (arg == "--size-sigma") spec.size_sigma = std::stod(value);
+      else if (arg == "--comment-density") spec.comment_density = std::stod(value);
+      else if (arg == "--doc-density") spec.doc_density = std::stod(value);
+      else if (arg == "--blank-density") spec.blank_density = std::stod(value);
+      else if (arg == "--literal-density") spec.literal_density = std::stod(value);
+      else if (arg == "--line-length") spec.line_length = std::stoul(value);
+      else {
+        std::cerr << "Unknown option \"" << arg << "\"\n";
+        bench_usage();
+        return EXIT_FAILURE;
+      }
+    } catch (const std::exception&) {
+      std::cerr << "Invalid value for \"" << arg << "\": " << value << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!generate_dir.empty()) {
+    CorpusStats stats = generate_corpus(generate_dir, spec);
+    std::cout << stats.files << " files, " << stats.lines << " lines, " << stats.bytes
+              << " bytes in " << stats.directories << " directories\n";
+    return EXIT_SUCCESS;
+  }
+
+  bool keep_corpus = !corpus_dir.empty();
+  if (!keep_corpus) {
+    corpus_dir = (fs::temp_directory_path() / ("sloc_bench." + std::to_string(::getpid()))).string();
+  }
+  CorpusStats corpus = generate_corpus(corpus_dir, spec);
+
+  std::vector<BenchResult> results;
+  for (const auto& bench : make_benchmarks(corpus_dir, spec)) {
+    if (!filter.empty() && bench.name.find(filter) == std::string::npos) continue;
+    results.push_back(measure(bench, min_time));
+    if (json_path != "-") std::cerr << "." << std::flush;
+  }
+  if (json_path != "-") std::cerr << "\n";
+
+  if (!keep_corpus) fs::remove_all(corpus_dir);
+
+  if (json_path.empty()) {
+    write_table(std::cout, results);
+  } else if (json_path == "-") {
+    write_json(std::cout, results, spec, corpus);
+  } else {
+    std::ofstream out(json_path);
+    write_json(out, results, spec, corpus);
+    if (!out) {
+      std::cerr << "Unable to write \"" << json_path << "\"\n";
+      return EXIT_FAILURE;
+    }
+    write_table(std::cout, results);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,234 @@
+/*!
+ * @file corpus_gen.cpp
+ * @description
+ * Implementation of the synthetic corpus generator.
+ *
+ * Random numbers come from a local splitmix64 generator and are turned into
+ * values with explicit arithmetic (no std::*_distribution, whose output is
+ * allowed to differ between standard libraries), so a spec always yields the
+ * same bytes.
+ */
+
+#include "corpus_gen.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/**
+ * @class Rng
+ * @brief splitmix64: tiny, fast and fully specified.
+ */
+class Rng {
+public:
+  explicit Rng(std::uint64_t seed) : m_state{ seed } {}
+
+  /// @brief Next 64 random bits.
+  std::uint64_t next() {
+    std::uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+
+  /// @brief Uniform double in [0, 1).
+  double uniform() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+  /// @brief Uniform integer in [0, n).
+  std::size_t below(std::size_t n) { return n == 0 ? 0 : static_cast<std::size_t>(next() % n); }
+
+  /// @brief Standard normal deviate (Box-Muller).
+  double normal() {
+    double u1 = 1.0 - uniform(); //in (0, 1], so the log is finite
+    double u2 = uniform();
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+  }
+
+  /// @brief A random element of an array.
+  template <typename T, std::size_t N>
+  const T& pick(const std::array<T, N>& items) {
+    return items[below(N)];
+  }
+
+private:
+  std::uint64_t m_state; //!< Generator state.
+};
+
+/// @brief Words used in comments.
+constexpr std::array<std::string_view, 16> WORDS{ "the",    "buffer", "returns", "index",
+                                                  "count",  "of",     "lines",   "when",
+                                                  "state",  "is",     "updated", "before",
+                                                  "parser", "value",  "a",       "file" };
+
+/// @brief Tokens used in code lines.
+constexpr std::array<std::string_view, 20> TOKENS{ "int",    "auto",  "size_t", "return", "const",
+                                                   "value",  "count", "idx",    "buf",    "state",
+                                                   "=",      "+",     "<",      "==",     "->",
+                                                   "(",      ")",     "[i]",    "std::",  "0" };
+
+/// @brief Literals, including the tricky ones the classifier must see through.
+constexpr std::array<std::string_view, 10> LITERALS{ "\"plain text\"",       "\"not // a comment\"",
+                                                     "\"not /* a comment\"", "\"escaped \\\" quote\"",
+                                                     "'x'",                  "'\\''",
+                                                     "'\"'",                 "\"path\\\\to\\\\file\"",
+                                                     "R\"(raw \"// text\")\"", "1'000'000" };
+
+/// @brief Supported extensions, one picked per file.
+constexpr std::array<std::string_view, 4> EXTENSIONS{ ".cpp", ".hpp", ".c", ".h" };
+
+/**
+ * @brief Append a few random words.
+ */
+void append_words(std::string& out, Rng& rng, std::size_t n) {
+  for (std::size_t i{ 0 }; i < n; ++i) {
+    if (i > 0) out += ' ';
+    out += rng.pick(WORDS);
+  }
+}
+
+/**
+ * @brief Append a code line (without its newline).
+ */
+void append_code(std::string& out, Rng& rng, const CorpusSpec& spec) {
+  out.append(2 * rng.below(4), ' ');
+  std::size_t target = static_cast<std::size_t>(static_cast<double>(spec.line_length) * (0.5 + rng.uniform()));
+  std::size_t start = out.size();
+  bool literal = rng.uniform() < spec.literal_density;
+  std::size_t literal_at = literal ? rng.below(target + 1) : target + 1;
+
+  while (out.size() - start < target) {
+    if (out.size() - start >= literal_at) {
+      out += rng.pick(LITERALS);
+      literal_at = target + 1;
+    } else {
+      out += rng.pick(TOKENS);
+    }
+    out += ' ';
+  }
+  out += ';';
+  if (rng.below(20) == 0) out += " // trailing note";
+}
+
+}  // namespace
+
+/**
+ * @brief Generate the content of one source file.
+ *
+ * @param spec Shape of the corpus (densities and line length are used).
+ * @param file_seed Distinguishes the files of a corpus.
+ * @param n_lines Number of lines to generate.
+ *
+ * Block comments and doc blocks span one to four lines; they are cut short
+ * rather than overshoot n_lines.
+ *
+ * @return The file content, every line ending in '\n'.
+ */
+std::string generate_source(const CorpusSpec& spec, std::uint64_t file_seed, std::size_t n_lines) {
+  Rng rng(spec.seed * 0x9E3779B97F4A7C15ull ^ file_seed);
+  std::string out;
+  out.reserve(n_lines * (spec.line_length / 2 + 8));
+
+  std::size_t lines{ 0 };
+  auto end_line = [&] {
+    out += '\n';
+    ++lines;
+  };
+
+  while (lines < n_lines) {
+    double r = rng.uniform();
+    std::size_t block = std::min<std::size_t>(1 + rng.below(4), n_lines - lines);
+
+    if (r < spec.blank_density) {
+      end_line();
+    } else if ((r -= spec.blank_density) < spec.comment_density) {
+      if (block > 1) {
+        out += "/* ";
+        for (std::size_t i{ 0 }; i < block; ++i) {
+          if (i > 0) out += "   ";
+          append_words(out, rng, 3 + rng.below(6));
+          if (i + 1 == block) out += " */";
+          end_line();
+        }
+      } else {
+        out += "// ";
+        append_words(out, rng, 3 + rng.below(8));
+        end_line();
+      }
+    } else if ((r -= spec.comment_density) < spec.doc_density) {
+      if (block > 2) {
+        out += "/**";
+        end_line();
+        for (std::size_t i{ 2 }; i < block; ++i) {
+          out += " * ";
+          append_words(out, rng, 3 + rng.below(8));
+          end_line();
+        }
+        out += " */";
+        end_line();
+      } else {
+        out += "/// ";
+        append_words(out, rng, 3 + rng.below(8));
+        end_line();
+      }
+    } else {
+      append_code(out, rng, spec);
+      end_line();
+    }
+  }
+  return out;
+}
+
+/**
+ * @brief Write a whole synthetic corpus below a directory.
+ *
+ * @param root Directory to fill (created if needed; existing files with the
+ *             same names are overwritten).
+ * @param spec Shape of the corpus.
+ *
+ * Files are spread round-robin over a tree of `fanout` sub-directories per
+ * level, `depth` levels deep. File sizes follow a log-normal distribution
+ * around `mean_lines`, which mimics real code bases: many small files and
+ * a few big ones.
+ *
+ * @return What was written.
+ */
+CorpusStats generate_corpus(const std::string& root, const CorpusSpec& spec) {
+  CorpusStats stats;
+
+  std::vector<fs::path> dirs{ fs::path(root) };
+  for (std::size_t level{ 0 }, first{ 0 }; level < spec.depth; ++level) {
+    std::size_t last = dirs.size();
+    for (std::size_t d{ first }; d < last; ++d) {
+      for (std::size_t i{ 0 }; i < spec.fanout; ++i) {
+        dirs.push_back(dirs[d] / ("d" + std::to_string(i)));
+      }
+    }
+    first = last;
+  }
+  for (const auto& dir : dirs) fs::create_directories(dir);
+  stats.directories = dirs.size();
+
+  Rng rng(spec.seed);
+  for (std::size_t i{ 0 }; i < spec.files; ++i) {
+    double scale = spec.size_sigma > 0 ? std::exp(spec.size_sigma * rng.normal()) : 1.0;
+    std::size_t n_lines = std::max<std::size_t>(1, static_cast<std::size_t>(std::llround(static_cast<double>(spec.mean_lines) * scale)));
+    std::string name = "f" + std::to_string(i) + std::string(rng.pick(EXTENSIONS));
+
+    std::string content = generate_source(spec, i, n_lines);
+    std::ofstream file(dirs[i % dirs.size()] / name, std::ios::binary | std::ios::trunc);
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+
+    ++stats.files;
+    stats.bytes += content.size();
+    stats.lines += n_lines;
+  }
+  return stats;
+}
@@ -0,0 +1,69 @@
+#ifndef CORPUS_GEN_HPP
+#define CORPUS_GEN_HPP
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*!
+ * @file corpus_gen.hpp
+ * @description
+ * Deterministic generator of synthetic C/C++ source trees, used by the
+ * benchmarks so their input does not depend on what is checked out.
+ */
+
+//== Structs
+
+/**
+ * @struct CorpusSpec
+ * @brief Shape of a synthetic corpus.
+ *
+ * Densities are the probability that a generated line is of that kind;
+ * whatever is left over becomes plain code. The same spec (and seed)
+ * always produces byte-identical files, on every platform.
+ */
+struct CorpusSpec {
+  std::uint64_t seed{ 1 };            //!< Seed of the generator.
+  std::size_t files{ 200 };           //!< Number of files.
+  std::size_t fanout{ 4 };            //!< Sub-directories per directory.
+  std::size_t depth{ 2 };             //!< Levels of sub-directories below the root.
+  std::size_t mean_lines{ 300 };      //!< Median number of lines per file.
+  double size_sigma{ 1.0 };           //!< Spread of the log-normal file size (0: all files equal).
+  double comment_density{ 0.15 };     //!< Share of `//` and `/* */` comment lines.
+  double doc_density{ 0.10 };         //!< Share of `///` and `/** */` doc comment lines.
+  double blank_density{ 0.10 };       //!< Share of blank lines.
+  double literal_density{ 0.20 };     //!< Share of code lines holding a string or char literal.
+  std::size_t line_length{ 60 };      //!< Mean length of a code line, in bytes.
+};
+
+/**
+ * @struct CorpusStats
+ * @brief What was generated.
+ */
+struct CorpusStats {
+  std::size_t files{ 0 };       //!< Files written.
+  std::size_t directories{ 0 }; //!< Directories created (root included).
+  std::uint64_t bytes{ 0 };     //!< Total size of the files.
+  std::uint64_t lines{ 0 };     //!< Total number of lines.
+};
+
+//== Functions
+
+/**
+ * @brief Generate the content of one source file.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see generate_source()
+ */
+std::string generate_source(const CorpusSpec& spec, std::uint64_t file_seed, std::size_t n_lines);
+
+/**
+ * @brief Write a whole synthetic corpus below a directory.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see generate_corpus()
+ */
+CorpusStats generate_corpus(const std::string& root, const CorpusSpec& spec);
+
+#endif
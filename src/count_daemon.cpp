@@ -0,0 +1,714 @@
+/*!
+ * @file count_daemon.cpp
+ * @description
+ * The `--daemon` event loop: inotify watches, batches of recounts, sorted
+ * views patched in place, and the request protocol of its socket.
+ */
+
+#include "count_daemon.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <poll.h>
+#include <streambuf>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "dir_walker.hpp"
+#include "record_sort.hpp"
+#include "report_writer.hpp"
+#include "result_cache.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/// @brief Events that may change the files of a watched directory. Files are
+/// counted again once closed after writing (not on every write, while they
+/// may still be half-written) or moved in.
+constexpr std::uint32_t WATCH_MASK{ IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MOVE_SELF
+                                    | IN_ONLYDIR };
+
+/// @brief An index of m_db that no longer exists.
+constexpr std::uint32_t GONE{ std::numeric_limits<std::uint32_t>::max() };
+
+/// @brief Set by SIGINT and SIGTERM, which stop the daemon between two events.
+volatile std::sig_atomic_t g_stop_signal{ 0 };
+
+/// @brief Signal handler of serve().
+void request_stop(int) { g_stop_signal = 1; }
+
+/**
+ * @brief Fill the address of a Unix domain socket.
+ *
+ * @return false if the path does not fit.
+ */
+bool socket_address(const std::string& path, sockaddr_un& address) {
+  address = {};
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+  std::memcpy(address.sun_path, path.data(), path.size());
+  return true;
+}
+
+/**
+ * @brief Send all the bytes, unless the peer goes away.
+ */
+bool send_all(int fd, const char* data, std::size_t size) {
+  while (size > 0) {
+    ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) continue;
+    if (sent <= 0) return false;
+    data += sent;
+    size -= static_cast<std::size_t>(sent);
+  }
+  return true;
+}
+
+/**
+ * @class SocketBuffer
+ * @brief A std::streambuf writing to a connected socket.
+ *
+ * Small writes are gathered; big ones (like the buffers of write_report())
+ * go straight to the socket. Once the peer is gone, everything is dropped.
+ */
+class SocketBuffer : public std::streambuf {
+public:
+  explicit SocketBuffer(int fd) : m_fd{ fd } { setp(m_buffer, m_buffer + sizeof(m_buffer)); }
+
+  ~SocketBuffer() override { sync(); }
+
+protected:
+  int_type overflow(int_type ch) override {
+    if (sync() != 0) return traits_type::eof();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(ch);
+      pbump(1);
+    }
+    return traits_type::not_eof(ch);
+  }
+
+  std::streamsize xsputn(const char* data, std::streamsize size) override {
+    if (size < epptr() - pptr()) {
+      std::memcpy(pptr(), data, static_cast<std::size_t>(size));
+      pbump(static_cast<int>(size));
+      return size;
+    }
+    if (sync() != 0) return 0;
+    m_failed = !send_all(m_fd, data, static_cast<std::size_t>(size));
+    return m_failed ? 0 : size;
+  }
+
+  int sync() override {
+    if (!m_failed && pptr() != pbase()) m_failed = !send_all(m_fd, pbase(), static_cast<std::size_t>(pptr() - pbase()));
+    setp(m_buffer, m_buffer + sizeof(m_buffer));
+    return m_failed ? -1 : 0;
+  }
+
+private:
+  int m_fd;                  //!< The connection.
+  bool m_failed{ false };    //!< Whether the peer went away.
+  char m_buffer[16 * 1024];  //!< Bytes not sent yet.
+};
+
+/// @brief Add the counts of a record to the totals.
+void add_counts(AttributeCount& totals, const FileInfo& info) {
+  totals.lines += info.n_lines;
+  totals.blank += info.n_blank;
+  totals.loc += info.n_loc;
+  totals.com += info.n_comments;
+  totals.dox += info.n_doc_comments;
+}
+
+/// @brief Take the counts of a record out of the totals.
+void remove_counts(AttributeCount& totals, const FileInfo& info) {
+  totals.lines -= info.n_lines;
+  totals.blank -= info.n_blank;
+  totals.loc -= info.n_loc;
+  totals.com -= info.n_comments;
+  totals.dox -= info.n_doc_comments;
+}
+
+}  // namespace
+
+/**
+ * @brief Listen on a Unix domain socket.
+ *
+ * @param socket_path Path of the socket to create.
+ *
+ * A socket left behind by a daemon that is gone is replaced; one that a
+ * daemon still answers on is an error, and so is any other kind of file
+ * at that path.
+ */
+CountDaemon::CountDaemon(std::string socket_path) : m_socket_path{ std::move(socket_path) } {
+  sockaddr_un address;
+  if (!socket_address(m_socket_path, address)) {
+    m_error = "the socket path \"" + m_socket_path + "\" is empty or too long";
+    return;
+  }
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (fd < 0) {
+    m_error = std::string{ "unable to create a socket (" } + std::strerror(errno) + ")";
+    return;
+  }
+
+  int status = ::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+  struct stat st {};
+  if (status != 0 && errno == EADDRINUSE && ::lstat(m_socket_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+    int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    bool stale = probe >= 0 && ::connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+                 && errno == ECONNREFUSED;
+    if (probe >= 0) ::close(probe);
+    if (!stale) {
+      m_error = "another daemon is listening on \"" + m_socket_path + "\"";
+      ::close(fd);
+      return;
+    }
+    ::unlink(m_socket_path.c_str());
+    status = ::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+  }
+  if (status != 0 || ::listen(fd, 64) != 0) {
+    m_error = "unable to listen on \"" + m_socket_path + "\" (" + std::strerror(errno) + ")";
+    ::close(fd);
+    return;
+  }
+  m_listen_fd = fd;
+}
+
+CountDaemon::~CountDaemon() {
+  if (m_inotify_fd >= 0) ::close(m_inotify_fd);
+  if (m_listen_fd >= 0) {
+    ::close(m_listen_fd);
+    ::unlink(m_socket_path.c_str());
+  }
+}
+
+/**
+ * @brief Watch the inputs and count them.
+ *
+ * @param run_options The files and directories to follow, `-r` and `-j`.
+ * @param cache Counts of previous runs, or nullptr; it must outlive the daemon.
+ * @param stats If not null, receives the counters of the first walk.
+ *
+ * The first count is a normal run (see process_files()), which the cache
+ * makes quick when the daemon is restarted. Files are read and never
+ * mapped: one truncated while it is counted would raise SIGBUS and take
+ * the daemon down.
+ */
+void CountDaemon::start(const RunningOpt& run_options, ResultCache* cache, RunStats* stats) {
+  if (!ok()) return;
+  m_options = run_options;
+  m_options.map_files = false;
+  m_cache = cache;
+  if (m_options.jobs > 1) m_pool.emplace(m_options.jobs);
+  rebuild(stats);
+}
+
+/**
+ * @brief Set up every watch and count every input from scratch.
+ *
+ * @param stats If not null, receives the counters of the walk.
+ *
+ * Explicit files are followed through a watch on their directory, which
+ * only reports them. The watches are in place before the walk, so that
+ * changes made while it runs are applied right after.
+ */
+void CountDaemon::rebuild(RunStats* stats) {
+  if (m_inotify_fd >= 0) ::close(m_inotify_fd); //drops every watch at once
+  m_inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_inotify_fd < 0) {
+    m_error = std::string{ "unable to follow the changes of the files (" } + std::strerror(errno) + ")";
+    return;
+  }
+  m_watches.clear();
+  m_batch.clear();
+
+  for (const auto& file : m_options.input_list) {
+    m_explicit.insert(m_paths.intern(file).path);
+    std::size_t slash = file.rfind('/');
+    watch_tree(slash == std::string::npos ? std::string{} : file.substr(0, slash == 0 ? 1 : slash), false, nullptr);
+  }
+  for (const auto& directory : m_options.directory_list) watch_tree(directory, true, nullptr);
+
+  m_db = process_files(m_options, m_paths, m_cache, stats);
+  m_index.clear();
+  m_index.reserve(m_db.size());
+  m_totals = AttributeCount{};
+  for (std::size_t i{ 0 }; i < m_db.size(); ++i) {
+    m_index.emplace(m_db[i].filename, static_cast<std::uint32_t>(i));
+    add_counts(m_totals, m_db[i]);
+  }
+  for (auto& sorted : m_views) sorted.order = sort_order(m_db, sorted.keys, sorted.ascending);
+}
+
+/**
+ * @brief Watch a directory, and its sub-directories with `-r`.
+ *
+ * @param path Path of the directory, as displayed ("" for the current directory).
+ * @param whole Whether all of its source files are inputs.
+ * @param found If not null, receives the candidate files found in the
+ *        directory and its sub-directories (for a directory that just
+ *        appeared, whose files were never counted).
+ *
+ * Like the walker, symlinks to directories are not followed. A directory
+ * that cannot be watched (e.g. past the inotify watch limit) is reported
+ * and left out.
+ */
+void CountDaemon::watch_tree(const std::string& path, bool whole, std::vector<std::string>* found) {
+  std::string open_path = path.empty() ? "." : path;
+  int wd = ::inotify_add_watch(m_inotify_fd, open_path.c_str(), WATCH_MASK);
+  if (wd < 0) {
+    std::cerr << "Warning: unable to watch \"" << open_path << "\" (" << std::strerror(errno) << ").\n";
+    return;
+  }
+  WatchedDir& dir = m_watches[wd];
+  if (!dir.whole) dir.path = path; //a directory watched whole keeps the name it was walked by
+  dir.whole = dir.whole || whole;
+  if (!whole || (!m_options.recursive && found == nullptr)) return;
+
+  std::error_code ec;
+  for (fs::directory_iterator it(open_path, ec), end; !ec && it != end; it.increment(ec)) {
+    std::string name = it->path().filename().string();
+    std::string child = join_path(path, name);
+    std::error_code type_ec;
+    if (m_options.recursive && it->is_directory(type_ec) && !it->is_symlink(type_ec)) {
+      watch_tree(child, true, found);
+    } else if (found != nullptr && it->is_regular_file(type_ec) && may_be_source(name)) {
+      found->push_back(std::move(child));
+    }
+  }
+}
+
+/**
+ * @brief Read the pending inotify events into the batch.
+ *
+ * A changed, created, deleted or renamed file of a watched directory goes
+ * to the batch if it may be source code (or, in a directory only watched
+ * for its explicit files, if it is one of them or already known). A new
+ * directory under a `-r` input is watched, and its files join the batch;
+ * one that is deleted or renamed away takes its files and watches along.
+ *
+ * @return false if the queue overflowed: events were lost.
+ */
+bool CountDaemon::read_events() {
+  alignas(inotify_event) char buffer[64 * 1024];
+  bool overflow{ false };
+  while (true) {
+    ssize_t n = ::read(m_inotify_fd, buffer, sizeof(buffer));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+
+    for (ssize_t pos{ 0 }; pos < n;) {
+      const auto* event = reinterpret_cast<const inotify_event*>(buffer + pos);
+      pos += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+      ++m_activity.events;
+      if (event->mask & IN_Q_OVERFLOW) {
+        overflow = true;
+        continue;
+      }
+      auto watch = m_watches.find(event->wd);
+      if (watch == m_watches.end()) continue;
+      if (event->mask & IN_IGNORED) {
+        m_watches.erase(watch);
+        continue;
+      }
+      WatchedDir dir = watch->second; //watch_tree() may rehash m_watches
+      if (event->mask & IN_MOVE_SELF) {
+        queue_under(dir.path);
+        continue;
+      }
+      if (event->len == 0) continue;
+
+      std::string_view name{ event->name };
+      std::string path = join_path(dir.path, name);
+      if (event->mask & IN_ISDIR) {
+        if (!dir.whole || !m_options.recursive) continue;
+        if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+          std::vector<std::string> found;
+          watch_tree(path, true, &found);
+          for (auto& file : found) m_batch.insert(std::move(file));
+        } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+          queue_under(path);
+        }
+        continue;
+      }
+      if ((dir.whole && may_be_source(name)) || m_explicit.count(path) > 0 || m_index.count(path) > 0) {
+        m_batch.insert(std::move(path));
+      }
+    }
+  }
+  return !overflow;
+}
+
+/**
+ * @brief Add the files displayed under a directory to the batch, and stop watching it.
+ *
+ * @param path Path of the directory, as displayed.
+ *
+ * For a directory that went away (or moved: its watches would report the
+ * new place under the old name). Its files are counted again with the
+ * batch, and found missing.
+ */
+void CountDaemon::queue_under(std::string_view path) {
+  std::string prefix{ path };
+  if (!prefix.empty() && prefix.back() != '/') prefix += '/';
+  auto under = [&path, &prefix](std::string_view name) {
+    return name == path || name.substr(0, prefix.size()) == prefix;
+  };
+  for (const auto& info : m_db) {
+    if (under(info.filename)) m_batch.insert(std::string{ info.filename });
+  }
+  for (auto it = m_watches.begin(); it != m_watches.end();) {
+    if (under(it->second.path)) {
+      ::inotify_rm_watch(m_inotify_fd, it->first);
+      it = m_watches.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+/**
+ * @brief Count the files of the batch again and update the records, totals and views.
+ *
+ * Each file is counted as in a normal run (through the cache, so a file
+ * touched but not changed is not read again), on the pool when there are
+ * several. A file that is gone, or no longer source code, is removed; a
+ * new one is appended. The totals move by the difference of each record.
+ *
+ * The records that changed are taken out of each sorted view and merged
+ * back in at their new place: linear in the number of files, with no
+ * sort but that of the batch itself. Ties are broken by file name, as
+ * with sort_order().
+ */
+void CountDaemon::apply_batch() {
+  if (m_batch.empty()) return;
+  ++m_activity.batches;
+  std::vector<std::string_view> paths;
+  paths.reserve(m_batch.size());
+  for (const auto& path : m_batch) paths.push_back(m_paths.intern(path).path);
+  m_batch.clear();
+  m_activity.recounted += paths.size();
+
+  ThreadPool* pool = m_pool ? &*m_pool : nullptr;
+  std::vector<FileInfo> counted(paths.size());
+  auto count = [this, pool, &paths, &counted](std::size_t i) {
+    std::error_code ec;
+    if (fs::is_regular_file(fs::path{ paths[i] }, ec)) {
+      counted[i] = make_file_info(paths[i], pool, m_cache, m_options.map_files);
+    } else {
+      counted[i].filename = paths[i]; //gone: stays UNDEF
+    }
+  };
+  if (pool != nullptr && paths.size() > 1) {
+    for (std::size_t i{ 0 }; i < paths.size(); ++i) pool->submit([&count, i] { count(i); });
+    pool->wait();
+  } else {
+    for (std::size_t i{ 0 }; i < paths.size(); ++i) count(i);
+  }
+
+  std::vector<std::uint32_t> touched;
+  std::vector<bool> removed(m_db.size(), false);
+  bool any_removed{ false };
+  for (const FileInfo& info : counted) {
+    bool present = info.type != UNDEF;
+    auto known = m_index.find(info.filename);
+    if (known != m_index.end()) {
+      std::uint32_t index = known->second;
+      remove_counts(m_totals, m_db[index]);
+      if (present) {
+        m_db[index] = info;
+        add_counts(m_totals, info);
+        touched.push_back(index);
+      } else {
+        removed[index] = true;
+        any_removed = true;
+      }
+    } else if (present) {
+      auto index = static_cast<std::uint32_t>(m_db.size());
+      m_db.push_back(info);
+      removed.push_back(false);
+      m_index.emplace(info.filename, index);
+      add_counts(m_totals, info);
+      touched.push_back(index);
+    }
+  }
+
+  std::vector<std::uint32_t> remap;
+  if (any_removed) {
+    remap.assign(m_db.size(), GONE);
+    std::size_t kept{ 0 };
+    for (std::size_t i{ 0 }; i < m_db.size(); ++i) {
+      if (removed[i]) continue;
+      remap[i] = static_cast<std::uint32_t>(kept);
+      m_db[kept++] = m_db[i];
+    }
+    m_db.resize(kept);
+    m_index.clear();
+    for (std::size_t i{ 0 }; i < m_db.size(); ++i) m_index.emplace(m_db[i].filename, static_cast<std::uint32_t>(i));
+    for (auto& index : touched) index = remap[index];
+  }
+
+  std::vector<bool> moved(m_db.size(), false);
+  for (std::uint32_t index : touched) moved[index] = true;
+  for (auto& sorted : m_views) {
+    auto before = [this, &sorted](std::uint32_t a, std::uint32_t b) {
+      if (compare_files(m_db[a], m_db[b], sorted.keys, sorted.ascending)) return true;
+      if (compare_files(m_db[b], m_db[a], sorted.keys, sorted.ascending)) return false;
+      if (m_db[a].filename != m_db[b].filename) return m_db[a].filename < m_db[b].filename;
+      return a < b;
+    };
+    std::vector<std::uint32_t> kept;
+    kept.reserve(m_db.size());
+    for (std::uint32_t index : sorted.order) {
+      if (any_removed) index = remap[index];
+      if (index != GONE && !moved[index]) kept.push_back(index);
+    }
+    std::vector<std::uint32_t> changed = touched;
+    std::sort(changed.begin(), changed.end(), before);
+    sorted.order.clear();
+    std::merge(kept.begin(), kept.end(), changed.begin(), changed.end(), std::back_inserter(sorted.order), before);
+  }
+}
+
+/**
+ * @brief The view of a sort order, sorting it on first use.
+ *
+ * @param keys Sort keys, most significant first.
+ * @param ascending Sort direction.
+ *
+ * @return The view, valid until the next call.
+ */
+const CountDaemon::SortedView& CountDaemon::view(const std::vector<sorting_arg>& keys, bool ascending) {
+  for (const auto& sorted : m_views) {
+    if (sorted.keys == keys && sorted.ascending == ascending) return sorted;
+  }
+  if (m_views.size() == MAX_VIEWS) m_views.erase(m_views.begin());
+  m_views.push_back({ keys, ascending, sort_order(m_db, keys, ascending) });
+  return m_views.back();
+}
+
+/**
+ * @brief Answer the request of one client.
+ *
+ * @param fd The connection.
+ *
+ * The request is read up to its newline (or the end of the connection),
+ * with a timeout so that a silent client cannot hold the daemon; so is
+ * the answer.
+ */
+void CountDaemon::answer(int fd) {
+  timeval timeout{ 1, 0 };
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  std::string request;
+  char buffer[512];
+  while (request.find('\n') == std::string::npos && request.size() < MAX_REQUEST) {
+    ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    request.append(buffer, static_cast<std::size_t>(n));
+  }
+  request.erase(std::min(request.find('\n'), request.size()));
+  ++m_activity.queries;
+
+  std::vector<std::string> words;
+  for (std::size_t start{ 0 }; start < request.size();) {
+    std::size_t end = std::min(request.find_first_of(" \t\r", start), request.size());
+    if (end > start) words.push_back(request.substr(start, end - start));
+    start = end + 1;
+  }
+
+  SocketBuffer socket_buffer(fd);
+  std::ostream out(&socket_buffer);
+  std::string text;
+  auto json_field = [&text](std::string_view key, std::uint64_t value) {
+    text += text.empty() ? "{\"" : ", \"";
+    text += key;
+    text += "\": ";
+    append_uint(text, value);
+  };
+
+  if (words.empty()) {
+    out << "error: empty request\n";
+  } else if (words[0] == "totals" && words.size() == 1) {
+    json_field("files", m_db.size());
+    json_field("comments", m_totals.com);
+    json_field("doc_comments", m_totals.dox);
+    json_field("blank", m_totals.blank);
+    json_field("code", m_totals.loc);
+    json_field("lines", m_totals.lines);
+    out << text << "}\n";
+  } else if (words[0] == "stats" && words.size() == 1) {
+    json_field("files", m_db.size());
+    json_field("directories", m_watches.size());
+    json_field("events", m_activity.events);
+    json_field("batches", m_activity.batches);
+    json_field("recounted", m_activity.recounted);
+    json_field("rescans", m_activity.rescans);
+    json_field("queries", m_activity.queries);
+    out << text << "}\n";
+  } else if (words[0] == "shutdown" && words.size() == 1) {
+    out << "ok\n";
+    m_stop = true;
+  } else if (words[0] == "files") {
+    std::vector<sorting_arg> keys;
+    bool ascending{ false };
+    std::size_t top{ 0 };
+    output_format_e format{ FORMAT_JSON };
+    std::string problem;
+    for (std::size_t i{ 1 }; i < words.size() && problem.empty(); ++i) {
+      const std::string& word = words[i];
+      if (word != "-s" && word != "-S" && word != "--top" && word != "--format") {
+        problem = "unknown option \"" + word + "\"";
+      } else if (i + 1 == words.size()) {
+        problem = "missing value after \"" + word + "\"";
+      } else if (word == "-s" || word == "-S") {
+        const std::string& value = words[++i];
+        ascending = word == "-s";
+        keys.clear();
+        for (std::size_t start{ 0 }; start <= value.size() && problem.empty();) {
+          std::size_t end = std::min(value.find(',', start), value.size());
+          auto key = sorters_with_their_keys.find(value.substr(start, end - start));
+          if (key == sorters_with_their_keys.end()) {
+            problem = "invalid sorter parameter: " + value;
+          } else {
+            keys.push_back(key->second);
+          }
+          start = end + 1;
+        }
+      } else if (word == "--top") {
+        const std::string& value = words[++i];
+        if (value.empty() || value.size() > 9 || value.find_first_not_of("0123456789") != std::string::npos) {
+          problem = "invalid number of files: " + value;
+        } else {
+          top = std::stoul(value);
+        }
+      } else {
+        auto known = output_formats_with_their_keys.find(words[++i]);
+        if (known == output_formats_with_their_keys.end() || known->second == FORMAT_TABLE) {
+          problem = "invalid output format: " + words[i] + " (json, csv or bin)";
+        } else {
+          format = known->second;
+        }
+      }
+    }
+
+    if (!problem.empty()) {
+      out << "error: " << problem << "\n";
+    } else {
+      if (top > 0 && keys.empty()) keys = { s }; //as --top alone on the command line
+      std::size_t n = top > 0 ? std::min(top, m_db.size()) : m_db.size();
+      std::vector<const FileInfo*> records;
+      records.reserve(n);
+      if (keys.empty()) {
+        for (std::size_t i{ 0 }; i < n; ++i) records.push_back(&m_db[i]);
+      } else {
+        const SortedView& sorted = view(keys, ascending);
+        for (std::size_t i{ 0 }; i < n; ++i) records.push_back(&m_db[sorted.order[i]]);
+      }
+      write_report(out, records, format);
+    }
+  } else {
+    out << "error: unknown request \"" << request << "\"\n";
+  }
+  out.flush();
+}
+
+/**
+ * @brief Follow the changes and answer queries, until asked to stop.
+ *
+ * One thread waits on both the inotify queue and the socket. Pending
+ * events are always applied before each query is answered, including
+ * between the queries of a burst, so an answer reflects every change made
+ * before its client connected. Stops on the `shutdown` request, SIGINT
+ * or SIGTERM.
+ */
+void CountDaemon::serve() {
+  if (!ok()) return;
+  struct sigaction action {};
+  action.sa_handler = request_stop;
+  ::sigemptyset(&action.sa_mask);
+  ::sigaction(SIGINT, &action, nullptr); //no SA_RESTART: poll() returns at once
+  ::sigaction(SIGTERM, &action, nullptr);
+
+  auto catch_up = [this] {
+    if (read_events()) {
+      apply_batch();
+    } else {
+      ++m_activity.rescans;
+      rebuild(nullptr);
+    }
+  };
+  while (!m_stop && g_stop_signal == 0 && ok()) {
+    pollfd fds[2]{ { m_listen_fd, POLLIN, 0 }, { m_inotify_fd, POLLIN, 0 } };
+    if (::poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    if (fds[1].revents & POLLIN) catch_up();
+    if (fds[0].revents & POLLIN) {
+      while (!m_stop) {
+        int client = ::accept4(m_listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) break;
+        catch_up(); //changes made while the previous client was answered
+        answer(client);
+        ::close(client);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Send a request to a daemon and print its answer.
+ *
+ * @param socket_path Socket of the daemon.
+ * @param request The request, without its newline.
+ * @param error Set when the daemon cannot be reached.
+ *
+ * The answer is copied to the standard output as it comes.
+ *
+ * @return false if the daemon could not be reached or answered with an
+ *         error (printed like any answer).
+ */
+bool query_daemon(const std::string& socket_path, const std::string& request, std::string& error) {
+  sockaddr_un address;
+  if (!socket_address(socket_path, address)) {
+    error = "the socket path \"" + socket_path + "\" is empty or too long";
+    return false;
+  }
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+    error = "unable to reach a daemon on \"" + socket_path + "\" (" + std::strerror(errno) + ")";
+    if (fd >= 0) ::close(fd);
+    return false;
+  }
+
+  std::string line = request + "\n";
+  send_all(fd, line.data(), line.size());
+  ::shutdown(fd, SHUT_WR);
+  char buffer[64 * 1024];
+  bool first{ true }, failed{ false };
+  while (true) {
+    ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    if (first) failed = std::string_view(buffer, static_cast<std::size_t>(n)).substr(0, 7) == "error: ";
+    first = false;
+    std::cout.write(buffer, n);
+  }
+  ::close(fd);
+  std::cout.flush();
+  return !failed;
+}
@@ -0,0 +1,195 @@
+#ifndef COUNT_DAEMON_HPP
+#define COUNT_DAEMON_HPP
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "main.hpp"
+#include "path_arena.hpp"
+#include "thread_pool.hpp"
+
+/*!
+ * @file count_daemon.hpp
+ * @description
+ * `--daemon SOCKET`: count the inputs once, keep the records in memory,
+ * follow the changes of the files with inotify, and answer queries on a
+ * Unix domain socket. `--query SOCKET REQUEST` is the matching client.
+ *
+ * A request is one line of words; the answer is the rest of the
+ * connection:
+ * - `totals`: the totals, as the `total` object of `--format json`.
+ * - `files [-s|-S KEYS] [--top K] [--format json|csv|bin]`: the records,
+ *   sorted as on the command line, in a `--format` layout (json by default).
+ * - `stats`: what the daemon watches and has done, as a JSON object.
+ * - `shutdown`: answers `ok` and stops the daemon.
+ * Anything else is answered by a line starting with `error: `.
+ */
+
+//== Classes
+
+/**
+ * @class CountDaemon
+ * @brief The records of a set of inputs, kept up to date and served over a socket.
+ *
+ * Every watched directory gets an inotify watch before the first count,
+ * so no change is missed while counting. Events are drained in batches,
+ * before any pending query: each file named by a batch is counted again
+ * (in parallel when there are many), and the totals move by the
+ * difference. New files are appended after the others. A queue overflow
+ * starts everything over.
+ *
+ * Sorted views are kept once asked for: a batch takes its files out of
+ * each view and merges them back in, instead of sorting everything again.
+ * A query thus costs the size of its answer.
+ *
+ * Files are known by the path they are displayed with, so a file reached
+ * through two different inputs is counted once, under its first name.
+ */
+class CountDaemon {
+public:
+  /**
+   * @brief Listen on a Unix domain socket.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  explicit CountDaemon(std::string socket_path);
+
+  /// @brief Stop listening and remove the socket.
+  ~CountDaemon();
+
+  CountDaemon(const CountDaemon&) = delete;
+  CountDaemon& operator=(const CountDaemon&) = delete;
+
+  /// @brief Whether the socket (and then the watches) could be set up; see error() otherwise.
+  bool ok() const { return m_error.empty(); }
+
+  /// @brief What went wrong, for a message after "Sorry, ".
+  const std::string& error() const { return m_error; }
+
+  /// @brief Number of files known.
+  std::size_t files() const { return m_db.size(); }
+
+  /**
+   * @brief Watch the inputs and count them.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  void start(const RunningOpt& run_options, ResultCache* cache, RunStats* stats);
+
+  /**
+   * @brief Follow the changes and answer queries, until asked to stop.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  void serve();
+
+private:
+  /// @brief A directory under watch.
+  struct WatchedDir {
+    std::string path;    //!< Path as displayed ("" for the current directory).
+    bool whole{ false }; //!< Whether all of its source files are inputs, or only the explicit ones.
+  };
+
+  /// @brief Records in a sort order, kept up to date.
+  struct SortedView {
+    std::vector<sorting_arg> keys;     //!< Sort keys, most significant first.
+    bool ascending{ false };           //!< Sort direction.
+    std::vector<std::uint32_t> order;  //!< Indexes into m_db, sorted.
+  };
+
+  /// @brief What the daemon has done, for the `stats` request.
+  struct Activity {
+    std::uint64_t events{ 0 };    //!< inotify events read.
+    std::uint64_t batches{ 0 };   //!< Batches of changes applied.
+    std::uint64_t recounted{ 0 }; //!< Files counted again.
+    std::uint64_t rescans{ 0 };   //!< Full rescans after a queue overflow.
+    std::uint64_t queries{ 0 };   //!< Requests answered.
+  };
+
+  /**
+   * @brief Watch a directory, and its sub-directories with `-r`.
+   * @param path Path of the directory, as displayed.
+   * @param whole Whether all of its source files are inputs.
+   * @param found If not null, receives the candidate files found (for a new directory).
+   */
+  void watch_tree(const std::string& path, bool whole, std::vector<std::string>* found);
+
+  /**
+   * @brief Set up every watch and count every input from scratch.
+   * @param stats If not null, receives the counters of the walk.
+   */
+  void rebuild(RunStats* stats);
+
+  /**
+   * @brief Read the pending inotify events into the batch.
+   * @return false if the queue overflowed.
+   */
+  bool read_events();
+
+  /**
+   * @brief Count the files of the batch again and update the records, totals and views.
+   */
+  void apply_batch();
+
+  /**
+   * @brief Add the files displayed under a directory to the batch.
+   * @param path Path of the directory, as displayed.
+   */
+  void queue_under(std::string_view path);
+
+  /**
+   * @brief Answer the request of one client.
+   * @param fd The connection.
+   */
+  void answer(int fd);
+
+  /**
+   * @brief The view of a sort order, sorting it on first use.
+   * @param keys Sort keys.
+   * @param ascending Sort direction.
+   * @return The view.
+   */
+  const SortedView& view(const std::vector<sorting_arg>& keys, bool ascending);
+
+  /// @brief Views kept at most; the oldest goes first.
+  static constexpr std::size_t MAX_VIEWS{ 8 };
+
+  /// @brief Bytes of a request at most.
+  static constexpr std::size_t MAX_REQUEST{ 4096 };
+
+  std::string m_socket_path;                                //!< Path of the socket.
+  int m_listen_fd{ -1 };                                    //!< Listening socket.
+  int m_inotify_fd{ -1 };                                   //!< inotify instance.
+  RunningOpt m_options;                                     //!< Inputs, `-r` and `-j`.
+  ResultCache* m_cache{ nullptr };                          //!< Counts of previous runs, or nullptr.
+  std::optional<ThreadPool> m_pool;                         //!< Workers counting big batches, with `-j`.
+  PathArena m_paths;                                        //!< Owns the file names of m_db.
+  std::vector<FileInfo> m_db;                               //!< Records, in order of appearance.
+  std::unordered_map<std::string_view, std::uint32_t> m_index; //!< Index in m_db of each path.
+  std::unordered_set<std::string_view> m_explicit;          //!< Files given explicitly (in m_paths).
+  std::unordered_map<int, WatchedDir> m_watches;            //!< Watched directories, by watch descriptor.
+  std::unordered_set<std::string> m_batch;                  //!< Paths changed since the last batch.
+  AttributeCount m_totals;                                  //!< Sums of the records.
+  std::vector<SortedView> m_views;                          //!< Sort orders asked for, oldest first.
+  Activity m_activity;                                      //!< Counters for the `stats` request.
+  bool m_stop{ false };                                     //!< Set by the `shutdown` request.
+  std::string m_error;                                      //!< Why setting up failed, empty on success.
+};
+
+//== Functions
+
+/**
+ * @brief Send a request to a daemon and print its answer.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see query_daemon()
+ */
+bool query_daemon(const std::string& socket_path, const std::string& request, std::string& error);
+
+#endif
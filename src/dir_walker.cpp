@@ -0,0 +1,547 @@
+/*!
+ * @file dir_walker.cpp
+ * @description
+ * Implementation of the concurrent directory traversal.
+ */
+
+#include "dir_walker.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+# include <sys/syscall.h>
+#endif
+
+#include "language_registry.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @brief Join a directory path and an entry name the way `fs::path::operator/` does.
+ *
+ * @param dir Directory path ("" for the current directory).
+ * @param name Entry name.
+ *
+ * @return The path of the entry, as the walker displays it.
+ */
+std::string join_path(std::string_view dir, std::string_view name) {
+  std::string path;
+  path.reserve(dir.size() + 1 + name.size());
+  path += dir;
+  if (!path.empty() && path.back() != '/') path += '/';
+  path += name;
+  return path;
+}
+
+namespace {
+
+/**
+ * @brief The last `size` characters of a path.
+ *
+ * The displayed path of a file is always the tail of its absolute path
+ * (the current directory, or nothing, joined in front of it), so it is
+ * taken from the interned copy instead of being stored again.
+ */
+std::string_view tail(std::string_view path, std::size_t size) {
+  return path.substr(path.size() - size);
+}
+
+/// @brief Kind of a directory entry, as far as the walk is concerned.
+enum entry_kind_e : std::uint8_t { EK_OTHER, EK_FILE, EK_DIR };
+
+/**
+ * @brief Classify an entry, calling fstatat only when d_type is not enough.
+ *
+ * @param dir_fd Descriptor of the directory holding the entry.
+ * @param name Entry name.
+ * @param d_type Type reported by the kernel.
+ * @param stat_calls Incremented for every fstatat call.
+ *
+ * Like `recursive_directory_iterator::is_regular_file()`, a symlink to a
+ * regular file is a file; a symlink to a directory is not descended into.
+ */
+entry_kind_e classify(int dir_fd, const char* name, unsigned char d_type, std::uint64_t& stat_calls) {
+  struct stat st {};
+  switch (d_type) {
+  case DT_REG: return EK_FILE;
+  case DT_DIR: return EK_DIR;
+  case DT_LNK:
+    ++stat_calls;
+    return ::fstatat(dir_fd, name, &st, 0) == 0 && S_ISREG(st.st_mode) ? EK_FILE : EK_OTHER;
+  case DT_UNKNOWN:
+    ++stat_calls;
+    if (::fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) return EK_OTHER;
+    if (S_ISREG(st.st_mode)) return EK_FILE;
+    if (S_ISDIR(st.st_mode)) return EK_DIR;
+    if (S_ISLNK(st.st_mode)) return classify(dir_fd, name, DT_LNK, stat_calls);
+    return EK_OTHER;
+  default: return EK_OTHER;
+  }
+}
+
+/**
+ * @brief Call a function for every entry of an open directory.
+ *
+ * @param fd Descriptor of the directory.
+ * @param visit Called with the name and d_type of each entry but "." and "..".
+ *
+ * Uses the raw `getdents64` system call on Linux (one call per 32 KiB of
+ * entries, no per-entry allocation) and `readdir` elsewhere.
+ */
+template <typename Visitor>
+void list_directory(int fd, Visitor&& visit) {
+  auto is_dot = [](const char* name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+  };
+
+#if defined(__linux__) && defined(SYS_getdents64)
+  struct linux_dirent64 { //fixed part of a record; the NUL-terminated name follows d_type
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+  };
+  constexpr std::size_t NAME_OFFSET{ offsetof(linux_dirent64, d_type) + 1 };
+  alignas(linux_dirent64) char buffer[32 * 1024];
+  while (true) {
+    long n = ::syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+    if (n <= 0) break;
+    for (long pos{ 0 }; pos < n;) {
+      auto* entry = reinterpret_cast<linux_dirent64*>(buffer + pos);
+      const char* name = buffer + pos + NAME_OFFSET;
+      if (!is_dot(name)) visit(name, entry->d_type);
+      pos += entry->d_reclen;
+    }
+  }
+#else
+  DIR* dir = ::fdopendir(::dup(fd));
+  if (dir == nullptr) return;
+  while (dirent* entry = ::readdir(dir)) {
+    if (!is_dot(entry->d_name)) visit(entry->d_name, entry->d_type);
+  }
+  ::closedir(dir);
+#endif
+}
+
+}  // namespace
+
+/**
+ * @brief Prepare a walk.
+ *
+ * @param pool Pool running the directory and counting tasks, or nullptr to walk sequentially.
+ * @param recursive Whether to descend into sub-directories.
+ * @param count Counting function for the files found, or nullptr to only collect them.
+ * @param paths Arena for the paths; it must outlive the records returned by files().
+ */
+DirectoryWalker::DirectoryWalker(ThreadPool* pool, bool recursive, count_fn count, PathArena& paths)
+    : m_pool{ pool }, m_recursive{ recursive }, m_count{ std::move(count) }, m_paths{ paths } {
+  char* cwd = ::getcwd(nullptr, 0);
+  if (cwd != nullptr) {
+    m_cwd = cwd;
+    std::free(cwd);
+  }
+}
+
+DirectoryWalker::~DirectoryWalker() = default;
+
+/**
+ * @brief Hand counted files to a sink instead of keeping them.
+ *
+ * @param sink Called with each file as soon as it is counted.
+ * @param dedupe Skip files already streamed; only needed when several
+ *               roots may overlap, since one walk never meets a path twice.
+ *
+ * Call it before adding files or directories. Memory then no longer grows
+ * with the number of files: directories are not remembered once listed,
+ * and each directory task counts its own files (its sub-directories are
+ * submitted first, so other workers walk them meanwhile). Only the arena
+ * of streamed paths grows, and only when deduplicating.
+ */
+void DirectoryWalker::stream_to(sink_fn sink, bool dedupe) {
+  m_sink = std::move(sink);
+  m_dedupe = dedupe;
+}
+
+/**
+ * @brief Register the files given explicitly, ahead of any directory.
+ *
+ * @param paths Paths of the files, as given.
+ * @param sizes Sizes of the files, if already known (e.g. from the git
+ *              index); otherwise each one is stat'ed.
+ *
+ * Explicit files are always listed, even when repeated, and hide later
+ * copies of themselves found while walking directories. Their counts are
+ * scheduled biggest first, so that a single huge file does not finish last.
+ */
+void DirectoryWalker::add_files(const std::vector<std::string>& paths, const std::vector<std::uint64_t>* sizes) {
+  if (m_sink) {
+    for (const auto& path : paths) {
+      if (m_dedupe) claim(path.front() == '/' ? path : join_path(m_cwd, path));
+      run([this, path] { emit(path); }); //explicit files are streamed even when repeated
+    }
+    return;
+  }
+
+  std::vector<std::pair<std::uint64_t, FileSlot*>> schedule;
+  for (std::size_t i{ 0 }; i < paths.size(); ++i) {
+    const std::string& path = paths[i];
+    InternedPath abs_path = m_paths.intern(path.front() == '/' ? path : join_path(m_cwd, path));
+    Entry entry;
+    entry.path = tail(abs_path.path, path.size());
+    auto [slot, created] = register_file(abs_path.id, entry.path);
+    entry.file = slot;
+    m_roots.push_back(std::move(entry));
+
+    if (created && sizes != nullptr) {
+      schedule.push_back({ (*sizes)[i], slot });
+    } else if (created) {
+      struct stat st {};
+      m_stat_calls.fetch_add(1, std::memory_order_relaxed);
+      std::uint64_t size = ::stat(path.c_str(), &st) == 0 ? static_cast<std::uint64_t>(st.st_size) : 0;
+      schedule.push_back({ size, slot });
+    }
+  }
+
+  std::stable_sort(schedule.begin(), schedule.end(), [](const auto& a, const auto& b) {
+    return a.first > b.first;
+  });
+  for (const auto& job : schedule) count_later(job.second, job.second->info.filename);
+}
+
+/**
+ * @brief Start walking a directory.
+ *
+ * @param path Path of the directory, as given.
+ *
+ * With a pool this returns at once; wait for the pool before calling files().
+ */
+void DirectoryWalker::add_directory(const std::string& path) {
+  if (m_sink) {
+    std::string abs_path = path.front() == '/' ? path : join_path(m_cwd, path);
+    run([this, path, abs_path] { stream_walk(path, abs_path); });
+    return;
+  }
+
+  Entry entry;
+  entry.subdir = std::make_unique<DirNode>();
+  entry.subdir->abs_path = m_paths.intern(path.front() == '/' ? path : join_path(m_cwd, path)).path;
+  entry.subdir->path = tail(entry.subdir->abs_path, path.size());
+  entry.path = entry.subdir->path;
+  DirNode* node = entry.subdir.get();
+  m_roots.push_back(std::move(entry));
+
+  run([this, node] { walk(node); });
+}
+
+/**
+ * @brief List one directory and schedule its files and sub-directories.
+ *
+ * @param node The directory.
+ *
+ * The listing is complete before any sub-directory is scheduled, so the
+ * entries vector never moves once another task may point into it.
+ * Directories that cannot be opened are skipped. Counters are kept locally
+ * and published once per directory. Paths are opened through the arena
+ * copies, which are NUL-terminated.
+ */
+void DirectoryWalker::walk(DirNode* node) {
+  TaskCounters& counters = local_counters();
+  std::uint64_t start = wall_clock_ns();
+  std::uint64_t count_start = counters.count_ns; //without a pool files are counted inline
+  int fd = ::openat(AT_FDCWD, node->path.data(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) return;
+
+  std::uint64_t entries{ 0 };
+  std::uint64_t stat_calls{ 0 };
+  list_directory(fd, [&](const char* name, unsigned char d_type) {
+    ++entries;
+    entry_kind_e kind = classify(fd, name, d_type, stat_calls);
+    bool is_file = kind == EK_FILE && is_candidate(name);
+    if (!is_file && !(kind == EK_DIR && m_recursive)) return;
+
+    InternedPath abs_path = m_paths.intern(join_path(node->abs_path, name));
+    Entry entry;
+    entry.path = tail(abs_path.path, abs_path.path.size() - (node->abs_path.size() - node->path.size()));
+    if (is_file) {
+      auto [slot, created] = register_file(abs_path.id, entry.path);
+      entry.file = slot;
+      if (created) count_later(slot, entry.path);
+    } else {
+      entry.subdir = std::make_unique<DirNode>();
+      entry.subdir->path = entry.path;
+      entry.subdir->abs_path = abs_path.path;
+    }
+    node->entries.push_back(std::move(entry));
+  });
+  ::close(fd);
+
+  m_directories.fetch_add(1, std::memory_order_relaxed);
+  m_entries.fetch_add(entries, std::memory_order_relaxed);
+  m_stat_calls.fetch_add(stat_calls, std::memory_order_relaxed);
+  counters.walk_ns += (wall_clock_ns() - start) - (counters.count_ns - count_start);
+
+  for (auto& entry : node->entries) {
+    if (entry.subdir) {
+      DirNode* sub = entry.subdir.get();
+      run([this, sub] { walk(sub); });
+    }
+  }
+}
+
+/**
+ * @brief List one directory in streaming mode and count its files.
+ *
+ * @param path Path of the directory, as displayed.
+ * @param abs_path Its absolute path.
+ *
+ * With a pool the sub-directories are submitted before the files are
+ * counted, so they are walked by other workers meanwhile. Without one,
+ * entries are handled in kernel order, which streams the files in the
+ * same order as the table.
+ */
+void DirectoryWalker::stream_walk(const std::string& path, const std::string& abs_path) {
+  TaskCounters& counters = local_counters();
+  std::uint64_t start = wall_clock_ns();
+  std::uint64_t count_start = counters.count_ns;
+  std::uint64_t walk_start = counters.walk_ns; //nested walks (no pool) account for themselves
+  int fd = ::openat(AT_FDCWD, path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) return;
+
+  std::vector<std::pair<std::string, entry_kind_e>> found;
+  std::uint64_t entries{ 0 };
+  std::uint64_t stat_calls{ 0 };
+  list_directory(fd, [&](const char* name, unsigned char d_type) {
+    ++entries;
+    entry_kind_e kind = classify(fd, name, d_type, stat_calls);
+    if ((kind == EK_FILE && is_candidate(name)) || (kind == EK_DIR && m_recursive)) {
+      found.emplace_back(name, kind);
+    }
+  });
+  ::close(fd);
+
+  m_directories.fetch_add(1, std::memory_order_relaxed);
+  m_entries.fetch_add(entries, std::memory_order_relaxed);
+  m_stat_calls.fetch_add(stat_calls, std::memory_order_relaxed);
+
+  if (m_pool != nullptr) {
+    for (const auto& [name, kind] : found) {
+      if (kind == EK_DIR) {
+        run([this, sub = join_path(path, name), sub_abs = join_path(abs_path, name)] { stream_walk(sub, sub_abs); });
+      }
+    }
+  }
+  for (const auto& [name, kind] : found) {
+    if (kind == EK_FILE) {
+      if (!m_dedupe || claim(join_path(abs_path, name))) emit(join_path(path, name));
+    } else if (m_pool == nullptr) {
+      stream_walk(join_path(path, name), join_path(abs_path, name));
+    }
+  }
+
+  std::uint64_t nested = (counters.count_ns - count_start) + (counters.walk_ns - walk_start);
+  counters.walk_ns += (wall_clock_ns() - start) - nested;
+}
+
+/**
+ * @brief Count a file and hand the result to the sink.
+ *
+ * @param path Path of the file, as displayed.
+ */
+void DirectoryWalker::emit(const std::string& path) {
+  std::uint64_t start = wall_clock_ns();
+  FileInfo info = m_count(path);
+  if (info.type != UNDEF) m_sink(info);
+  local_counters().count_ns += wall_clock_ns() - start;
+  (info.type != UNDEF ? m_emitted : m_rejected).fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Claim a file for streaming, unless it was already claimed.
+ *
+ * @param abs_path Absolute path of the file.
+ *
+ * @return true the first time a path is claimed.
+ */
+bool DirectoryWalker::claim(std::string_view abs_path) {
+  path_id id = m_paths.intern(abs_path).id;
+  std::lock_guard<std::mutex> lock(m_files_mtx);
+  return m_claimed.insert(id).second;
+}
+
+/**
+ * @brief Run a task on the pool, or right away without one.
+ *
+ * @param task The task.
+ */
+void DirectoryWalker::run(std::function<void()> task) {
+  if (m_pool != nullptr) {
+    m_pool->submit(std::move(task));
+  } else {
+    task();
+  }
+}
+
+/**
+ * @brief Get the slot of a file, creating it if new.
+ *
+ * @param id Interned absolute path, the de-duplication key.
+ * @param path Path as displayed, in the arena.
+ *
+ * @return The slot shared by every occurrence of the file, and whether
+ * this call created it (the caller then schedules its count).
+ */
+std::pair<DirectoryWalker::FileSlot*, bool> DirectoryWalker::register_file(path_id id, std::string_view path) {
+  std::lock_guard<std::mutex> lock(m_files_mtx);
+  auto [it, created] = m_by_path.try_emplace(id, nullptr);
+  if (created) {
+    it->second = &m_slots.emplace_back();
+    it->second->info.filename = path;
+  }
+  return { it->second, created };
+}
+
+/**
+ * @brief Schedule the count of a new file.
+ *
+ * @param slot Slot receiving the counts; only this task writes it.
+ * @param path Path the file is opened by, in the arena.
+ */
+void DirectoryWalker::count_later(FileSlot* slot, std::string_view path) {
+  if (m_count) {
+    run([this, slot, path] {
+      std::uint64_t start = wall_clock_ns();
+      slot->info = m_count(path);
+      if (slot->info.type == UNDEF) m_rejected.fetch_add(1, std::memory_order_relaxed);
+      local_counters().count_ns += wall_clock_ns() - start;
+    });
+  }
+}
+
+/**
+ * @brief Whether a directory entry is worth a FileSlot.
+ *
+ * @param name Entry name.
+ *
+ * Without a counting function the content is never read, so only files
+ * named after a language are taken.
+ *
+ * @return true for files that may be source code.
+ */
+bool DirectoryWalker::is_candidate(std::string_view name) const {
+  return m_count ? may_be_source(name) : has_supported_extension(name);
+}
+
+/**
+ * @brief Whether a counted file turned out not to be source code.
+ *
+ * @param slot The file.
+ *
+ * @return true if it was counted and its language is UNDEF.
+ */
+bool DirectoryWalker::rejected(const FileSlot& slot) const {
+  return m_count && slot.info.type == UNDEF;
+}
+
+/**
+ * @brief The files found, in sequential traversal order.
+ *
+ * Explicit files come first, then the files of each directory in the
+ * order they were added, depth first, each directory in kernel order: the
+ * order of the former sequential walk. A file appearing more than once is
+ * only kept the first time (explicit files excepted). Files whose content
+ * turned out not to be source code (UNDEF after counting) are left out.
+ *
+ * @return One FileInfo per file, counted if a counting function was given.
+ */
+std::vector<FileInfo> DirectoryWalker::files() {
+  std::vector<FileInfo> out;
+  std::unordered_set<const FileSlot*> emitted;
+
+  for (const auto& root : m_roots) {
+    if (root.file != nullptr) {
+      emitted.insert(root.file);
+      if (rejected(*root.file)) continue;
+      out.push_back(root.file->info);
+      out.back().filename = root.path;
+    }
+  }
+  for (const auto& root : m_roots) {
+    if (root.subdir) flatten(*root.subdir, out, emitted);
+  }
+  return out;
+}
+
+/**
+ * @brief Counters of the walk so far.
+ *
+ * Final once the pool has been waited for.
+ *
+ * @return Directories listed, entries read, stat calls made and unique source files found.
+ */
+WalkStats DirectoryWalker::stats() const {
+  WalkStats stats;
+  stats.directories = m_directories.load(std::memory_order_relaxed);
+  stats.entries = m_entries.load(std::memory_order_relaxed);
+  stats.stat_calls = m_stat_calls.load(std::memory_order_relaxed);
+  if (m_sink) {
+    stats.files = m_emitted.load(std::memory_order_relaxed);
+  } else {
+    std::lock_guard<std::mutex> lock(m_files_mtx);
+    stats.files = m_slots.size() - m_rejected.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+/**
+ * @brief Append the files of a directory, depth first, to the result.
+ *
+ * @param node The directory.
+ * @param out The result.
+ * @param emitted Files already in the result.
+ */
+void DirectoryWalker::flatten(const DirNode& node,
+                              std::vector<FileInfo>& out,
+                              std::unordered_set<const FileSlot*>& emitted) {
+  for (const auto& entry : node.entries) {
+    if (entry.file != nullptr) {
+      if (!emitted.insert(entry.file).second || rejected(*entry.file)) continue;
+      out.push_back(entry.file->info);
+      out.back().filename = entry.path;
+    } else if (entry.subdir) {
+      flatten(*entry.subdir, out, emitted);
+    }
+  }
+}
+
+/**
+ * @brief Whether a file name has one of the supported extensions.
+ *
+ * @param name File name (or path).
+ *
+ * @return true for the names of a registered language (see language_registry.hpp).
+ */
+bool has_supported_extension(std::string_view name) {
+  return language_by_file_name(name) != UNDEF;
+}
+
+/**
+ * @brief Whether a file may be source code, before looking at its content.
+ *
+ * @param name File name (or path).
+ *
+ * Files of a registered language, and files without an extension (like
+ * the libstdc++ headers or scripts), whose content decides; a leading dot
+ * does not start an extension.
+ *
+ * @return false for files with an extension of no registered language.
+ */
+bool may_be_source(std::string_view name) {
+  std::size_t slash = name.rfind('/');
+  std::string_view base = slash == std::string_view::npos ? name : name.substr(slash + 1);
+  return base.find('.', 1) == std::string_view::npos || has_supported_extension(base);
+}
@@ -0,0 +1,252 @@
+#ifndef DIR_WALKER_HPP
+#define DIR_WALKER_HPP
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "main.hpp"
+#include "path_arena.hpp"
+#include "run_stats.hpp"
+
+/*!
+ * @file dir_walker.hpp
+ * @description
+ * Concurrent directory traversal that hands files to the counting pool as
+ * soon as they are found, so walking and counting overlap.
+ */
+
+class ThreadPool;
+
+//== Classes
+
+/**
+ * @class DirectoryWalker
+ * @brief Finds the supported source files under a set of directories.
+ *
+ * Every directory is listed by its own pool task with `getdents64`, using
+ * `d_type` to tell files from directories without a stat call (only
+ * symlinks and file systems that do not fill `d_type` need `fstatat`).
+ * Each new file is immediately submitted for counting to the same pool.
+ *
+ * Directories are listed in whatever order the threads get to them, but
+ * each one remembers its entries in the order the kernel returned them, so
+ * files() rebuilds exactly the depth-first order of a sequential
+ * `recursive_directory_iterator`. Duplicates (the same absolute path found
+ * twice) are counted once, and only their first appearance in that order
+ * is kept.
+ *
+ * Paths live in a PathArena: the absolute path of each file and directory
+ * is interned once, and the path as displayed is a suffix of it, so the
+ * records returned by files() only hold views. Duplicates are found by
+ * the interned id.
+ *
+ * In streaming mode (see stream_to()) nothing is kept: each file is handed
+ * to a sink as soon as it is counted, in completion order.
+ *
+ * Files without an extension are taken too when there is a counting
+ * function: it sniffs their content, and those it leaves UNDEF are
+ * dropped from the results.
+ */
+class DirectoryWalker {
+public:
+  /// @brief How a file is turned into its FileInfo record.
+  using count_fn = std::function<FileInfo(std::string_view path)>;
+
+  /// @brief Where streamed records go (called from any thread; the file name is only valid during the call).
+  using sink_fn = std::function<void(const FileInfo& info)>;
+
+  /**
+   * @brief Prepare a walk.
+   * @param pool Pool running the directory and counting tasks, or nullptr to walk sequentially.
+   * @param recursive Whether to descend into sub-directories.
+   * @param count Counting function for the files found, or nullptr to only collect them.
+   * @param paths Arena for the paths; it must outlive the records returned by files().
+   */
+  DirectoryWalker(ThreadPool* pool, bool recursive, count_fn count, PathArena& paths);
+
+  ~DirectoryWalker();
+
+  DirectoryWalker(const DirectoryWalker&) = delete;
+  DirectoryWalker& operator=(const DirectoryWalker&) = delete;
+
+  /**
+   * @brief Hand counted files to a sink instead of keeping them.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  void stream_to(sink_fn sink, bool dedupe);
+
+  /**
+   * @brief Register the files given explicitly, ahead of any directory.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  void add_files(const std::vector<std::string>& paths, const std::vector<std::uint64_t>* sizes = nullptr);
+
+  /**
+   * @brief Start walking a directory.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  void add_directory(const std::string& path);
+
+  /**
+   * @brief The files found, in sequential traversal order.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  std::vector<FileInfo> files();
+
+  /**
+   * @brief Counters of the walk so far.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  WalkStats stats() const;
+
+private:
+  struct DirNode;
+
+  /// @brief Where a unique file and its counts live.
+  struct FileSlot {
+    FileInfo info; //!< Counts, filled by the counting task.
+  };
+
+  /// @brief One entry of a directory listing: a file or a sub-directory.
+  struct Entry {
+    std::string_view path;           //!< Path as displayed (parent path + name), in the arena.
+    FileSlot* file{ nullptr };       //!< The file, if the entry is a supported file.
+    std::unique_ptr<DirNode> subdir; //!< The sub-directory, if the entry is one being walked.
+  };
+
+  /// @brief A directory and its listing.
+  struct DirNode {
+    std::string_view path;      //!< Path as displayed, a suffix of abs_path.
+    std::string_view abs_path;  //!< Absolute path, in the arena.
+    std::vector<Entry> entries; //!< Entries in the order returned by the kernel.
+  };
+
+  /**
+   * @brief List one directory and schedule its files and sub-directories.
+   * @param node The directory.
+   */
+  void walk(DirNode* node);
+
+  /**
+   * @brief List one directory in streaming mode and count its files.
+   * @param path Path of the directory, as displayed.
+   * @param abs_path Its absolute path.
+   */
+  void stream_walk(const std::string& path, const std::string& abs_path);
+
+  /**
+   * @brief Count a file and hand the result to the sink.
+   * @param path Path of the file, as displayed.
+   */
+  void emit(const std::string& path);
+
+  /**
+   * @brief Claim a file for streaming, unless it was already claimed.
+   * @param abs_path Absolute path of the file.
+   * @return true the first time a path is claimed.
+   */
+  bool claim(std::string_view abs_path);
+
+  /**
+   * @brief Whether a directory entry is worth a FileSlot.
+   * @param name Entry name.
+   */
+  bool is_candidate(std::string_view name) const;
+
+  /**
+   * @brief Whether a counted file turned out not to be source code.
+   * @param slot The file.
+   */
+  bool rejected(const FileSlot& slot) const;
+
+  /**
+   * @brief Run a task on the pool, or right away without one.
+   * @param task The task.
+   */
+  void run(std::function<void()> task);
+
+  /**
+   * @brief Get the slot of a file, creating it if new.
+   * @param id Interned absolute path, the de-duplication key.
+   * @param path Path as displayed.
+   * @return The slot, and whether it was just created.
+   */
+  std::pair<FileSlot*, bool> register_file(path_id id, std::string_view path);
+
+  /**
+   * @brief Schedule the count of a new file.
+   * @param slot Slot receiving the counts.
+   * @param path Path the file is opened by.
+   */
+  void count_later(FileSlot* slot, std::string_view path);
+
+  /**
+   * @brief Append the files of a directory, depth first, to the result.
+   */
+  void flatten(const DirNode& node,
+               std::vector<FileInfo>& out,
+               std::unordered_set<const FileSlot*>& emitted);
+
+  ThreadPool* m_pool;                                      //!< Pool, or nullptr.
+  bool m_recursive;                                        //!< Descend into sub-directories.
+  count_fn m_count;                                        //!< Counting function, or nullptr.
+  PathArena& m_paths;                                      //!< Where the paths live.
+  std::string m_cwd;                                       //!< Current directory, to make paths absolute.
+  std::vector<Entry> m_roots;                              //!< Explicit files and root directories, in order.
+  mutable std::mutex m_files_mtx;                          //!< Guards m_slots, m_by_path and m_claimed.
+  std::deque<FileSlot> m_slots;                            //!< Unique files (stable addresses).
+  std::unordered_map<path_id, FileSlot*> m_by_path;        //!< Slots by interned absolute path.
+  std::atomic<std::uint64_t> m_directories{ 0 };           //!< Directories listed.
+  std::atomic<std::uint64_t> m_entries{ 0 };               //!< Directory entries read.
+  std::atomic<std::uint64_t> m_stat_calls{ 0 };            //!< stat/fstatat calls.
+  sink_fn m_sink;                                          //!< Sink of streaming mode, or nullptr.
+  bool m_dedupe{ true };                                   //!< Whether streaming checks for duplicates.
+  std::unordered_set<path_id> m_claimed;                   //!< Files streamed so far, when deduplicating.
+  std::atomic<std::uint64_t> m_emitted{ 0 };               //!< Files streamed so far.
+  std::atomic<std::uint64_t> m_rejected{ 0 };              //!< Files counted but found not to be source code.
+};
+
+//== Functions
+
+/**
+ * @brief Join a directory path and an entry name the way `fs::path::operator/` does.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see join_path()
+ */
+std::string join_path(std::string_view dir, std::string_view name);
+
+/**
+ * @brief Whether a file name has one of the supported extensions.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see has_supported_extension()
+ */
+bool has_supported_extension(std::string_view name);
+
+/**
+ * @brief Whether a file may be source code, before looking at its content.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see may_be_source()
+ */
+bool may_be_source(std::string_view name);
+
+#endif
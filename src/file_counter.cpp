@@ -0,0 +1,838 @@
+/*!
+ * @file file_counter.cpp
+ * @description
+ * The counting engine: the line classifier, the records of single files
+ * and the parallel walk over every input. Nothing here prints or exits;
+ * the command line front end is main.cpp.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+
+#include "main.hpp"
+#include "dir_walker.hpp"
+#include "file_reader.hpp"
+#include "git_repo.hpp"
+#include "language_registry.hpp"
+#include "language_sniffer.hpp"
+#include "lexer_table.hpp"
+#include "path_arena.hpp"
+#include "result_cache.hpp"
+#include "run_stats.hpp"
+#include "thread_pool.hpp"
+
+// alias
+namespace fs = std::filesystem;
+
+//== Counting
+
+/**
+ * @brief Trim whitespace from left of string.
+ * 
+ * @param s String to trim.
+ * @param t Characters to trim (default whitespace).
+ * 
+ * @return Left-trimmed view of the same characters (nothing is copied).
+ */
+inline std::string_view ltrim(std::string_view s, const char* t) {
+  size_t start = s.find_first_not_of(t); //finds the first character not in t, i.e. the first visible character
+
+  if (start == std::string_view::npos) { //if there is only space
+    return {};
+  }
+  return s.substr(start); //drop from the first character (which is a space) to the first visible character
+}
+
+/**
+ * @brief Trim whitespace from right of string.
+ * 
+ * @param s String to trim.
+ * @param t Characters to trim (default whitespace).
+ * 
+ * @return Right-trimmed view of the same characters (nothing is copied).
+ */
+inline std::string_view rtrim(std::string_view s, const char* t) {
+  size_t end = s.find_last_not_of(t); //finds the last character not in t, i.e. the last visible character
+
+  if (end == std::string_view::npos) {
+    return {};
+  }
+  return s.substr(0, end + 1); //drop everything after the last visible character
+}
+
+/**
+ * @brief Trim whitespace from both ends of string.
+ * 
+ * @param s String to trim.
+ * @param t Characters to trim (default whitespace).
+ * 
+ * @return Trimmed view of the same characters.
+ */
+inline std::string_view trim(std::string_view s, const char* t) {
+  return ltrim(rtrim(s, t), t);
+}
+
+/**
+ * @brief Check if a line ends with a backslash that continues it on the next line.
+ * 
+ * @param line Line to be analysed.
+ * @param from Index where the backslash may start.
+ * 
+ * As compilers do, spaces (and the '\r' of CRLF files) between the backslash
+ * and the end of the line are allowed.
+ * 
+ * @return true if the last character that is not ' ' or '\r' is a backslash at index from or after.
+ */
+bool continues_line(std::string_view line, size_t from){
+  size_t last = line.find_last_not_of(" \r");
+  return last != std::string_view::npos && last >= from && line[last] == '\\';
+}
+
+/**
+ * @brief Find where a character literal ends.
+ * 
+ * @param line Line to be analysed.
+ * @param i Index of the opening quote.
+ * 
+ * `''`, `'x'` and `'\...'` (up to the next quote, or the end of the line) are
+ * character literals. A quote followed by one character but not closed right
+ * after, as the digit separator of `1'000`, is code; that character is
+ * skipped along with the quote, and what follows is code again.
+ * 
+ * @return Index of the last character of the literal.
+ */
+size_t char_literal_end(std::string_view line, size_t i){
+  size_t len = line.length();
+  if (i + 1 >= len) return i;
+  if (line[i + 1] == '\\'){ //escape sequence, of any length
+    if (i + 2 >= len) return i + 1;
+    size_t close = line.find('\'', i + 3);
+    return close == std::string_view::npos ? len - 1 : close;
+  }
+  if (line[i + 1] != '\'' && i + 2 < len && line[i + 2] == '\''){
+    return i + 2;
+  }
+  return i + 1;
+}
+
+/**
+ * @brief Find where a raw string literal ends.
+ * 
+ * @param line Line to be analysed.
+ * @param from Index where the search starts.
+ * @param delimiter Delimiter of the raw string.
+ * 
+ * @return Index of the closing quote of `)delimiter"`, or npos if the string goes on after the line.
+ */
+size_t raw_literal_end(std::string_view line, size_t from, std::string_view delimiter){
+  for (size_t close = line.find(')', from); close != std::string_view::npos; close = line.find(')', close + 1)){
+    size_t quote = close + 1 + delimiter.size();
+    if (quote < line.size() && line[quote] == '"' && line.substr(close + 1, delimiter.size()) == delimiter){
+      return quote;
+    }
+  }
+  return std::string_view::npos;
+}
+
+/**
+ * @brief Update the counting state based on line content.
+ * 
+ * @param line Current line being processed (a view into the file content).
+ * @param ts Current state tracker.
+ * 
+ * Implements the state machine transitions based on line content. String
+ * literals end at an unescaped quote, or with the line unless a backslash
+ * continues them; raw strings `R"delim(...)delim"` end only at their own
+ * delimiter; `//` comments go on as long as their lines end with a backslash.
+ * 
+ * @return AttributeCount with counts for this line.
+ */
+AttributeCount updateState(std::string_view line, CurrentCount& ts){
+  AttributeCount atributes;
+  line = trim(line, " ");
+  size_t len = line.length();
+
+    //a line comment continued by a backslash takes the whole line
+    if (ts.current_state == ts.LINE_COMMENT || ts.current_state == ts.LINE_DOXY){
+      (ts.current_state == ts.LINE_DOXY ? atributes.dox : atributes.com) = 1;
+      if (!continues_line(line, 0)){
+        ts.current_state = ts.START;
+      }
+      return atributes;
+    }
+
+      //verify if line is blank
+      if (ts.current_state != ts.COMMENT && ts.current_state != ts.DOXY){
+      if (line.empty()) {
+        atributes.blank = 1;
+        if (ts.current_state == ts.LITERAL){ //nothing continues the literal: it ends here
+          ts.current_state = ts.START;
+        }
+        return atributes;
+      }
+
+    }//increment the current state starting a new line
+    if (ts.current_state == ts.COMMENT){
+      atributes.com = 1;
+    }
+    if (ts.current_state == ts.DOXY){
+      atributes.dox = 1;
+    }
+    if (ts.current_state == ts.LITERAL || ts.current_state == ts.RAW_LITERAL || ts.current_state == ts.CODE){
+      atributes.loc = 1;
+    }
+
+    bool continued {false};                    //a backslash continues the literal on the next line
+    size_t raw_prefix {std::string_view::npos}; //index of the last 'R' read as code
+
+    //scan all the chars of the line
+    for (size_t i{0}; i < len; ++i){
+      //the raw string goes on up to its own delimiter, whatever is in between
+      if (ts.current_state == ts.RAW_LITERAL){
+        size_t quote = raw_literal_end(line, i, ts.raw_delimiter);
+        if (quote == std::string_view::npos) break;
+        ts.current_state = ts.START;
+        ts.raw_delimiter.clear();
+        i = quote;
+        continue;
+      }
+
+      //jump straight to the next char that can change the state; whatever is
+      //skipped is plain text, which only matters as code outside comments/literals
+      size_t next = find_delimiter(line.data() + i, line.data() + len, SOURCE_DELIMITERS) - line.data();
+      if (next != i){
+        if (ts.current_state == ts.CODE || ts.current_state == ts.START){
+          ts.current_state = ts.CODE;
+          atributes.loc = 1;
+        }
+        i = next;
+        if (i == len) break;
+      }
+
+      auto minline3 = line.substr(i, 3);
+      auto minline2 = line.substr(i, 2);
+
+      //close the literal state, or skip what a backslash escapes
+    if (ts.current_state == ts.LITERAL){
+        if (line[i] == '"'){
+          ts.current_state = ts.START;
+        }
+        else if (line[i] == '\\'){
+          size_t after = line.find_first_not_of(" \r", i + 1);
+          if (after == std::string_view::npos){ //backslash-newline: the literal goes on
+            continued = true;
+            break;
+          }
+          //an escaped char is skipped; after an escaped space, the next one counts as usual
+          i = (after == i + 1) ? after : after - 1;
+        }
+        continue;
+      }
+
+      //close the comment or doxy states
+      if (ts.current_state == ts.DOXY || ts.current_state == ts.COMMENT){
+        if (minline2 == "*/"){
+          ts.current_state = ts.START;
+          i += 1;
+          continue;
+        }
+      }
+      
+      //verify if the program is in code state or literal state
+      if (ts.current_state == ts.CODE || ts.current_state == ts.START){
+
+        //start a raw string, whose delimiter (at most 16 chars) runs up to the '('
+        if (line[i] == '"' && raw_prefix != std::string_view::npos && raw_prefix + 1 == i){
+          size_t open = i + 1;
+          while (open < len && open - (i + 1) < RAW_DELIMITER_MAX && is_raw_delimiter_char(line[open])){
+            ++open;
+          }
+          atributes.loc = 1;
+          if (open < len && line[open] == '('){
+            ts.raw_delimiter.assign(line.substr(i + 1, open - (i + 1)));
+            ts.current_state = ts.RAW_LITERAL;
+            i = open;
+          }
+          else{ //no valid delimiter: an ordinary literal, read again from where the delimiter failed
+            ts.current_state = ts.LITERAL;
+            i = open - 1;
+          }
+          continue;
+        }
+        //start literal state
+        else if (line[i] == '"'){
+          ts.current_state = ts.LITERAL;
+          atributes.loc = 1;
+          continue;
+        }
+        //skip a character literal (or a digit separator)
+        else if (line[i] == '\''){
+          ts.current_state = ts.CODE;
+          atributes.loc = 1;
+          i = char_literal_end(line, i);
+          continue;
+        }
+        //start the doxy-comment state
+        else if (minline3 == "/*!" || minline3 == "/**"){
+          ts.current_state = ts.DOXY;
+          atributes.dox = 1;
+          i += 2;
+          continue;
+        } 
+        //count the line as single-line doxy-comment and stop scanning the line
+        else if (minline3 == "//!" || minline3 == "///"){
+          atributes.dox = 1; 
+          ts.current_state = continues_line(line, i + 2) ? ts.LINE_DOXY : ts.START;
+          break;
+        }
+        //start the comment state
+        else if (minline2 == "/*"){
+          ts.current_state = ts.COMMENT;
+          atributes.com = 1;
+          i += 1;
+          continue;
+        }
+        //count the line as single-line comment and stop scanning the line
+        else if (minline2 == "//"){
+          atributes.com = 1;
+          ts.current_state = continues_line(line, i + 2) ? ts.LINE_COMMENT : ts.START;
+          break;
+        }
+        //if none of the before cases happens, count one code line.
+        else{
+          if (line[i] == 'R'){
+            raw_prefix = i;
+          }
+          ts.current_state = ts.CODE;
+          atributes.loc = 1;
+        }
+      }
+    }
+    //if the line ended with a code state, set the state to start to scan the next line
+    if (ts.current_state == ts.CODE || (ts.current_state == ts.LITERAL && !continued)){
+      ts.current_state = ts.START;
+    }
+    //return the attributes of a line of the code.
+    return atributes;
+}
+
+/**
+ * @brief Count the lines of a buffer one line at a time with updateState().
+ * 
+ * @param buffer Whole content of a file.
+ * @param ts Current state.
+ * @param atr Accumulator for counts.
+ * 
+ * Lines are handed to updateState() as views into the buffer, so no line is
+ * ever copied. Like `std::getline`, a last line without a trailing newline
+ * still counts, and an empty remainder after the last newline does not.
+ * 
+ * This is the reference classifier: count_buffer() must always agree with it.
+ * 
+ * @return AttributeCount with updated counts.
+ */
+AttributeCount count_buffer_by_lines(std::string_view buffer, CurrentCount& ts, AttributeCount& atr){
+  const char* cursor = buffer.data();
+  const char* end = cursor + buffer.size();
+
+  while (cursor != end) {
+    const char* eol = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+    const char* line_end = eol ? eol : end;
+
+    //call updateState() for each line of the buffer.
+    AttributeCount atributes = updateState(std::string_view(cursor, line_end - cursor), ts);
+    atributes.lines = 1; //every line read counts towards the total, whatever its kind
+    atr += atributes;
+
+    cursor = eol ? eol + 1 : end;
+  }
+  //return the attributes of the entire buffer
+  return atr;
+}
+
+/**
+ * @brief Count the lines of a buffer through the state machine.
+ * 
+ * @param buffer Whole content of a file.
+ * @param ts Current state, updated to the state after the last line.
+ * @param atr Accumulator for counts.
+ * 
+ * Runs the table-driven lexer (see lexer_table.hpp) over the buffer, newlines
+ * included, with a single table lookup per byte. It gives the same counts as
+ * count_buffer_by_lines().
+ * 
+ * @return AttributeCount with updated counts.
+ */
+AttributeCount count_buffer(std::string_view buffer, CurrentCount& ts, AttributeCount& atr){
+  LexerCursor cursor = lexer_line_cursor(ts);
+
+  lexer_scan(buffer, cursor, atr);
+  lexer_finish(cursor, atr);
+
+  lexer_count_state(cursor, ts);
+  return atr;
+}
+
+/**
+ * @brief Process a file through the state machine.
+ * 
+ * @param filename File to process.
+ * @param ts Initial state.
+ * @param atr Accumulator for counts.
+ * 
+ * The file is read exactly once, memory-mapped when it is big enough (see
+ * FileBuffer), and the total number of lines is counted in the same loop
+ * that classifies them.
+ * 
+ * @return AttributeCount with updated counts.
+ */
+AttributeCount statesMachine(const std::string& filename, CurrentCount ts, AttributeCount& atr){
+  FileBuffer file(filename);
+  if (!file.ok()) return atr; //unreadable files count as empty
+
+  return count_buffer(file.view(), ts, atr);
+}
+
+/// @brief Files at least this big are split into chunks counted in parallel.
+constexpr size_t CHUNKED_FILE_THRESHOLD { 16 * 1024 * 1024 };
+/// @brief Smallest chunk a big file is split into.
+constexpr size_t MIN_CHUNK_SIZE { 4 * 1024 * 1024 };
+
+/**
+ * @brief Count the lines of a big buffer by chunks, in parallel.
+ * 
+ * @param buffer Whole content of a file.
+ * @param pool Pool that runs the chunks.
+ * @param atr Accumulator for counts.
+ * 
+ * The buffer is cut right after newlines into chunks of whole lines. Each
+ * chunk is lexed on its own for every state a line can start in (START,
+ * LITERAL, COMMENT, DOXY and their `//` counterparts), since the real one is
+ * not known until the previous chunks are done. The chunk summaries are then
+ * composed in order, each one picking the entry matching the state the
+ * previous one left, which gives exactly the counts of a sequential scan.
+ * A chunk that starts inside a raw string, whose delimiter could not be
+ * guessed, is lexed again from the actual state instead.
+ * 
+ * @return AttributeCount with updated counts.
+ */
+AttributeCount count_buffer_parallel(std::string_view buffer, ThreadPool& pool, AttributeCount& atr){
+  size_t n_chunks = std::max<size_t>(1, std::min(buffer.size() / MIN_CHUNK_SIZE, pool.size() * 2));
+  size_t step = buffer.size() / n_chunks;
+
+  //cut the buffer after the first newline following each nominal boundary
+  std::vector<std::string_view> chunks;
+  size_t begin {0};
+  while (begin < buffer.size()) {
+    size_t cut = begin + step;
+    if (chunks.size() + 1 >= n_chunks || cut >= buffer.size()) {
+      cut = buffer.size();
+    } else {
+      size_t eol = buffer.find('\n', cut);
+      cut = (eol == std::string_view::npos) ? buffer.size() : eol + 1;
+    }
+    chunks.push_back(buffer.substr(begin, cut - begin));
+    begin = cut;
+  }
+
+  std::vector<ChunkSummary> summaries(chunks.size());
+  std::atomic<size_t> remaining { chunks.size() };
+  for (size_t i{0}; i < chunks.size(); ++i) {
+    pool.submit([&chunks, &summaries, &remaining, i] {
+      lexer_scan_chunk(chunks[i], i + 1 == chunks.size(), i == 0, summaries[i]);
+      --remaining;
+    });
+  }
+  pool.run_until([&remaining] { return remaining == 0; }); //helps with the chunks instead of blocking a worker
+
+  //stitch the chunks together, following the actual state from one to the next
+  LexerCursor cursor;
+  for (size_t i{0}; i < chunks.size(); ++i) {
+    if (cursor.state < LX_N_LINE_STATES) {
+      atr += summaries[i].counts[cursor.state];
+      cursor = summaries[i].exit[cursor.state];
+    } else {
+      lexer_scan(chunks[i], cursor, atr);
+      if (i + 1 == chunks.size()) lexer_finish(cursor, atr);
+    }
+  }
+  return atr;
+}
+
+/**
+ * @brief Count the lines of a file content already in memory.
+ * 
+ * @param content Whole content of a file.
+ * @param pool Pool to split big contents over, or nullptr to count sequentially.
+ * 
+ * Contents of at least CHUNKED_FILE_THRESHOLD bytes are counted by chunks on
+ * the pool (see count_buffer_parallel()); the rest goes through the state
+ * machine in a single pass.
+ * 
+ * @return AttributeCount with all line counts.
+ */
+AttributeCount process_buffer(std::string_view content, ThreadPool* pool) {
+  AttributeCount atr;
+  CurrentCount ts;
+
+  if (pool != nullptr && pool->size() > 1 && content.size() >= CHUNKED_FILE_THRESHOLD) {
+    return count_buffer_parallel(content, *pool, atr);
+  }
+  return count_buffer(content, ts, atr);
+}
+
+/**
+ * @brief Process a file and count its lines.
+ * 
+ * @param filename Path to the file.
+ * @param pool Pool to split big files over, or nullptr to count sequentially.
+ * 
+ * @return AttributeCount with all line counts.
+ */
+AttributeCount process_file(const std::string& filename, ThreadPool* pool) {
+  AttributeCount atr;
+  CurrentCount ts;
+
+  if (pool == nullptr) {
+    statesMachine(filename, ts, atr); //single pass: lines, blank, loc, com and dox at once
+    return atr;
+  }
+
+  FileBuffer file(filename);
+  if (!file.ok()) return atr; //unreadable files count as empty
+  return process_buffer(file.view(), pool);
+}
+
+/**
+ * @brief Copy line counts into a FileInfo record.
+ * 
+ * @param info Record to fill.
+ * @param counts The counts.
+ */
+void set_counts(FileInfo& info, const AttributeCount& counts) {
+  info.n_lines = counts.lines;
+  info.n_blank = counts.blank;
+  info.n_comments = counts.com;
+  info.n_doc_comments = counts.dox;
+  info.n_loc = counts.loc;
+}
+
+/**
+ * @brief Build the FileInfo record of a single file.
+ * 
+ * @param filename Path to the file; the record keeps a view of it.
+ * @param pool Pool to split big files over, or nullptr.
+ * @param cache Counts of previous runs, or nullptr to count every file.
+ * @param map_files Whether big files may be mapped (see FileBuffer), or must be read.
+ * 
+ * With a cache, a file whose mtime and size match its cached entry is not
+ * opened at all (unless content verification is on, in which case it is
+ * read and hashed, but still not counted when the hash matches). Files that
+ * had to be counted are recorded in the cache for the next run.
+ * Files read, bytes read and cache hits go to the thread's TaskCounters.
+ * The language comes from the file name or, failing that, from the first
+ * SNIFF_BYTES of the content (see sniff_language()), and picks the scanner
+ * (see count_language()). Such files are opened for their head only, and
+ * the rest is read into the same buffer once they are known to be source
+ * code; those that are not keep the UNDEF type and no counts, and are
+ * cached as such so later runs do not read them again.
+ * 
+ * @return FileInfo with the language type and all line counts of the file.
+ */
+FileInfo make_file_info(std::string_view filename, ThreadPool* pool, ResultCache* cache, bool map_files) {
+  FileInfo current_file;
+  current_file.filename = filename;
+  std::string path{ filename }; //for the system calls
+  current_file.type = return_language_by_extension(path);
+  bool sniffed = current_file.type == UNDEF;
+
+  auto from_entry = [&current_file, sniffed](const CacheEntry& entry) {
+    if (sniffed) { //found from its content
+      current_file.type = entry.type;
+      current_file.confidence = entry.confidence;
+    }
+    current_file.n_lines = entry.n_lines;
+    current_file.n_blank = entry.n_blank;
+    current_file.n_comments = entry.n_comments;
+    current_file.n_doc_comments = entry.n_doc_comments;
+    current_file.n_loc = entry.n_loc;
+    ++local_counters().cache_hits;
+    return current_file;
+  };
+
+  std::error_code ec;
+  std::string key;
+  std::optional<FileStamp> stamp;
+  std::optional<CacheEntry> hit;
+  if (cache != nullptr) {
+    key = fs::absolute(path, ec).string();
+    stamp = file_stamp(path);
+    if (stamp && !ec) hit = cache->lookup(key, *stamp);
+    if (hit && !cache->verify()) return from_entry(*hit);
+  }
+
+  FileBuffer file(path, sniffed ? SNIFF_BYTES : 0, map_files);
+  if (!file.ok()) return current_file; //unreadable files count as empty, and are not cached
+  if (sniffed) {
+    LanguageGuess guess = sniff_language(file.view());
+    current_file.type = guess.type;
+    current_file.confidence = guess.confidence;
+    if (current_file.type != UNDEF && !file.load_rest()) return current_file;
+  }
+  TaskCounters& counters = local_counters();
+  ++counters.files_read;
+  counters.bytes_read += file.view().size();
+
+  CacheEntry entry;
+  if (cache != nullptr && cache->verify()) entry.content_hash = content_hash(file.view());
+  if (hit && hit->content_hash == entry.content_hash) return from_entry(*hit);
+
+  AttributeCount result;
+  if (current_file.type != UNDEF) result = count_language(current_file.type, file.view(), pool);
+  set_counts(current_file, result);
+
+  if (cache != nullptr && stamp && !ec) {
+    entry.stamp = *stamp;
+    entry.type = current_file.type;
+    entry.confidence = current_file.confidence;
+    entry.n_lines = result.lines;
+    entry.n_blank = result.blank;
+    entry.n_comments = result.com;
+    entry.n_doc_comments = result.dox;
+    entry.n_loc = result.loc;
+    cache->store(key, entry);
+  }
+  return current_file;
+}
+
+/**
+ * @brief Build the FileInfo record of a file whose content is already in memory.
+ * 
+ * @param filename Path of the file; the record keeps a view of it.
+ * @param content The content of the file (e.g. a git blob).
+ * @param pool Pool to split big contents over, or nullptr.
+ * 
+ * Same language detection and counting as make_file_info(), without
+ * opening anything and without the cache.
+ * 
+ * @return FileInfo with the language type and all line counts of the content.
+ */
+FileInfo make_blob_info(std::string_view filename, std::string_view content, ThreadPool* pool) {
+  FileInfo current_file;
+  current_file.filename = filename;
+  current_file.type = language_by_file_name(filename);
+  if (current_file.type == UNDEF) {
+    LanguageGuess guess = sniff_language(content.substr(0, SNIFF_BYTES));
+    current_file.type = guess.type;
+    current_file.confidence = guess.confidence;
+  }
+  TaskCounters& counters = local_counters();
+  ++counters.files_read;
+  counters.bytes_read += content.size();
+  if (current_file.type != UNDEF) set_counts(current_file, count_language(current_file.type, content, pool));
+  return current_file;
+}
+
+/**
+ * @brief Find and count every input file, possibly in parallel.
+ * 
+ * @param run_options Runtime options with the input files, directories and number of jobs.
+ * @param paths Arena holding the paths of the files; it must outlive the result.
+ * @param cache Counts of previous runs, or nullptr to count every file.
+ * @param stats If not null, receives the walk counters and the activity of the pool workers.
+ * @param git With `--git`, the tracked files to count instead of the inputs.
+ * 
+ * Directories are walked by a DirectoryWalker that hands each file it
+ * finds to the counting function right away. With more than one job the
+ * walk and the counts share one work-stealing pool, so counting starts
+ * with the first file found instead of after the whole tree was listed;
+ * really big files are further split into chunks on the same pool.
+ * The result is put back in the order of a sequential walk, so it does not
+ * depend on which thread listed or counted what.
+ * 
+ * @return One FileInfo per file: the explicit files first, then the files of each directory.
+ */
+std::vector<FileInfo> process_files(const RunningOpt& run_options, PathArena& paths, ResultCache* cache, RunStats* stats, const GitSnapshot* git) {
+  std::uint64_t start = wall_clock_ns();
+  std::optional<ThreadPool> pool;
+  if (run_options.jobs > 1) pool.emplace(run_options.jobs);
+  ThreadPool* pool_ptr = pool ? &*pool : nullptr;
+
+  bool map_files = run_options.map_files;
+  DirectoryWalker walker(pool_ptr, run_options.recursive, [pool_ptr, cache, git, map_files](std::string_view filename) {
+    return git != nullptr ? git->count(filename, pool_ptr, cache) : make_file_info(filename, pool_ptr, cache, map_files);
+  }, paths);
+  if (git != nullptr) {
+    walker.add_files(git->paths(), &git->sizes());
+  } else {
+    walker.add_files(run_options.input_list);
+    for (const auto& directory : run_options.directory_list) walker.add_directory(directory);
+  }
+  if (pool) pool->wait();
+
+  if (stats != nullptr) {
+    stats->walk = walker.stats();
+    if (git != nullptr) stats->walk.entries = git->entries();
+    if (pool) stats->workers = pool->worker_stats();
+    stats->pool_wall_ns = wall_clock_ns() - start;
+    stats->paths = paths.size();
+    stats->path_bytes = paths.bytes();
+  }
+  return walker.files();
+}
+
+/**
+ * @brief Find and count every input file, handing each result over as it comes.
+ * 
+ * @param run_options Runtime options with the input files, directories and number of jobs.
+ * @param cache Counts of previous runs, or nullptr to count every file.
+ * @param sink Receives each record (from any thread); e.g. RecordStream::write() or TopRecords::offer().
+ * @param stats If not null, receives the walk counters and the activity of the pool workers.
+ * @param git With `--git`, the tracked files to count instead of the inputs.
+ * 
+ * Same walk and counting as process_files(), but nothing is kept: each
+ * file goes to `sink` when its count is done, so with `-j` records
+ * come in completion order. Duplicates are only looked for when several
+ * inputs were given, since a single directory never yields a path twice;
+ * only then are paths interned, to remember which files were streamed.
+ * The file name of a record is only valid during the call to `sink`.
+ */
+void stream_files(const RunningOpt& run_options, ResultCache* cache, const std::function<void(const FileInfo&)>& sink, RunStats* stats, const GitSnapshot* git) {
+  std::uint64_t start = wall_clock_ns();
+  std::optional<ThreadPool> pool;
+  if (run_options.jobs > 1) pool.emplace(run_options.jobs);
+  ThreadPool* pool_ptr = pool ? &*pool : nullptr;
+
+  PathArena paths;
+  bool map_files = run_options.map_files;
+  DirectoryWalker walker(pool_ptr, run_options.recursive, [pool_ptr, cache, git, map_files](std::string_view filename) {
+    return git != nullptr ? git->count(filename, pool_ptr, cache) : make_file_info(filename, pool_ptr, cache, map_files);
+  }, paths);
+  if (git != nullptr) { //already listed once each
+    walker.stream_to(sink, false);
+    walker.add_files(git->paths(), &git->sizes());
+  } else {
+    walker.stream_to(sink, run_options.input_list.size() + run_options.directory_list.size() > 1);
+    walker.add_files(run_options.input_list);
+    for (const auto& directory : run_options.directory_list) walker.add_directory(directory);
+  }
+  if (pool) pool->wait();
+
+  if (stats != nullptr) {
+    stats->walk = walker.stats();
+    if (git != nullptr) stats->walk.entries = git->entries();
+    if (pool) stats->workers = pool->worker_stats();
+    stats->pool_wall_ns = wall_clock_ns() - start;
+    stats->paths = paths.size();
+    stats->path_bytes = paths.bytes();
+  }
+}
+
+//== Records
+
+/**
+ * @brief Compare two files for sorting.
+ * 
+ * @param firstFile First file to compare.
+ * @param secondFile Second file to compare.
+ * @param sort_field Field to compare by.
+ * @param sort_ascending Sort direction.
+ * 
+ * @return true if firstFile should come before secondFile.
+ */
+bool compare_files(const FileInfo& firstFile, const FileInfo& secondFile, std::optional<sorting_arg> sort_field, bool sort_ascending) {
+
+  switch (sort_field.value()) { //gets the value in sort_field, e.g., t, f, etc...
+    case f: //case sort by filename
+      // If ascending: compare if the first filename is less than the second (by ASCII, because filename is a std::string)
+      // If descending: compare if the first filename is greater than the second
+      return sort_ascending ? (firstFile.filename < secondFile.filename) : (firstFile.filename > secondFile.filename);
+    case t: //case sort by filetype
+      return sort_ascending ? (firstFile.type < secondFile.type) : (firstFile.type > secondFile.type);
+    case c: //case sort by number of comments
+      return sort_ascending ? (firstFile.n_comments < secondFile.n_comments) : (firstFile.n_comments > secondFile.n_comments);
+    case d: //case sort by documentation comments
+      return sort_ascending ? (firstFile.n_doc_comments < secondFile.n_doc_comments) : (firstFile.n_doc_comments > secondFile.n_doc_comments);
+    case b: //case sort by number of blank lines
+      return sort_ascending ? (firstFile.n_blank < secondFile.n_blank) : (firstFile.n_blank > secondFile.n_blank);
+    case s: //case sort by sloc
+      return sort_ascending ? (firstFile.n_loc < secondFile.n_loc) : (firstFile.n_loc > secondFile.n_loc);
+    case a: //case sort by number of total lines
+      return sort_ascending ? (firstFile.n_lines < secondFile.n_lines) : (firstFile.n_lines > secondFile.n_lines);
+    default:
+      return false;
+  }
+}
+
+/**
+ * @brief Compare two files by a list of fields.
+ * 
+ * @param firstFile First file to compare.
+ * @param secondFile Second file to compare.
+ * @param sort_fields Fields to compare by, most significant first.
+ * @param sort_ascending Sort direction.
+ * 
+ * @return true if firstFile should come before secondFile: the first field
+ *         on which they differ decides.
+ */
+bool compare_files(const FileInfo& firstFile, const FileInfo& secondFile, const std::vector<sorting_arg>& sort_fields, bool sort_ascending) {
+  for (sorting_arg field : sort_fields) {
+    if (compare_files(firstFile, secondFile, field, sort_ascending)) return true;
+    if (compare_files(secondFile, firstFile, field, sort_ascending)) return false;
+  }
+  return false;
+}
+
+/**
+ * @brief Convert language enum to string.
+ * 
+ * @param lang_type The language type to convert.
+ * 
+ * @return String representation of the language type.
+ * 
+ * @retval "C" for C language
+ * @retval "C++" for C++ language
+ * @retval "C/C++ header" for C/C++ header files
+ * @retval "C++ header" for C++ header files
+ * @retval "Python", "Rust", "Go", "Java", "Shell" or "CMake" for the other languages
+ * @retval "Undefined type" for unknown/unsupported types
+ * 
+ * @see lang_type_e
+ */
+std::string language_to_string (lang_type_e lang_type) {
+  return std::string(language_name(lang_type));
+}
+
+/**
+ * @brief Name of a language, without building a string.
+ * 
+ * @param lang_type The language type.
+ * 
+ * @return The same text as language_to_string(), pointing to static storage.
+ */
+std::string_view language_name (lang_type_e lang_type) {
+  return language_info(lang_type).name;
+}
+
+/**
+ * @brief Determine language by file extension.
+ * 
+ * @param filename The name/path of the file to analyze.
+ * 
+ * @return The corresponding language type enum value.
+ * @retval C for .c files
+ * @retval CPP for .cpp files
+ * @retval H for .h files
+ * @retval HPP for .hpp files
+ * @retval PYTHON, RUST, GO, JAVA, SHELL or CMAKE for their extensions (and CMakeLists.txt)
+ * @retval UNDEF for unsupported extensions
+ * 
+ * @note Only checks the file name, not the actual content.
+ * 
+ * @see language_by_file_name()
+ */
+lang_type_e return_language_by_extension (const std::string& filename) {
+  return language_by_file_name(filename);
+}
@@ -0,0 +1,123 @@
+/*!
+ * @file file_reader.cpp
+ * @description
+ * Implementation of FileBuffer, the mmap/read() backed file loader.
+ */
+
+#include "file_reader.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Open and load (or map) a file, or only its head.
+ *
+ * @param filename Path to the file.
+ * @param head_bytes If not 0, read at most that many bytes for now; see
+ *        load_rest(). Mapped files are always mapped whole (their pages
+ *        are only read once touched).
+ * @param allow_map Whether big files may be mapped. A mapped file that is
+ *        truncated while its pages are read raises SIGBUS, so files that
+ *        may be written meanwhile are better read.
+ *
+ * Regular files of at least MMAP_THRESHOLD bytes are mapped read-only; the
+ * rest (small files, pipes, character devices, or a failed mmap) falls back
+ * to a buffered read. ok() tells whether the content is available.
+ */
+FileBuffer::FileBuffer(const std::string& filename, std::size_t head_bytes, bool allow_map) {
+  int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return;
+
+  struct stat st {};
+  bool is_regular = ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+  std::size_t size = is_regular ? static_cast<std::size_t>(st.st_size) : 0;
+
+  if (allow_map && is_regular && size >= MMAP_THRESHOLD) {
+    void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      if (size >= SEQUENTIAL_HINT_THRESHOLD) {
+        ::madvise(addr, size, MADV_SEQUENTIAL); //it is just a hint, failure is harmless
+      }
+      m_map = addr;
+      m_map_size = size;
+      m_view = std::string_view(static_cast<const char*>(addr), size);
+      m_ok = true;
+      ::close(fd);
+      return;
+    }
+  }
+
+  m_ok = read_all(fd, size, head_bytes > 0 ? head_bytes : SIZE_MAX);
+  if (m_ok && !m_eof) { //only the head was read: keep the file open for load_rest()
+    m_fd = fd;
+    m_size_hint = size;
+    return;
+  }
+  ::close(fd);
+}
+
+/**
+ * @brief Unmap or release the content.
+ */
+FileBuffer::~FileBuffer() {
+  if (m_map != nullptr) ::munmap(m_map, m_map_size);
+  if (m_fd >= 0) ::close(m_fd);
+}
+
+/**
+ * @brief Read the rest of a file opened for its head.
+ *
+ * The rest is appended to the head in the same buffer. Does nothing if the
+ * whole file is already loaded.
+ *
+ * @return ok(), updated: false if the rest could not be read.
+ */
+bool FileBuffer::load_rest() {
+  if (m_fd < 0) return m_ok;
+  m_ok = read_all(m_fd, m_size_hint);
+  ::close(m_fd);
+  m_fd = -1;
+  return m_ok;
+}
+
+/**
+ * @brief Read from a descriptor into the owned buffer, after what it already holds.
+ *
+ * @param fd Open file descriptor.
+ * @param size_hint Expected size, used to reserve memory (0 if unknown).
+ * @param limit Stop once the buffer holds that many bytes.
+ *
+ * Keeps reading until end of file (or `limit`), so it also works for
+ * pipes, whose size is not known in advance. m_eof tells which came first.
+ *
+ * @return true on success.
+ */
+bool FileBuffer::read_all(int fd, std::size_t size_hint, std::size_t limit) {
+  constexpr std::size_t CHUNK{ 64 * 1024 };
+  std::size_t used = m_view.size(); //the head, when called by load_rest()
+  std::size_t capacity = size_hint + 1 > CHUNK ? size_hint + 1 : CHUNK; //+1 so a regular file ends in one extra (empty) read
+  if (capacity > limit) capacity = limit;
+  if (m_data.size() < capacity) m_data.resize(capacity);
+  m_eof = false;
+
+  while (used < limit) {
+    if (used == m_data.size()) m_data.resize(m_data.size() * 2 < limit ? m_data.size() * 2 : limit);
+    ssize_t n = ::read(fd, m_data.data() + used, m_data.size() - used);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    if (n == 0) {
+      m_eof = true;
+      break;
+    }
+    used += static_cast<std::size_t>(n);
+  }
+
+  if (m_eof) m_data.resize(used);
+  m_view = std::string_view(m_data.data(), used);
+  return true;
+}
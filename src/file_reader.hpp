@@ -0,0 +1,88 @@
+#ifndef FILE_READER_HPP
+#define FILE_READER_HPP
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*!
+ * @file file_reader.hpp
+ * @description
+ * Read-only access to the whole content of a file, without copying it line by line.
+ */
+
+//== Classes
+
+/**
+ * @class FileBuffer
+ * @brief Holds the entire content of a file in memory.
+ *
+ * Big regular files are memory-mapped, so the counting code reads straight
+ * from the page cache. Small files, pipes and anything that cannot be mapped
+ * are read with plain `read()` calls into an owned buffer instead.
+ *
+ * A file can also be opened for its head only (to look at its content
+ * before deciding whether to count it): load_rest() then reads the rest
+ * into the same buffer, so the head is never read twice.
+ */
+class FileBuffer {
+public:
+  /// @brief Files smaller than this are read instead of mapped.
+  static constexpr std::size_t MMAP_THRESHOLD{ 64 * 1024 };
+  /// @brief Mapped files at least this big get a sequential-access hint.
+  static constexpr std::size_t SEQUENTIAL_HINT_THRESHOLD{ 1024 * 1024 };
+
+  /**
+   * @brief Open and load (or map) a file, or only its head.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  explicit FileBuffer(const std::string& filename, std::size_t head_bytes = 0, bool allow_map = true);
+
+  /// @brief Unmap or release the content.
+  ~FileBuffer();
+
+  FileBuffer(const FileBuffer&) = delete;
+  FileBuffer& operator=(const FileBuffer&) = delete;
+
+  /// @brief Whether the file could be opened and read.
+  bool ok() const { return m_ok; }
+
+  /// @brief Whether the content is memory-mapped (as opposed to copied).
+  bool mapped() const { return m_map != nullptr; }
+
+  /// @brief Whether view() is the whole file (and not just its head).
+  bool complete() const { return m_fd < 0; }
+
+  /// @brief The content of the file (or its head, until load_rest()).
+  std::string_view view() const { return m_view; }
+
+  /**
+   * @brief Read the rest of a file opened for its head.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  bool load_rest();
+
+private:
+  /**
+   * @brief Read from a descriptor into the owned buffer, after what it already holds.
+   * @param fd Open file descriptor.
+   * @param size_hint Expected size, used to reserve memory (0 if unknown).
+   * @param limit Stop once the buffer holds that many bytes.
+   * @return true on success.
+   */
+  bool read_all(int fd, std::size_t size_hint, std::size_t limit = SIZE_MAX);
+
+  bool m_ok{ false };           //!< Content is valid.
+  void* m_map{ nullptr };       //!< Mapped region, if any.
+  std::size_t m_map_size{ 0 };  //!< Size of the mapped region.
+  std::vector<char> m_data;     //!< Owned content when not mapped.
+  std::string_view m_view;      //!< View over the content, mapped or owned.
+  int m_fd{ -1 };               //!< Descriptor kept open while only the head is loaded.
+  std::size_t m_size_hint{ 0 }; //!< Size of the file, for load_rest().
+  bool m_eof{ false };          //!< The last read_all() reached the end of the file.
+};
+
+#endif
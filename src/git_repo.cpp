@@ -0,0 +1,1041 @@
+/*!
+ * @file git_repo.cpp
+ * @description
+ * Implementation of the git repository reader and of `--git` file selection.
+ *
+ * Only the on-disk formats are used, as documented by git
+ * (Documentation/gitformat-index.txt and gitformat-pack.txt):
+ *
+ * - the index, versions 2 to 4 (entries only; extensions are not needed);
+ * - loose objects, zlib-compressed `<type> <size>\0<content>`;
+ * - packfile indexes, version 2, and packfiles with offset and reference
+ *   deltas;
+ * - loose and packed refs.
+ *
+ * Only SHA-1 repositories are supported.
+ */
+
+#include "git_repo.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_set>
+#include <zlib.h>
+
+#include "dir_walker.hpp"
+#include "file_reader.hpp"
+#include "language_registry.hpp"
+
+namespace {
+
+constexpr int MAX_DELTA_DEPTH{ 10000 };  //!< Longest delta chain followed (git itself stops at 4095).
+constexpr int MAX_REF_DEPTH{ 10 };       //!< Longest chain of symbolic refs followed.
+constexpr int MAX_TREE_DEPTH{ 4096 };    //!< Deepest directory nesting followed.
+constexpr std::uint32_t IDX_MAGIC{ 0xff744f63 }; //!< "\377tOc", start of a version 2 pack index.
+constexpr std::size_t IDX_HEADER{ 8 + 256 * 4 }; //!< Magic, version and fan-out table.
+constexpr unsigned PACK_OFS_DELTA{ 6 };  //!< Pack entry type of a delta against an earlier offset.
+constexpr unsigned PACK_REF_DELTA{ 7 };  //!< Pack entry type of a delta against an object id.
+constexpr std::uint32_t MODE_TYPE{ 0170000 };    //!< File type bits of a git mode.
+constexpr std::uint32_t MODE_FILE{ 0100000 };    //!< Regular file (executable or not).
+constexpr std::uint32_t MODE_TREE{ 0040000 };    //!< Directory.
+
+/// @brief Big-endian 16-bit integer.
+std::uint32_t be16(const unsigned char* p) { return (std::uint32_t{ p[0] } << 8) | p[1]; }
+
+/// @brief Big-endian 32-bit integer.
+std::uint32_t be32(const unsigned char* p) {
+  return (std::uint32_t{ p[0] } << 24) | (std::uint32_t{ p[1] } << 16) | (std::uint32_t{ p[2] } << 8) | p[3];
+}
+
+/// @brief Big-endian 64-bit integer.
+std::uint64_t be64(const unsigned char* p) { return (std::uint64_t{ be32(p) } << 32) | be32(p + 4); }
+
+/// @brief Value of a lower-case hex digit, or -1.
+int hex_value(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+/**
+ * @brief Parse a full 40-digit hex object name.
+ */
+bool parse_hex(std::string_view hex, ObjectId& out) {
+  if (hex.size() < 40) return false;
+  for (std::size_t i{ 0 }; i < 20; ++i) {
+    int hi = hex_value(hex[2 * i]);
+    int lo = hex_value(hex[2 * i + 1]);
+    if (hi < 0 || lo < 0) return false;
+    out.bytes[i] = static_cast<std::uint8_t>(hi << 4 | lo);
+  }
+  return true;
+}
+
+/**
+ * @brief The 40-digit hex name of an object.
+ */
+std::string to_hex(const ObjectId& id) {
+  static constexpr char DIGITS[] = "0123456789abcdef";
+  std::string hex(40, '0');
+  for (std::size_t i{ 0 }; i < 20; ++i) {
+    hex[2 * i] = DIGITS[id.bytes[i] >> 4];
+    hex[2 * i + 1] = DIGITS[id.bytes[i] & 15];
+  }
+  return hex;
+}
+
+/**
+ * @brief Whether the hex name of an object starts with a (possibly odd-length) prefix.
+ */
+bool has_hex_prefix(const unsigned char* id, std::string_view prefix) {
+  for (std::size_t i{ 0 }; i < prefix.size(); ++i) {
+    int nibble = i % 2 == 0 ? id[i / 2] >> 4 : id[i / 2] & 15;
+    if (nibble != hex_value(prefix[i])) return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Absolute path with symlinks resolved, or an empty string if it does not exist.
+ */
+std::string real_path(const std::string& path) {
+  char* resolved = ::realpath(path.c_str(), nullptr);
+  if (resolved == nullptr) return {};
+  std::string out{ resolved };
+  std::free(resolved);
+  return out;
+}
+
+/**
+ * @brief A path relative to a directory, made absolute.
+ */
+std::string resolve_path(const std::string& dir, std::string_view path) {
+  if (!path.empty() && path.front() == '/') return std::string{ path };
+  return dir + "/" + std::string{ path };
+}
+
+/**
+ * @brief Read a whole (small) file.
+ */
+bool read_file(const std::string& path, std::string& out) {
+  FileBuffer file(path);
+  if (!file.ok()) return false;
+  out.assign(file.view());
+  return true;
+}
+
+/**
+ * @brief The first line of a text, without its end of line and trailing blanks.
+ */
+std::string_view first_line(std::string_view text) {
+  text = text.substr(0, text.find('\n'));
+  while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) text.remove_suffix(1);
+  return text;
+}
+
+/**
+ * @brief Whether a path lies below a directory (both relative to the work tree).
+ *
+ * The top directory, "", holds every path.
+ */
+bool is_inside(std::string_view path, std::string_view dir) {
+  return dir.empty() || (path.size() > dir.size() && path.compare(0, dir.size(), dir) == 0 && path[dir.size()] == '/');
+}
+
+/**
+ * @brief Inflate a zlib stream.
+ *
+ * @param in Compressed bytes; the stream may end before them.
+ * @param in_size Number of bytes available.
+ * @param size Size of the result if `exact`, else a first guess.
+ * @param exact Whether the result must be exactly `size` bytes.
+ * @param out The inflated bytes.
+ *
+ * @return true if the stream was complete and, if `exact`, of the right size.
+ */
+bool inflate_data(const unsigned char* in, std::size_t in_size, std::size_t size, bool exact, std::string& out) {
+  z_stream zs{};
+  if (inflateInit(&zs) != Z_OK) return false;
+  zs.next_in = const_cast<Bytef*>(in);
+  zs.avail_in = static_cast<uInt>(std::min<std::size_t>(in_size, UINT_MAX));
+
+  out.resize(exact ? size + 1 : std::max<std::size_t>(size, 1024)); //one spare byte tells a stream that is too long
+  std::size_t produced{ 0 };
+  int rc{ Z_OK };
+  while (rc == Z_OK) {
+    if (produced == out.size()) {
+      if (exact) break;
+      out.resize(out.size() * 2);
+    }
+    std::size_t room = std::min<std::size_t>(out.size() - produced, UINT_MAX);
+    zs.next_out = reinterpret_cast<Bytef*>(&out[produced]);
+    zs.avail_out = static_cast<uInt>(room);
+    rc = inflate(&zs, Z_NO_FLUSH);
+    produced += room - zs.avail_out;
+  }
+  inflateEnd(&zs);
+  out.resize(produced);
+  return rc == Z_STREAM_END && (!exact || produced == size);
+}
+
+/**
+ * @brief Rebuild an object from its delta base and a delta.
+ *
+ * @param base Content of the base object.
+ * @param delta Inflated delta: the base and result sizes, then copy and insert instructions.
+ * @param out The result.
+ *
+ * @return false if the delta does not apply to that base.
+ */
+bool apply_delta(std::string_view base, std::string_view delta, std::string& out) {
+  const auto* p = reinterpret_cast<const unsigned char*>(delta.data());
+  const auto* end = p + delta.size();
+  auto varint = [&p, end](std::uint64_t& value) {
+    value = 0;
+    for (int shift{ 0 }; p < end && shift < 64; shift += 7) {
+      unsigned char c = *p++;
+      value |= std::uint64_t{ c & 0x7fu } << shift;
+      if ((c & 0x80) == 0) return true;
+    }
+    return false;
+  };
+
+  std::uint64_t base_size{ 0 }, result_size{ 0 };
+  if (!varint(base_size) || !varint(result_size) || base_size != base.size()) return false;
+  out.clear();
+  out.reserve(result_size);
+  while (p < end) {
+    unsigned char op = *p++;
+    if (op & 0x80) { //copy a range of the base
+      std::uint64_t offset{ 0 }, size{ 0 };
+      for (int i{ 0 }; i < 4; ++i) {
+        if ((op & (1 << i)) == 0) continue;
+        if (p == end) return false;
+        offset |= std::uint64_t{ *p++ } << (8 * i);
+      }
+      for (int i{ 0 }; i < 3; ++i) {
+        if ((op & (0x10 << i)) == 0) continue;
+        if (p == end) return false;
+        size |= std::uint64_t{ *p++ } << (8 * i);
+      }
+      if (size == 0) size = 0x10000;
+      if (offset > base.size() || size > base.size() - offset) return false;
+      out.append(base.data() + offset, size);
+    } else if (op != 0) { //insert the next op bytes
+      if (static_cast<std::size_t>(end - p) < op) return false;
+      out.append(reinterpret_cast<const char*>(p), op);
+      p += op;
+    } else {
+      return false;
+    }
+  }
+  return out.size() == result_size;
+}
+
+/**
+ * @struct BaseCacheSlot
+ * @brief A delta base recently rebuilt by this thread.
+ */
+struct BaseCacheSlot {
+  std::uint64_t pack{ 0 };         //!< Serial number of the packfile, 0 if the slot is empty.
+  std::uint64_t offset{ 0 };       //!< Offset of the object in the packfile.
+  git_object_e type{ GIT_NONE };   //!< Type of the object.
+  std::string data;                //!< Content of the object.
+};
+
+constexpr std::size_t BASE_CACHE_SLOTS{ 64 };           //!< Delta bases remembered per thread.
+constexpr std::size_t BASE_CACHE_MAX_BYTES{ 1 << 20 };  //!< Bigger bases are not remembered.
+
+/**
+ * @brief The delta base cache of the calling thread.
+ *
+ * Deltas of related files often share their bases; remembering the last
+ * few saves inflating whole chains again. Each thread has its own, so
+ * readers never wait on each other.
+ */
+std::array<BaseCacheSlot, BASE_CACHE_SLOTS>& base_cache() {
+  thread_local std::array<BaseCacheSlot, BASE_CACHE_SLOTS> cache;
+  return cache;
+}
+
+/// @brief Source of the serial numbers of packfiles (0 marks an empty cache slot).
+std::atomic<std::uint64_t> next_pack_serial{ 1 };
+
+}  // namespace
+
+//== Pack
+
+/**
+ * @struct GitRepository::Pack
+ * @brief A mapped packfile and its index.
+ */
+struct GitRepository::Pack {
+  const unsigned char* index{ nullptr }; //!< Mapped `.idx` file.
+  std::size_t index_size{ 0 };           //!< Its size.
+  const unsigned char* data{ nullptr };  //!< Mapped `.pack` file.
+  std::size_t data_size{ 0 };            //!< Its size.
+  std::uint32_t count{ 0 };              //!< Number of objects.
+  std::uint64_t serial{ 0 };             //!< Identifies the pack in the delta base cache.
+
+  Pack() = default;
+  Pack(const Pack&) = delete;
+  Pack& operator=(const Pack&) = delete;
+
+  ~Pack() {
+    if (index != nullptr) ::munmap(const_cast<unsigned char*>(index), index_size);
+    if (data != nullptr) ::munmap(const_cast<unsigned char*>(data), data_size);
+  }
+
+  /**
+   * @brief Map a whole file read-only.
+   * @return The mapping, or nullptr (empty files cannot be mapped and are never valid here).
+   */
+  static const unsigned char* map(const std::string& path, std::size_t& size) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+    struct stat st {};
+    void* addr = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+      size = static_cast<std::size_t>(st.st_size);
+      addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    return addr == MAP_FAILED ? nullptr : static_cast<const unsigned char*>(addr);
+  }
+
+  /**
+   * @brief Map a pack and its index, and check their headers.
+   * @param base Path of the pack without the `.idx`/`.pack` suffix.
+   */
+  bool open(const std::string& base) {
+    index = map(base + ".idx", index_size);
+    data = map(base + ".pack", data_size);
+    if (index == nullptr || data == nullptr) return false;
+    if (index_size < IDX_HEADER + 40 || be32(index) != IDX_MAGIC || be32(index + 4) != 2) return false;
+    count = be32(index + 8 + 255 * 4);
+    if ((index_size - IDX_HEADER - 40) / 28 < count) return false;
+    if (data_size < 12 + 20 || std::memcmp(data, "PACK", 4) != 0 || be32(data + 8) != count) return false;
+    serial = next_pack_serial.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /// @brief Object id of the i-th object in index order.
+  const unsigned char* name(std::uint32_t i) const { return index + IDX_HEADER + std::size_t{ 20 } * i; }
+
+  /**
+   * @brief Offset in the pack of the i-th object in index order.
+   * @return The offset, or 0 (never a valid one) if the index is corrupt.
+   */
+  std::uint64_t offset(std::uint32_t i) const {
+    std::size_t small = IDX_HEADER + std::size_t{ 24 } * count + std::size_t{ 4 } * i;
+    std::uint32_t value = be32(index + small);
+    if ((value & 0x80000000u) == 0) return value;
+    std::size_t large = IDX_HEADER + std::size_t{ 28 } * count + std::size_t{ 8 } * (value & 0x7fffffffu);
+    return large + 8 <= index_size - 40 ? be64(index + large) : 0;
+  }
+
+  /**
+   * @brief Index positions of the objects whose first byte is `first`.
+   */
+  std::pair<std::uint32_t, std::uint32_t> bucket(unsigned first) const {
+    std::uint32_t lo = first == 0 ? 0 : be32(index + 8 + (first - 1) * 4);
+    std::uint32_t hi = be32(index + 8 + first * 4);
+    return { std::min(lo, count), std::min(hi, count) };
+  }
+
+  /**
+   * @brief Find an object.
+   * @param id The object.
+   * @param out Its offset in the pack.
+   */
+  bool find(const ObjectId& id, std::uint64_t& out) const {
+    auto [lo, hi] = bucket(id.bytes[0]);
+    while (lo < hi) {
+      std::uint32_t mid = lo + (hi - lo) / 2;
+      int cmp = std::memcmp(name(mid), id.bytes.data(), 20);
+      if (cmp == 0) {
+        out = offset(mid);
+        return out != 0;
+      }
+      if (cmp < 0) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return false;
+  }
+};
+
+//== GitRepository
+
+/**
+ * @brief Find the repository holding a directory.
+ *
+ * @param start_dir A directory of the work tree (not necessarily its top).
+ *
+ * Looks for `.git` in the directory and then in each parent, like git does.
+ * A `.git` file (linked work trees, submodules) points to the real git
+ * directory, whose `commondir` file in turn points to the shared refs and
+ * objects. Object directories listed in `objects/info/alternates` are
+ * searched too. ok() tells whether a repository was found.
+ */
+GitRepository::GitRepository(const std::string& start_dir) {
+  std::string dir = real_path(start_dir);
+  std::string git_dir;
+  while (!dir.empty()) {
+    std::string dot_git = (dir == "/" ? "" : dir) + "/.git";
+    struct stat st {};
+    if (::stat(dot_git.c_str(), &st) == 0) {
+      std::string content;
+      if (S_ISDIR(st.st_mode)) {
+        git_dir = dot_git;
+      } else if (read_file(dot_git, content) && content.compare(0, 8, "gitdir: ") == 0) {
+        git_dir = real_path(resolve_path(dir, first_line(content).substr(8)));
+      }
+      if (!git_dir.empty()) break;
+    }
+    if (dir == "/") return;
+    std::size_t slash = dir.rfind('/');
+    dir = dir.substr(0, slash == 0 ? 1 : slash);
+  }
+  if (git_dir.empty()) return;
+
+  m_git_dir = git_dir;
+  m_common_dir = git_dir;
+  std::string content;
+  if (read_file(git_dir + "/commondir", content)) m_common_dir = real_path(resolve_path(git_dir, first_line(content)));
+
+  std::string objects = m_common_dir + "/objects";
+  struct stat st {};
+  if (m_common_dir.empty() || ::stat(objects.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return;
+  m_object_dirs.push_back(objects);
+  if (read_file(objects + "/info/alternates", content)) {
+    for (std::size_t start{ 0 }; start < content.size();) {
+      std::size_t end = std::min(content.find('\n', start), content.size());
+      std::string_view line = first_line(std::string_view{ content }.substr(start, end - start));
+      if (!line.empty() && line.front() != '#') m_object_dirs.push_back(resolve_path(objects, line));
+      start = end + 1;
+    }
+  }
+  for (const auto& objects_dir : m_object_dirs) load_packs(objects_dir);
+  m_work_tree = dir;
+}
+
+GitRepository::~GitRepository() = default;
+
+/**
+ * @brief Map the packfiles of an object directory.
+ *
+ * @param objects_dir The directory.
+ *
+ * Packs that cannot be mapped or whose headers do not check out are left
+ * out; their objects are then simply not found.
+ */
+void GitRepository::load_packs(const std::string& objects_dir) {
+  std::string pack_dir = objects_dir + "/pack";
+  DIR* dir = ::opendir(pack_dir.c_str());
+  if (dir == nullptr) return;
+  while (dirent* entry = ::readdir(dir)) {
+    std::string_view name{ entry->d_name };
+    if (name.size() <= 4 || name.substr(name.size() - 4) != ".idx") continue;
+    auto pack = std::make_unique<Pack>();
+    if (pack->open(pack_dir + "/" + std::string{ name.substr(0, name.size() - 4) })) m_packs.push_back(std::move(pack));
+  }
+  ::closedir(dir);
+}
+
+/**
+ * @brief The regular files recorded in the index.
+ *
+ * @param out Receives the entries, in index (path) order.
+ *
+ * Symlinks, submodules and the directory entries of a sparse index are
+ * skipped, and so are files marked skip-worktree, which are not in the
+ * work tree. Of a conflicted file only "our" version (stage 2) is kept.
+ * A repository without an index yet has no tracked files.
+ *
+ * @return false if the index cannot be read or is corrupt.
+ */
+bool GitRepository::read_index(std::vector<GitEntry>& out) const {
+  std::string path = m_git_dir + "/index";
+  FileBuffer file(path);
+  if (!file.ok()) {
+    struct stat st {};
+    return ::stat(path.c_str(), &st) != 0;
+  }
+  const auto* base = reinterpret_cast<const unsigned char*>(file.view().data());
+  std::size_t size = file.view().size();
+  if (size < 12 + 20 || std::memcmp(base, "DIRC", 4) != 0) return false;
+  std::uint32_t version = be32(base + 4);
+  std::uint32_t count = be32(base + 8);
+  if (version < 2 || version > 4) return false;
+
+  const std::size_t end = size - 20; //the checksum
+  std::size_t pos{ 12 };
+  std::string previous; //version 4 compresses each path against the previous one
+  out.reserve(out.size() + count);
+  for (std::uint32_t i{ 0 }; i < count; ++i) {
+    if (pos + 62 > end) return false;
+    const unsigned char* entry = base + pos;
+    std::uint32_t mode = be32(entry + 24);
+    std::uint32_t file_size = be32(entry + 36);
+    std::uint32_t flags = be16(entry + 60);
+    std::uint32_t extended{ 0 };
+    std::size_t header{ 62 };
+    if (flags & 0x4000) {
+      if (version < 3 || pos + 64 > end) return false;
+      extended = be16(entry + 62);
+      header = 64;
+    }
+
+    std::string name;
+    if (version == 4) {
+      const unsigned char* p = entry + header;
+      const unsigned char* limit = base + end;
+      if (p == limit) return false;
+      unsigned char c = *p++;
+      std::uint64_t strip = c & 0x7f;
+      while (c & 0x80) {
+        if (p == limit || strip > (UINT64_MAX >> 8)) return false;
+        c = *p++;
+        strip = ((strip + 1) << 7) | (c & 0x7f);
+      }
+      const void* nul = std::memchr(p, '\0', static_cast<std::size_t>(limit - p));
+      if (nul == nullptr || strip > previous.size()) return false;
+      name.assign(previous, 0, previous.size() - strip);
+      name.append(reinterpret_cast<const char*>(p), static_cast<const unsigned char*>(nul) - p);
+      pos = static_cast<std::size_t>(static_cast<const unsigned char*>(nul) - base) + 1;
+      previous = name;
+    } else {
+      const void* nul = std::memchr(entry + header, '\0', end - pos - header);
+      if (nul == nullptr) return false;
+      name.assign(reinterpret_cast<const char*>(entry + header), static_cast<const unsigned char*>(nul) - (entry + header));
+      pos += (header + name.size() + 8) & ~std::size_t{ 7 }; //NUL-padded to a multiple of 8
+    }
+
+    std::uint32_t stage = (flags >> 12) & 3;
+    if ((mode & MODE_TYPE) != MODE_FILE || (stage != 0 && stage != 2) || (extended & 0x4000)) continue;
+    GitEntry tracked;
+    tracked.path = std::move(name);
+    std::memcpy(tracked.id.bytes.data(), entry + 40, 20);
+    tracked.size = file_size;
+    out.push_back(std::move(tracked));
+  }
+  return true;
+}
+
+/**
+ * @brief The object a revision names.
+ *
+ * @param rev A full or abbreviated (4+ digits) hex object name, `HEAD`
+ *            (or `@`), or the name of a branch, tag or remote branch,
+ *            followed by any number of `^`, `^N` and `~N`.
+ * @param out The object.
+ *
+ * Names are looked up in the same order as git: the name itself, then
+ * under `refs/`, `refs/tags/`, `refs/heads/`, `refs/remotes/`, and as a
+ * remote's `HEAD`; an abbreviated object name comes last.
+ *
+ * @return false if the revision names nothing.
+ */
+bool GitRepository::resolve(std::string_view rev, ObjectId& out) const {
+  std::size_t ops = std::min(rev.find_first_of("^~"), rev.size());
+  std::string name{ rev.substr(0, ops) };
+  if (name.empty() || name == "@") name = "HEAD";
+
+  bool hex = name.size() >= 4 && name.size() <= 40
+             && std::all_of(name.begin(), name.end(), [](char c) { return hex_value(c) >= 0; });
+  bool found = hex && name.size() == 40 && parse_hex(name, out);
+  for (const std::string& ref : { name, "refs/" + name, "refs/tags/" + name, "refs/heads/" + name,
+                                  "refs/remotes/" + name, "refs/remotes/" + name + "/HEAD" }) {
+    if (found) break;
+    found = read_ref(ref, out);
+  }
+  if (!found && hex) found = find_abbreviated(name, out);
+  if (!found) return false;
+
+  auto parent = [this](const ObjectId& commit, std::uint64_t n, ObjectId& result) {
+    git_object_e type;
+    std::string data;
+    if (!read_object(commit, type, data) || type != GIT_COMMIT) return false;
+    std::string_view headers{ data };
+    headers = headers.substr(0, headers.find("\n\n"));
+    for (std::size_t start{ 0 }; start < headers.size();) {
+      std::size_t end = std::min(headers.find('\n', start), headers.size());
+      std::string_view line = headers.substr(start, end - start);
+      if (line.compare(0, 7, "parent ") == 0 && --n == 0) return parse_hex(line.substr(7), result);
+      start = end + 1;
+    }
+    return false;
+  };
+
+  for (std::size_t i{ ops }; i < rev.size();) {
+    char op = rev[i++];
+    std::size_t digits = i;
+    while (i < rev.size() && std::isdigit(static_cast<unsigned char>(rev[i]))) ++i;
+    if (op != '^' && op != '~') return false;
+    if (i - digits > 9) return false;
+    std::uint64_t n = i == digits ? 1 : std::stoul(std::string{ rev.substr(digits, i - digits) });
+
+    ObjectId commit;
+    if (!peel(out, GIT_COMMIT, commit)) return false;
+    if (op == '^') {
+      if (n == 0) {
+        out = commit;
+      } else if (!parent(commit, n, out)) {
+        return false;
+      }
+    } else {
+      for (; n > 0; --n) {
+        if (!parent(commit, 1, commit)) return false;
+      }
+      out = commit;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief The object id a ref (or symbolic ref) points to.
+ *
+ * @param name Full name of the ref, e.g. "refs/heads/main" or "HEAD".
+ * @param out The object.
+ * @param depth Symbolic refs already followed.
+ *
+ * Loose refs are looked for in the git directory (HEAD of a linked work
+ * tree) and then in the common one, before `packed-refs`.
+ */
+bool GitRepository::read_ref(const std::string& name, ObjectId& out, int depth) const {
+  if (depth > MAX_REF_DEPTH) return false;
+  std::string content;
+  for (const auto* dir : { &m_git_dir, &m_common_dir }) {
+    if (!read_file(*dir + "/" + name, content)) continue;
+    std::string_view line = first_line(content);
+    if (line.compare(0, 5, "ref: ") == 0) return read_ref(std::string{ line.substr(5) }, out, depth + 1);
+    return line.size() == 40 && parse_hex(line, out);
+  }
+
+  if (!read_file(m_common_dir + "/packed-refs", content)) return false;
+  std::string_view packed{ content };
+  for (std::size_t start{ 0 }; start < packed.size();) {
+    std::size_t end = std::min(packed.find('\n', start), packed.size());
+    std::string_view line = first_line(packed.substr(start, end - start));
+    if (line.size() == 41 + name.size() && line[40] == ' ' && line.substr(41) == name) return parse_hex(line, out);
+    start = end + 1;
+  }
+  return false;
+}
+
+/**
+ * @brief The unique object whose hex name starts with a prefix.
+ *
+ * @param prefix At least 4 lower-case hex digits.
+ * @param out The object.
+ *
+ * @return false if no object, or more than one, has that prefix.
+ */
+bool GitRepository::find_abbreviated(std::string_view prefix, ObjectId& out) const {
+  std::vector<ObjectId> matches;
+  auto add = [&matches](const ObjectId& id) {
+    if (std::find(matches.begin(), matches.end(), id) == matches.end()) matches.push_back(id);
+  };
+
+  unsigned first = static_cast<unsigned>(hex_value(prefix[0]) << 4 | hex_value(prefix[1]));
+  for (const auto& pack : m_packs) {
+    auto [lo, hi] = pack->bucket(first);
+    for (std::uint32_t i{ lo }; i < hi && matches.size() < 2; ++i) {
+      if (!has_hex_prefix(pack->name(i), prefix)) continue;
+      ObjectId id;
+      std::memcpy(id.bytes.data(), pack->name(i), 20);
+      add(id);
+    }
+  }
+  for (const auto& objects_dir : m_object_dirs) {
+    std::string fan_dir = objects_dir + "/" + std::string{ prefix.substr(0, 2) };
+    DIR* dir = ::opendir(fan_dir.c_str());
+    if (dir == nullptr) continue;
+    while (dirent* entry = ::readdir(dir)) {
+      std::string hex = std::string{ prefix.substr(0, 2) } + entry->d_name;
+      ObjectId id;
+      if (hex.size() == 40 && hex.compare(0, prefix.size(), prefix) == 0 && parse_hex(hex, id)) add(id);
+    }
+    ::closedir(dir);
+  }
+  if (matches.size() != 1) return false;
+  out = matches.front();
+  return true;
+}
+
+/**
+ * @brief Follow tags and commits down to the object of a given type.
+ *
+ * @param id Starting object.
+ * @param wanted GIT_COMMIT (peels tags) or GIT_TREE (also takes the tree of a commit).
+ * @param out The object reached.
+ */
+bool GitRepository::peel(ObjectId id, git_object_e wanted, ObjectId& out) const {
+  for (int hops{ 0 }; hops <= MAX_REF_DEPTH; ++hops) {
+    git_object_e type;
+    std::string data;
+    if (!read_object(id, type, data)) return false;
+    if (type == wanted) {
+      out = id;
+      return true;
+    }
+    std::string_view field = type == GIT_TAG ? "object " : type == GIT_COMMIT && wanted == GIT_TREE ? "tree " : "";
+    if (field.empty() || data.compare(0, field.size(), field) != 0 || !parse_hex(std::string_view{ data }.substr(field.size()), id)) return false;
+  }
+  return false;
+}
+
+/**
+ * @brief The regular files of the tree of a commit (or tag, or tree).
+ *
+ * @param tree_ish The commit, tag or tree.
+ * @param descend Called with the path of each sub-directory; it is only
+ *                read if this returns true.
+ * @param out Receives the files, in the same (path) order as the index.
+ *
+ * Symlinks and submodules are skipped. Only the trees of the directories
+ * asked for are inflated, so counting a sub-directory of a big repository
+ * only reads that part of the history.
+ *
+ * @return false if an object is missing or corrupt.
+ */
+bool GitRepository::list_tree(const ObjectId& tree_ish, const std::function<bool(std::string_view dir)>& descend, std::vector<GitEntry>& out) const {
+  ObjectId tree;
+  return peel(tree_ish, GIT_TREE, tree) && walk_tree(tree, "", descend, out, 0);
+}
+
+/**
+ * @brief List a tree, recursing into the sub-trees `descend` accepts.
+ *
+ * @param tree The tree.
+ * @param base Path of its directory ("" for the top).
+ * @param descend Filter of sub-directories.
+ * @param out Receives the files.
+ * @param depth Nesting of the directory.
+ */
+bool GitRepository::walk_tree(const ObjectId& tree, const std::string& base, const std::function<bool(std::string_view dir)>& descend, std::vector<GitEntry>& out, int depth) const {
+  git_object_e type;
+  std::string data;
+  if (depth > MAX_TREE_DEPTH || !read_object(tree, type, data) || type != GIT_TREE) return false;
+
+  for (std::size_t pos{ 0 }; pos < data.size();) { //entries: "<octal mode> <name>\0<20-byte id>"
+    std::size_t space = data.find(' ', pos);
+    std::size_t nul = space == std::string::npos ? space : data.find('\0', space);
+    if (nul == std::string::npos || nul + 21 > data.size()) return false;
+    std::uint32_t mode{ 0 };
+    for (std::size_t i{ pos }; i < space; ++i) mode = mode << 3 | static_cast<std::uint32_t>(data[i] - '0');
+
+    GitEntry entry;
+    entry.path = base.empty() ? data.substr(space + 1, nul - space - 1) : base + "/" + data.substr(space + 1, nul - space - 1);
+    std::memcpy(entry.id.bytes.data(), data.data() + nul + 1, 20);
+    pos = nul + 21;
+
+    if ((mode & MODE_TYPE) == MODE_TREE) {
+      if (descend(entry.path) && !walk_tree(entry.id, entry.path, descend, out, depth + 1)) return false;
+    } else if ((mode & MODE_TYPE) == MODE_FILE) {
+      out.push_back(std::move(entry));
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Read and inflate an object.
+ *
+ * @param id The object.
+ * @param type Its type.
+ * @param data Its content.
+ *
+ * Packs are searched first, then loose objects. May be called from any
+ * thread.
+ *
+ * @return false if the object is missing or corrupt.
+ */
+bool GitRepository::read_object(const ObjectId& id, git_object_e& type, std::string& data) const {
+  return read_object(id, type, data, 0);
+}
+
+/**
+ * @brief Read an object, resolving deltas, below a given delta depth.
+ *
+ * @param id The object.
+ * @param type Its type.
+ * @param data Its content.
+ * @param depth Number of deltas already being resolved above this one.
+ */
+bool GitRepository::read_object(const ObjectId& id, git_object_e& type, std::string& data, int depth) const {
+  for (const auto& pack : m_packs) {
+    std::uint64_t offset{ 0 };
+    if (pack->find(id, offset)) return read_packed(*pack, offset, type, data, depth);
+  }
+
+  std::string hex = to_hex(id);
+  for (const auto& objects_dir : m_object_dirs) {
+    FileBuffer file(objects_dir + "/" + hex.substr(0, 2) + "/" + hex.substr(2));
+    if (!file.ok()) continue;
+    std::string raw;
+    const auto* in = reinterpret_cast<const unsigned char*>(file.view().data());
+    if (!inflate_data(in, file.view().size(), file.view().size() * 4, false, raw)) return false;
+
+    std::size_t nul = raw.find('\0');
+    std::size_t space = raw.find(' ');
+    if (nul == std::string::npos || space > nul) return false;
+    std::string_view kind = std::string_view{ raw }.substr(0, space);
+    type = kind == "blob" ? GIT_BLOB : kind == "tree" ? GIT_TREE : kind == "commit" ? GIT_COMMIT : kind == "tag" ? GIT_TAG : GIT_NONE;
+    if (type == GIT_NONE || std::to_string(raw.size() - nul - 1) != raw.substr(space + 1, nul - space - 1)) return false;
+    data = raw.substr(nul + 1);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Read an object stored at some offset of a packfile, resolving deltas.
+ *
+ * @param pack The packfile.
+ * @param offset Offset of the object entry.
+ * @param type Type of the object (of its base, for a delta).
+ * @param data Its content.
+ * @param depth Number of deltas already being resolved above this one.
+ *
+ * Each entry starts with its type and inflated size (a varint); deltas
+ * then give their base, as a backward offset in the same pack or as an
+ * object id. Bases of offset deltas go through the thread's base cache.
+ */
+bool GitRepository::read_packed(const Pack& pack, std::uint64_t offset, git_object_e& type, std::string& data, int depth) const {
+  if (depth > MAX_DELTA_DEPTH || offset < 12 || offset >= pack.data_size - 20) return false;
+  const unsigned char* p = pack.data + offset;
+  const unsigned char* end = pack.data + pack.data_size - 20;
+
+  unsigned char c = *p++;
+  unsigned kind = (c >> 4) & 7;
+  std::uint64_t size = c & 15;
+  for (int shift{ 4 }; c & 0x80; shift += 7) {
+    if (p == end || shift > 57) return false;
+    c = *p++;
+    size |= std::uint64_t{ c & 0x7fu } << shift;
+  }
+  if (kind >= GIT_COMMIT && kind <= GIT_TAG) {
+    type = static_cast<git_object_e>(kind);
+    return inflate_data(p, static_cast<std::size_t>(end - p), size, true, data);
+  }
+
+  std::string own_base;
+  const std::string* base{ &own_base };
+  git_object_e base_type{ GIT_NONE };
+  if (kind == PACK_OFS_DELTA) {
+    if (p == end) return false;
+    c = *p++;
+    std::uint64_t back = c & 0x7f;
+    while (c & 0x80) {
+      if (p == end || back > (UINT64_MAX >> 8)) return false;
+      c = *p++;
+      back = ((back + 1) << 7) | (c & 0x7f);
+    }
+    if (back == 0 || back > offset) return false;
+
+    std::uint64_t base_offset = offset - back;
+    BaseCacheSlot& slot = base_cache()[(base_offset ^ (pack.serial << 32)) % BASE_CACHE_SLOTS];
+    if (slot.pack != pack.serial || slot.offset != base_offset) {
+      if (!read_packed(pack, base_offset, base_type, own_base, depth + 1)) return false;
+      if (own_base.size() <= BASE_CACHE_MAX_BYTES) {
+        slot.pack = pack.serial;
+        slot.offset = base_offset;
+        slot.type = base_type;
+        slot.data = std::move(own_base);
+      }
+    }
+    if (slot.pack == pack.serial && slot.offset == base_offset) {
+      base_type = slot.type;
+      base = &slot.data;
+    }
+  } else if (kind == PACK_REF_DELTA) {
+    if (end - p < 20) return false;
+    ObjectId base_id;
+    std::memcpy(base_id.bytes.data(), p, 20);
+    p += 20;
+    if (!read_object(base_id, base_type, own_base, depth + 1)) return false;
+  } else {
+    return false;
+  }
+
+  std::string delta;
+  if (!inflate_data(p, static_cast<std::size_t>(end - p), size, true, delta)) return false;
+  type = base_type;
+  return apply_delta(*base, delta, data);
+}
+
+//== GitSnapshot
+
+/**
+ * @brief Find the repository and list the tracked files picked by the options.
+ *
+ * @param run_options The inputs, `-r`, and the revision (empty for the index).
+ *
+ * The repository is the one holding the first directory given (or the
+ * directory of the first file, or the current directory). Files given
+ * explicitly are kept if tracked, and listed first; then come the tracked
+ * files of each directory (only those directly inside it without `-r`),
+ * each file once, in index order. Without any input, every tracked file
+ * is taken, shown by its path in the repository. Files that cannot be
+ * source code (see may_be_source()) are left out.
+ */
+GitSnapshot::GitSnapshot(const RunningOpt& run_options) {
+  std::string start{ "." };
+  if (!run_options.directory_list.empty()) {
+    start = run_options.directory_list.front();
+  } else if (!run_options.input_list.empty()) {
+    std::size_t slash = run_options.input_list.front().rfind('/');
+    if (slash != std::string::npos) start = run_options.input_list.front().substr(0, slash + 1);
+  }
+  m_repo = std::make_unique<GitRepository>(start);
+  if (!m_repo->ok()) {
+    m_error = "\"" + start + "\" is not inside a git repository";
+    return;
+  }
+
+  /// Where an input lies in the repository.
+  struct Pick {
+    std::string shown; //!< Input as given ("" for the whole repository).
+    std::string path;  //!< Its path in the repository ("" for the top).
+    bool is_file;      //!< Whether it is a file.
+  };
+  std::vector<Pick> picks;
+  auto in_repository = [this](const std::string& input, bool is_file, std::string& out) {
+    std::string abs_path;
+    if (is_file) { //the link itself, not its target, is what git tracks
+      std::size_t slash = input.rfind('/');
+      std::string dir = real_path(slash == std::string::npos ? "." : input.substr(0, slash + 1));
+      if (!dir.empty()) abs_path = (dir == "/" ? "" : dir) + "/" + input.substr(slash + 1);
+    } else {
+      abs_path = real_path(input);
+    }
+    const std::string& top = m_repo->work_tree();
+    if (abs_path == top) {
+      out.clear();
+    } else if (is_inside(abs_path, top == "/" ? "" : top)) {
+      out = abs_path.substr(top == "/" ? 1 : top.size() + 1);
+    } else {
+      m_error = "\"" + input + "\" is outside the git repository of \"" + top + "\"";
+      return false;
+    }
+    return true;
+  };
+  for (const auto& file : run_options.input_list) {
+    picks.push_back({ file, "", true });
+    if (!in_repository(file, true, picks.back().path)) return;
+  }
+  for (const auto& directory : run_options.directory_list) {
+    picks.push_back({ directory, "", false });
+    if (!in_repository(directory, false, picks.back().path)) return;
+  }
+  bool recursive = run_options.recursive || picks.empty();
+  if (picks.empty()) picks.push_back({ "", "", false });
+
+  std::vector<GitEntry> tracked;
+  m_revision = !run_options.git_rev.empty();
+  if (m_revision) {
+    ObjectId commit;
+    if (!m_repo->resolve(run_options.git_rev, commit)) {
+      m_error = "unknown revision \"" + run_options.git_rev + "\"";
+      return;
+    }
+    auto descend = [&picks, recursive](std::string_view dir) {
+      return std::any_of(picks.begin(), picks.end(), [dir, recursive](const Pick& pick) {
+        return is_inside(pick.path, dir) || (!pick.is_file && (dir == pick.path || (recursive && is_inside(dir, pick.path))));
+      });
+    };
+    if (!m_repo->list_tree(commit, descend, tracked)) {
+      m_error = "unable to read the files of \"" + run_options.git_rev + "\" in the git repository";
+      return;
+    }
+  } else if (!m_repo->read_index(tracked)) {
+    m_error = "unable to read the git index of \"" + m_repo->work_tree() + "\"";
+    return;
+  }
+  m_entries = tracked.size();
+  auto by_path = [](const GitEntry& a, const GitEntry& b) { return a.path < b.path; };
+  if (!std::is_sorted(tracked.begin(), tracked.end(), by_path)) std::sort(tracked.begin(), tracked.end(), by_path);
+
+  std::vector<const GitEntry*> picked;
+  std::unordered_set<std::string_view> taken;
+  for (const auto& pick : picks) {
+    if (!pick.is_file) continue;
+    GitEntry key;
+    key.path = pick.path;
+    auto it = std::lower_bound(tracked.begin(), tracked.end(), key, by_path);
+    if (it == tracked.end() || it->path != pick.path) {
+      m_untracked.push_back(pick.shown);
+      continue;
+    }
+    taken.insert(it->path);
+    m_paths.push_back(pick.shown); //explicit files are listed even when repeated
+    picked.push_back(&*it);
+  }
+  for (const auto& pick : picks) {
+    if (pick.is_file) continue;
+    GitEntry key;
+    key.path = pick.path.empty() ? "" : pick.path + "/";
+    for (auto it = std::lower_bound(tracked.begin(), tracked.end(), key, by_path); it != tracked.end() && is_inside(it->path, pick.path); ++it) {
+      std::string_view rest = std::string_view{ it->path }.substr(pick.path.empty() ? 0 : pick.path.size() + 1);
+      if ((!recursive && rest.find('/') != std::string_view::npos) || !may_be_source(rest)) continue;
+      if (!taken.insert(it->path).second) continue;
+      if (pick.shown.empty()) {
+        m_paths.emplace_back(rest);
+      } else {
+        m_paths.push_back(pick.shown + (pick.shown.back() == '/' ? "" : "/") + std::string{ rest });
+      }
+      picked.push_back(&*it);
+    }
+  }
+
+  m_sizes.reserve(picked.size());
+  for (std::size_t i{ 0 }; i < picked.size(); ++i) {
+    m_sizes.push_back(m_revision ? 0 : picked[i]->size);
+    if (m_revision) m_blobs.emplace(m_paths[i], picked[i]->id);
+  }
+}
+
+GitSnapshot::~GitSnapshot() = default;
+
+/**
+ * @brief Build the FileInfo record of one of the files.
+ *
+ * @param path One of paths().
+ * @param pool Pool to split big files over, or nullptr.
+ * @param cache Counts of previous runs, or nullptr.
+ *
+ * From the index, the file is read from the work tree by make_file_info(),
+ * cache included. From a revision, its blob is inflated and counted by
+ * make_blob_info(); like an unreadable file, a missing blob counts as
+ * empty.
+ *
+ * @return The record, whose file name is a view of `path`.
+ */
+FileInfo GitSnapshot::count(std::string_view path, ThreadPool* pool, ResultCache* cache) const {
+  if (!m_revision) return make_file_info(path, pool, cache);
+
+  auto it = m_blobs.find(path);
+  git_object_e type{ GIT_NONE };
+  std::string content;
+  if (it == m_blobs.end() || !m_repo->read_object(it->second, type, content) || type != GIT_BLOB) {
+    FileInfo info;
+    info.filename = path;
+    info.type = language_by_file_name(path);
+    return info;
+  }
+  return make_blob_info(path, content, pool);
+}
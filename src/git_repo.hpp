@@ -0,0 +1,245 @@
+#ifndef GIT_REPO_HPP
+#define GIT_REPO_HPP
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "main.hpp"
+
+/*!
+ * @file git_repo.hpp
+ * @description
+ * Read access to a local git repository without a git binary: the index,
+ * refs, and commit, tree and blob objects, loose or in packfiles. Used by
+ * `--git [rev]` to count the tracked files only.
+ */
+
+//== Enums
+
+/**
+ * @enum git_object_e
+ * @brief Type of a git object, numbered as in packfiles.
+ */
+enum git_object_e : std::uint8_t {
+  GIT_NONE = 0,   //!< No object (or an unreadable one).
+  GIT_COMMIT = 1, //!< Commit.
+  GIT_TREE = 2,   //!< Tree (a directory listing).
+  GIT_BLOB = 3,   //!< Blob (the content of a file).
+  GIT_TAG = 4,    //!< Annotated tag.
+};
+
+//== Structs
+
+/**
+ * @struct ObjectId
+ * @brief Binary SHA-1 name of a git object.
+ */
+struct ObjectId {
+  std::array<std::uint8_t, 20> bytes{}; //!< The 20 bytes of the hash.
+
+  bool operator==(const ObjectId& other) const { return bytes == other.bytes; }
+};
+
+/**
+ * @struct GitEntry
+ * @brief A tracked file: its path from the top of the work tree and its blob.
+ */
+struct GitEntry {
+  std::string path;        //!< Path relative to the work tree, '/'-separated.
+  ObjectId id;             //!< Blob holding the content.
+  std::uint64_t size{ 0 }; //!< Size in the work tree as recorded by the index (0 for trees).
+};
+
+//== Classes
+
+/**
+ * @class GitRepository
+ * @brief The repository holding a directory.
+ *
+ * Packfiles and their indexes are mapped once when the repository is
+ * opened; every read afterwards only touches those mappings or loose object
+ * files, so objects can be read from several threads at once.
+ */
+class GitRepository {
+public:
+  /**
+   * @brief Find the repository holding a directory.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  explicit GitRepository(const std::string& start_dir);
+
+  ~GitRepository();
+
+  GitRepository(const GitRepository&) = delete;
+  GitRepository& operator=(const GitRepository&) = delete;
+
+  /// @brief Whether a repository was found.
+  bool ok() const { return !m_work_tree.empty(); }
+
+  /// @brief Absolute, symlink-free path of the top of the work tree.
+  const std::string& work_tree() const { return m_work_tree; }
+
+  /**
+   * @brief The regular files recorded in the index.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  bool read_index(std::vector<GitEntry>& out) const;
+
+  /**
+   * @brief The object a revision names.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  bool resolve(std::string_view rev, ObjectId& out) const;
+
+  /**
+   * @brief The regular files of the tree of a commit (or tag, or tree).
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  bool list_tree(const ObjectId& tree_ish, const std::function<bool(std::string_view dir)>& descend, std::vector<GitEntry>& out) const;
+
+  /**
+   * @brief Read and inflate an object.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  bool read_object(const ObjectId& id, git_object_e& type, std::string& data) const;
+
+private:
+  struct Pack;
+
+  /**
+   * @brief Read an object stored at some offset of a packfile, resolving deltas.
+   * @param pack The packfile.
+   * @param offset Offset of the object entry.
+   * @param type Type of the object.
+   * @param data Its content.
+   * @param depth Number of deltas already being resolved above this one.
+   */
+  bool read_packed(const Pack& pack, std::uint64_t offset, git_object_e& type, std::string& data, int depth) const;
+
+  /**
+   * @brief Read an object, resolving deltas, below a given delta depth.
+   * @param id The object.
+   * @param type Its type.
+   * @param data Its content.
+   * @param depth Number of deltas already being resolved above this one.
+   */
+  bool read_object(const ObjectId& id, git_object_e& type, std::string& data, int depth) const;
+
+  /**
+   * @brief The object id a ref (or symbolic ref) points to.
+   * @param name Full name of the ref, e.g. "refs/heads/main" or "HEAD".
+   * @param out The object.
+   * @param depth Symbolic refs already followed.
+   */
+  bool read_ref(const std::string& name, ObjectId& out, int depth = 0) const;
+
+  /**
+   * @brief The unique object whose hex name starts with a prefix.
+   * @param prefix At least 4 lower-case hex digits.
+   * @param out The object.
+   */
+  bool find_abbreviated(std::string_view prefix, ObjectId& out) const;
+
+  /**
+   * @brief Follow tags and commits down to the object of a given type.
+   * @param id Starting object.
+   * @param wanted GIT_COMMIT or GIT_TREE.
+   * @param out The object reached.
+   */
+  bool peel(ObjectId id, git_object_e wanted, ObjectId& out) const;
+
+  /**
+   * @brief List a tree, recursing into the sub-trees `descend` accepts.
+   * @param tree The tree.
+   * @param base Path of its directory ("" for the top).
+   * @param descend Filter of sub-directories.
+   * @param out Receives the files.
+   * @param depth Nesting of the directory.
+   */
+  bool walk_tree(const ObjectId& tree, const std::string& base, const std::function<bool(std::string_view dir)>& descend, std::vector<GitEntry>& out, int depth) const;
+
+  /**
+   * @brief Map the packfiles of an object directory.
+   * @param objects_dir The directory.
+   */
+  void load_packs(const std::string& objects_dir);
+
+  std::string m_work_tree;                    //!< Top of the work tree, empty if not found.
+  std::string m_git_dir;                      //!< Directory of HEAD and of the index.
+  std::string m_common_dir;                   //!< Directory of refs and objects (differs in linked work trees).
+  std::vector<std::string> m_object_dirs;     //!< Object directories: own first, then alternates.
+  std::vector<std::unique_ptr<Pack>> m_packs; //!< Mapped packfiles.
+};
+
+/**
+ * @class GitSnapshot
+ * @brief The tracked files picked by the command line, and how to count them.
+ *
+ * Without a revision the files come from the index and are read from the
+ * work tree like any other file; with one they come from the tree of that
+ * revision and their content is read from the object database. Either way
+ * untracked and ignored paths are never looked at: neither the index nor a
+ * tree records them.
+ */
+class GitSnapshot {
+public:
+  /**
+   * @brief Find the repository and list the tracked files picked by the options.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  explicit GitSnapshot(const RunningOpt& run_options);
+
+  ~GitSnapshot();
+
+  GitSnapshot(const GitSnapshot&) = delete;
+  GitSnapshot& operator=(const GitSnapshot&) = delete;
+
+  /// @brief Whether the files could be listed; see error() otherwise.
+  bool ok() const { return m_error.empty(); }
+
+  /// @brief What went wrong, for a message after "Sorry, ".
+  const std::string& error() const { return m_error; }
+
+  /// @brief The files to count, as displayed, in the order of the index.
+  const std::vector<std::string>& paths() const { return m_paths; }
+
+  /// @brief Their sizes, for scheduling (0 when unknown).
+  const std::vector<std::uint64_t>& sizes() const { return m_sizes; }
+
+  /// @brief Files given explicitly that git does not track (left out).
+  const std::vector<std::string>& untracked() const { return m_untracked; }
+
+  /// @brief Number of index or tree entries looked at.
+  std::uint64_t entries() const { return m_entries; }
+
+  /**
+   * @brief Build the FileInfo record of one of the files.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  FileInfo count(std::string_view path, ThreadPool* pool, ResultCache* cache) const;
+
+private:
+  std::unique_ptr<GitRepository> m_repo;                   //!< The repository.
+  bool m_revision{ false };                                //!< Whether the files come from a revision.
+  std::vector<std::string> m_paths;                        //!< Files, as displayed.
+  std::vector<std::uint64_t> m_sizes;                      //!< Their sizes, or 0.
+  std::unordered_map<std::string_view, ObjectId> m_blobs;  //!< Blob of each displayed path (with a revision).
+  std::vector<std::string> m_untracked;                    //!< Explicit files left out.
+  std::uint64_t m_entries{ 0 };                            //!< Entries looked at.
+  std::string m_error;                                     //!< Why listing failed, empty on success.
+};
+
+#endif
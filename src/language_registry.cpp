@@ -0,0 +1,332 @@
+/*!
+ * @file language_registry.cpp
+ * @description
+ * The language table and the lexer specs of the languages other than C/C++.
+ *
+ * Adding a language takes a lang_type_e value, a spec struct (see
+ * language_scanner.hpp) and a row in LANGUAGES. C and C++ keep the
+ * table-driven lexer of lexer_table.cpp, reached through process_buffer(),
+ * so new languages add nothing to their hot path: the only dispatch is one
+ * function pointer per file.
+ */
+
+#include "language_registry.hpp"
+
+#include <array>
+#include <cctype>
+
+#include "file_reader.hpp"
+#include "language_sniffer.hpp"
+
+namespace {
+
+//== Lexer specs
+
+/// @brief Python: `#` comments; triple-quoted strings opening a line are docstrings.
+struct PythonSpec {
+  static constexpr std::array<BlockRule, 0> blocks{};
+  static constexpr std::string_view nested_open{};
+  static constexpr std::array<std::string_view, 0> doc_lines{};
+  static constexpr std::array<std::string_view, 1> line_comments{ "#" };
+  static constexpr std::array<StringRule, 4> strings{ { { "\"\"\"", "\"\"\"", true, true, true },
+                                                        { "'''", "'''", true, true, true },
+                                                        { "\"", "\"", true, false, false },
+                                                        { "'", "'", true, false, false } } };
+  static constexpr bool char_literals{ false };
+  static constexpr bool code_escapes{ false };
+  static constexpr bool comment_at_word_start{ false };
+};
+
+/// @brief Rust: nested block comments, `///`, `//!`, `/**` and `/*!` doc comments.
+struct RustSpec {
+  static constexpr std::array<BlockRule, 3> blocks{ { { "/**", "*/", true }, { "/*!", "*/", true }, { "/*", "*/", false } } };
+  static constexpr std::string_view nested_open{ "/*" };
+  static constexpr std::array<std::string_view, 2> doc_lines{ "///", "//!" };
+  static constexpr std::array<std::string_view, 1> line_comments{ "//" };
+  static constexpr std::array<StringRule, 1> strings{ { { "\"", "\"", true, true, false } } };
+  static constexpr bool char_literals{ true };
+  static constexpr bool code_escapes{ false };
+  static constexpr bool comment_at_word_start{ false };
+};
+
+/// @brief Go: C-style comments, raw strings between backquotes.
+struct GoSpec {
+  static constexpr std::array<BlockRule, 1> blocks{ { { "/*", "*/", false } } };
+  static constexpr std::string_view nested_open{};
+  static constexpr std::array<std::string_view, 0> doc_lines{};
+  static constexpr std::array<std::string_view, 1> line_comments{ "//" };
+  static constexpr std::array<StringRule, 2> strings{ { { "`", "`", false, true, false }, { "\"", "\"", true, false, false } } };
+  static constexpr bool char_literals{ true };
+  static constexpr bool code_escapes{ false };
+  static constexpr bool comment_at_word_start{ false };
+};
+
+/// @brief Java: C-style comments, `/**` Javadoc, `"""` text blocks.
+struct JavaSpec {
+  static constexpr std::array<BlockRule, 2> blocks{ { { "/**", "*/", true }, { "/*", "*/", false } } };
+  static constexpr std::string_view nested_open{};
+  static constexpr std::array<std::string_view, 0> doc_lines{};
+  static constexpr std::array<std::string_view, 1> line_comments{ "//" };
+  static constexpr std::array<StringRule, 2> strings{ { { "\"\"\"", "\"\"\"", true, true, false }, { "\"", "\"", true, false, false } } };
+  static constexpr bool char_literals{ true };
+  static constexpr bool code_escapes{ false };
+  static constexpr bool comment_at_word_start{ false };
+};
+
+/// @brief POSIX shells: `#` comments at word starts, `'` strings without escapes.
+struct ShellSpec {
+  static constexpr std::array<BlockRule, 0> blocks{};
+  static constexpr std::string_view nested_open{};
+  static constexpr std::array<std::string_view, 0> doc_lines{};
+  static constexpr std::array<std::string_view, 1> line_comments{ "#" };
+  static constexpr std::array<StringRule, 2> strings{ { { "\"", "\"", true, true, false }, { "'", "'", false, true, false } } };
+  static constexpr bool char_literals{ false };
+  static constexpr bool code_escapes{ true };
+  static constexpr bool comment_at_word_start{ true };
+};
+
+/// @brief CMake: `#` comments and `#[[ ]]` bracket comments.
+struct CMakeSpec {
+  static constexpr std::array<BlockRule, 1> blocks{ { { "#[[", "]]", false } } };
+  static constexpr std::string_view nested_open{};
+  static constexpr std::array<std::string_view, 0> doc_lines{};
+  static constexpr std::array<std::string_view, 1> line_comments{ "#" };
+  static constexpr std::array<StringRule, 1> strings{ { { "\"", "\"", true, true, false } } };
+  static constexpr bool char_literals{ false };
+  static constexpr bool code_escapes{ true };
+  static constexpr bool comment_at_word_start{ false };
+};
+
+/// @brief Counting function of a spec, with the signature of process_buffer().
+template <class Spec>
+AttributeCount count_with(std::string_view content, ThreadPool*) {
+  return scan_language<Spec>(content);
+}
+
+/// @brief Line classifying function of a spec.
+template <class Spec>
+void classify_with(std::string_view content, LineState& state, std::vector<std::uint8_t>& lines) {
+  scan_language_lines<Spec>(content, state.scanner, [&lines](std::uint8_t line_class) { lines.push_back(line_class); });
+}
+
+/// @brief Line classifying function of C and C++.
+void classify_c(std::string_view content, LineState& state, std::vector<std::uint8_t>& lines) {
+  lexer_classify_lines(content, state.lexer, lines);
+}
+
+//== Names
+
+constexpr std::string_view NONE[] = { {} };
+constexpr std::string_view C_EXTENSIONS[] = { ".c", {} };
+constexpr std::string_view C_MODES[] = { "c", {} };
+constexpr std::string_view CPP_EXTENSIONS[] = { ".cpp", ".cc", ".cxx", ".c++", ".C", {} };
+constexpr std::string_view CPP_MODES[] = { "c++", "cpp", {} };
+constexpr std::string_view H_EXTENSIONS[] = { ".h", {} };
+constexpr std::string_view HPP_EXTENSIONS[] = { ".hpp", ".hh", ".hxx", ".h++", ".H", ".inl", ".ipp", ".tpp", ".tcc", {} };
+constexpr std::string_view PYTHON_EXTENSIONS[] = { ".py", ".pyw", {} };
+constexpr std::string_view PYTHON_INTERPRETERS[] = { "python", {} };
+constexpr std::string_view PYTHON_MODES[] = { "python", {} };
+constexpr std::string_view RUST_EXTENSIONS[] = { ".rs", {} };
+constexpr std::string_view RUST_MODES[] = { "rust", {} };
+constexpr std::string_view GO_EXTENSIONS[] = { ".go", {} };
+constexpr std::string_view GO_MODES[] = { "go", {} };
+constexpr std::string_view JAVA_EXTENSIONS[] = { ".java", {} };
+constexpr std::string_view JAVA_MODES[] = { "java", {} };
+constexpr std::string_view SHELL_EXTENSIONS[] = { ".sh", ".bash", ".zsh", ".ksh", {} };
+constexpr std::string_view SHELL_INTERPRETERS[] = { "sh", "bash", "zsh", "ksh", "dash", "ash", {} };
+constexpr std::string_view SHELL_MODES[] = { "sh", "shell-script", "bash", "zsh", "ksh", {} };
+constexpr std::string_view CMAKE_EXTENSIONS[] = { ".cmake", {} };
+constexpr std::string_view CMAKE_FILE_NAMES[] = { "CMakeLists.txt", {} };
+constexpr std::string_view CMAKE_MODES[] = { "cmake", {} };
+
+/// @brief The languages, indexed by lang_type_e.
+const LanguageInfo LANGUAGES[] = {
+  { C, "C", C_EXTENSIONS, NONE, NONE, C_MODES, process_buffer, classify_c },
+  { CPP, "C++", CPP_EXTENSIONS, NONE, NONE, CPP_MODES, process_buffer, classify_c },
+  { H, "C/C++ header", H_EXTENSIONS, NONE, NONE, NONE, process_buffer, classify_c },
+  { HPP, "C++ header", HPP_EXTENSIONS, NONE, NONE, NONE, process_buffer, classify_c },
+  { PYTHON, "Python", PYTHON_EXTENSIONS, NONE, PYTHON_INTERPRETERS, PYTHON_MODES, count_with<PythonSpec>, classify_with<PythonSpec> },
+  { RUST, "Rust", RUST_EXTENSIONS, NONE, NONE, RUST_MODES, count_with<RustSpec>, classify_with<RustSpec> },
+  { GO, "Go", GO_EXTENSIONS, NONE, NONE, GO_MODES, count_with<GoSpec>, classify_with<GoSpec> },
+  { JAVA, "Java", JAVA_EXTENSIONS, NONE, NONE, JAVA_MODES, count_with<JavaSpec>, classify_with<JavaSpec> },
+  { SHELL, "Shell", SHELL_EXTENSIONS, NONE, SHELL_INTERPRETERS, SHELL_MODES, count_with<ShellSpec>, classify_with<ShellSpec> },
+  { CMAKE, "CMake", CMAKE_EXTENSIONS, CMAKE_FILE_NAMES, NONE, CMAKE_MODES, count_with<CMakeSpec>, classify_with<CMakeSpec> },
+  { UNDEF, "Undefined type", NONE, NONE, NONE, NONE, process_buffer, classify_c },
+};
+
+static_assert(sizeof(LANGUAGES) / sizeof(LANGUAGES[0]) == UNDEF + 1, "one row per language, in lang_type_e order");
+
+/// @brief Whether a name is in an empty-terminated list.
+bool listed(const std::string_view* list, std::string_view name) {
+  for (; !list->empty(); ++list) {
+    if (*list == name) return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+/**
+ * @brief Description of a language.
+ *
+ * @param lang_type The language.
+ *
+ * @return Its row of the language table (the UNDEF row for unknown values).
+ */
+const LanguageInfo& language_info(lang_type_e lang_type) {
+  return LANGUAGES[lang_type < UNDEF ? lang_type : UNDEF];
+}
+
+/**
+ * @brief Language of a file, from its name.
+ *
+ * @param path File name or path.
+ *
+ * Whole file names (like `CMakeLists.txt`) are checked first, then the
+ * extensions, matched as suffixes of the name.
+ *
+ * @return The language, or UNDEF if the name is not recognized.
+ */
+lang_type_e language_by_file_name(std::string_view path) {
+  std::size_t slash = path.rfind('/');
+  std::string_view name = slash == std::string_view::npos ? path : path.substr(slash + 1);
+
+  for (const auto& language : LANGUAGES) {
+    if (listed(language.file_names, name)) return language.type;
+  }
+  for (const auto& language : LANGUAGES) {
+    for (const std::string_view* extension = language.extensions; !extension->empty(); ++extension) {
+      if (name.size() >= extension->size() && name.substr(name.size() - extension->size()) == *extension) {
+        return language.type;
+      }
+    }
+  }
+  return UNDEF;
+}
+
+/**
+ * @brief Language of a script, from its shebang line.
+ *
+ * @param content The start of the file (the first line is enough).
+ *
+ * Understands `#!/path/to/interpreter` and `#!/usr/bin/env [-S] interpreter`.
+ * Version suffixes are ignored, so `python3.12` is Python.
+ *
+ * @return The language, or UNDEF without a shebang of a known interpreter.
+ */
+lang_type_e language_by_shebang(std::string_view content) {
+  if (content.substr(0, 2) != "#!") return UNDEF;
+  std::string_view line = content.substr(0, content.find('\n')).substr(2);
+
+  auto next_word = [&line] {
+    std::size_t begin = line.find_first_not_of(" \t\r");
+    if (begin == std::string_view::npos) return std::string_view{};
+    std::size_t end = line.find_first_of(" \t\r", begin);
+    std::string_view word = line.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin);
+    line.remove_prefix(end == std::string_view::npos ? line.size() : end);
+    return word;
+  };
+  auto base_name = [](std::string_view word) {
+    std::size_t slash = word.rfind('/');
+    return slash == std::string_view::npos ? word : word.substr(slash + 1);
+  };
+
+  std::string_view interpreter = base_name(next_word());
+  if (interpreter == "env") {
+    do {
+      interpreter = next_word();
+    } while (!interpreter.empty() && interpreter.front() == '-');
+    interpreter = base_name(interpreter);
+  }
+  std::size_t version = interpreter.find_last_not_of("0123456789.");
+  interpreter = interpreter.substr(0, version == std::string_view::npos ? 0 : version + 1);
+  if (interpreter.empty()) return UNDEF;
+
+  for (const auto& language : LANGUAGES) {
+    if (listed(language.interpreters, interpreter)) return language.type;
+  }
+  return UNDEF;
+}
+
+/**
+ * @brief Language named by an editor modeline.
+ *
+ * @param mode Mode name, as in `-*- mode: c++ -*-` or `vim: ft=cpp`, in any case.
+ *
+ * @return The language, or UNDEF for modes of other languages. C and C++
+ *         modes give C and CPP: whether the file is a header is up to the
+ *         caller (see sniff_language()).
+ */
+lang_type_e language_by_mode_name(std::string_view mode) {
+  char lower[32];
+  if (mode.empty() || mode.size() > sizeof(lower)) return UNDEF;
+  for (std::size_t i{ 0 }; i < mode.size(); ++i) {
+    lower[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(mode[i])));
+  }
+  for (const auto& language : LANGUAGES) {
+    if (listed(language.modes, std::string_view(lower, mode.size()))) return language.type;
+  }
+  return UNDEF;
+}
+
+/**
+ * @brief Language of a file, from its name or else from its content.
+ *
+ * @param path Path to the file.
+ *
+ * Only reads the head of files whose name is not recognized (see
+ * sniff_language()).
+ *
+ * @return The language, or UNDEF.
+ */
+lang_type_e language_of_file(const std::string& path) {
+  lang_type_e type = language_by_file_name(path);
+  if (type != UNDEF) return type;
+
+  FileBuffer file(path, SNIFF_BYTES);
+  return file.ok() ? sniff_language(file.view()).type : UNDEF;
+}
+
+/**
+ * @brief Count the lines of a file content with the scanner of its language.
+ *
+ * @param lang_type Language of the content.
+ * @param content Whole content of a file.
+ * @param pool Pool to split big C/C++ contents over, or nullptr.
+ *
+ * @return AttributeCount with all line counts.
+ */
+AttributeCount count_language(lang_type_e lang_type, std::string_view content, ThreadPool* pool) {
+  return language_info(lang_type).count(content, pool);
+}
+
+/**
+ * @brief Classify each line of a file content with the scanner of its language.
+ *
+ * @param lang_type Language of the content.
+ * @param content Whole content of a file.
+ * @param lines Receives the line_class_e flags of each line, in order.
+ *
+ * Lines are split and classified exactly as count_language() counts them:
+ * as many flags are appended as it counts lines.
+ */
+void classify_language(lang_type_e lang_type, std::string_view content, std::vector<std::uint8_t>& lines) {
+  LineState state;
+  language_info(lang_type).classify(content, state, lines);
+}
+
+/**
+ * @brief Classify each line of some whole lines of a file, from a saved state.
+ *
+ * @param lang_type Language of the file.
+ * @param lines_text Whole lines of the file, starting at a line start.
+ * @param state State of the scanner at the start of `lines_text` (a default
+ *        LineState at the start of the file); updated to its state at the end.
+ * @param lines Receives the line_class_e flags of each line, in order.
+ *
+ * Classifying a content in pieces of whole lines, passing the state on,
+ * gives the same flags as classifying it at once.
+ */
+void classify_language(lang_type_e lang_type, std::string_view lines_text, LineState& state, std::vector<std::uint8_t>& lines) {
+  language_info(lang_type).classify(lines_text, state, lines);
+}
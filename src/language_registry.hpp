@@ -0,0 +1,137 @@
+#ifndef LANGUAGE_REGISTRY_HPP
+#define LANGUAGE_REGISTRY_HPP
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "language_scanner.hpp"
+#include "lexer_table.hpp"
+#include "main.hpp"
+
+/*!
+ * @file language_registry.hpp
+ * @description
+ * The languages sloc knows: how their files are recognized (extensions,
+ * file names, shebang interpreters, editor modes) and which scanner counts
+ * them.
+ */
+
+/**
+ * @brief Version of the line classification, saved with cached counts.
+ *
+ * Bump it with any change to a scanner, the C/C++ lexer or the language
+ * sniffer that may change the counts of a file: counts cached by an
+ * older version are then dropped instead of being reused.
+ */
+constexpr std::uint32_t CLASSIFIER_VERSION{ 3 };
+
+//== Structs
+
+/**
+ * @struct LineState
+ * @brief Where the scanner of any language stands at the start of a line.
+ *
+ * Only the member of the scanner of the language is used; the other keeps
+ * its initial value, so states of the same language compare as a whole.
+ */
+struct LineState {
+  LexerCursor lexer;    //!< Table-driven C/C++ lexer (see lexer_table.hpp).
+  ScannerState scanner; //!< Spec-generated scanner of the other languages (see language_scanner.hpp).
+
+  /// @brief Whether two states will classify what follows the same way.
+  bool same_as(const LineState& other) const { return lexer.same_as(other.lexer) && scanner == other.scanner; }
+};
+
+/**
+ * @struct LanguageInfo
+ * @brief Everything the rest of the program needs to know about a language.
+ *
+ * The name lists end with an empty string_view.
+ */
+struct LanguageInfo {
+  lang_type_e type;                     //!< Language.
+  std::string_view name;                //!< Name shown in reports.
+  const std::string_view* extensions;   //!< File name suffixes, dot included.
+  const std::string_view* file_names;   //!< Whole file names (e.g. "CMakeLists.txt").
+  const std::string_view* interpreters; //!< Shebang interpreters, without version suffix.
+  const std::string_view* modes;        //!< Emacs/Vim mode names, in lower case.
+  AttributeCount (*count)(std::string_view content, ThreadPool* pool); //!< Counts the lines of a file content.
+  void (*classify)(std::string_view content, LineState& state, std::vector<std::uint8_t>& lines); //!< Appends the line_class_e flags of each line.
+};
+
+//== Functions
+
+/**
+ * @brief Description of a language.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see language_info()
+ */
+const LanguageInfo& language_info(lang_type_e lang_type);
+
+/**
+ * @brief Language of a file, from its name.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see language_by_file_name()
+ */
+lang_type_e language_by_file_name(std::string_view path);
+
+/**
+ * @brief Language of a script, from its shebang line.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see language_by_shebang()
+ */
+lang_type_e language_by_shebang(std::string_view content);
+
+/**
+ * @brief Language named by an editor modeline.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see language_by_mode_name()
+ */
+lang_type_e language_by_mode_name(std::string_view mode);
+
+/**
+ * @brief Language of a file, from its name or else from its content.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see language_of_file()
+ */
+lang_type_e language_of_file(const std::string& path);
+
+/**
+ * @brief Count the lines of a file content with the scanner of its language.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see count_language()
+ */
+AttributeCount count_language(lang_type_e lang_type, std::string_view content, ThreadPool* pool = nullptr);
+
+/**
+ * @brief Classify each line of a file content with the scanner of its language.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see classify_language()
+ */
+void classify_language(lang_type_e lang_type, std::string_view content, std::vector<std::uint8_t>& lines);
+
+/**
+ * @brief Classify each line of some whole lines of a file, from a saved state.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see classify_language()
+ */
+void classify_language(lang_type_e lang_type, std::string_view lines_text, LineState& state, std::vector<std::uint8_t>& lines);
+
+#endif
@@ -0,0 +1,384 @@
+#ifndef LANGUAGE_SCANNER_HPP
+#define LANGUAGE_SCANNER_HPP
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "main.hpp"
+#include "scan_simd.hpp"
+
+/*!
+ * @file language_scanner.hpp
+ * @description
+ * Line classifier generated from a lexer spec, for the languages other than
+ * C/C++ (which keep their own table-driven lexer, see lexer_table.hpp).
+ *
+ * A spec is a struct of `static constexpr` members describing the comment
+ * and string syntax of a language:
+ *
+ * - `blocks`: block comment rules (BlockRule), longest opener first;
+ * - `nested_open`: opener that nests inside a block comment (empty if
+ *   block comments do not nest);
+ * - `doc_lines`, `line_comments`: line comment markers, doc ones first;
+ * - `strings`: string rules (StringRule), longest opener first;
+ * - `char_literals`: whether `'x'`/`'\x'` are character literals (a lone
+ *   `'` is left as code, e.g. a Rust lifetime);
+ * - `code_escapes`: whether `\` escapes the next byte outside strings;
+ * - `comment_at_word_start`: whether line comments only start at the
+ *   beginning of a word (as `#` in shell, where `$#` is code).
+ *
+ * scan_language<Spec>() is instantiated once per spec, so every rule is a
+ * compile-time constant and the loops over them are unrolled: a language
+ * only pays for the syntax it has.
+ *
+ * Counting follows the C/C++ classifier: a line may count as code and as a
+ * comment at once; lines inside a block comment are comment lines even when
+ * empty; other lines with nothing but whitespace are blank.
+ */
+
+//== Structs
+
+/**
+ * @struct BlockRule
+ * @brief A block comment syntax.
+ */
+struct BlockRule {
+  std::string_view open;  //!< Opening token.
+  std::string_view close; //!< Closing token.
+  bool doc;               //!< Whether it is a doc comment.
+};
+
+/**
+ * @struct StringRule
+ * @brief A string literal syntax.
+ */
+struct StringRule {
+  std::string_view open;  //!< Opening token.
+  std::string_view close; //!< Closing token.
+  bool escapes;           //!< Whether `\` escapes the next byte.
+  bool multiline;         //!< Whether the literal may span lines (otherwise a newline ends it).
+  bool doc;               //!< Whether it is a docstring when nothing but whitespace precedes it on its line.
+};
+
+/**
+ * @struct ScannerState
+ * @brief Where scan_language_lines() stands between two lines.
+ *
+ * Everything a line inherits from the lines before it; two equal states
+ * scan whatever follows the same way.
+ */
+struct ScannerState {
+  /// @brief What the scanner is inside of.
+  enum mode_e : std::uint8_t {
+    M_CODE,   //!< Code (or nothing yet).
+    M_BLOCK,  //!< A block comment.
+    M_STRING, //!< A string literal.
+  };
+
+  mode_e mode{ M_CODE };    //!< What the scanner is inside of.
+  std::uint8_t rule{ 0 };   //!< Block or string rule in use.
+  bool doc_string{ false }; //!< Whether the string is a docstring.
+  std::uint32_t depth{ 0 }; //!< Nesting of block comments.
+
+  /// @brief Whether two states will scan what follows the same way.
+  bool operator==(const ScannerState& other) const {
+    return mode == other.mode && rule == other.rule && doc_string == other.doc_string && depth == other.depth;
+  }
+};
+
+namespace language_scanner_detail {
+
+/// @brief Whether a byte is whitespace for the blank line test.
+constexpr bool is_space(char ch) {
+  return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+/// @brief Whether a token starts at `p`.
+inline bool starts_with(const char* p, const char* end, std::string_view token) {
+  return static_cast<std::size_t>(end - p) >= token.size() && std::string_view(p, token.size()) == token;
+}
+
+/// @brief Whether `[first, last)` has a byte other than whitespace.
+inline bool has_ink(const char* first, const char* last) {
+  for (; first != last; ++first) {
+    if (!is_space(*first) && *first != '\n') return true;
+  }
+  return false;
+}
+
+/// @brief Add a byte to the characters of a set being built, once.
+constexpr void add_stop(std::array<char, DelimiterSet::MAX_SIZE>& bytes, std::size_t& n, char ch) {
+  for (std::size_t i{ 0 }; i < n; ++i) {
+    if (bytes[i] == ch) return;
+  }
+  if (n < bytes.size()) bytes[n++] = ch;
+}
+
+/**
+ * @brief Bytes that may start a token in code.
+ *
+ * Anything else is plain code, and is skipped with find_delimiter().
+ */
+template <class Spec>
+constexpr DelimiterSet code_stops() {
+  std::array<char, DelimiterSet::MAX_SIZE> bytes{};
+  std::size_t n{ 0 };
+  add_stop(bytes, n, '\n');
+  for (const auto& rule : Spec::blocks) add_stop(bytes, n, rule.open[0]);
+  for (const auto& token : Spec::doc_lines) add_stop(bytes, n, token[0]);
+  for (const auto& token : Spec::line_comments) add_stop(bytes, n, token[0]);
+  for (const auto& rule : Spec::strings) add_stop(bytes, n, rule.open[0]);
+  if (Spec::char_literals) add_stop(bytes, n, '\'');
+  if (Spec::code_escapes) add_stop(bytes, n, '\\');
+  return DelimiterSet{ std::string_view(bytes.data(), n) };
+}
+
+/// @brief Bytes that matter inside each block comment rule.
+template <class Spec>
+constexpr std::array<DelimiterSet, Spec::blocks.size()> block_stops() {
+  std::array<DelimiterSet, Spec::blocks.size()> sets{};
+  for (std::size_t r{ 0 }; r < Spec::blocks.size(); ++r) {
+    std::array<char, DelimiterSet::MAX_SIZE> bytes{};
+    std::size_t n{ 0 };
+    add_stop(bytes, n, '\n');
+    add_stop(bytes, n, Spec::blocks[r].close[0]);
+    if (!Spec::nested_open.empty()) add_stop(bytes, n, Spec::nested_open[0]);
+    sets[r] = DelimiterSet{ std::string_view(bytes.data(), n) };
+  }
+  return sets;
+}
+
+/// @brief Bytes that matter inside each string rule.
+template <class Spec>
+constexpr std::array<DelimiterSet, Spec::strings.size()> string_stops() {
+  std::array<DelimiterSet, Spec::strings.size()> sets{};
+  for (std::size_t r{ 0 }; r < Spec::strings.size(); ++r) {
+    std::array<char, DelimiterSet::MAX_SIZE> bytes{};
+    std::size_t n{ 0 };
+    add_stop(bytes, n, '\n');
+    add_stop(bytes, n, Spec::strings[r].close[0]);
+    if (Spec::strings[r].escapes) add_stop(bytes, n, '\\');
+    sets[r] = DelimiterSet{ std::string_view(bytes.data(), n) };
+  }
+  return sets;
+}
+
+}  // namespace language_scanner_detail
+
+//== Functions
+
+/**
+ * @brief Count the lines of a buffer with the lexer of a spec, reporting each line.
+ *
+ * @tparam Spec The lexer spec of the language (see the file description).
+ * @tparam OnLine Callable taking the line_class_e flags of a line.
+ * @param text Whole lines of a file: the whole content, or lines starting where `state` was saved.
+ * @param state Where the scanner stands at the start of `text`; updated to where it stands at its end.
+ * @param on_line Called once per line, in order, as the line is counted.
+ *
+ * A single pass over the buffer, newlines included. Runs of bytes that
+ * cannot end the current token (plain code, comment or string text) are
+ * skipped with find_delimiter(). Like `std::getline`, a last line without
+ * a trailing newline still counts.
+ *
+ * Scanning a content in several calls, each on whole lines and passing
+ * the state on, gives the same lines as a single call.
+ *
+ * @return The line counts.
+ */
+template <class Spec, class OnLine>
+AttributeCount scan_language_lines(std::string_view text, ScannerState& state, OnLine&& on_line) {
+  using namespace language_scanner_detail;
+  using mode_e = ScannerState::mode_e;
+  constexpr mode_e M_CODE{ ScannerState::M_CODE }, M_BLOCK{ ScannerState::M_BLOCK }, M_STRING{ ScannerState::M_STRING };
+  static constexpr DelimiterSet CODE_STOPS = code_stops<Spec>();
+  static constexpr auto BLOCK_STOPS = block_stops<Spec>();
+  static constexpr auto STRING_STOPS = string_stops<Spec>();
+
+  AttributeCount atr;
+  const char* p = text.data();
+  const char* end = p + text.size();
+  const char* line_start = p;
+  mode_e mode = state.mode;
+  std::size_t rule{ state.rule };   //block or string rule in use
+  std::size_t depth{ state.depth }; //nesting of block comments
+  bool doc_string{ state.doc_string };
+  bool ink{ false }, code{ false }, com{ false }, dox{ false };
+  bool string_line{ false }; //line started inside a (non-doc) string
+
+  auto start_line = [&] { //a line starting inside a comment or string
+    if constexpr (Spec::blocks.size() > 0) {
+      if (mode == M_BLOCK) (Spec::blocks[rule].doc ? dox : com) = true;
+    }
+    if (mode == M_STRING) (doc_string ? dox : string_line) = true;
+  };
+  start_line();
+
+  auto end_line = [&] {
+    ++atr.lines;
+    if (string_line && ink) code = true;
+    on_line(static_cast<std::uint8_t>((!ink && !com && !dox ? LINE_BLANK : 0) | (code ? LINE_CODE : 0)
+                                      | (com ? LINE_COMMENT : 0) | (dox ? LINE_DOC : 0)));
+    atr.blank += !ink && !com && !dox;
+    atr.loc += code;
+    atr.com += com;
+    atr.dox += dox;
+    ink = code = com = dox = string_line = false;
+    start_line();
+  };
+
+  while (p != end) {
+    if (mode == M_CODE) {
+      char ch = *p;
+      if (ch == '\n') {
+        ++p;
+        end_line();
+        line_start = p;
+        continue;
+      }
+      if (is_space(ch)) {
+        ++p;
+        continue;
+      }
+
+      bool matched{ false };
+      for (std::size_t r{ 0 }; r < Spec::blocks.size() && !matched; ++r) {
+        const BlockRule& block = Spec::blocks[r];
+        if (!starts_with(p, end, block.open)) continue;
+        //a doc opener whose tail closes right away ("/**/") is an empty regular comment
+        if (block.doc && starts_with(p + block.open.size() - (block.close.size() - 1), end, block.close)) continue;
+        (block.doc ? dox : com) = true;
+        ink = true;
+        mode = M_BLOCK;
+        rule = r;
+        depth = 1;
+        p += block.open.size();
+        matched = true;
+      }
+      if (matched) continue;
+
+      bool word_start = !Spec::comment_at_word_start || p == line_start || is_space(p[-1]) || p[-1] == ';'
+                        || p[-1] == '|' || p[-1] == '&' || p[-1] == '(' || p[-1] == ')';
+      for (const auto& token : Spec::doc_lines) {
+        if (!matched && word_start && starts_with(p, end, token)) {
+          dox = ink = matched = true;
+        }
+      }
+      for (const auto& token : Spec::line_comments) {
+        if (!matched && word_start && starts_with(p, end, token)) {
+          com = ink = matched = true;
+        }
+      }
+      if (matched) { //the rest of the line is comment
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        p = eol ? eol : end;
+        continue;
+      }
+
+      for (std::size_t r{ 0 }; r < Spec::strings.size() && !matched; ++r) {
+        const StringRule& string = Spec::strings[r];
+        if (!starts_with(p, end, string.open)) continue;
+        doc_string = string.doc && !ink;
+        (doc_string ? dox : code) = true;
+        ink = true;
+        mode = M_STRING;
+        rule = r;
+        p += string.open.size();
+        matched = true;
+      }
+      if (matched) continue;
+
+      ink = code = true;
+      if (Spec::char_literals && ch == '\'') { //'x' and '\x' are literals, a lone ' is code
+        if (end - p >= 3 && p[1] == '\\') {
+          const char* q = p + 3;
+          while (q < end && *q != '\'' && *q != '\n') ++q;
+          p = (q < end && *q == '\'') ? q + 1 : p + 1;
+          continue;
+        }
+        if (end - p >= 3 && p[1] != '\n' && p[2] == '\'') {
+          p += 3;
+          continue;
+        }
+      }
+      if (Spec::code_escapes && ch == '\\' && end - p >= 2 && p[1] != '\n') {
+        p += 2;
+        continue;
+      }
+      p = find_delimiter(p + 1, end, CODE_STOPS);
+    } else if (mode == M_BLOCK) {
+      if constexpr (Spec::blocks.size() > 0) {
+        const BlockRule& block = Spec::blocks[rule];
+        const char* q = find_delimiter(p, end, BLOCK_STOPS[rule]);
+        if (!ink && has_ink(p, q)) ink = true;
+        p = q;
+        if (p == end) break;
+        if (*p == '\n') {
+          ++p;
+          end_line();
+          line_start = p;
+        } else if (starts_with(p, end, block.close)) {
+          ink = true;
+          p += block.close.size();
+          if (--depth == 0) mode = M_CODE;
+        } else if (!Spec::nested_open.empty() && starts_with(p, end, Spec::nested_open)) {
+          ++depth;
+          p += Spec::nested_open.size();
+        } else {
+          ink = true;
+          ++p;
+        }
+      }
+    } else {
+      const StringRule& string = Spec::strings[rule];
+      const char* q = find_delimiter(p, end, STRING_STOPS[rule]);
+      if (!ink && has_ink(p, q)) ink = true;
+      p = q;
+      if (p == end) break;
+      if (*p == '\n') {
+        if (!string.multiline) mode = M_CODE; //unterminated: give up at the end of the line
+        ++p;
+        end_line();
+        line_start = p;
+      } else if (string.escapes && *p == '\\') {
+        ink = true;
+        p += (end - p >= 2 && p[1] != '\n') ? 2 : 1;
+      } else if (starts_with(p, end, string.close)) {
+        ink = true;
+        p += string.close.size();
+        mode = M_CODE;
+      } else {
+        ink = true;
+        ++p;
+      }
+    }
+  }
+
+  if (p != line_start) end_line();
+  state.mode = mode;
+  state.rule = static_cast<std::uint8_t>(rule);
+  state.depth = static_cast<std::uint32_t>(depth);
+  state.doc_string = doc_string;
+  return atr;
+}
+
+/**
+ * @brief Count the lines of a buffer with the lexer of a spec.
+ *
+ * @tparam Spec The lexer spec of the language (see the file description).
+ * @param text Whole content of a file.
+ *
+ * scan_language_lines() with nothing to report per line, which the
+ * compiler drops entirely.
+ *
+ * @return The line counts.
+ */
+template <class Spec>
+AttributeCount scan_language(std::string_view text) {
+  ScannerState state;
+  return scan_language_lines<Spec>(text, state, [](std::uint8_t) {});
+}
+
+#endif
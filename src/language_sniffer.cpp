@@ -0,0 +1,354 @@
+/*!
+ * @file language_sniffer.cpp
+ * @description
+ * Implementation of the content-based language detection.
+ *
+ * Only the first SNIFF_BYTES bytes are looked at, in three stages, from
+ * the surest to the least sure:
+ *
+ * 1. a shebang line (`#!/usr/bin/env python3`);
+ * 2. an editor modeline: Emacs `-*- C++ -*-` or `-*- mode: python -*-` on
+ *    one of the first two lines, Vim `vim: set ft=cpp:` on one of the
+ *    first (or, for a file that fits in the head, last) five lines;
+ * 3. token frequency: lines are matched against a table of tokens typical
+ *    of each language (`#include`, `def f(...):`, `fn`, `package`...), and
+ *    the language with the highest score wins if it is both high enough and
+ *    ahead of the next one.
+ *
+ * Binary files (a NUL byte, or many control characters) are never source
+ * code. C and C++ found by a modeline or by their tokens are headers when
+ * they have an include guard or `#pragma once`.
+ */
+
+#include "language_sniffer.hpp"
+
+#include <cctype>
+
+#include "language_registry.hpp"
+
+namespace {
+
+/**
+ * @struct TokenRule
+ * @brief A token typical of a language, at the start of a line.
+ */
+struct TokenRule {
+  std::string_view prefix; //!< Start of the line (after indentation), ending at a word boundary.
+  std::string_view also;   //!< Text that must also appear later on the line (may be empty).
+  lang_type_e type;        //!< Language it points to (C for C and C++, CPP for C++ only).
+  int weight;              //!< Score it adds.
+};
+
+/// @brief Tokens counted by the frequency stage.
+constexpr TokenRule TOKEN_RULES[] = {
+  { "#include", "", C, 3 },
+  { "#define", "", C, 2 },
+  { "#ifndef", "", C, 2 },
+  { "#ifdef", "", C, 1 },
+  { "#if", "", C, 1 },
+  { "#endif", "", C, 1 },
+  { "#pragma", "", C, 2 },
+  { "typedef", ";", C, 2 },
+  { "struct", "{", C, 1 },
+  { "namespace", "", CPP, 3 },
+  { "template", "<", CPP, 3 },
+  { "using namespace", ";", CPP, 3 },
+  { "public:", "", CPP, 3 },
+  { "private:", "", CPP, 3 },
+  { "protected:", "", CPP, 3 },
+  { "constexpr", "", CPP, 2 },
+  { "std::", "", CPP, 2 },
+  { "def", "):", PYTHON, 3 },
+  { "from", " import ", PYTHON, 3 },
+  { "import", "", PYTHON, 1 },
+  { "elif", ":", PYTHON, 3 },
+  { "if __name__", "", PYTHON, 3 },
+  { "self.", "", PYTHON, 1 },
+  { "fn", "(", RUST, 3 },
+  { "pub fn", "(", RUST, 3 },
+  { "let mut", "", RUST, 3 },
+  { "use", "::", RUST, 2 },
+  { "impl", "{", RUST, 3 },
+  { "#[", "]", RUST, 2 },
+  { "mod", ";", RUST, 2 },
+  { "package", "", GO, 1 },
+  { "func", "", GO, 3 },
+  { "import (", "", GO, 3 },
+  { "package", ";", JAVA, 3 },
+  { "import java", ";", JAVA, 3 },
+  { "public class", "", JAVA, 3 },
+  { "public static", "", JAVA, 2 },
+  { "@Override", "", JAVA, 3 },
+  { "fi", "", SHELL, 3 },
+  { "esac", "", SHELL, 3 },
+  { "done", "", SHELL, 2 },
+  { "then", "", SHELL, 2 },
+  { "if [", "", SHELL, 3 },
+  { "elif [", "", SHELL, 3 },
+  { "echo", "", SHELL, 2 },
+  { "export", "=", SHELL, 1 },
+  { "local", "", SHELL, 1 },
+  { "set -e", "", SHELL, 3 },
+  { "for", "; do", SHELL, 2 },
+  { "while", "; do", SHELL, 2 },
+  { "case", " in", SHELL, 2 },
+  { "cmake_minimum_required(", "", CMAKE, 5 },
+  { "project(", "", CMAKE, 2 },
+  { "add_executable(", "", CMAKE, 3 },
+  { "add_library(", "", CMAKE, 3 },
+  { "target_link_libraries(", "", CMAKE, 3 },
+  { "find_package(", "", CMAKE, 3 },
+  { "include_directories(", "", CMAKE, 3 },
+  { "set(", "", CMAKE, 2 },
+  { "endif(", "", CMAKE, 3 },
+};
+
+/// @brief Score the winner of the frequency stage needs at least.
+constexpr int MIN_SCORE{ 6 };
+
+/// @brief Lines looked at for a Vim modeline, at each end of the file.
+constexpr int VIM_MODELINE_LINES{ 5 };
+
+/// @brief Whether a byte can be part of an identifier.
+bool is_word(char ch) {
+  return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_';
+}
+
+/// @brief A string without its leading and trailing whitespace.
+std::string_view trim(std::string_view text) {
+  std::size_t begin = text.find_first_not_of(" \t\r\f\v");
+  if (begin == std::string_view::npos) return {};
+  std::size_t end = text.find_last_not_of(" \t\r\f\v");
+  return text.substr(begin, end - begin + 1);
+}
+
+/// @brief Case-insensitive comparison of two ASCII strings.
+bool iequals(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) return false;
+  for (std::size_t i{ 0 }; i < a.size(); ++i) {
+    if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) return false;
+  }
+  return true;
+}
+
+/// @brief Split a text in lines (without their newline), calling `fn` on each until it returns false.
+template <class Fn>
+void for_each_line(std::string_view text, Fn fn) {
+  while (!text.empty()) {
+    std::size_t eol = text.find('\n');
+    if (!fn(text.substr(0, eol))) return;
+    text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+  }
+}
+
+/**
+ * @brief Whether a head looks like binary data rather than text.
+ *
+ * A NUL byte, or more than one byte in 32 being a control character other
+ * than whitespace and escape.
+ */
+bool looks_binary(std::string_view head) {
+  std::size_t control{ 0 };
+  for (char ch : head) {
+    unsigned char byte = static_cast<unsigned char>(ch);
+    if (byte == 0) return true;
+    if (byte < 0x20 && byte != '\n' && byte != '\r' && byte != '\t' && byte != '\f' && byte != '\v' && byte != 0x1b) {
+      ++control;
+    }
+  }
+  return control * 32 > head.size();
+}
+
+/**
+ * @brief Language of an Emacs modeline (`-*- C++ -*-`, `-*- mode: c++; ... -*-`).
+ */
+lang_type_e emacs_mode(std::string_view line) {
+  std::size_t open = line.find("-*-");
+  if (open == std::string_view::npos) return UNDEF;
+  std::size_t close = line.find("-*-", open + 3);
+  if (close == std::string_view::npos) return UNDEF;
+  std::string_view vars = line.substr(open + 3, close - open - 3);
+  if (vars.find(':') == std::string_view::npos) return language_by_mode_name(trim(vars));
+
+  while (!vars.empty()) {
+    std::size_t semicolon = vars.find(';');
+    std::string_view var = vars.substr(0, semicolon);
+    vars.remove_prefix(semicolon == std::string_view::npos ? vars.size() : semicolon + 1);
+    std::size_t colon = var.find(':');
+    if (colon != std::string_view::npos && iequals(trim(var.substr(0, colon)), "mode")) {
+      return language_by_mode_name(trim(var.substr(colon + 1)));
+    }
+  }
+  return UNDEF;
+}
+
+/**
+ * @brief Language of a Vim modeline (`vim: set ft=cpp:`, `vi: filetype=python`).
+ */
+lang_type_e vim_mode(std::string_view line) {
+  for (std::string_view marker : { "vim:", "vi:", "ex:" }) {
+    std::size_t at = line.find(marker);
+    while (at != std::string_view::npos && at > 0 && line[at - 1] != ' ' && line[at - 1] != '\t') {
+      at = line.find(marker, at + 1); //"vi:" must not be the end of another word
+    }
+    if (at == std::string_view::npos) continue;
+
+    std::string_view options = line.substr(at + marker.size());
+    while (!options.empty()) {
+      std::size_t begin = options.find_first_not_of(" \t:");
+      if (begin == std::string_view::npos) break;
+      std::size_t end = options.find_first_of(" \t:", begin);
+      std::string_view option = options.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin);
+      options.remove_prefix(end == std::string_view::npos ? options.size() : end);
+
+      std::size_t equal = option.find('=');
+      if (equal == std::string_view::npos) continue;
+      std::string_view name = option.substr(0, equal);
+      if (name == "ft" || name == "filetype" || name == "syn" || name == "syntax") {
+        return language_by_mode_name(option.substr(equal + 1));
+      }
+    }
+  }
+  return UNDEF;
+}
+
+/**
+ * @brief Language declared by a modeline in the head.
+ *
+ * @param head Start of the file.
+ * @param whole Whether `head` is the whole file, so its last lines can be checked too.
+ */
+lang_type_e modeline_language(std::string_view head, bool whole) {
+  lang_type_e type{ UNDEF };
+  int line_no{ 0 };
+  for_each_line(head, [&](std::string_view line) {
+    if (line_no < 2) type = emacs_mode(line);
+    if (type == UNDEF) type = vim_mode(line);
+    return type == UNDEF && ++line_no < VIM_MODELINE_LINES;
+  });
+  if (type != UNDEF || !whole) return type;
+
+  std::size_t start = head.size();
+  for (int i{ 0 }; i <= VIM_MODELINE_LINES && start > 0; ++i) {
+    start = head.rfind('\n', start - 1);
+    if (start == std::string_view::npos) start = 0;
+  }
+  for_each_line(head.substr(start), [&](std::string_view line) {
+    type = vim_mode(line);
+    return type == UNDEF;
+  });
+  return type;
+}
+
+/**
+ * @brief Whether C/C++ code has an include guard or `#pragma once`.
+ */
+bool looks_like_header(std::string_view head) {
+  bool header{ false };
+  std::string_view guard;
+  for_each_line(head, [&](std::string_view line) {
+    line = trim(line);
+    if (line.empty() || line.front() != '#') {
+      if (!line.empty()) guard = {};
+      return true;
+    }
+    line = trim(line.substr(1));
+    std::size_t word_end = line.find_first_of(" \t");
+    std::string_view directive = line.substr(0, word_end);
+    std::string_view argument = word_end == std::string_view::npos ? std::string_view{} : trim(line.substr(word_end));
+    std::string_view name = argument.substr(0, argument.find_first_of(" \t"));
+
+    if (directive == "pragma" && (argument == "once" || argument == "GCC system_header")) {
+      header = true;
+    } else if (directive == "define" && !guard.empty() && name == guard) {
+      header = true;
+    }
+    guard = directive == "ifndef" ? name : std::string_view{};
+    return !header;
+  });
+  return header;
+}
+
+/**
+ * @brief Language with the highest token score, if it wins clearly enough.
+ */
+LanguageGuess token_language(std::string_view head) {
+  int scores[UNDEF + 1]{};
+  for_each_line(head, [&scores](std::string_view line) {
+    line = trim(line);
+    for (const TokenRule& rule : TOKEN_RULES) {
+      if (line.substr(0, rule.prefix.size()) != rule.prefix) continue;
+      if (line.size() > rule.prefix.size() && is_word(rule.prefix.back()) && is_word(line[rule.prefix.size()])) continue;
+      if (!rule.also.empty() && line.find(rule.also, rule.prefix.size()) == std::string_view::npos) continue;
+      scores[rule.type] += rule.weight;
+    }
+    return true;
+  });
+
+  int c_family = scores[C] + scores[CPP];
+  lang_type_e best{ UNDEF };
+  int best_score{ 0 }, second_score{ 0 };
+  for (lang_type_e type : { C, PYTHON, RUST, GO, JAVA, SHELL, CMAKE }) {
+    int score = type == C ? c_family : scores[type];
+    if (score > best_score) {
+      second_score = best_score;
+      best_score = score;
+      best = type;
+    } else if (score > second_score) {
+      second_score = score;
+    }
+  }
+  if (best_score < MIN_SCORE || best_score == second_score) return {};
+
+  if (best == C && scores[CPP] > 0) best = CPP;
+  return { best, best_score >= 2 * second_score ? CONFIDENCE_MEDIUM : CONFIDENCE_LOW };
+}
+
+}  // namespace
+
+/**
+ * @brief Guess the language of a file from the start of its content.
+ *
+ * @param content The content of the file, or at least its first SNIFF_BYTES
+ *        bytes; anything after them is ignored.
+ *
+ * @return The language and how it was found: CONFIDENCE_HIGH for a shebang
+ *         or a modeline, CONFIDENCE_MEDIUM or CONFIDENCE_LOW for the token
+ *         frequency. UNDEF if the content does not look like source code of
+ *         a known language.
+ */
+LanguageGuess sniff_language(std::string_view content) {
+  std::string_view head = content.substr(0, SNIFF_BYTES);
+  if (looks_binary(head)) return {};
+
+  lang_type_e type = language_by_shebang(head);
+  if (type != UNDEF) return { type, CONFIDENCE_HIGH };
+
+  LanguageGuess guess;
+  type = modeline_language(head, content.size() < SNIFF_BYTES);
+  if (type != UNDEF) {
+    guess = { type, CONFIDENCE_HIGH };
+  } else {
+    guess = token_language(head);
+  }
+  if ((guess.type == C || guess.type == CPP) && looks_like_header(head)) {
+    guess.type = guess.type == C ? H : HPP;
+  }
+  return guess;
+}
+
+/**
+ * @brief Name of a confidence level, as shown in reports.
+ *
+ * @param confidence The level.
+ *
+ * @return "certain", "high", "medium" or "low".
+ */
+std::string_view confidence_name(lang_confidence_e confidence) {
+  switch (confidence) {
+    case CONFIDENCE_CERTAIN: return "certain";
+    case CONFIDENCE_HIGH: return "high";
+    case CONFIDENCE_MEDIUM: return "medium";
+    default: return "low";
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef LANGUAGE_SNIFFER_HPP
+#define LANGUAGE_SNIFFER_HPP
+#include <cstddef>
+#include <string_view>
+
+#include "main.hpp"
+
+/*!
+ * @file language_sniffer.hpp
+ * @description
+ * Language detection from the content of a file, for files whose name does
+ * not tell (extensionless headers like libstdc++'s `<vector>`, scripts,
+ * misnamed files).
+ */
+
+/// @brief Bytes of the head of a file looked at to guess its language.
+constexpr std::size_t SNIFF_BYTES{ 4096 };
+
+//== Structs
+
+/**
+ * @struct LanguageGuess
+ * @brief A language and how sure the guess is.
+ */
+struct LanguageGuess {
+  lang_type_e type{ UNDEF };                      //!< Language, UNDEF if not source code.
+  lang_confidence_e confidence{ CONFIDENCE_LOW }; //!< How it was found.
+};
+
+//== Functions
+
+/**
+ * @brief Guess the language of a file from the start of its content.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see sniff_language()
+ */
+LanguageGuess sniff_language(std::string_view content);
+
+/**
+ * @brief Name of a confidence level, as shown in reports.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see confidence_name()
+ */
+std::string_view confidence_name(lang_confidence_e confidence);
+
+#endif
@@ -0,0 +1,615 @@
+/*!
+ * @file lexer_table.cpp
+ * @description
+ * Compile-time generation of the lexer transition table and the scanning
+ * loop that drives it.
+ */
+
+#include "lexer_table.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include "scan_simd.hpp"
+
+namespace {
+
+//== Byte classes
+
+/**
+ * @enum byte_class_e
+ * @brief The only distinctions the lexer makes between bytes.
+ */
+enum byte_class_e : std::uint8_t {
+  BC_OTHER = 0, //!< Anything else (tabs included, as in updateState()).
+  BC_SPACE,     //!< ' ', the only character trimmed by updateState().
+  BC_CR,        //!< '\r', which may sit between a continuation backslash and the newline.
+  BC_SLASH,     //!< '/'
+  BC_STAR,      //!< '*'
+  BC_BANG,      //!< '!'
+  BC_QUOTE,     //!< '"'
+  BC_APOS,      //!< '\''
+  BC_BSLASH,    //!< '\\'
+  BC_NEWLINE,   //!< '\n'
+  BC_R,         //!< 'R', the raw string prefix.
+  BC_N_CLASSES  //!< Number of classes.
+};
+
+/// @brief The byte standing for each class (none for BC_OTHER).
+constexpr char CLASS_BYTE[BC_N_CLASSES] = { '\0', ' ', '\r', '/', '*', '!', '"', '\'', '\\', '\n', 'R' };
+
+/// @brief Class of every byte value.
+constexpr std::array<std::uint8_t, 256> make_class_table() {
+  std::array<std::uint8_t, 256> table{};
+  for (std::uint8_t c{ 1 }; c < BC_N_CLASSES; ++c) {
+    table[static_cast<unsigned char>(CLASS_BYTE[c])] = c;
+  }
+  return table;
+}
+
+constexpr std::array<std::uint8_t, 256> BYTE_CLASS = make_class_table();
+
+//== Table entries
+//
+// An entry packs the next state in its low bits and, above them, the flags
+// the transition adds to the current line.
+
+constexpr std::uint16_t STATE_MASK{ 0x1f };
+constexpr std::uint16_t EM_LOC{ 1u << 5 };   //!< Line has code.
+constexpr std::uint16_t EM_COM{ 1u << 6 };   //!< Line has a regular comment.
+constexpr std::uint16_t EM_DOX{ 1u << 7 };   //!< Line has a doc comment.
+constexpr std::uint16_t EM_BLANK{ 1u << 8 }; //!< Line is blank.
+constexpr std::uint16_t EM_EOL{ 1u << 9 };   //!< Line ends here.
+constexpr std::uint16_t EM_RAW{ 1u << 10 };  //!< A raw string starts: lexer_scan() leaves the table.
+
+static_assert(LX_N_STATES <= STATE_MASK + 1, "lexer states do not fit in an entry");
+static_assert(LX_RAW_DELIM >= LX_RAW_LINE, "raw string states must come last");
+
+/// @brief Build a table entry.
+constexpr std::uint16_t go(lexer_state_e next, std::uint16_t flags = 0) {
+  return static_cast<std::uint16_t>(next | flags);
+}
+
+/**
+ * @brief Transition rules, written state by state.
+ *
+ * @param s Current state.
+ * @param c Class of the byte read.
+ *
+ * Each case mirrors a branch of updateState(). When a state was only
+ * waiting to see the next character, the rule settles the pending decision
+ * and then replays the byte from the state it settled in (the recursive
+ * calls), which is what the one-character lookahead of updateState() does.
+ *
+ * @return The table entry for (s, c).
+ */
+constexpr std::uint16_t step(lexer_state_e s, byte_class_e c) {
+  switch (s) {
+  case LX_START_LINE: //leading spaces are trimmed
+    switch (c) {
+    case BC_SPACE: return go(LX_START_LINE);
+    case BC_NEWLINE: return go(LX_START_LINE, EM_BLANK | EM_EOL);
+    default: return step(LX_CODE, c);
+    }
+  case LX_CODE:
+    switch (c) {
+    case BC_SPACE: return go(LX_CODE_SPACE);
+    case BC_NEWLINE: return go(LX_START_LINE, EM_EOL);
+    case BC_QUOTE: return go(LX_LITERAL, EM_LOC);
+    case BC_SLASH: return go(LX_SLASH);
+    case BC_APOS: return go(LX_CHAR_OPEN, EM_LOC);
+    case BC_R: return go(LX_CODE_R, EM_LOC);
+    default: return go(LX_CODE, EM_LOC);
+    }
+  case LX_CODE_SPACE: //inner spaces are code, trailing ones are trimmed
+    switch (c) {
+    case BC_SPACE: return go(LX_CODE_SPACE);
+    case BC_NEWLINE: return go(LX_START_LINE, EM_EOL);
+    default: return EM_LOC | step(LX_CODE, c);
+    }
+  case LX_CODE_R: // R" opens a raw string, lexer_scan() reads its delimiter
+    if (c == BC_QUOTE) return go(LX_RAW_DELIM, EM_LOC | EM_RAW);
+    return EM_LOC | step(LX_CODE, c);
+  case LX_SLASH:
+    switch (c) {
+    case BC_SLASH: return go(LX_SLASH_SLASH);
+    case BC_STAR: return go(LX_SLASH_STAR);
+    default: return EM_LOC | step(LX_CODE, c);
+    }
+  case LX_SLASH_STAR: // "/**" and "/*!" open a doc comment, "/*" a regular one
+    if (c == BC_STAR || c == BC_BANG) return go(LX_DOXY, EM_DOX);
+    return EM_COM | step(LX_COMMENT, c);
+  case LX_SLASH_SLASH: // "///" and "//!" are doc comments, "//" a regular one
+    if (c == BC_SLASH || c == BC_BANG) return go(LX_LINE_DOXY, EM_DOX);
+    return EM_COM | step(LX_LINE_COMMENT, c);
+  case LX_LINE_COMMENT:
+  case LX_LINE_COMMENT_BSLASH:
+  case LX_LINE_DOXY:
+  case LX_LINE_DOXY_BSLASH: { //a backslash ending the line continues the comment on the next one
+    const bool doxy = s == LX_LINE_DOXY || s == LX_LINE_DOXY_BSLASH;
+    const bool bslash = s == LX_LINE_COMMENT_BSLASH || s == LX_LINE_DOXY_BSLASH;
+    switch (c) {
+    case BC_BSLASH: return go(doxy ? LX_LINE_DOXY_BSLASH : LX_LINE_COMMENT_BSLASH);
+    case BC_NEWLINE:
+      if (bslash) return go(doxy ? LX_LINE_DOXY_LINE : LX_LINE_COMMENT_LINE, EM_EOL);
+      return go(LX_START_LINE, EM_EOL);
+    case BC_SPACE:
+    case BC_CR: return go(s);
+    default: return go(doxy ? LX_LINE_DOXY : LX_LINE_COMMENT);
+    }
+  }
+  case LX_LINE_COMMENT_LINE: return EM_COM | step(LX_LINE_COMMENT, c);
+  case LX_LINE_DOXY_LINE: return EM_DOX | step(LX_LINE_DOXY, c);
+  case LX_LITERAL_LINE: //a line continuing a literal is code, unless blank (which ends the literal)
+    switch (c) {
+    case BC_SPACE: return go(LX_LITERAL_LINE);
+    case BC_NEWLINE: return go(LX_START_LINE, EM_BLANK | EM_EOL);
+    default: return EM_LOC | step(LX_LITERAL, c);
+    }
+  case LX_LITERAL: //an unterminated literal ends with its line
+    switch (c) {
+    case BC_QUOTE: return go(LX_CODE);
+    case BC_BSLASH: return go(LX_LITERAL_BSLASH);
+    case BC_NEWLINE: return go(LX_START_LINE, EM_EOL);
+    default: return go(LX_LITERAL);
+    }
+  case LX_LITERAL_BSLASH: //escapes the next char, or continues the literal if the line ends
+    switch (c) {
+    case BC_NEWLINE: return go(LX_LITERAL_LINE, EM_EOL);
+    case BC_SPACE:
+    case BC_CR: return go(LX_LITERAL_BSLASH_SPACE);
+    default: return go(LX_LITERAL);
+    }
+  case LX_LITERAL_BSLASH_SPACE:
+    switch (c) {
+    case BC_NEWLINE: return go(LX_LITERAL_LINE, EM_EOL);
+    case BC_SPACE:
+    case BC_CR: return go(LX_LITERAL_BSLASH_SPACE);
+    default: return step(LX_LITERAL, c);
+    }
+  case LX_CHAR_OPEN: // '' and 'x' are literals, '\ starts an escape sequence
+    switch (c) {
+    case BC_BSLASH: return go(LX_CHAR_ESC, EM_LOC);
+    case BC_NEWLINE: return go(LX_START_LINE, EM_EOL);
+    case BC_APOS: return go(LX_CODE, EM_LOC);
+    default: return go(LX_CHAR_ONE, EM_LOC);
+    }
+  case LX_CHAR_ONE: //not closed right away: the quote was a digit separator
+    if (c == BC_APOS) return go(LX_CODE, EM_LOC);
+    return EM_LOC | step(LX_CODE, c);
+  case LX_CHAR_ESC:
+    if (c == BC_NEWLINE) return go(LX_START_LINE, EM_EOL);
+    return go(LX_CHAR_BODY, EM_LOC);
+  case LX_CHAR_BODY:
+    switch (c) {
+    case BC_APOS: return go(LX_CODE, EM_LOC);
+    case BC_NEWLINE: return go(LX_START_LINE, EM_EOL);
+    default: return go(LX_CHAR_BODY);
+    }
+  case LX_COMMENT_LINE: return EM_COM | step(LX_COMMENT, c);
+  case LX_COMMENT:
+  case LX_COMMENT_STAR:
+    switch (c) {
+    case BC_STAR: return go(LX_COMMENT_STAR);
+    case BC_SLASH: return s == LX_COMMENT_STAR ? go(LX_CODE) : go(LX_COMMENT);
+    case BC_NEWLINE: return go(LX_COMMENT_LINE, EM_EOL);
+    default: return go(LX_COMMENT);
+    }
+  case LX_DOXY_LINE: return EM_DOX | step(LX_DOXY, c);
+  case LX_DOXY:
+  case LX_DOXY_STAR:
+    switch (c) {
+    case BC_STAR: return go(LX_DOXY_STAR);
+    case BC_SLASH: return s == LX_DOXY_STAR ? go(LX_CODE) : go(LX_DOXY);
+    case BC_NEWLINE: return go(LX_DOXY_LINE, EM_EOL);
+    default: return go(LX_DOXY);
+    }
+  default: return go(LX_START_LINE); //raw string states are run by lexer_scan()
+  }
+}
+
+/// @brief The transition table, indexed by [state][byte class].
+struct TransitionTable {
+  std::uint16_t next[LX_N_STATES][BC_N_CLASSES]{}; //!< Packed entries.
+};
+
+constexpr TransitionTable make_transition_table() {
+  TransitionTable table{};
+  for (std::uint8_t s{ 0 }; s < LX_N_STATES; ++s) {
+    for (std::uint8_t c{ 0 }; c < BC_N_CLASSES; ++c) {
+      table.next[s][c] = step(static_cast<lexer_state_e>(s), static_cast<byte_class_e>(c));
+    }
+  }
+  return table;
+}
+
+constexpr TransitionTable TABLE = make_transition_table();
+
+//== Skipping
+
+/**
+ * @struct SkipRule
+ * @brief How to jump over bytes that leave a state unchanged.
+ */
+struct SkipRule {
+  bool enabled{ false };           //!< State loops on plain bytes.
+  std::uint16_t flags{ 0 };        //!< Flags a plain byte adds to the line.
+  DelimiterSet stops{ "" };        //!< Bytes whose transition is different.
+};
+
+/**
+ * @brief Derive the skip rule of every state from the table itself.
+ *
+ * A state is skippable when a plain byte (BC_OTHER) keeps the lexer in it;
+ * the bytes to stop at are those of every class whose entry differs from
+ * the plain one.
+ */
+constexpr std::array<SkipRule, LX_N_STATES> make_skip_rules() {
+  std::array<SkipRule, LX_N_STATES> rules{};
+  for (std::uint8_t s{ 0 }; s < LX_N_STATES; ++s) {
+    std::uint16_t plain = TABLE.next[s][BC_OTHER];
+    if ((plain & STATE_MASK) != s) continue;
+
+    char stops[BC_N_CLASSES]{};
+    std::size_t n{ 0 };
+    for (std::uint8_t c{ 1 }; c < BC_N_CLASSES; ++c) {
+      if (TABLE.next[s][c] != plain) stops[n++] = CLASS_BYTE[c];
+    }
+    rules[s].enabled = true;
+    rules[s].flags = plain & ~STATE_MASK;
+    rules[s].stops = DelimiterSet{ std::string_view(stops, n) };
+  }
+  return rules;
+}
+
+constexpr std::array<SkipRule, LX_N_STATES> SKIP = make_skip_rules();
+
+/// @brief Bytes that matter in a raw string body.
+constexpr DelimiterSet RAW_STOPS{ ")\n" };
+
+}  // namespace
+
+/**
+ * @brief Lexer position for the start of a line in a given CurrentCount state.
+ *
+ * @param ts The counting state.
+ *
+ * @return A cursor in the matching `*_LINE` state (CODE, which never outlives a
+ * line, maps to START), with the delimiter of the raw string if inside one.
+ */
+LexerCursor lexer_line_cursor(const CurrentCount& ts) {
+  LexerCursor cursor;
+  switch (ts.current_state) {
+  case CurrentCount::LITERAL: cursor.state = LX_LITERAL_LINE; break;
+  case CurrentCount::COMMENT: cursor.state = LX_COMMENT_LINE; break;
+  case CurrentCount::DOXY: cursor.state = LX_DOXY_LINE; break;
+  case CurrentCount::LINE_COMMENT: cursor.state = LX_LINE_COMMENT_LINE; break;
+  case CurrentCount::LINE_DOXY: cursor.state = LX_LINE_DOXY_LINE; break;
+  case CurrentCount::RAW_LITERAL:
+    cursor.state = LX_RAW_LINE;
+    cursor.raw_length = static_cast<std::uint8_t>(std::min(ts.raw_delimiter.size(), RAW_DELIMITER_MAX));
+    ts.raw_delimiter.copy(cursor.raw_delimiter, cursor.raw_length);
+    break;
+  default: cursor.state = LX_START_LINE; break;
+  }
+  return cursor;
+}
+
+/**
+ * @brief Bring a CurrentCount to the state of a start-of-line lexer position.
+ *
+ * @param cursor A lexer position.
+ * @param ts The counting state to update: START, LITERAL, COMMENT, DOXY,
+ *        LINE_COMMENT, LINE_DOXY or RAW_LITERAL (with its delimiter),
+ *        according to the kind of text the cursor is in.
+ */
+void lexer_count_state(const LexerCursor& cursor, CurrentCount& ts) {
+  ts.raw_delimiter.clear();
+  switch (cursor.state) {
+  case LX_LITERAL_LINE:
+  case LX_LITERAL:
+  case LX_LITERAL_BSLASH:
+  case LX_LITERAL_BSLASH_SPACE:
+  case LX_RAW_DELIM: ts.current_state = CurrentCount::LITERAL; break;
+  case LX_COMMENT_LINE:
+  case LX_COMMENT:
+  case LX_COMMENT_STAR: ts.current_state = CurrentCount::COMMENT; break;
+  case LX_DOXY_LINE:
+  case LX_DOXY:
+  case LX_DOXY_STAR: ts.current_state = CurrentCount::DOXY; break;
+  case LX_LINE_COMMENT_LINE:
+  case LX_LINE_COMMENT:
+  case LX_LINE_COMMENT_BSLASH: ts.current_state = CurrentCount::LINE_COMMENT; break;
+  case LX_LINE_DOXY_LINE:
+  case LX_LINE_DOXY:
+  case LX_LINE_DOXY_BSLASH: ts.current_state = CurrentCount::LINE_DOXY; break;
+  case LX_RAW_LINE:
+  case LX_RAW:
+  case LX_RAW_CLOSE:
+    ts.current_state = CurrentCount::RAW_LITERAL;
+    ts.raw_delimiter.assign(cursor.raw_delimiter, cursor.raw_length);
+    break;
+  default: ts.current_state = CurrentCount::START; break;
+  }
+}
+
+namespace {
+
+/**
+ * @struct LineTally
+ * @brief Lines counted by a lexer_scan() call so far.
+ */
+struct LineTally {
+  count_t lines{ 0 }, blank{ 0 }, loc{ 0 }, com{ 0 }, dox{ 0 };
+  std::vector<std::uint8_t>* classes{ nullptr }; //!< Receives the line_class_e flags of each line, if set.
+
+  /// @brief Count a line with the flags gathered for it, and start the next one.
+  void end_line(unsigned& flags) {
+    ++lines;
+    blank += (flags & EM_BLANK) != 0;
+    loc += (flags & EM_LOC) != 0;
+    com += (flags & EM_COM) != 0;
+    dox += (flags & EM_DOX) != 0;
+    if (classes != nullptr) {
+      classes->push_back(static_cast<std::uint8_t>(((flags & EM_BLANK) != 0 ? LINE_BLANK : 0) | ((flags & EM_LOC) != 0 ? LINE_CODE : 0)
+                                                   | ((flags & EM_COM) != 0 ? LINE_COMMENT : 0)
+                                                   | ((flags & EM_DOX) != 0 ? LINE_DOC : 0)));
+    }
+    flags = 0;
+  }
+};
+
+/**
+ * @brief Run the raw string states, until the string ends or the bytes run out.
+ *
+ * @param p First byte to lex.
+ * @param end End of the bytes.
+ * @param cursor Lexer position, whose raw string fields are used and updated.
+ * @param state Current state (LX_RAW_LINE or above), updated on return.
+ * @param flags Flags of the current line, updated on return.
+ * @param tally Where completed lines are counted.
+ *
+ * The closing `)delim"` is matched one byte at a time against the delimiter
+ * kept in the cursor, so a raw string costs no more per byte than the rest;
+ * text that cannot close it is skipped with find_delimiter(). Kept out of
+ * line, away from the table loop of lexer_scan().
+ *
+ * @return Where the lexer stopped.
+ */
+[[gnu::noinline]] const char* scan_raw(const char* p, const char* end, LexerCursor& cursor, unsigned& state,
+                                        unsigned& flags, LineTally& tally) {
+  while (p != end && state >= LX_RAW_LINE) {
+    char ch = *p;
+    if (state == LX_RAW) {
+      p = find_delimiter(p, end, RAW_STOPS);
+      if (p == end) break;
+      if (*p++ == ')') {
+        state = LX_RAW_CLOSE;
+        cursor.raw_matched = 0;
+      } else {
+        tally.end_line(flags);
+        state = LX_RAW_LINE;
+      }
+    } else if (state == LX_RAW_LINE) { //same as a literal line: code, unless blank
+      if (ch == ' ') {
+        ++p;
+      } else if (ch == '\n') {
+        ++p;
+        flags |= EM_BLANK;
+        tally.end_line(flags);
+      } else {
+        flags |= EM_LOC;
+        state = LX_RAW; //the byte is read again as raw string text
+      }
+    } else if (state == LX_RAW_DELIM) {
+      if (ch == '(') {
+        ++p;
+        state = LX_RAW;
+      } else if (is_raw_delimiter_char(ch) && cursor.raw_length < RAW_DELIMITER_MAX) {
+        ++p;
+        cursor.raw_delimiter[cursor.raw_length++] = ch;
+      } else { //no valid delimiter: an ordinary literal, whose text the byte is
+        cursor.raw_length = 0;
+        state = LX_LITERAL;
+      }
+    } else { //LX_RAW_CLOSE
+      ++p;
+      if (cursor.raw_matched < cursor.raw_length && ch == cursor.raw_delimiter[cursor.raw_matched]) {
+        ++cursor.raw_matched;
+      } else if (cursor.raw_matched == cursor.raw_length && ch == '"') {
+        state = LX_CODE;
+        cursor.raw_length = cursor.raw_matched = 0;
+      } else if (ch == ')') {
+        cursor.raw_matched = 0;
+      } else if (ch == '\n') {
+        tally.end_line(flags);
+        state = LX_RAW_LINE;
+      } else {
+        state = LX_RAW;
+      }
+    }
+  }
+  return p;
+}
+
+/**
+ * @brief Run the lexer over a range of bytes, counting the lines it completes.
+ *
+ * @param bytes The bytes to lex; lines may span several calls.
+ * @param cursor Lexer position, updated on return.
+ * @param tally Where every completed line is counted.
+ *
+ * The body of lexer_scan() (see there), shared with lexer_classify_lines().
+ */
+void scan_bytes(std::string_view bytes, LexerCursor& cursor, LineTally& tally) {
+  const char* p = bytes.data();
+  const char* end = p + bytes.size();
+  unsigned state = cursor.state;
+  unsigned flags = cursor.line_flags;
+
+  if (state >= LX_RAW_LINE) p = scan_raw(p, end, cursor, state, flags, tally);
+  while (p != end) {
+    const SkipRule& skip = SKIP[state];
+    if (skip.enabled) {
+      const char* stop = find_delimiter(p, end, skip.stops);
+      if (stop != p) {
+        flags |= skip.flags;
+        p = stop;
+        if (p == end) break;
+      }
+    }
+
+    std::uint16_t entry = TABLE.next[state][BYTE_CLASS[static_cast<unsigned char>(*p++)]];
+    state = entry & STATE_MASK;
+    flags |= entry;
+    if (entry & (EM_EOL | EM_RAW)) { //one test for both, raw strings are rare
+      if (entry & EM_EOL) {
+        tally.end_line(flags);
+      } else {
+        flags &= ~EM_RAW;
+        p = scan_raw(p, end, cursor, state, flags, tally);
+      }
+    }
+  }
+
+  if (!bytes.empty()) cursor.mid_line = bytes.back() != '\n';
+  cursor.state = static_cast<lexer_state_e>(state);
+  cursor.line_flags = static_cast<std::uint16_t>(flags & ~STATE_MASK);
+}
+
+}  // namespace
+
+/**
+ * @brief Run the lexer over a range of bytes.
+ *
+ * @param bytes The bytes to lex; lines may span several calls.
+ * @param cursor Lexer position, updated on return.
+ * @param atr Accumulator where every completed line is counted.
+ *
+ * One table lookup per byte, except where a run of bytes cannot change the
+ * state (plain code, comment or literal text): such runs are skipped with
+ * find_delimiter(). Raw strings are followed outside the table (see
+ * scan_raw()).
+ */
+void lexer_scan(std::string_view bytes, LexerCursor& cursor, AttributeCount& atr) {
+  LineTally tally;
+  scan_bytes(bytes, cursor, tally);
+  AttributeCount partial;
+  partial.lines = tally.lines;
+  partial.blank = tally.blank;
+  partial.loc = tally.loc;
+  partial.com = tally.com;
+  partial.dox = tally.dox;
+  atr += partial;
+}
+
+/**
+ * @brief Close the last line if it has no trailing newline.
+ *
+ * @param cursor Lexer position after the last lexer_scan() of a buffer.
+ * @param atr Accumulator where the last line is counted.
+ *
+ * Like `std::getline`, a last line without newline still counts, while an
+ * empty remainder after the final newline does not.
+ */
+void lexer_finish(LexerCursor& cursor, AttributeCount& atr) {
+  if (cursor.mid_line) lexer_scan("\n", cursor, atr);
+}
+
+/**
+ * @brief Classify every line of a buffer.
+ *
+ * @param bytes Whole lines of a file: the whole content, or lines starting where `cursor` was saved.
+ * @param cursor Lexer position at the start of `bytes`, updated on return.
+ * @param out Receives the line_class_e flags of each line, in order.
+ *
+ * A single pass of the lexer of lexer_scan(), which records the flags of
+ * each line as it counts it, so the lines are classified exactly as
+ * count_buffer() counts them. A last line without newline is closed as by
+ * lexer_finish().
+ */
+void lexer_classify_lines(std::string_view bytes, LexerCursor& cursor, std::vector<std::uint8_t>& out) {
+  LineTally tally;
+  tally.classes = &out;
+  scan_bytes(bytes, cursor, tally);
+  if (cursor.mid_line) scan_bytes("\n", cursor, tally);
+}
+
+namespace {
+
+/// @brief Counts of a minus counts of b, wrapping around like any unsigned sum.
+AttributeCount count_difference(const AttributeCount& a, const AttributeCount& b) {
+  AttributeCount diff;
+  diff.lines = a.lines - b.lines;
+  diff.blank = a.blank - b.blank;
+  diff.loc = a.loc - b.loc;
+  diff.com = a.com - b.com;
+  diff.dox = a.dox - b.dox;
+  return diff;
+}
+
+}  // namespace
+
+/**
+ * @brief Lex a chunk of whole lines speculatively from every possible entry state.
+ *
+ * @param chunk The bytes; unless it is the last chunk of a buffer it must end with a newline.
+ * @param last Whether this is the last chunk (its last line may lack a newline).
+ * @param known_start Whether the chunk is known to start in LX_START_LINE (the first
+ *        chunk of a buffer), in which case only that entry is computed.
+ * @param out Exit state and counts for each entry state.
+ *
+ * The entry states are run side by side ("lanes") over segments of the chunk.
+ * As soon as two lanes reach the same cursor, their futures are identical,
+ * so the later one is dropped and only remembers how far its counts were
+ * from the surviving lane. In real code the lanes merge within a few lines
+ * (at the first quote or comment end), so the speculation costs little
+ * more than a single scan.
+ */
+void lexer_scan_chunk(std::string_view chunk, bool last, bool known_start, ChunkSummary& out) {
+  constexpr std::size_t SEGMENT{ 64 * 1024 };
+  const std::size_t n_lanes = known_start ? 1 : LX_N_LINE_STATES;
+
+  LexerCursor cursor[LX_N_LINE_STATES];
+  AttributeCount counts[LX_N_LINE_STATES];
+  AttributeCount offset[LX_N_LINE_STATES];   //counts of a dropped lane minus those of its target
+  std::size_t target[LX_N_LINE_STATES];      //lane a lane was merged into (itself if alive)
+  for (std::size_t l{ 0 }; l < n_lanes; ++l) {
+    cursor[l].state = static_cast<lexer_state_e>(l);
+    target[l] = l;
+  }
+
+  for (std::size_t pos{ 0 }; pos < chunk.size(); pos += SEGMENT) {
+    std::string_view segment = chunk.substr(pos, SEGMENT);
+    for (std::size_t l{ 0 }; l < n_lanes; ++l) {
+      if (target[l] == l) lexer_scan(segment, cursor[l], counts[l]);
+    }
+
+    for (std::size_t l{ 1 }; l < n_lanes; ++l) {
+      if (target[l] != l) continue;
+      for (std::size_t m{ 0 }; m < l; ++m) {
+        if (target[m] == m && cursor[m].same_as(cursor[l])) {
+          target[l] = m;
+          offset[l] = count_difference(counts[l], counts[m]);
+          break;
+        }
+      }
+    }
+  }
+
+  for (std::size_t l{ 0 }; l < n_lanes; ++l) {
+    if (target[l] == l && last) lexer_finish(cursor[l], counts[l]);
+  }
+
+  for (std::size_t l{ 0 }; l < n_lanes; ++l) {
+    AttributeCount total;
+    std::size_t lane = l;
+    while (target[lane] != lane) { //follow the merges down to a surviving lane
+      total += offset[lane];
+      lane = target[lane];
+    }
+    total += counts[lane];
+    out.counts[l] = total;
+    out.exit[l] = cursor[lane];
+  }
+}
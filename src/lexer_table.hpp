@@ -0,0 +1,195 @@
+#ifndef LEXER_TABLE_HPP
+#define LEXER_TABLE_HPP
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "main.hpp"
+
+/*!
+ * @file lexer_table.hpp
+ * @description
+ * Table-driven replacement for the per-line updateState() classifier.
+ *
+ * The lexer is a DFA over whole buffers (newlines included): one table
+ * lookup per byte gives the next state plus the flags (blank, loc, com,
+ * dox, end of line) that the byte contributes to the current line. The
+ * table is generated at compile time from the rules updateState()
+ * implements, so both classifiers give the same counts:
+ *
+ * - string literals open at any `"` in code and close at the next `"` not
+ *   escaped by a `\`; a newline ends them, unless it follows a `\`
+ *   (possibly with spaces or `\r` in between), which continues them;
+ * - `'x'` and `'\...'` are character literals; a `'` not closed right
+ *   after one character (a digit separator, as in `1'000`) is plain code;
+ * - `R"delim( ... )delim"` raw strings may span lines and are only
+ *   closed by their own delimiter;
+ * - a `//` comment ending with a `\` (possibly followed by spaces or
+ *   `\r`) goes on on the next line, which is then a comment line too.
+ *
+ * Raw strings are the only construct the table cannot follow on its own,
+ * since their delimiter can be anything: their states (LX_RAW_LINE and
+ * above) are handled next to the table by lexer_scan(), still in constant
+ * time per byte, with the delimiter kept in the LexerCursor.
+ */
+
+//== Enumerations
+
+/**
+ * @enum lexer_state_e
+ * @brief States of the table-driven lexer.
+ *
+ * The `*_LINE` states are the only ones seen at the start of a line
+ * (nothing but spaces read yet); they correspond to the START, LITERAL,
+ * COMMENT, DOXY, LINE_COMMENT, LINE_DOXY and RAW_LITERAL states of
+ * CurrentCount. The others only live inside a line and remember the
+ * previous characters the rules look at.
+ */
+enum lexer_state_e : std::uint8_t {
+  LX_START_LINE = 0,      //!< Line start, outside comments and literals.
+  LX_LITERAL_LINE,        //!< Line start, inside a string literal continued by a backslash.
+  LX_COMMENT_LINE,        //!< Line start, inside a regular block comment.
+  LX_DOXY_LINE,           //!< Line start, inside a doc block comment.
+  LX_LINE_COMMENT_LINE,   //!< Line start, inside a regular `//` comment continued by a backslash.
+  LX_LINE_DOXY_LINE,      //!< Line start, inside a doc `///` comment continued by a backslash.
+  LX_CODE,                //!< Code, previous char is nothing special.
+  LX_CODE_SPACE,          //!< Code, after spaces that count only if more text follows.
+  LX_CODE_R,              //!< Code, after `R` (a raw string prefix if a `"` follows).
+  LX_SLASH,               //!< Code, after `/`.
+  LX_SLASH_STAR,          //!< Code, after `/*`.
+  LX_SLASH_SLASH,         //!< Code, after `//`.
+  LX_LINE_COMMENT,        //!< Rest of a regular `//` comment line.
+  LX_LINE_COMMENT_BSLASH, //!< Regular `//` comment, after `\` and maybe spaces.
+  LX_LINE_DOXY,           //!< Rest of a doc `///` or `//!` comment line.
+  LX_LINE_DOXY_BSLASH,    //!< Doc `///` comment, after `\` and maybe spaces.
+  LX_LITERAL,             //!< String literal, previous char is nothing special.
+  LX_LITERAL_BSLASH,      //!< String literal, after `\`.
+  LX_LITERAL_BSLASH_SPACE,//!< String literal, after `\` then spaces: a continuation if the line ends.
+  LX_CHAR_OPEN,           //!< Code, after `'`.
+  LX_CHAR_ONE,            //!< Code, after `'x`: a literal if `'` follows.
+  LX_CHAR_ESC,            //!< Character literal, after `'\`.
+  LX_CHAR_BODY,           //!< Character literal, rest of an escape sequence.
+  LX_COMMENT,             //!< Regular block comment.
+  LX_COMMENT_STAR,        //!< Regular block comment, after `*`.
+  LX_DOXY,                //!< Doc block comment.
+  LX_DOXY_STAR,           //!< Doc block comment, after `*`.
+  LX_RAW_LINE,            //!< Line start, inside a raw string literal.
+  LX_RAW_DELIM,           //!< Raw string, reading the delimiter after `R"`.
+  LX_RAW,                 //!< Raw string content.
+  LX_RAW_CLOSE,           //!< Raw string, after `)` and part of the delimiter.
+  LX_N_STATES             //!< Number of states.
+};
+
+/// @brief Number of `*_LINE` states a chunk is speculatively lexed from (all but LX_RAW_LINE).
+constexpr std::size_t LX_N_LINE_STATES{ 6 };
+
+/// @brief Longest raw string delimiter, as in the C++ standard.
+constexpr std::size_t RAW_DELIMITER_MAX{ 16 };
+
+//== Structs
+
+/**
+ * @struct LexerCursor
+ * @brief Where the lexer stands between two calls to lexer_scan().
+ */
+struct LexerCursor {
+  lexer_state_e state{ LX_START_LINE };   //!< Current DFA state.
+  std::uint16_t line_flags{ 0 };          //!< Flags gathered so far for the current line.
+  bool mid_line{ false };                 //!< Bytes were read after the last newline.
+  std::uint8_t raw_length{ 0 };           //!< Length of the raw string delimiter (0 outside raw strings).
+  std::uint8_t raw_matched{ 0 };          //!< Delimiter bytes matched after a `)` (LX_RAW_CLOSE).
+  char raw_delimiter[RAW_DELIMITER_MAX]{}; //!< Delimiter of the raw string being read.
+
+  /// @brief Whether two cursors will lex what follows the same way.
+  bool same_as(const LexerCursor& other) const {
+    return state == other.state && line_flags == other.line_flags && raw_length == other.raw_length
+           && raw_matched == other.raw_matched
+           && std::char_traits<char>::compare(raw_delimiter, other.raw_delimiter, raw_length) == 0;
+  }
+};
+
+/**
+ * @struct ChunkSummary
+ * @brief Outcome of lexing a chunk of whole lines from each possible entry state.
+ *
+ * Entry `e` (one of the first LX_N_LINE_STATES states) tells the counts the
+ * chunk adds and where it leaves the lexer for the next chunk, had the chunk
+ * started in state `e`. Composing summaries chunk after chunk gives the
+ * exact sequential result. A chunk entered inside a raw string has no
+ * summary (its delimiter is not known in advance) and is lexed again.
+ */
+struct ChunkSummary {
+  LexerCursor exit[LX_N_LINE_STATES]{};       //!< Lexer after the chunk, per entry state.
+  AttributeCount counts[LX_N_LINE_STATES]{};  //!< Counts of the chunk, per entry state.
+};
+
+//== Inline functions
+
+/**
+ * @brief Whether a byte may be part of a raw string delimiter.
+ * @param ch The byte.
+ * @return true for printable ASCII other than space, `(`, `)`, `\` and `"`.
+ */
+constexpr bool is_raw_delimiter_char(char ch) {
+  return ch > ' ' && ch < 0x7f && ch != '(' && ch != ')' && ch != '\\' && ch != '"';
+}
+
+//== Functions
+
+/**
+ * @brief Lexer position for the start of a line in a given CurrentCount state.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see lexer_line_cursor()
+ */
+LexerCursor lexer_line_cursor(const CurrentCount& ts);
+
+/**
+ * @brief Bring a CurrentCount to the state of a start-of-line lexer position.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see lexer_count_state()
+ */
+void lexer_count_state(const LexerCursor& cursor, CurrentCount& ts);
+
+/**
+ * @brief Run the lexer over a range of bytes.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see lexer_scan()
+ */
+void lexer_scan(std::string_view bytes, LexerCursor& cursor, AttributeCount& atr);
+
+/**
+ * @brief Close the last line if it has no trailing newline.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see lexer_finish()
+ */
+void lexer_finish(LexerCursor& cursor, AttributeCount& atr);
+
+/**
+ * @brief Classify every line of a buffer.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see lexer_classify_lines()
+ */
+void lexer_classify_lines(std::string_view bytes, LexerCursor& cursor, std::vector<std::uint8_t>& out);
+
+/**
+ * @brief Lex a chunk of whole lines speculatively from every possible entry state.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see lexer_scan_chunk()
+ */
+void lexer_scan_chunk(std::string_view chunk, bool last, bool known_start, ChunkSummary& out);
+
+#endif
@@ -0,0 +1,111 @@
+/*!
+ * @file libsloc.cpp
+ * @description
+ * The counting API of libsloc, over the scanners of language_registry.hpp.
+ */
+
+#include "libsloc.hpp"
+
+#include <atomic>
+
+#include "file_reader.hpp"
+#include "language_registry.hpp"
+#include "language_sniffer.hpp"
+#include "thread_pool.hpp"
+
+namespace sloc {
+
+static_assert(static_cast<int>(lang_type_e::UNDEF) == ::UNDEF && static_cast<int>(lang_type_e::CMAKE) == ::CMAKE,
+              "sloc::lang_type_e follows the languages of main.hpp");
+static_assert(static_cast<int>(lang_confidence_e::LOW) == ::CONFIDENCE_LOW,
+              "sloc::lang_confidence_e follows the confidences of main.hpp");
+
+/**
+ * @brief Count the lines of a content already in memory.
+ *
+ * @param content The content, e.g. an editor buffer or a file read by the caller.
+ * @param lang_type Its language, e.g. the one count_file() finds for its name; UNDEF counts nothing.
+ * @param pool Pool to split big contents over, or nullptr to count on the calling thread.
+ *
+ * Same scanner and same counts as `sloc` gives for a file with this
+ * content.
+ *
+ * @return The line counts.
+ */
+LineCounts count_buffer(std::string_view content, lang_type_e lang_type, ThreadPool* pool) {
+  LineCounts counts;
+  if (lang_type >= lang_type_e::UNDEF) return counts;
+
+  AttributeCount result = count_language(static_cast<::lang_type_e>(lang_type), content, pool);
+  counts.lines = result.lines;
+  counts.blank = result.blank;
+  counts.code = result.loc;
+  counts.comments = result.com;
+  counts.doc_comments = result.dox;
+  return counts;
+}
+
+/**
+ * @brief Find the language of a file and count its lines.
+ *
+ * @param path Path of the file.
+ * @param pool Pool to split big files over, or nullptr to count on the calling thread.
+ *
+ * The language comes from the file name or, failing that, from the first
+ * SNIFF_BYTES of the content, as with `sloc`; only then is the rest of a
+ * sniffed file read. Unlike make_file_info(), there is no result cache and
+ * no `--stats` counters: the file is always read and counted.
+ *
+ * @return The language and counts; `readable` is false if the file could not be read.
+ */
+FileCount count_file(const std::string& path, ThreadPool* pool) {
+  FileCount result;
+  ::lang_type_e type = language_by_file_name(path);
+  bool sniffed = type == ::UNDEF;
+
+  FileBuffer file(path, sniffed ? SNIFF_BYTES : 0);
+  result.type = static_cast<lang_type_e>(type);
+  if (!file.ok()) return result;
+  if (sniffed) {
+    LanguageGuess guess = sniff_language(file.view());
+    result.type = static_cast<lang_type_e>(guess.type);
+    result.confidence = static_cast<lang_confidence_e>(guess.confidence);
+    if (guess.type != ::UNDEF && !file.load_rest()) return result;
+  }
+  result.readable = true;
+  result.counts = count_buffer(file.view(), result.type, pool);
+  return result;
+}
+
+/**
+ * @brief Count a batch of files, possibly in parallel.
+ *
+ * @param paths Paths of the files.
+ * @param pool Pool to count the files on, or nullptr to count them one after the other.
+ *
+ * Each file is a task of the pool (see count_file()). The calling thread
+ * runs tasks too until the batch is done, and only waits for the tasks of
+ * this batch: the pool can be shared by several batches, from several
+ * threads, and kept from one call to the next.
+ *
+ * @return One FileCount per path, in the order of `paths`.
+ */
+std::vector<FileCount> count_files(const std::vector<std::string>& paths, ThreadPool* pool) {
+  std::vector<FileCount> results(paths.size());
+  if (pool == nullptr) {
+    for (std::size_t i{ 0 }; i < paths.size(); ++i) results[i] = count_file(paths[i]);
+    return results;
+  }
+
+  std::atomic<std::size_t> remaining{ paths.size() };
+  for (std::size_t i{ 0 }; i < paths.size(); ++i) {
+    pool->submit([&paths, &results, &remaining, pool, i] {
+      results[i] = count_file(paths[i], pool);
+      --remaining;
+    });
+  }
+  pool->run_until([&remaining] { return remaining == 0; });
+  return results;
+}
+
+}  // namespace sloc
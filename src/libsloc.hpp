@@ -0,0 +1,119 @@
+#ifndef LIBSLOC_HPP
+#define LIBSLOC_HPP
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ThreadPool;
+
+/*!
+ * @file libsloc.hpp
+ * @description
+ * The counting API of libsloc, for programs that embed the counter instead
+ * of running `sloc`: count a buffer, a file or a batch of files. Nothing
+ * here prints, exits or keeps state between calls, so every function can
+ * be called from any number of threads at once.
+ *
+ * This header stands on its own: the names live in the `sloc` namespace,
+ * away from those of the command line (main.hpp, which is not part of the
+ * API), and the only other type it mentions is the ThreadPool of
+ * thread_pool.hpp, for parallel counts.
+ */
+
+namespace sloc {
+
+/// @brief Integer type of the line counts.
+using count_t = std::uint64_t;
+
+//== Enumerations
+
+/**
+ * @enum lang_type_e
+ * @brief Languages counted by libsloc.
+ */
+enum class lang_type_e : std::uint8_t {
+  C = 0,  //!< C language
+  CPP,    //!< C++ language
+  H,      //!< C/C++ header
+  HPP,    //!< C++ header
+  PYTHON, //!< Python
+  RUST,   //!< Rust
+  GO,     //!< Go
+  JAVA,   //!< Java
+  SHELL,  //!< POSIX shell scripts
+  CMAKE,  //!< CMake scripts
+  UNDEF,  //!< Not source code, or unknown.
+};
+
+/**
+ * @enum lang_confidence_e
+ * @brief How the language of a file was found, from the surest to the least sure.
+ */
+enum class lang_confidence_e : std::uint8_t {
+  CERTAIN = 0, //!< File name: extension or well-known name.
+  HIGH,        //!< Declared by the file: shebang or editor modeline.
+  MEDIUM,      //!< Guessed from its tokens, by a clear margin.
+  LOW,         //!< Guessed from its tokens, by a narrow margin.
+};
+
+//== Structs
+
+/**
+ * @struct LineCounts
+ * @brief Line counts of a buffer or file.
+ *
+ * As in the table of `sloc`, a line may count as several kinds: a line
+ * with code and a trailing comment is both code and comment.
+ */
+struct LineCounts {
+  count_t lines{ 0 };        //!< Every line.
+  count_t blank{ 0 };        //!< Blank lines.
+  count_t code{ 0 };         //!< Lines with code.
+  count_t comments{ 0 };     //!< Lines with a regular comment.
+  count_t doc_comments{ 0 }; //!< Lines with a doc comment.
+};
+
+/**
+ * @struct FileCount
+ * @brief What was found about one file.
+ */
+struct FileCount {
+  lang_type_e type{ lang_type_e::UNDEF };                     //!< Language, UNDEF if the file is not source code.
+  lang_confidence_e confidence{ lang_confidence_e::CERTAIN }; //!< How the language was found.
+  LineCounts counts;                                          //!< Line counts, zero unless type is a language.
+  bool readable{ false };                                     //!< Whether the file could be read at all.
+};
+
+//== Functions
+
+/**
+ * @brief Count the lines of a content already in memory.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see count_buffer()
+ */
+LineCounts count_buffer(std::string_view content, lang_type_e lang_type, ThreadPool* pool = nullptr);
+
+/**
+ * @brief Find the language of a file and count its lines.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see count_file()
+ */
+FileCount count_file(const std::string& path, ThreadPool* pool = nullptr);
+
+/**
+ * @brief Count a batch of files, possibly in parallel.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see count_files()
+ */
+std::vector<FileCount> count_files(const std::vector<std::string>& paths, ThreadPool* pool = nullptr);
+
+}  // namespace sloc
+
+#endif
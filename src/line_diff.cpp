@@ -0,0 +1,308 @@
+/*!
+ * @file line_diff.cpp
+ * @description
+ * Myers' O(ND) diff over line ids, in linear space, and the delta counts
+ * built on its hunks.
+ */
+
+#include "line_diff.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <unordered_map>
+
+namespace {
+
+/// @brief Edit distance past which a middle snake search gives up and splits at its furthest point.
+constexpr std::ptrdiff_t MIN_COST_LIMIT{ 256 };
+
+/// @brief Work budget of a middle snake search, in diagonal steps times lines.
+constexpr std::ptrdiff_t COST_BUDGET{ std::ptrdiff_t{ 1 } << 26 };
+
+/**
+ * @class MyersDiff
+ * @brief Marks the lines of two sequences of ids that are not in their longest common subsequence.
+ *
+ * Divide and conquer on the middle snake (Myers 1986, section 4b): the
+ * forward and backward searches meet on a snake of an optimal path, which
+ * splits the problem in two. Ranges are kept on an explicit stack, and the
+ * common head and tail of each range are matched before searching.
+ *
+ * The search is capped at a cost that keeps a single search around
+ * COST_BUDGET steps; beyond it, the range is split at the furthest point
+ * the forward search reached, as xdiff does. The script is then still
+ * correct, only possibly not the shortest, which only happens for
+ * thoroughly rewritten files.
+ */
+class MyersDiff {
+public:
+  /**
+   * @brief Prepare a diff.
+   * @param a Old sequence.
+   * @param b New sequence.
+   * @param a_changed Set for each line of `a` not kept (sized like `a`, all false).
+   * @param b_changed Set for each line of `b` not kept (sized like `b`, all false).
+   */
+  MyersDiff(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b, std::vector<bool>& a_changed, std::vector<bool>& b_changed)
+      : m_a{ a }, m_b{ b }, m_a_changed{ a_changed }, m_b_changed{ b_changed } {
+  }
+
+  /// @brief Mark the changed lines of both sequences.
+  void run() {
+    std::vector<Range> stack{ { 0, static_cast<std::ptrdiff_t>(m_a.size()), 0, static_cast<std::ptrdiff_t>(m_b.size()) } };
+    while (!stack.empty()) {
+      Range r = stack.back();
+      stack.pop_back();
+      while (r.a_lo < r.a_hi && r.b_lo < r.b_hi && m_a[r.a_lo] == m_b[r.b_lo]) ++r.a_lo, ++r.b_lo;
+      while (r.a_lo < r.a_hi && r.b_lo < r.b_hi && m_a[r.a_hi - 1] == m_b[r.b_hi - 1]) --r.a_hi, --r.b_hi;
+      if (r.a_lo == r.a_hi || r.b_lo == r.b_hi) {
+        mark(r);
+        continue;
+      }
+
+      std::ptrdiff_t x{ 0 }, y{ 0 };
+      middle_snake(r, x, y);
+      if ((x == 0 && y == 0) || (x == r.a_hi - r.a_lo && y == r.b_hi - r.b_lo)) {
+        mark(r); //no split that makes progress
+        continue;
+      }
+      stack.push_back({ r.a_lo, r.a_lo + x, r.b_lo, r.b_lo + y });
+      stack.push_back({ r.a_lo + x, r.a_hi, r.b_lo + y, r.b_hi });
+    }
+  }
+
+private:
+  /// @brief Lines [a_lo, a_hi) of `a` against [b_lo, b_hi) of `b`.
+  struct Range {
+    std::ptrdiff_t a_lo, a_hi, b_lo, b_hi;
+  };
+
+  /// @brief Mark every line of a range as changed.
+  void mark(const Range& r) {
+    for (std::ptrdiff_t i{ r.a_lo }; i < r.a_hi; ++i) m_a_changed[i] = true;
+    for (std::ptrdiff_t j{ r.b_lo }; j < r.b_hi; ++j) m_b_changed[j] = true;
+  }
+
+  /**
+   * @brief Find where an optimal path of a range crosses its middle diagonal.
+   * @param r The range, whose first and last lines differ on both sides.
+   * @param x Receives the split point in the old lines, relative to the range.
+   * @param y Receives the split point in the new lines, relative to the range.
+   */
+  void middle_snake(const Range& r, std::ptrdiff_t& x, std::ptrdiff_t& y) {
+    const std::ptrdiff_t n = r.a_hi - r.a_lo;
+    const std::ptrdiff_t m = r.b_hi - r.b_lo;
+    const std::ptrdiff_t max_d = (n + m + 1) / 2;
+    const std::ptrdiff_t cost_limit = std::min(max_d, std::max(MIN_COST_LIMIT, COST_BUDGET / (n + m)));
+    const std::ptrdiff_t offset = max_d;
+    const std::ptrdiff_t length = 2 * max_d + 2;
+    m_forward.assign(length, -1);
+    m_backward.assign(length, -1);
+    m_forward[offset + 1] = 0;
+    m_backward[offset + 1] = 0;
+    const std::ptrdiff_t delta = n - m;
+    const bool front = delta % 2 != 0; //whether the forward search meets the backward one
+    std::ptrdiff_t k1_start{ 0 }, k1_end{ 0 }, k2_start{ 0 }, k2_end{ 0 };
+    std::ptrdiff_t best_x{ 0 }, best_y{ 0 };
+
+    const std::uint32_t* a = m_a.data() + r.a_lo;
+    const std::uint32_t* b = m_b.data() + r.b_lo;
+    for (std::ptrdiff_t d{ 0 }; d < cost_limit; ++d) {
+      for (std::ptrdiff_t k1{ -d + k1_start }; k1 <= d - k1_end; k1 += 2) {
+        std::ptrdiff_t k1_offset = offset + k1;
+        std::ptrdiff_t x1 = (k1 == -d || (k1 != d && m_forward[k1_offset - 1] < m_forward[k1_offset + 1]))
+                              ? m_forward[k1_offset + 1]
+                              : m_forward[k1_offset - 1] + 1;
+        std::ptrdiff_t y1 = x1 - k1;
+        while (x1 < n && y1 < m && a[x1] == b[y1]) ++x1, ++y1;
+        m_forward[k1_offset] = x1;
+        if (x1 > n) {
+          k1_end += 2; //ran off the right of the grid
+        } else if (y1 > m) {
+          k1_start += 2; //ran off the bottom of the grid
+        } else {
+          if (x1 + y1 > best_x + best_y) best_x = x1, best_y = y1;
+          if (front) {
+            std::ptrdiff_t k2_offset = offset + delta - k1;
+            if (k2_offset >= 0 && k2_offset < length && m_backward[k2_offset] != -1 && x1 >= n - m_backward[k2_offset]) {
+              x = x1;
+              y = y1;
+              return;
+            }
+          }
+        }
+      }
+
+      for (std::ptrdiff_t k2{ -d + k2_start }; k2 <= d - k2_end; k2 += 2) {
+        std::ptrdiff_t k2_offset = offset + k2;
+        std::ptrdiff_t x2 = (k2 == -d || (k2 != d && m_backward[k2_offset - 1] < m_backward[k2_offset + 1]))
+                              ? m_backward[k2_offset + 1]
+                              : m_backward[k2_offset - 1] + 1;
+        std::ptrdiff_t y2 = x2 - k2;
+        while (x2 < n && y2 < m && a[n - x2 - 1] == b[m - y2 - 1]) ++x2, ++y2;
+        m_backward[k2_offset] = x2;
+        if (x2 > n) {
+          k2_end += 2;
+        } else if (y2 > m) {
+          k2_start += 2;
+        } else if (!front) {
+          std::ptrdiff_t k1_offset = offset + delta - k2;
+          if (k1_offset >= 0 && k1_offset < length && m_forward[k1_offset] != -1) {
+            std::ptrdiff_t x1 = m_forward[k1_offset];
+            std::ptrdiff_t y1 = offset + x1 - k1_offset;
+            if (x1 >= n - x2) {
+              x = x1;
+              y = y1;
+              return;
+            }
+          }
+        }
+      }
+    }
+
+    //over the cost limit: split where the forward search got furthest
+    x = best_x;
+    y = best_y;
+  }
+
+  const std::vector<std::uint32_t>& m_a;  //!< Old sequence.
+  const std::vector<std::uint32_t>& m_b;  //!< New sequence.
+  std::vector<bool>& m_a_changed;         //!< Changed lines of the old sequence.
+  std::vector<bool>& m_b_changed;         //!< Changed lines of the new sequence.
+  std::vector<std::ptrdiff_t> m_forward;  //!< Furthest x on each diagonal, forward search.
+  std::vector<std::ptrdiff_t> m_backward; //!< Furthest x on each diagonal, backward search.
+};
+
+}  // namespace
+
+/**
+ * @brief Split a file content into lines.
+ *
+ * @param content The content.
+ *
+ * Lines end at a newline, which is not part of them. Like `std::getline`
+ * (and the counting), a last line without a newline is a line, while
+ * nothing after the final newline is not. The lines are views of `content`.
+ *
+ * @return The lines, in order.
+ */
+std::vector<std::string_view> split_lines(std::string_view content) {
+  std::vector<std::string_view> lines;
+  std::size_t pos{ 0 };
+  while (pos < content.size()) {
+    std::size_t eol = content.find('\n', pos);
+    if (eol == std::string_view::npos) eol = content.size();
+    lines.push_back(content.substr(pos, eol - pos));
+    pos = eol + 1;
+  }
+  return lines;
+}
+
+/**
+ * @brief Shortest edit script between two versions of a file, as hunks.
+ *
+ * @param old_lines Lines of the old version.
+ * @param new_lines Lines of the new version.
+ *
+ * Each distinct line is numbered once through a hash table, so the diff
+ * itself compares integers. Lines found in only one version can never be
+ * kept, so they are marked as changed up front and left out of the search:
+ * this does not change the result (they are in no common subsequence) but
+ * shrinks rewritten regions, where the cost of the search grows.
+ *
+ * @return The hunks, in order, none of them empty.
+ */
+std::vector<Hunk> diff_lines(const std::vector<std::string_view>& old_lines, const std::vector<std::string_view>& new_lines) {
+  std::unordered_map<std::string_view, std::uint32_t> ids;
+  ids.reserve(old_lines.size() + new_lines.size());
+  auto number = [&ids](const std::vector<std::string_view>& lines) {
+    std::vector<std::uint32_t> out;
+    out.reserve(lines.size());
+    for (std::string_view line : lines) out.push_back(ids.emplace(line, static_cast<std::uint32_t>(ids.size())).first->second);
+    return out;
+  };
+  std::vector<std::uint32_t> old_ids = number(old_lines);
+  std::vector<std::uint32_t> new_ids = number(new_lines);
+
+  std::vector<std::uint8_t> seen(ids.size(), 0); //bit 0: in the old version, bit 1: in the new one
+  for (std::uint32_t id : old_ids) seen[id] |= 1;
+  for (std::uint32_t id : new_ids) seen[id] |= 2;
+
+  std::vector<bool> old_changed(old_ids.size(), true), new_changed(new_ids.size(), true);
+  std::vector<std::uint32_t> old_kept, new_kept; //positions of the lines found in both versions
+  for (std::uint32_t i{ 0 }; i < old_ids.size(); ++i) {
+    if (seen[old_ids[i]] == 3) old_kept.push_back(i);
+  }
+  for (std::uint32_t j{ 0 }; j < new_ids.size(); ++j) {
+    if (seen[new_ids[j]] == 3) new_kept.push_back(j);
+  }
+
+  std::vector<std::uint32_t> a(old_kept.size()), b(new_kept.size());
+  for (std::size_t i{ 0 }; i < old_kept.size(); ++i) a[i] = old_ids[old_kept[i]];
+  for (std::size_t j{ 0 }; j < new_kept.size(); ++j) b[j] = new_ids[new_kept[j]];
+  std::vector<bool> a_changed(a.size(), false), b_changed(b.size(), false);
+  MyersDiff(a, b, a_changed, b_changed).run();
+  for (std::size_t i{ 0 }; i < a.size(); ++i) old_changed[old_kept[i]] = a_changed[i];
+  for (std::size_t j{ 0 }; j < b.size(); ++j) new_changed[new_kept[j]] = b_changed[j];
+
+  std::vector<Hunk> hunks;
+  std::uint32_t i{ 0 }, j{ 0 };
+  const auto n = static_cast<std::uint32_t>(old_changed.size());
+  const auto m = static_cast<std::uint32_t>(new_changed.size());
+  while (i < n || j < m) {
+    if (i < n && j < m && !old_changed[i] && !new_changed[j]) { //a kept line, on both sides
+      ++i, ++j;
+      continue;
+    }
+    Hunk hunk{ i, i, j, j };
+    while (i < n && old_changed[i]) ++i;
+    while (j < m && new_changed[j]) ++j;
+    hunk.old_end = i;
+    hunk.new_end = j;
+    if (hunk.old_begin == hunk.old_end && hunk.new_begin == hunk.new_end) break; //cannot happen with a valid script
+    hunks.push_back(hunk);
+  }
+  return hunks;
+}
+
+/**
+ * @brief Changed lines by kind, from the hunks and the classes of the lines.
+ *
+ * @param hunks The hunks of diff_lines().
+ * @param old_classes line_class_e flags of each old line (see classify_language()).
+ * @param new_classes line_class_e flags of each new line.
+ *
+ * Within each hunk and for each kind, the removed and added lines of that
+ * kind are paired up as modified lines, and only the surplus counts as
+ * added or removed: a hunk rewriting 3 code lines into 5 is 3 modified and
+ * 2 added code lines. Lines kept by the diff are not counted, even if an
+ * edit elsewhere changed their class (e.g. code now inside a comment).
+ *
+ * @return The delta counts of the file.
+ */
+DeltaCount count_delta(const std::vector<Hunk>& hunks, const std::vector<std::uint8_t>& old_classes, const std::vector<std::uint8_t>& new_classes) {
+  DeltaCount delta;
+  auto pair_up = [](LineDelta& out, count_t removed, count_t added) {
+    count_t modified = std::min(removed, added);
+    out.modified += modified;
+    out.removed += removed - modified;
+    out.added += added - modified;
+  };
+  for (const Hunk& hunk : hunks) {
+    count_t removed[4]{}, added[4]{}; //blank, code, comment, doc
+    auto tally = [](count_t (&counts)[4], std::uint8_t line_class) {
+      counts[0] += (line_class & LINE_BLANK) != 0;
+      counts[1] += (line_class & LINE_CODE) != 0;
+      counts[2] += (line_class & LINE_COMMENT) != 0;
+      counts[3] += (line_class & LINE_DOC) != 0;
+    };
+    for (std::uint32_t i{ hunk.old_begin }; i < hunk.old_end && i < old_classes.size(); ++i) tally(removed, old_classes[i]);
+    for (std::uint32_t j{ hunk.new_begin }; j < hunk.new_end && j < new_classes.size(); ++j) tally(added, new_classes[j]);
+    pair_up(delta.lines, hunk.old_end - hunk.old_begin, hunk.new_end - hunk.new_begin);
+    pair_up(delta.blank, removed[0], added[0]);
+    pair_up(delta.loc, removed[1], added[1]);
+    pair_up(delta.com, removed[2], added[2]);
+    pair_up(delta.dox, removed[3], added[3]);
+  }
+  return delta;
+}
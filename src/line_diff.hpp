@@ -0,0 +1,104 @@
+#ifndef LINE_DIFF_HPP
+#define LINE_DIFF_HPP
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "main.hpp"
+
+/*!
+ * @file line_diff.hpp
+ * @description
+ * Line diff of two versions of a file, and the delta counts of `--diff`:
+ * how many code, comment, doc and blank lines were added, removed or
+ * modified between them.
+ */
+
+//== Structs
+
+/**
+ * @struct Hunk
+ * @brief A run of lines replaced by another: [old_begin, old_end) became [new_begin, new_end).
+ *
+ * Either side may be empty (a pure insertion or deletion).
+ */
+struct Hunk {
+  std::uint32_t old_begin{ 0 }; //!< First removed line of the old version.
+  std::uint32_t old_end{ 0 };   //!< One past the last removed line.
+  std::uint32_t new_begin{ 0 }; //!< First added line of the new version.
+  std::uint32_t new_end{ 0 };   //!< One past the last added line.
+};
+
+/**
+ * @struct LineDelta
+ * @brief Changed lines of one kind.
+ *
+ * Within a hunk, as many removed and added lines of a kind as possible
+ * are paired up as modified; the rest are plain additions or removals.
+ */
+struct LineDelta {
+  count_t added{ 0 };    //!< Lines only in the new version.
+  count_t removed{ 0 };  //!< Lines only in the old version.
+  count_t modified{ 0 }; //!< Lines rewritten in place.
+
+  /// @brief Add the changes of another file or hunk.
+  LineDelta& operator+=(const LineDelta& other) {
+    added += other.added;
+    removed += other.removed;
+    modified += other.modified;
+    return *this;
+  }
+};
+
+/**
+ * @struct DeltaCount
+ * @brief Changed lines of a file, by kind, with the same categories as AttributeCount.
+ */
+struct DeltaCount {
+  LineDelta lines; //!< All lines.
+  LineDelta blank; //!< Blank lines.
+  LineDelta loc;   //!< Lines of code.
+  LineDelta com;   //!< Regular comment lines.
+  LineDelta dox;   //!< Doc comment lines.
+
+  /// @brief Add the changes of another file.
+  DeltaCount& operator+=(const DeltaCount& other) {
+    lines += other.lines;
+    blank += other.blank;
+    loc += other.loc;
+    com += other.com;
+    dox += other.dox;
+    return *this;
+  }
+};
+
+//== Functions
+
+/**
+ * @brief Split a file content into lines.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see split_lines()
+ */
+std::vector<std::string_view> split_lines(std::string_view content);
+
+/**
+ * @brief Shortest edit script between two versions of a file, as hunks.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see diff_lines()
+ */
+std::vector<Hunk> diff_lines(const std::vector<std::string_view>& old_lines, const std::vector<std::string_view>& new_lines);
+
+/**
+ * @brief Changed lines by kind, from the hunks and the classes of the lines.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see count_delta()
+ */
+DeltaCount count_delta(const std::vector<Hunk>& hunks, const std::vector<std::uint8_t>& old_classes, const std::vector<std::uint8_t>& new_classes);
+
+#endif
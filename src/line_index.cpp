@@ -0,0 +1,153 @@
+/*!
+ * @file line_index.cpp
+ * @description
+ * Line classes of a file kept up to date across edits, by rescanning from
+ * the last saved scanner state before an edit until the state converges.
+ */
+
+#include "line_index.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Classify every line of a content.
+ *
+ * @param lang_type Language of the content.
+ * @param content The content, which need not outlive the index.
+ *
+ * A single pass with the scanner of the language, saving its state every
+ * CHECKPOINT_SPACING bytes or so. The counts are those count_language()
+ * gives.
+ */
+LineIndex::LineIndex(lang_type_e lang_type, std::string_view content) : m_type{ lang_type }, m_size{ content.size() } {
+  m_checkpoints.push_back({});
+  std::size_t converged{ 0 };
+  rescan(content, 0, {}, 0, m_lines, converged);
+  for (std::uint8_t line_class : m_lines) tally(line_class, 1);
+}
+
+/**
+ * @brief Bring the index up to date after an edit.
+ *
+ * @param content The whole content after the edit.
+ * @param offset Where the edit starts, in bytes.
+ * @param removed Bytes removed at `offset`.
+ * @param inserted Bytes inserted in their place.
+ *
+ * Rescans from the last checkpoint at or before `offset`: the state at a
+ * line start only depends on the bytes before it, which the edit left
+ * alone. The scan stops at the first old checkpoint past the edit whose
+ * state it reaches unchanged; its lines replace those from the start
+ * checkpoint to there, and the counts change by the difference. A one-line
+ * edit thus rescans a few kilobytes whatever the size of the file, unless
+ * it opens or closes a comment or a string, which changes every line
+ * after it.
+ *
+ * An edit that does not fit the content indexed (with `content`) rebuilds
+ * the whole index.
+ *
+ * @return Bytes rescanned.
+ */
+std::size_t LineIndex::edit(std::string_view content, std::size_t offset, std::size_t removed, std::size_t inserted) {
+  if (offset > m_size || removed > m_size - offset || content.size() != m_size - removed + inserted) {
+    *this = LineIndex(m_type, content);
+    return content.size();
+  }
+
+  auto after_offset = [](std::size_t value, const LineCheckpoint& checkpoint) { return value < checkpoint.offset; };
+  std::size_t from = static_cast<std::size_t>(
+                       std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), offset, after_offset) - m_checkpoints.begin())
+                     - 1;
+  std::size_t first_line = m_checkpoints[from].line;
+  auto tail = std::upper_bound(m_checkpoints.begin() + from, m_checkpoints.end(), offset + removed, after_offset);
+  std::vector<LineCheckpoint> old(tail, m_checkpoints.end());
+  std::ptrdiff_t shift = static_cast<std::ptrdiff_t>(inserted) - static_cast<std::ptrdiff_t>(removed);
+
+  std::vector<std::uint8_t> lines;
+  std::size_t converged{ 0 };
+  std::size_t scanned = rescan(content, from, old, shift, lines, converged);
+
+  std::size_t last_line = converged < old.size() ? old[converged].line : m_lines.size();
+  for (std::size_t line{ first_line }; line < last_line; ++line) tally(m_lines[line], -1);
+  for (std::uint8_t line_class : lines) tally(line_class, 1);
+  std::ptrdiff_t line_shift = static_cast<std::ptrdiff_t>(lines.size()) - static_cast<std::ptrdiff_t>(last_line - first_line);
+  m_lines.erase(m_lines.begin() + first_line, m_lines.begin() + last_line);
+  m_lines.insert(m_lines.begin() + first_line, lines.begin(), lines.end());
+
+  for (std::size_t index{ converged }; index < old.size(); ++index) {
+    LineCheckpoint& checkpoint = m_checkpoints.emplace_back(old[index]);
+    checkpoint.offset += shift;
+    checkpoint.line += line_shift;
+  }
+  m_size = content.size();
+  return scanned;
+}
+
+/**
+ * @brief Classify the content from a checkpoint on, until it converges with an old checkpoint.
+ *
+ * @param content The whole content.
+ * @param from Index of the checkpoint to start from; the later ones are dropped and saved again.
+ * @param old Checkpoints past the edit, with their offsets before it, to converge with.
+ * @param shift Added to an old offset to get its offset in `content`.
+ * @param lines Receives the classes of the lines scanned.
+ * @param converged Set to the index in `old` where the state converged, or old.size().
+ *
+ * Scans whole lines, in chunks ending at the first line start past
+ * CHECKPOINT_SPACING bytes, and saves the state after each chunk. A chunk
+ * never runs past the next old checkpoint: its offset is a line start in
+ * both versions, so the states there can be compared. When they differ,
+ * the new state is saved there instead and the scan goes on to the next.
+ *
+ * @return Bytes scanned.
+ */
+std::size_t LineIndex::rescan(std::string_view content, std::size_t from, const std::vector<LineCheckpoint>& old,
+                              std::ptrdiff_t shift, std::vector<std::uint8_t>& lines, std::size_t& converged) {
+  m_checkpoints.resize(from + 1);
+  LineState state = m_checkpoints[from].state;
+  std::size_t start = m_checkpoints[from].offset;
+  std::size_t pos{ start };
+  std::size_t line = m_checkpoints[from].line;
+  converged = 0;
+
+  while (pos < content.size()) {
+    std::size_t chunk_end = content.size();
+    if (content.size() - pos > CHECKPOINT_SPACING) {
+      std::size_t eol = content.find('\n', pos + CHECKPOINT_SPACING);
+      if (eol != std::string_view::npos) chunk_end = eol + 1;
+    }
+    bool at_old{ false };
+    if (converged < old.size()) {
+      std::size_t old_pos = old[converged].offset + shift;
+      if (old_pos <= chunk_end) {
+        chunk_end = old_pos;
+        at_old = true;
+      }
+    }
+
+    std::size_t before = lines.size();
+    classify_language(m_type, content.substr(pos, chunk_end - pos), state, lines);
+    line += lines.size() - before;
+    pos = chunk_end;
+
+    if (at_old && state.same_as(old[converged].state)) return pos - start;
+    if (pos < content.size()) m_checkpoints.push_back({ pos, line, state });
+    converged += at_old;
+  }
+  converged = old.size();
+  return pos - start;
+}
+
+/**
+ * @brief Add (or, with `sign` -1, remove) a line class to the counts.
+ *
+ * @param line_class The line_class_e flags of a line.
+ * @param sign 1 to add the line, -1 to remove it.
+ */
+void LineIndex::tally(std::uint8_t line_class, int sign) {
+  m_counts.lines += sign;
+  m_counts.blank += (line_class & LINE_BLANK) != 0 ? sign : 0;
+  m_counts.loc += (line_class & LINE_CODE) != 0 ? sign : 0;
+  m_counts.com += (line_class & LINE_COMMENT) != 0 ? sign : 0;
+  m_counts.dox += (line_class & LINE_DOC) != 0 ? sign : 0;
+}
@@ -0,0 +1,106 @@
+#ifndef LINE_INDEX_HPP
+#define LINE_INDEX_HPP
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "language_registry.hpp"
+#include "main.hpp"
+
+/*!
+ * @file line_index.hpp
+ * @description
+ * Incremental counting of a file being edited: the class of every line,
+ * plus sparse checkpoints of the scanner state, so that an edit only
+ * rescans the lines around it.
+ */
+
+//== Structs
+
+/**
+ * @struct LineCheckpoint
+ * @brief The scanner state saved at the start of a line.
+ */
+struct LineCheckpoint {
+  std::size_t offset{ 0 }; //!< Byte offset of the line start.
+  std::size_t line{ 0 };   //!< Index of the line.
+  LineState state;         //!< Scanner state at the start of the line.
+};
+
+//== Classes
+
+/**
+ * @class LineIndex
+ * @brief The line classes and counts of a file content, kept up to date across edits.
+ *
+ * A checkpoint is saved at the first line start after every
+ * CHECKPOINT_SPACING bytes. An edit rescans from the last checkpoint
+ * before it, and stops at the first later checkpoint (past the edit)
+ * where the scanner is back in the state it had there before the edit:
+ * from that line on, the content and the state are the same as before,
+ * so the old classes still hold. Only the checkpoints after that point
+ * move, by the bytes and lines the edit added or removed.
+ *
+ * The index holds no copy of the content; the caller passes the new
+ * content to edit().
+ */
+class LineIndex {
+public:
+  /// @brief Approximate distance in bytes between two checkpoints.
+  static constexpr std::size_t CHECKPOINT_SPACING{ 4096 };
+
+  /**
+   * @brief Classify every line of a content.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  LineIndex(lang_type_e lang_type, std::string_view content);
+
+  /// @brief Language of the content.
+  lang_type_e type() const { return m_type; }
+
+  /// @brief Line counts of the content.
+  const AttributeCount& counts() const { return m_counts; }
+
+  /// @brief line_class_e flags of each line.
+  const std::vector<std::uint8_t>& lines() const { return m_lines; }
+
+  /// @brief The checkpoints, by increasing offset; the first is at offset 0.
+  const std::vector<LineCheckpoint>& checkpoints() const { return m_checkpoints; }
+
+  /// @brief Size in bytes of the content indexed.
+  std::size_t size() const { return m_size; }
+
+  /**
+   * @brief Bring the index up to date after an edit.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  std::size_t edit(std::string_view content, std::size_t offset, std::size_t removed, std::size_t inserted);
+
+private:
+  /**
+   * @brief Classify the content from a checkpoint on, until it converges with an old checkpoint.
+   * @param content The whole content.
+   * @param from Index of the checkpoint to start from; the later ones are dropped and saved again.
+   * @param old Checkpoints past the edit, with their offsets before it, to converge with.
+   * @param shift Added to an old offset to get its offset in `content`.
+   * @param lines Receives the classes of the lines scanned.
+   * @param converged Set to the index in `old` where the state converged, or old.size().
+   * @return Bytes scanned.
+   */
+  std::size_t rescan(std::string_view content, std::size_t from, const std::vector<LineCheckpoint>& old, std::ptrdiff_t shift,
+                     std::vector<std::uint8_t>& lines, std::size_t& converged);
+
+  /// @brief Add (or, with `sign` -1, remove) a line class to the counts.
+  void tally(std::uint8_t line_class, int sign);
+
+  lang_type_e m_type;                        //!< Language of the content.
+  std::size_t m_size{ 0 };                   //!< Bytes of the content.
+  AttributeCount m_counts;                   //!< Counts of the content.
+  std::vector<std::uint8_t> m_lines;         //!< Class of each line.
+  std::vector<LineCheckpoint> m_checkpoints; //!< Saved states, by offset.
+};
+
+#endif
@@ -1,6 +1,6 @@
 #include <algorithm>
+#include <charconv>
 #include <filesystem>
-#include <fstream> //ifstream
 #include <iomanip>
 #include <iostream>
 
@@ -10,13 +10,27 @@ namespace fs = std::filesystem;
 /*!
  * @file main.cpp
  * @description
- * This program implements a single line of code count for C/C++ programs.
+ * This program implements a single line of code count for C/C++ programs
+ * (and Python, Rust, Go, Java, shell and CMake, see language_registry.hpp).
  * @author	Haniel Lucas Machado Rocha
  * @author  Theo Henrique da Silva Borges
  * @date	May, 14th 2025.
  */
 
 #include "main.hpp"
+#include "count_daemon.hpp"
+#include "dir_walker.hpp"
+#include "language_registry.hpp"
+#include "git_repo.hpp"
+#include "path_arena.hpp"
+#include "record_sort.hpp"
+#include "report_writer.hpp"
+#include "result_cache.hpp"
+#include "run_stats.hpp"
+#include "stream_output.hpp"
+#include "thread_pool.hpp"
+#include "top_records.hpp"
+#include "tree_diff.hpp"
 #include <string>
 
 /**
@@ -31,19 +45,25 @@ void usage(std::string_view msg) {
   std::cout << "NAME\n";
   std::cout << "  sloc - single line of code counter.\n\n";
   std::cout << "SYNOPSIS\n";
-  std::cout << "  sloc [-h | --help] [-r] [(-s | -S) f|t|c|b|s|a] <file | directory>\n\n";
+  std::cout << "  sloc [-h | --help] [-r] [-j N] [--no-cache | --rebuild-cache] [--cache-verify]\n";
+  std::cout << "       [--stats | --stats-json] [--stream tsv|ndjson] [--format table|json|csv|bin]\n";
+  std::cout << "       [--top K] [--git [rev]] [--diff A B] [--daemon SOCKET]\n";
+  std::cout << "       [(-s | -S) f|t|c|d|b|s|a[,...]] <file | directory>\n";
+  std::cout << "  sloc --query SOCKET REQUEST\n\n";
   std::cout << "EXAMPLES\n";
   std::cout << "  sloc main.cpp sloc.cpp\n";
   std::cout << "     Counts loc, comments, blanks of the source files 'main.cpp' and 'sloc.cpp'\n\n";
   std::cout << "  sloc source\n";
-  std::cout << "     Counts loc, comments, blanks of all C/C++ source files inside 'source'\n\n";
+  std::cout << "     Counts loc, comments, blanks of all supported source files inside 'source'\n\n";
   std::cout << "  sloc -r -s c source\n";
-  std::cout << "     Counts loc, comments, blanks of all C/C++ source files recursively inside 'source'\n";
+  std::cout << "     Counts loc, comments, blanks of all supported source files recursively inside 'source'\n";
   std::cout << "     and sort the result in ascending order by # of comment lines.\n\n";
   std::cout << "DESCRIPTION\n";
   std::cout << "  Sloc counts the individual number **lines of code** (LOC), comments, and blank\n";
   std::cout << "  lines found in a list of files or directories passed as the last argument\n";
-  std::cout << "  (after options).\n";
+  std::cout << "  (after options). Supported languages are C, C++, Python, Rust, Go, Java, shell\n";
+  std::cout << "  and CMake, recognized by file extension (or CMakeLists.txt), and for files\n";
+  std::cout << "  given explicitly also by their #! line.\n";
   std::cout << "  After the counting process is concluded the program prints out to the standard\n";
   std::cout << "  output a table summarizing the information gathered, by each source file and/or\n";
   std::cout << "  directory provided.\n";
@@ -54,13 +74,61 @@ void usage(std::string_view msg) {
   std::cout << "            Display this information.\n\n";
   std::cout << "  -r\n";
   std::cout << "            Look for files recursively in the directory provided.\n\n";
-  std::cout << "  -s f|t|c|d|b|s|a\n";
+  std::cout << "  -j N\n";
+  std::cout << "            Count files using N threads. Default is the number of hardware threads.\n\n";
+  std::cout << "  --no-cache\n";
+  std::cout << "            Do not read nor write the cache file, $XDG_CACHE_HOME/sloc/counts (or\n";
+  std::cout << "            ~/.cache/sloc/counts). By default, the counts of files are kept there,\n";
+  std::cout << "            and unchanged files are not read again.\n\n";
+  std::cout << "  --rebuild-cache\n";
+  std::cout << "            Ignore the cached counts, count every file again and update the cache.\n\n";
+  std::cout << "  --cache-verify\n";
+  std::cout << "            Also compare a hash of the content before reusing cached counts.\n\n";
+  std::cout << "  --stats, --stats-json\n";
+  std::cout << "            Report on stderr (as text or JSON) the time spent in each phase, the\n";
+  std::cout << "            bytes read, throughput, peak memory and the activity of each thread.\n\n";
+  std::cout << "  --stream tsv|ndjson\n";
+  std::cout << "            Instead of the table, print one record per file (tab-separated or one\n";
+  std::cout << "            JSON object per line) as soon as it is counted, then the totals.\n";
+  std::cout << "            Records come in completion order and cannot be sorted.\n\n";
+  std::cout << "  --format table|json|csv|bin\n";
+  std::cout << "            Print the results as a table (the default), a JSON document, CSV\n";
+  std::cout << "            rows or little-endian binary records. Sorting applies to all of them.\n\n";
+  std::cout << "  --top K\n";
+  std::cout << "            Only print the first K files of the sort. The other files are dropped\n";
+  std::cout << "            as they are counted. Without -s/-S, keeps the K files with most sloc.\n\n";
+  std::cout << "  --git [rev]\n";
+  std::cout << "            Only count the files tracked by git, listed from the index instead of\n";
+  std::cout << "            walking the directories. With a revision (a commit, branch or tag,\n";
+  std::cout << "            with ^ and ~ suffixes), count the files as they are in that revision,\n";
+  std::cout << "            read from the repository without a checkout. Without a file or\n";
+  std::cout << "            directory, counts the whole repository of the current directory.\n\n";
+  std::cout << "  --diff A B\n";
+  std::cout << "            Instead of totals, count the lines changed from A to B: two directories\n";
+  std::cout << "            (compared recursively, file by file), two files, or revisions of the git\n";
+  std::cout << "            repository of the current directory. Each count reads '+added -removed\n";
+  std::cout << "            ~modified', where modified lines are removed lines replaced by added\n";
+  std::cout << "            lines of the same kind. Unchanged files are not listed.\n\n";
+  std::cout << "  --daemon SOCKET\n";
+  std::cout << "            Count the files once, then keep running: follow their changes (with\n";
+  std::cout << "            inotify), count again the files that changed, and answer queries on\n";
+  std::cout << "            the Unix domain socket SOCKET. Stops on the 'shutdown' request, SIGINT\n";
+  std::cout << "            or SIGTERM. Sorting and formats are chosen by each query.\n\n";
+  std::cout << "  --query SOCKET REQUEST\n";
+  std::cout << "            Send REQUEST (the rest of the command line) to the daemon on SOCKET\n";
+  std::cout << "            and print its answer. Requests: 'totals', 'stats', 'shutdown' and\n";
+  std::cout << "            'files [-s|-S keys] [--top K] [--format json|csv|bin]'.\n\n";
+  std::cout << "  -s f|t|c|d|b|s|a[,...]\n";
   std::cout << "            Sort table in ASCENDING order by (f)ilename, (t) filetype,\n";
   std::cout << "            (c)omments, (d)oc comments, (b)lank lines, (s)loc, or (a)ll.\n";
+  std::cout << "            Several keys separated by commas (e.g. s,c,f) break ties in turn;\n";
+  std::cout << "            files equal on every key are listed by file name.\n";
   std::cout << "            Default is to show files in ordem of appearance.\n\n";
-  std::cout << "  -S f|t|c|d|b|s|a\n";
+  std::cout << "  -S f|t|c|d|b|s|a[,...]\n";
   std::cout << "            Sort table in DESCENDING order by (f)ilename, (t) filetype,\n";
   std::cout << "            (c)omments, (d)oc comments, (b)lank lines, (s)loc, or (a)ll.\n";
+  std::cout << "            Several keys separated by commas (e.g. s,c,f) break ties in turn;\n";
+  std::cout << "            files equal on every key are listed by file name.\n";
   std::cout << "            Default is to show files in ordem of appearance.\n";
 }
 
@@ -79,9 +147,10 @@ void usage(std::string_view msg) {
 std::string percent(count_t part, count_t total) {
   if (total == 0) return "0%";
   double perc = (static_cast<double>(part) / total) * 100; //converts part to double, divides by total and multiplies by 100
-  std::ostringstream oss;
-  oss << std::fixed << std::setprecision(1) << perc; //std::fixed rounds the number and std::setprecision(1) shows one decimal place
-  return oss.str() + "%"; //extracts the contents of ostringstream as a std::string.
+  char text[32];
+  auto result = std::to_chars(text, text + sizeof(text) - 1, perc, std::chars_format::fixed, 1); //same digits as std::fixed with std::setprecision(1), without a stream or a locale
+  *result.ptr++ = '%';
+  return std::string(text, result.ptr);
 }
 
 /**
@@ -93,306 +162,15 @@ std::string percent(count_t part, count_t total) {
  * @return String in format `value (percentage)`.
  */
 std::string value_with_percent(count_t value, count_t total) {
-    return std::to_string(value) + " (" + percent(value, total) + ")";
+    std::string text;
+    text.reserve(32);
+    append_uint(text, value);
+    text += " (";
+    text += percent(value, total);
+    text += ')';
+    return text;
 }
 
-/**
- * @brief Trim whitespace from left of string.
- * 
- * @param s String to trim.
- * @param t Characters to trim (default whitespace).
- * 
- * @return Left-trimmed string.
- */
-inline std::string ltrim(const std::string& s, const char* t) {
-  std::string clone{s}; //copy of the original string s
-  size_t start = clone.find_first_not_of(t); //finds the first character not in t, i.e. the first visible character
-
-  if (start != std::string::npos) { //if there is a visible character
-    clone.erase(0, start); //erase from the first character (which is a space) to the first visible character
-  } else { //if there is only space, i.e., start == std::string::npos
-    clone.clear();
-  }
-
-  return clone;
-}
-
-/**
- * @brief Trim whitespace from right of string.
- * 
- * @param s String to trim.
- * @param t Characters to trim (default whitespace).
- * 
- * @return Right-trimmed string.
- */
-inline std::string rtrim(const std::string& s, const char* t) {
-  std::string clone{s}; //copy of the original string s
-  size_t end = clone.find_last_not_of(t); //finds the last character not in t, i.e. the last visible character
-
-  if (end != std::string::npos) {
-    clone.erase(end + 1); //erase everything after the last visible character
-  } else {
-    clone.clear();
-  }
-  
-  return clone;
-}
-
-/**
- * @brief Trim whitespace from both ends of string.
- * 
- * @param s String to trim.
- * @param t Characters to trim (default whitespace).
- * 
- * @return Trimmed string.
- */
-inline std::string trim(const std::string& s, const char* t) {
-  return ltrim(rtrim(s, t), t);
-}
-
-/**
- * @brief Count total lines in a file.
- * 
- * @param filename Path to the file.
- * 
- * @return Total number of lines.
- */
-count_t countTotalLines (const std::string& filename) {
-  std::ifstream file(filename);
-  int line = 0;
-  std::string codeLines;
-
-  while (std::getline(file, codeLines)) ++line;
-  
-  return line;
-}
-
-
-/**
- * @brief Verify if index i in list line has a next value.
- * 
- * @param line Line to be analysed.
- * @param idx Index to verify if there is a next.
- * 
- * @return True if i has a next value, false otherwise.
- * 
- */
-bool exist_next(std::string line, size_t idx){
-  if (idx + 1 > line.size()){
-    return false;
-  }
-  return true;
-}
-
-/**
- * @brief Verify if index i in list line has a prev value.
- * 
- * @param line Line to be analysed.
- * @param idx Index to verify if there is a prev.
- * 
- * @return True if i has a previous value, false otherwise.
- * 
- */
-bool exist_prev(std::string line, size_t idx){
-  if (idx == 0){
-    return false;
-  }
-  return true;
-}
-
-/**
- * @brief Check if a quote ends a string literal.
- * 
- * @param line The full line content.
- * @param i Index of the quote character.
- * 
- * Checks if the quote isn't escaped and isn't part of a character literal.
- * 
- * @return true if it's a valid string literal end.
- */
-bool endLiteral(std::string line, size_t i){
-  if (exist_next(line, i) && exist_prev(line, i)){
-    if (line[i - 1] == '\\' || (line[i - 1] == '\'' && line[i + 1] == '\'')){
-      return false;
-    }
-    return true;
-  }
-  return false;
-}
-
-/**
- * @brief Check if a quote start a string literal.
- * 
- * @param line The full line content.
- * @param i Index of the quote character.
- * 
- * Checks if the quote isn't escaped and isn't part of a character literal.
- * 
- * @return true if it's a valid string literal start.
- */
- bool startLiteral(std::string line, size_t i){
-  if (exist_next(line, i) && exist_prev(line, i)){
-    if ((line[i - 1] == '\'' && line[i + 1] == '\'')){
-      return false;
-    }
-    return true;
-  }
-  return false;
-}
-
-/**
- * @brief Update the counting state based on line content.
- * 
- * @param line Current line being processed.
- * @param ts Current state tracker.
- * 
- * Implements the state machine transitions based on line content.
- * 
- * @return AttributeCount with counts for this line.
- */
-AttributeCount updateState(std::string line, CurrentCount& ts){
-  AttributeCount atributes;
-  line = trim(line, " ");
-  size_t len = line.length();
-
-      //verify if line is blank
-      if (ts.current_state != ts.COMMENT && ts.current_state != ts.DOXY){
-        bool blank{false};
-      if (line.empty()) {
-        blank = true;
-        atributes.blank = 1;
-        return atributes;
-      }
-
-    }//increment the current state starting a new line
-    if (ts.current_state == ts.COMMENT){
-      atributes.com = 1;
-    }
-    if (ts.current_state == ts.DOXY){
-      atributes.dox = 1;
-    }
-    if (ts.current_state == ts.LITERAL || ts.current_state == ts.CODE){
-      atributes.loc = 1;
-    }
-
-    //scan all the chars of the line
-    for (size_t i{0}; i < len; ++i){
-      auto minline3 = line.substr(i, 3);
-      auto minline2 = line.substr(i, 2);
-
-      //close the literal state
-    if (ts.current_state == ts.LITERAL){
-        if (line[i] == '"'){
-          if(endLiteral(line, i)){
-            ts.current_state = ts.START;
-            continue;
-          }
-        }
-      }
-
-      //close the comment or doxy states
-      if (ts.current_state == ts.DOXY || ts.current_state == ts.COMMENT){
-        if (minline2 == "*/"){
-          ts.current_state = ts.START;
-          i += 1;
-          continue;
-        }
-      }
-      
-      //verify if the program is in code state or literal state
-      if (ts.current_state == ts.CODE || ts.current_state == ts.START){
-
-        //start literal state
-        if (line[i]  == '"'){
-          if (startLiteral(line, i)){
-            ts.current_state = ts.LITERAL;
-            continue;
-          }
-        }
-        //start the doxy-comment state
-        else if (minline3 == "/*!" || minline3 == "/**"){
-          ts.current_state = ts.DOXY;
-          atributes.dox = 1;
-          i += 2;
-          continue;
-        } 
-        //count the line as single-line doxy-comment and stop scanning the line
-        else if (minline3 == "//!" || minline3 == "///"){
-          atributes.dox = 1; 
-          ts.current_state = ts.START;
-          break;
-        }
-        //start the comment state
-        else if (minline2 == "/*"){
-          ts.current_state = ts.COMMENT;
-          atributes.com = 1;
-          i += 1;
-          continue;
-        }
-        //count the line as single-line comment and stop scanning the line
-        else if (minline2 == "//"){
-          atributes.com = 1;
-          ts.current_state = ts.START;
-          break;
-        }
-        //if none of the before cases happens, count one code line.
-        else{
-          ts.current_state = ts.CODE;
-          atributes.loc = 1;
-        }
-      }
-    }
-    //if the line ended with a code state, set the state to start to scan the next line
-    if (ts.current_state == ts.CODE){
-      ts.current_state = ts.START;
-    }
-    //return the attributes of a line of the code.
-    return atributes;
-}
-
-/**
- * @brief Process a file through the state machine.
- * 
- * @param filename File to process.
- * @param ts Initial state.
- * @param atr Accumulator for counts.
- * 
- * @return AttributeCount with updated counts.
- */
-AttributeCount statesMachine(const std::string& filename, CurrentCount ts, AttributeCount& atr){
-  std::ifstream file(filename);
-  std::string codeLines;
-
-  while (std::getline(file, codeLines)) {
-    //call updateState() for each line of the file selected.
-    AttributeCount atributes = updateState(codeLines, ts);
-    atr.lines += atributes.lines;
-    atr.blank += atributes.blank;
-    atr.com += atributes.com;
-    atr.dox += atributes.dox;
-    atr.loc += atributes.loc;
-  }
-  //return the attributes of a entire file
-  return atr;
-}
-
-/**
- * @brief Process a file and count its lines.
- * 
- * @param filename Path to the file.
- * 
- * @return AttributeCount with all line counts.
- */
-AttributeCount process_file(const std::string& filename) {
-  AttributeCount atr;
-  CurrentCount ts;
-
-  statesMachine(filename, ts, atr);
-  atr.lines = countTotalLines(filename);
-
-  return atr;
-}
- 
 /**
  * @brief Validate and process command line arguments.
  * 
@@ -402,9 +180,16 @@ AttributeCount process_file(const std::string& filename) {
  * 
  * Parses arguments, validates them, and sets up runtime options.
  * Exits with error message if invalid arguments are provided.
+ * Directories are only recorded here; they are walked once, by
+ * process_files(), which is also where a directory without any supported
+ * file is reported. `--top` without `-s`/`-S` sorts like `-S s`.
+ * `--git` takes the next argument as its revision, unless it starts with
+ * a dash or names an existing file or directory. `--diff` takes the next
+ * two arguments, whatever they are.
  */
 void validate_arguments(int argc, char* argv[], RunningOpt& run_options) {
-  for (size_t ct{1}; ct < argc; ++ct) {
+  const size_t n_args = static_cast<size_t>(argc); //argc is never negative; indexes below are size_t
+  for (size_t ct{1}; ct < n_args; ++ct) {
     auto it { inputed_arguments_with_their_keys.find(argv[ct]) }; //find the key argv[ct] in inputed_arguments_with_their_keys, which is, e.g., "-r" in case of recursive
     if (it != inputed_arguments_with_their_keys.end()) { //.find() returns .end() if nothing is found with that inputed argument
       enum_arguments arg {it -> second}; //iterator -> second returns the value of the dictionary
@@ -414,6 +199,19 @@ void validate_arguments(int argc, char* argv[], RunningOpt& run_options) {
         case SORTDES: run_options.sort_descending = true; run_options.should_sort = true; break;
         case SORTAS: run_options.sort_ascending = true; run_options.should_sort = true; break;
         case HELP: run_options.help = true; break;
+        case JOBS: break; //the value is read below
+        case NOCACHE: run_options.use_cache = false; break;
+        case REBUILDCACHE: run_options.rebuild_cache = true; break;
+        case VERIFYCACHE: run_options.verify_cache = true; break;
+        case STATS: run_options.stats = true; break;
+        case STATSJSON: run_options.stats = true; run_options.stats_json = true; break;
+        case STREAM: break; //the value is read below
+        case FORMAT: break; //the value is read below
+        case TOP: break; //the value is read below
+        case GIT: run_options.git = true; break; //the optional revision is read below
+        case DIFF: run_options.diff = true; break; //the two snapshots are read below
+        case DAEMON: run_options.daemon = true; break; //the socket is read below
+        case QUERY: run_options.query = true; break; //the socket and the request are read below
       }
 
       if (run_options.help){
@@ -423,219 +221,211 @@ void validate_arguments(int argc, char* argv[], RunningOpt& run_options) {
 
       //Checking if sort arguments are correctly inputed
       if (arg == SORTAS || arg == SORTDES){
-        if (ct + 1 >= argc) { //treating memory leak
+        if (ct + 1 >= n_args) { //treating memory leak
           std::cerr << "Missing value\n";
           usage();
           exit(1);
         }
-        const char* nextArgument { argv[ct+1] };
-        auto it { sorters_with_their_keys.find(nextArgument) }; //find the key argv[ct+1] in sorters_with_their_keys, which is, e.g., "f" in case of sort by filename
-        if (it != sorters_with_their_keys.end()) {
-          run_options.sort_field = it -> second;
-          ct++;
-        } else {
-          std::cerr << "Invalid sorter parameter: " << nextArgument << "\n";
+        const std::string nextArgument { argv[ct+1] };
+        run_options.sort_fields.clear(); //the last -s/-S wins
+        for (size_t start{0}; start <= nextArgument.size(); ) { //keys are separated by commas, e.g. "s,c,f"
+          size_t end = std::min(nextArgument.find(',', start), nextArgument.size());
+          auto it { sorters_with_their_keys.find(nextArgument.substr(start, end - start)) }; //find the key in sorters_with_their_keys, which is, e.g., "f" in case of sort by filename
+          if (it == sorters_with_their_keys.end()) {
+            std::cerr << "Invalid sorter parameter: " << nextArgument << "\n";
+            usage();
+            exit(1);
+          }
+          run_options.sort_fields.push_back(it -> second);
+          start = end + 1;
+        }
+        ct++;
+      }
+
+      //Checking if the number of jobs is a positive integer
+      if (arg == JOBS){
+        if (ct + 1 >= n_args) {
+          std::cerr << "Missing value\n";
+          usage();
+          exit(1);
+        }
+        const std::string nextArgument { argv[ct+1] };
+        if (nextArgument.empty() || nextArgument.size() > 6 || nextArgument.find_first_not_of("0123456789") != std::string::npos || std::stoul(nextArgument) == 0) {
+          std::cerr << "Invalid number of jobs: " << nextArgument << "\n";
           usage();
           exit(1);
         }
+        run_options.jobs = std::stoul(nextArgument);
+        ct++;
       }
-    } else {
-      std::string file_or_dir_inputed_by_the_user = argv[ct];
 
-      if (!fs::exists(file_or_dir_inputed_by_the_user)) {
-        std::cerr << "Sorry, unable to read \"" << file_or_dir_inputed_by_the_user << "\".\n";
+      //Checking if the stream format is known
+      if (arg == STREAM){
+        if (ct + 1 >= n_args) {
+          std::cerr << "Missing value\n";
+          usage();
+          exit(1);
+        }
+        const char* nextArgument { argv[ct+1] };
+        auto format { stream_formats_with_their_keys.find(nextArgument) };
+        if (format == stream_formats_with_their_keys.end()) {
+          std::cerr << "Invalid stream format: " << nextArgument << "\n";
+          usage();
+          exit(1);
+        }
+        run_options.stream_format = format -> second;
+        ct++;
       }
 
-      if (fs::is_regular_file(file_or_dir_inputed_by_the_user)) {
-        std::string extension = fs::path(file_or_dir_inputed_by_the_user).extension().string();
-        if (extension == ".cpp" || extension == ".c" || extension == ".hpp" || extension == ".h") {
-          run_options.input_list.push_back(file_or_dir_inputed_by_the_user);
-        } else {
-          std::cerr << "Sorry, \"" << extension << "\" files are not supported at this time.\n";
+      //Checking if the report format is known
+      if (arg == FORMAT){
+        if (ct + 1 >= n_args) {
+          std::cerr << "Missing value\n";
+          usage();
+          exit(1);
+        }
+        const char* nextArgument { argv[ct+1] };
+        auto format { output_formats_with_their_keys.find(nextArgument) };
+        if (format == output_formats_with_their_keys.end()) {
+          std::cerr << "Invalid output format: " << nextArgument << "\n";
+          usage();
           exit(1);
         }
-      } else if (fs::is_directory(file_or_dir_inputed_by_the_user)) {
-        run_options.directory_list.push_back(file_or_dir_inputed_by_the_user);
+        run_options.output_format = format -> second;
+        ct++;
       }
-    }
 
-    if (run_options.input_list.empty()) {
-      bool found_any_supported_file {false};
-
-      for (const auto& directory : run_options.directory_list) {
-        for (const auto& directory_file : fs::recursive_directory_iterator(directory)) {
-          if (directory_file.is_regular_file()) {
-            std::string extension = directory_file.path().extension().string();
-            if (extension == ".c" || extension == ".cpp" || extension == ".h" || extension == ".hpp") {
-              found_any_supported_file = true;
-              break;
-            }
-          }
+      //Checking if the number of files to keep is a positive integer
+      if (arg == TOP){
+        if (ct + 1 >= n_args) {
+          std::cerr << "Missing value\n";
+          usage();
+          exit(1);
         }
-
-        if (found_any_supported_file) break;
+        const std::string nextArgument { argv[ct+1] };
+        if (nextArgument.empty() || nextArgument.size() > 9 || nextArgument.find_first_not_of("0123456789") != std::string::npos || std::stoul(nextArgument) == 0) {
+          std::cerr << "Invalid number of files: " << nextArgument << "\n";
+          usage();
+          exit(1);
+        }
+        run_options.top = std::stoul(nextArgument);
+        ct++;
       }
 
-      if (!found_any_supported_file) {
-        if (!run_options.directory_list.empty()) {
-          std::cerr << "Sorry, unable to find any supported source file inside directory \"" << run_options.directory_list[0] << "\".\n";
+      //--diff takes the old and the new snapshot, which may be anything (a revision need not exist on disk)
+      if (arg == DIFF){
+        if (ct + 2 >= n_args) {
+          std::cerr << "Missing value\n";
+          usage();
+          exit(1);
         }
+        run_options.diff_old = argv[ct+1];
+        run_options.diff_new = argv[ct+2];
+        ct += 2;
       }
-    }
-  }
-}
-
-/**
- * @brief Collect files from directories based on options.
- * 
- * @param run_options Runtime options including directory list.
- * 
- * Populates input_list with files found in directories, respecting recursive flag.
- * Skuns unsupported file types and avoids duplicate files.
- */
-void collect_files(RunningOpt& run_options) {
-  if (run_options.directory_list.empty()) return; //return gets out of the function
 
-  std::unordered_set<std::string> unique_files;
-  for (const auto& file : run_options.input_list) {
-    unique_files.insert(fs::absolute(file).string()); //absolute returns the absolute path of the file
-  }
+      //--daemon takes the path of its socket
+      if (arg == DAEMON){
+        if (ct + 1 >= n_args) {
+          std::cerr << "Missing value\n";
+          usage();
+          exit(1);
+        }
+        run_options.socket_path = argv[ct+1];
+        ct++;
+      }
 
-  if (run_options.recursive) {
-    for (const auto& directory : run_options.directory_list) { //for each directory in directory_list
-    for (const auto& directory_file : fs::recursive_directory_iterator(directory)) { //recursive_directory_iterator and directory_iterator both return directory_entry
-      if (directory_file.is_regular_file()) { //if the file in the directory is a file, not another directory
-        std::string file_path = directory_file.path().string(); //path() gets the... path... of the file, and .string() converts the path to string
-        std::string absolute_path = fs::absolute(file_path).string();
+      //--query takes the socket, and the rest of the command line is the request (whose options are not ours)
+      if (arg == QUERY){
+        if (ct + 2 >= n_args) {
+          std::cerr << "Missing value\n";
+          usage();
+          exit(1);
+        }
+        run_options.socket_path = argv[ct+1];
+        for (size_t word{ct + 2}; word < n_args; ++word) {
+          if (!run_options.request.empty()) run_options.request += ' ';
+          run_options.request += argv[word];
+        }
+        ct = n_args - 1;
+      }
 
-        if (unique_files.find(absolute_path) != unique_files.end()) { //.find returns end(). so if the return is != from .end(), it is found
-          continue;
+      //The revision of --git is optional: the next argument is one unless it is an option or a path
+      if (arg == GIT && ct + 1 < n_args && argv[ct+1][0] != '-') {
+        std::error_code ec;
+        if (!fs::exists(argv[ct+1], ec)) {
+          run_options.git_rev = argv[ct+1];
+          ct++;
         }
+      }
+    } else {
+      std::string file_or_dir_inputed_by_the_user = argv[ct];
+      std::error_code ec;
+      fs::file_status status = fs::status(file_or_dir_inputed_by_the_user, ec); //one stat answers all three questions
 
-        if (file_path.length() >= 4) {
-          std::string last4(file_path.end() - 4, file_path.end());
-          std::string last2(file_path.end() - 2, file_path.end());
+      if (!fs::exists(status)) {
+        std::cerr << "Sorry, unable to read \"" << file_or_dir_inputed_by_the_user << "\".\n";
+      }
 
-          if (last4 == ".cpp" || last4 == ".hpp" || last2 == ".c" || last2 == ".h") {
-            run_options.input_list.push_back(file_path);
-            unique_files.insert(absolute_path);
-          }
+      if (fs::is_regular_file(status)) {
+        if (language_of_file(file_or_dir_inputed_by_the_user) != UNDEF) { //known extension or name, or recognized from its content
+          run_options.input_list.push_back(file_or_dir_inputed_by_the_user);
+        } else {
+          std::cerr << "Skipping \"" << file_or_dir_inputed_by_the_user << "\": not recognized as source code.\n";
         }
+      } else if (fs::is_directory(status)) {
+        run_options.directory_list.push_back(file_or_dir_inputed_by_the_user); //walked once, later, by process_files()
       }
     }
   }
-  } else {
-      for (const auto& directory : run_options.directory_list) { //for each directory in directory_list
-        for (const auto& directory_file : fs::directory_iterator(directory)) {
-          if (directory_file.is_regular_file()) { //if the file in the directory is a file, not another directory
-            std::string file_path = directory_file.path().string(); //path() gets the... path... of the file, and .string() converts the path to string
-            std::string absolute_path = fs::absolute(file_path).string();
-
-            if (unique_files.find(absolute_path) != unique_files.end()) { //if the path of a file is found, is because the file is already here, so we go to the next iteraction. this way, there is no chance for the file to be count twice
-              continue;
-            }
-
-            if (file_path.length() >= 4) {
-              std::string last4(file_path.end() - 4, file_path.end());
-              std::string last2(file_path.end() - 2, file_path.end());
-
-              if (last4 == ".cpp" || last4 == ".hpp" || last2 == ".c" || last2 == ".h") {
-                run_options.input_list.push_back(file_path);
-                unique_files.insert(absolute_path);
-              }
-            }
-          }
-        }
-    }
-  }
-}
 
-/**
- * @brief Compare two files for sorting.
- * 
- * @param firstFile First file to compare.
- * @param secondFile Second file to compare.
- * @param sort_field Field to compare by.
- * @param sort_ascending Sort direction.
- * 
- * @return true if firstFile should come before secondFile.
- */
-bool compare_files(const FileInfo& firstFile, const FileInfo& secondFile, std::optional<sorting_arg> sort_field, bool sort_ascending) {
-
-  switch (sort_field.value()) { //gets the value in sort_field, e.g., t, f, etc...
-    case f: //case sort by filename
-      // If ascending: compare if the first filename is less than the second (by ASCII, because filename is a std::string)
-      // If descending: compare if the first filename is greater than the second
-      return sort_ascending ? (firstFile.filename < secondFile.filename) : (firstFile.filename > secondFile.filename);
-    case t: //case sort by filetype
-      return sort_ascending ? (firstFile.type < secondFile.type) : (firstFile.type > secondFile.type);
-    case c: //case sort by number of comments
-      return sort_ascending ? (firstFile.n_comments < secondFile.n_comments) : (firstFile.n_comments > secondFile.n_comments);
-    case d: //case sort by documentation comments
-      return sort_ascending ? (firstFile.n_doc_comments < secondFile.n_doc_comments) : (firstFile.n_doc_comments > secondFile.n_doc_comments);
-    case b: //case sort by number of blank lines
-      return sort_ascending ? (firstFile.n_blank < secondFile.n_blank) : (firstFile.n_blank > secondFile.n_blank);
-    case s: //case sort by sloc
-      return sort_ascending ? (firstFile.n_loc < secondFile.n_loc) : (firstFile.n_loc > secondFile.n_loc);
-    case a: //case sort by number of total lines
-      return sort_ascending ? (firstFile.n_lines < secondFile.n_lines) : (firstFile.n_lines > secondFile.n_loc);
-    default:
-      return false;
+  if (run_options.top > 0 && !run_options.should_sort) { //--top alone keeps the biggest files
+    run_options.should_sort = true;
+    run_options.sort_descending = true;
+    run_options.sort_fields = { s };
   }
 }
 
 /**
- * @brief Convert language enum to string.
- * 
- * @param lang_type The language type to convert.
- * 
- * @return String representation of the language type.
+ * @brief Collect files from directories based on options.
  * 
- * @retval "C" for C language
- * @retval "C++" for C++ language
- * @retval "C/C++ header" for C/C++ header files
- * @retval "C++ header" for C++ header files
- * @retval "Undefined type" for unknown/unsupported types
+ * @param run_options Runtime options including directory list.
  * 
- * @see lang_type_e
+ * Populates input_list with files found in directories, respecting recursive flag.
+ * Skips unsupported file types and avoids duplicate files. Only lists the
+ * files: process_files() walks the directories itself while counting.
  */
-std::string language_to_string (lang_type_e lang_type) {
-  switch (lang_type) {
-    case C: return "C";
-    case CPP: return "C++";
-    case H: return "C/C++ header";
-    case HPP: return "C++ header";
-    default: return "Undefined type";
-  }
+void collect_files(RunningOpt& run_options) {
+  if (run_options.directory_list.empty()) return; //return gets out of the function
+
+  PathArena paths;
+  DirectoryWalker walker(nullptr, run_options.recursive, nullptr, paths);
+  walker.add_files(run_options.input_list);
+  for (const auto& directory : run_options.directory_list) walker.add_directory(directory);
+
+  run_options.input_list.clear();
+  for (const auto& file : walker.files()) run_options.input_list.emplace_back(file.filename);
 }
 
 /**
- * @brief Determine language by file extension.
- * 
- * @param filename The name/path of the file to analyze.
+ * @brief Records in the order they are reported.
  * 
- * @return The corresponding language type enum value.
- * @retval C for .c files
- * @retval CPP for .cpp files
- * @retval H for .h files
- * @retval HPP for .hpp files
- * @retval UNDEF for unsupported extensions
- * 
- * @note Only checks the file extension, not the actual content.
+ * @param db Vector of file information.
+ * @param run_options Runtime options including sort preferences.
  * 
- * @see lang_type_e
+ * @return Pointers into `db`, sorted as asked on the command line (the
+ *         records themselves are not copied). Files equal on every key
+ *         are listed by file name, as with `--top`.
  */
-lang_type_e return_language_by_extension (const std::string& filename) {
-  fs::path file(filename);
-
-  std::string extension = file.extension().string();
-
-  if (extension == ".cpp") return CPP;
-  if (extension == ".c") return C;
-  if (extension == ".hpp") return HPP;
-  if (extension == ".h") return H;
-
-  return UNDEF;
+std::vector<const FileInfo*> sorted_records(const std::vector<FileInfo>& db, const RunningOpt& run_options) {
+  std::vector<const FileInfo*> sorted_db;
+  sorted_db.reserve(db.size());
+  if (run_options.should_sort) {
+    for (std::uint32_t index : sort_order(db, run_options.sort_fields, run_options.sort_ascending)) sorted_db.push_back(&db[index]);
+  } else {
+    for (const auto& info : db) sorted_db.push_back(&info);
+  }
+  return sorted_db;
 }
 
 /**
@@ -653,19 +443,13 @@ void print_summary(const std::vector<FileInfo>& db, const RunningOpt& run_option
     return;
   }
 
-  std::vector<FileInfo> sorted_db { db }; //creates a copy of the vector, and this copy will be sorted
-
-  if (run_options.should_sort) {
-    std::sort(sorted_db.begin(), sorted_db.end(), [&run_options](const FileInfo& a, const FileInfo& b) {
-      return compare_files(a, b, run_options.sort_field, run_options.sort_ascending); //if compare_files return true, 'a' comes before 'b' after sorting
-    });
-  }
+  std::vector<const FileInfo*> sorted_db = sorted_records(db, run_options);
 
   //calculate column widths
   size_t max_filename_length {0};
 
-  for (const auto& info : sorted_db) {
-    max_filename_length = std::max(max_filename_length, info.filename.size()); //returns the greater of values
+  for (const FileInfo* info : sorted_db) {
+    max_filename_length = std::max(max_filename_length, info->filename.size()); //returns the greater of values
   }
 
   constexpr size_t MIN_FILENAME_WIDTH {20};
@@ -683,7 +467,8 @@ void print_summary(const std::vector<FileInfo>& db, const RunningOpt& run_option
   //print data
   count_t total_comments = 0, total_doc_comments = 0, total_blank = 0, total_code = 0, total_lines = 0;
 
-  for (const auto& info : sorted_db) {
+  for (const FileInfo* record : sorted_db) {
+    const FileInfo& info = *record;
     std::cout << std::left << std::setw(filename_width + 1) << info.filename << std::setw(14) << language_to_string(info.type) << std::setw(16) << value_with_percent(info.n_comments, info.n_lines) << std::setw(16) << value_with_percent(info.n_doc_comments, info.n_lines) << std::setw(14) << value_with_percent(info.n_blank, info.n_lines) << std::setw(14) << value_with_percent(info.n_loc, info.n_lines) << info.n_lines << "\n";
 
     //add totals
@@ -714,41 +499,212 @@ void print_summary(const std::vector<FileInfo>& db, const RunningOpt& run_option
  * 
  * Coordinates the entire counting process:
  * 1. Parses command line arguments
- * 2. Collects files to process
- * 3. Counts lines in each file
- * 4. Prints summary table
+ * 2. Walks the directories and counts lines in each file found (both in
+ *    parallel with `-j`), reusing the counts cached by previous runs for
+ *    unchanged files
+ * 3. Prints summary table, or the report in the `--format` asked for (or,
+ *    with `--stream`, writes each file's record as soon as it is counted,
+ *    then the totals)
+ * 4. With `--stats`, reports the time and resources each phase used
+ * 
+ * With `--diff`, steps 2 and 3 are replaced by the diff of the two
+ * snapshots and its table of changed lines (see TreeDiff). With
+ * `--daemon`, step 3 is replaced by following the changes and answering
+ * queries until stopped (see CountDaemon); `--query` only sends one.
+ * 
+ * Left out when building with SLOC_NO_MAIN, so that other programs (the
+ * benchmarks) can link against the rest of this file.
  * 
  * @return EXIT_SUCCESS if the program executes successfully.
  */
+#ifndef SLOC_NO_MAIN
 int main(int argc, char* argv[]) {
   RunningOpt run_options;
-  validate_arguments(argc, argv, run_options);
+  RunStats stats;
+  {
+    PhaseTimer timer(stats, "validate");
+    validate_arguments(argc, argv, run_options);
+  }
+
+  auto report_stats = [&run_options, &stats] {
+    if (!run_options.stats) return;
+    stats.tasks = total_counters();
+    stats.peak_rss_kb = peak_rss_kb();
+    if (run_options.stats_json) {
+      print_stats_json(std::cerr, stats);
+    } else {
+      print_stats(std::cerr, stats);
+    }
+  };
+
+  if (run_options.query) {
+    if (run_options.daemon || run_options.diff || !run_options.input_list.empty() || !run_options.directory_list.empty()) {
+      std::cerr << "Sorry, --query only sends its request.\n";
+      exit(1);
+    }
+    std::string error;
+    if (!query_daemon(run_options.socket_path, run_options.request, error)) {
+      if (!error.empty()) std::cerr << "Sorry, " << error << ".\n";
+      exit(1);
+    }
+    return EXIT_SUCCESS;
+  }
 
-  collect_files(run_options);
+  if (run_options.diff) {
+    if (!run_options.input_list.empty() || !run_options.directory_list.empty()) {
+      std::cerr << "Sorry, --diff only compares its own two arguments.\n";
+      exit(1);
+    }
+    if (run_options.git || run_options.stream_format || run_options.top > 0 || run_options.should_sort
+        || run_options.output_format != FORMAT_TABLE) {
+      std::cerr << "Sorry, --diff cannot be combined with --git, --stream, --top, --format or sorting.\n";
+      exit(1);
+    }
 
-  if (run_options.input_list.empty() && run_options.directory_list.empty()) {
+    std::optional<TreeDiff> diff;
+    {
+      PhaseTimer timer(stats, "diff listing");
+      diff.emplace(run_options.diff_old, run_options.diff_new);
+    }
+    if (!diff->ok()) {
+      std::cerr << "Sorry, " << diff->error() << ".\n";
+      exit(1);
+    }
+    std::vector<FileDelta> deltas;
+    {
+      PhaseTimer timer(stats, "diff");
+      std::optional<ThreadPool> pool;
+      if (run_options.jobs > 1) pool.emplace(run_options.jobs);
+      deltas = diff->compare(pool ? &*pool : nullptr);
+    }
+    {
+      PhaseTimer timer(stats, "print summary");
+      print_delta_summary(deltas, diff->unchanged());
+      std::cout.flush();
+    }
+    report_stats();
+    return EXIT_SUCCESS;
+  }
+
+  if (run_options.daemon) {
+    if (run_options.input_list.empty() && run_options.directory_list.empty()) {
+      std::cerr << "Sorry, --daemon needs files or directories to follow.\n";
+      exit(1);
+    }
+    if (run_options.git || run_options.stream_format || run_options.top > 0 || run_options.should_sort
+        || run_options.output_format != FORMAT_TABLE) {
+      std::cerr << "Sorry, --daemon cannot be combined with --git, --stream, --top, --format or sorting; each query asks for its own.\n";
+      exit(1);
+    }
+  }
+
+  if (run_options.input_list.empty() && run_options.directory_list.empty() && !run_options.git) {
     std::cerr << "Error: no input file or directory provided.\n";
     usage();
   }
 
-  std::vector<FileInfo> db;
+  if (run_options.stream_format && run_options.top > 0) {
+    std::cerr << "Sorry, --top cannot be combined with --stream.\n";
+    exit(1);
+  }
+
+  if (run_options.stream_format && run_options.should_sort) {
+    std::cerr << "Sorry, results cannot be sorted with --stream.\n";
+    exit(1);
+  }
+
+  if (run_options.stream_format && run_options.output_format != FORMAT_TABLE) {
+    std::cerr << "Sorry, --format cannot be combined with --stream.\n";
+    exit(1);
+  }
+
+  std::optional<ResultCache> cache;
+  std::string cache_file = ResultCache::default_file();
+  if (run_options.use_cache && !cache_file.empty()) {
+    PhaseTimer timer(stats, "cache load");
+    cache.emplace(cache_file, run_options.verify_cache);
+    if (!run_options.rebuild_cache) cache->load();
+  }
+
+  if (run_options.daemon) {
+    CountDaemon daemon(run_options.socket_path);
+    {
+      PhaseTimer timer(stats, "collect+count");
+      daemon.start(run_options, cache ? &*cache : nullptr, &stats);
+    }
+    if (!daemon.ok()) {
+      std::cerr << "Sorry, " << daemon.error() << ".\n";
+      exit(1);
+    }
+    if (cache && !cache->save()) {
+      std::cerr << "Warning: unable to write the cache file \"" << cache->path() << "\".\n";
+    }
+    report_stats();
+    std::cerr << "Following " << daemon.files() << " files, answering on \"" << run_options.socket_path << "\".\n";
+    daemon.serve();
+    if (cache && !cache->save()) {
+      std::cerr << "Warning: unable to write the cache file \"" << cache->path() << "\".\n";
+    }
+    return EXIT_SUCCESS;
+  }
+
+  std::optional<GitSnapshot> git;
+  if (run_options.git) {
+    PhaseTimer timer(stats, "git listing");
+    git.emplace(run_options);
+    if (!git->ok()) {
+      std::cerr << "Sorry, " << git->error() << ".\n";
+      exit(1);
+    }
+    for (const auto& file : git->untracked()) std::cerr << "Skipping \"" << file << "\": not tracked by git.\n";
+  }
+  const GitSnapshot* git_ptr = git ? &*git : nullptr;
 
-  for (const auto& file : run_options.input_list){
-    FileInfo current_file;
-    AttributeCount result = process_file(file);
+  PathArena paths; //owns the file names of db
+  std::vector<FileInfo> db;
+  std::optional<RecordStream> stream;
+  std::optional<TopRecords> top;
+  {
+    PhaseTimer timer(stats, "collect+count");
+    if (run_options.stream_format) {
+      stream.emplace(std::cout, *run_options.stream_format);
+      stream->begin();
+      stream_files(run_options, cache ? &*cache : nullptr, [&stream](const FileInfo& info) { stream->write(info); }, &stats, git_ptr);
+    } else if (run_options.top > 0) {
+      top.emplace(run_options.top, run_options.sort_fields, run_options.sort_ascending);
+      stream_files(run_options, cache ? &*cache : nullptr, [&top](const FileInfo& info) { top->offer(info); }, &stats, git_ptr);
+      db = top->take(paths);
+    } else {
+      db = process_files(run_options, paths, cache ? &*cache : nullptr, &stats, git_ptr);
+    }
+  }
 
-    current_file.filename = file;
-    current_file.type = return_language_by_extension(file);
-    current_file.n_lines = result.lines;
-    current_file.n_blank = result.blank;
-    current_file.n_comments = result.com;
-    current_file.n_doc_comments = result.dox;
-    current_file.n_loc = result.loc;
+  std::size_t n_files = stream ? stream->records() : top ? top->seen() : db.size();
+  if (n_files == 0 && !run_options.directory_list.empty()) {
+    std::cerr << "Sorry, unable to find any supported source file inside directory \"" << run_options.directory_list[0] << "\""
+              << " (" << stats.walk.entries << " entries read in " << stats.walk.directories << " directories).\n";
+  }
 
-    db.push_back(current_file);
+  if (cache) {
+    PhaseTimer timer(stats, "cache save");
+    if (!cache->save()) {
+      std::cerr << "Warning: unable to write the cache file \"" << cache->path() << "\".\n";
+    }
   }
 
-  print_summary(db, run_options);
+  {
+    PhaseTimer timer(stats, "print summary");
+    if (stream) {
+      stream->finish();
+    } else if (run_options.output_format == FORMAT_TABLE) {
+      print_summary(db, run_options);
+    } else {
+      write_report(std::cout, sorted_records(db, run_options), run_options.output_format);
+    }
+    std::cout.flush();
+  }
 
+  report_stats();
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
+#endif
@@ -1,11 +1,16 @@
 #ifndef SLOC_HPP
 #define SLOC_HPP
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <dirent.h>
+#include <functional>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 #include <utility>
 
 #include <vector>
@@ -14,8 +19,17 @@
 
 
 
-/// @brief Integer type for counting lines.
-using count_t = unsigned long;
+/// @brief Integer type for counting lines (64 bits wide on every platform).
+using count_t = std::uint64_t;
+
+/// @brief Size of a cache line, used to keep per-thread counters apart.
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+class ThreadPool;
+class ResultCache;
+class PathArena;
+class GitSnapshot;
+struct RunStats;
 
 //== Enumerations
 
@@ -28,9 +42,40 @@ enum lang_type_e : std::uint8_t {
     CPP,    //!< C++ language
     H,      //!< C/C++ header
     HPP,    //!< C++ header
+    PYTHON, //!< Python
+    RUST,   //!< Rust
+    GO,     //!< Go
+    JAVA,   //!< Java
+    SHELL,  //!< POSIX shell scripts
+    CMAKE,  //!< CMake scripts
     UNDEF,  //!< Undefined type.
 };
 
+/**
+ * @enum lang_confidence_e
+ * @brief How the language of a file was found, from the surest to the least sure.
+ */
+enum lang_confidence_e : std::uint8_t {
+  CONFIDENCE_CERTAIN = 0, //!< File name: extension or well-known name.
+  CONFIDENCE_HIGH,        //!< Declared by the file: shebang or editor modeline.
+  CONFIDENCE_MEDIUM,      //!< Guessed from its tokens, by a clear margin.
+  CONFIDENCE_LOW,         //!< Guessed from its tokens, by a narrow margin.
+};
+
+/**
+ * @enum line_class_e
+ * @brief What a single line counts as, as bit flags.
+ *
+ * Like the counts, the flags are not exclusive: a line with code and a
+ * trailing comment is both LINE_CODE and LINE_COMMENT.
+ */
+enum line_class_e : std::uint8_t {
+  LINE_BLANK = 1u << 0,   //!< Nothing but whitespace, outside comments.
+  LINE_CODE = 1u << 1,    //!< Has code.
+  LINE_COMMENT = 1u << 2, //!< Has a regular comment.
+  LINE_DOC = 1u << 3,     //!< Has a doc comment.
+};
+
 /**
  * @enum sorting_arg
  * @brief Enumeration of sorting criteria for results.
@@ -45,6 +90,26 @@ enum sorting_arg : std::uint8_t {
   a,         //all
 };
 
+/**
+ * @enum stream_format_e
+ * @brief Record formats of `--stream`.
+ */
+enum stream_format_e : std::uint8_t {
+  STREAM_TSV = 0, //tab-separated values
+  STREAM_NDJSON,  //one JSON object per line
+};
+
+/**
+ * @enum output_format_e
+ * @brief Report formats of `--format`.
+ */
+enum output_format_e : std::uint8_t {
+  FORMAT_TABLE = 0, //human readable table
+  FORMAT_JSON,      //one JSON document
+  FORMAT_CSV,       //comma-separated values
+  FORMAT_BIN,       //little-endian binary records
+};
+
 /**
  * @enum enum_arguments
  * @brief Enumeration of supported command line arguments
@@ -54,6 +119,19 @@ enum enum_arguments : std::uint8_t {
   SORTDES,              //sort descending
   SORTAS,               //sort ascending
   HELP,                 //help
+  JOBS,                 //number of worker threads
+  NOCACHE,              //do not use the result cache
+  REBUILDCACHE,         //ignore and rewrite the result cache
+  VERIFYCACHE,          //check content hashes of cached files
+  STATS,                //report timings and counters on stderr
+  STATSJSON,            //same, as JSON
+  STREAM,               //print one record per file as soon as it is counted
+  FORMAT,               //report format
+  TOP,                  //keep only the first K files of the sort
+  GIT,                  //count the tracked files only, from the index or a revision
+  DIFF,                 //count the lines changed between two snapshots
+  DAEMON,               //serve the counts on a socket and follow the changes
+  QUERY,                //send a request to a daemon
 };
   
 
@@ -62,11 +140,15 @@ enum enum_arguments : std::uint8_t {
 /**
  * @class FileInfo
  * @brief Stores statistics about a source code file
+ *
+ * A plain 64-byte record: the file name is a view of a path owned by
+ * someone else, usually the PathArena of the run (see path_arena.hpp).
  */
 class FileInfo {
 public:
-  std::string filename;   //!< the filename.
+  std::string_view filename; //!< the filename (not owned).
   lang_type_e type;       //!< the language type.
+  lang_confidence_e confidence; //!< how the language type was found.
   count_t n_blank;        //!< # of blank lines in the file.
   count_t n_comments;     //!< # of comment lines.
   count_t n_doc_comments; //!< # of doc comments
@@ -75,24 +157,26 @@ public:
 
   /**
    * @brief Construct a new FileInfo object.
-   * @param fn Filename (default empty)
+   * @param fn Filename (default empty), which must outlive the record
    * @param t  Language type (default UNDEF)
    * @param nb Blank lines count (default 0)
    * @param nc Comment lines count (default 0)
    * @param nl Lines of code count (default 0)
    * @param ni Total lines count (default 0)
    */
-  FileInfo(std::string fn = "",
+  FileInfo(std::string_view fn = {},
             lang_type_e t = UNDEF,
             count_t nb = 0,
             count_t nc = 0,
             count_t nl = 0,
             count_t ni = 0)
-      : filename{ std::move(fn) }, type{ t }, n_blank{ nb }, n_comments{ nc }, n_loc{ nl },
-        n_lines{ ni } {
+      : filename{ fn }, type{ t }, confidence{ CONFIDENCE_CERTAIN }, n_blank{ nb }, n_comments{ nc },
+        n_doc_comments{ 0 }, n_loc{ nl }, n_lines{ ni } {
   }
 };
 
+static_assert(std::is_trivially_copyable_v<FileInfo>, "FileInfo records are copied around as plain bytes");
+
 /**
  * @class CurrentCount
  * @brief State machine for parsing source code.
@@ -107,41 +191,89 @@ class CurrentCount {
       COMMENT,       //!< Inside regular comment
       POSSIBDOXY,    //!< Possible documentation comment start
       DOXY,          //!< Inside documentation comment
-      LITERAL        //!< Inside string literal
+      LITERAL,       //!< Inside string literal
+      RAW_LITERAL,   //!< Inside raw string literal (see raw_delimiter)
+      LINE_COMMENT,  //!< Inside `//` comment continued by a backslash-newline
+      LINE_DOXY      //!< Inside `///` or `//!` comment continued by a backslash-newline
     };
 
     std::uint8_t current_state {START}; //!< Current parsing state
+    std::string raw_delimiter;          //!< Delimiter of the raw string literal, in RAW_LITERAL state
 };
 
 
 //== Structs
 
+/**
+ * @brief Default number of worker threads.
+ * 
+ * @return The hardware concurrency, or 1 if it cannot be determined.
+ */
+inline std::size_t default_jobs() {
+  std::size_t n = std::thread::hardware_concurrency();
+  return n == 0 ? 1 : n;
+}
+
 /**
  * @struct AttributeCount
- * @brief Temporary storage for line counts during processing.
- */
-struct AttributeCount{
-  short lines{0}; //!< Total lines processed
-  short blank{0}; //!< Blank lines count
-  short loc{0};   //!< Lines of code count
-  short com{0};   //!< Regular comments count
-  short dox{0};   //!< Documentation comments count
+ * @brief Line counts of a file (or of part of it) during processing.
+ * 
+ * The counters are packed together and the struct takes a full cache line,
+ * so per-thread partial counts never share a line and can be merged with
+ * operator+= without false sharing.
+ */
+struct alignas(CACHE_LINE_SIZE) AttributeCount{
+  count_t lines{0}; //!< Total lines processed
+  count_t blank{0}; //!< Blank lines count
+  count_t loc{0};   //!< Lines of code count
+  count_t com{0};   //!< Regular comments count
+  count_t dox{0};   //!< Documentation comments count
+
+  /// @brief Add the counts of another part to this one.
+  AttributeCount& operator+=(const AttributeCount& other) {
+    lines += other.lines;
+    blank += other.blank;
+    loc += other.loc;
+    com += other.com;
+    dox += other.dox;
+    return *this;
+  }
 };
 
+static_assert(sizeof(AttributeCount) == CACHE_LINE_SIZE, "AttributeCount must fill exactly one cache line");
+
 /**
  * @struct RunningOpt
  * @brief Runtime options from command line.
  */
 struct RunningOpt {
   bool recursive { false };                    //!< Recursive directory search
-  std::optional<sorting_arg> sort_field;       //!< Field to sort by
+  std::vector<sorting_arg> sort_fields;        //!< Fields to sort by, most significant first
   bool should_sort { false };                  //!< Whether to sort results
   bool sort_ascending { false };               //!< Sort in ascending order
   bool sort_descending { false };              //!< Sort in descending order
   bool help { false };                         //!< Show help message
+  std::size_t jobs { default_jobs() };         //!< Worker threads used for counting
+  bool use_cache { true };                     //!< Reuse and update the result cache
+  bool rebuild_cache { false };                //!< Ignore the cached counts
+  bool verify_cache { false };                 //!< Check content hashes of cached files
+  bool stats { false };                        //!< Report timings and counters on stderr
+  bool stats_json { false };                   //!< Report them as JSON
+  std::optional<stream_format_e> stream_format; //!< Stream records in this format instead of printing a table
+  output_format_e output_format { FORMAT_TABLE }; //!< Format of the report
+  std::size_t top { 0 };                       //!< Keep only this many files of the sort (0 keeps them all)
+  bool git { false };                          //!< Count the files tracked by git only
+  std::string git_rev;                         //!< Revision to count with --git (empty: the index and work tree)
+  bool diff { false };                         //!< Count the lines changed between two snapshots
+  std::string diff_old;                        //!< Old snapshot of --diff: a directory, file or git revision
+  std::string diff_new;                        //!< New snapshot of --diff
+  bool daemon { false };                       //!< Serve the counts on a socket and follow the changes
+  bool query { false };                        //!< Send a request to a daemon
+  std::string socket_path;                     //!< Socket of --daemon or --query
+  std::string request;                         //!< Request of --query
+  bool map_files { true };                     //!< Map big files instead of reading them (not while they may be truncated)
   std::vector<std::string> input_list;         //!< list of input files
   std::vector<std::string> directory_list;     //!< list of input directories
-  std::unordered_set<std::string> added_files; //!< Files already processed
 };
 
 //== Unordered Maps
@@ -151,7 +283,20 @@ const std::unordered_map<std::string, enum_arguments> inputed_arguments_with_the
   {"-r", RECURSIVE},
   {"-s", SORTAS},
   {"-S", SORTDES},
-  {"-h", HELP}, {"--help", HELP}
+  {"-h", HELP}, {"--help", HELP},
+  {"-j", JOBS},
+  {"--no-cache", NOCACHE},
+  {"--rebuild-cache", REBUILDCACHE},
+  {"--cache-verify", VERIFYCACHE},
+  {"--stats", STATS},
+  {"--stats-json", STATSJSON},
+  {"--stream", STREAM},
+  {"--format", FORMAT},
+  {"--top", TOP},
+  {"--git", GIT},
+  {"--diff", DIFF},
+  {"--daemon", DAEMON},
+  {"--query", QUERY}
 };
 
 /// @brief Mapping sorting criteria to their enum values.
@@ -165,8 +310,49 @@ const std::unordered_map<std::string, sorting_arg> sorters_with_their_keys = {
   {"a", a},
 };
 
+/// @brief Mapping `--stream` formats to their enum values.
+const std::unordered_map<std::string, stream_format_e> stream_formats_with_their_keys = {
+  {"tsv", STREAM_TSV},
+  {"ndjson", STREAM_NDJSON},
+};
+
+/// @brief Mapping `--format` names to their enum values.
+const std::unordered_map<std::string, output_format_e> output_formats_with_their_keys = {
+  {"table", FORMAT_TABLE},
+  {"json", FORMAT_JSON},
+  {"csv", FORMAT_CSV},
+  {"bin", FORMAT_BIN},
+};
+
 //== Functions
 
+/**
+ * @brief Count the lines of a big buffer by chunks, in parallel.
+ * 
+ * Detailed documentation for this function is provided in the implementation file.
+ * 
+ * @see count_buffer_parallel()
+ */
+AttributeCount count_buffer_parallel(std::string_view buffer, ThreadPool& pool, AttributeCount& atr);
+
+/**
+ * @brief Count the lines of a file content already in memory.
+ * 
+ * Detailed documentation for this function is provided in the implementation file.
+ * 
+ * @see process_buffer()
+ */
+AttributeCount process_buffer(std::string_view content, ThreadPool* pool = nullptr);
+
+/**
+ * @brief Copy line counts into a FileInfo record.
+ * 
+ * Detailed documentation for this function is provided in the implementation file.
+ * 
+ * @see set_counts()
+ */
+void set_counts(FileInfo& info, const AttributeCount& counts);
+
 /**
  * @brief Process a file and count its lines.
  * 
@@ -174,7 +360,43 @@ const std::unordered_map<std::string, sorting_arg> sorters_with_their_keys = {
  * 
  * @see process_file()
  */
-AttributeCount process_file(const std::string& filename);
+AttributeCount process_file(const std::string& filename, ThreadPool* pool = nullptr);
+
+/**
+ * @brief Find and count every input file, possibly in parallel.
+ * 
+ * Detailed documentation for this function is provided in the implementation file.
+ * 
+ * @see process_files()
+ */
+std::vector<FileInfo> process_files(const RunningOpt& run_options, PathArena& paths, ResultCache* cache = nullptr, RunStats* stats = nullptr, const GitSnapshot* git = nullptr);
+
+/**
+ * @brief Find and count every input file, handing each result over as it comes.
+ * 
+ * Detailed documentation for this function is provided in the implementation file.
+ * 
+ * @see stream_files()
+ */
+void stream_files(const RunningOpt& run_options, ResultCache* cache, const std::function<void(const FileInfo&)>& sink, RunStats* stats = nullptr, const GitSnapshot* git = nullptr);
+
+/**
+ * @brief Build the FileInfo record of a single file.
+ * 
+ * Detailed documentation for this function is provided in the implementation file.
+ * 
+ * @see make_file_info()
+ */
+FileInfo make_file_info(std::string_view filename, ThreadPool* pool = nullptr, ResultCache* cache = nullptr, bool map_files = true);
+
+/**
+ * @brief Build the FileInfo record of a file whose content is already in memory.
+ * 
+ * Detailed documentation for this function is provided in the implementation file.
+ * 
+ * @see make_blob_info()
+ */
+FileInfo make_blob_info(std::string_view filename, std::string_view content, ThreadPool* pool = nullptr);
 
 /**
  * @brief Process a file through the state machine.
@@ -187,67 +409,76 @@ AttributeCount statesMachine(const std::string& filename, CurrentCount ts, Attri
 
 
 /**
- * @brief Update the counting state based on line content.
+ * @brief Count the lines of a buffer through the state machine.
  * 
  * Detailed documentation for this function is provided in the implementation file.
  * 
- * @see updateState()
+ * @see count_buffer()
  */
-AttributeCount updateState(std::string line, CurrentCount &ts);
+AttributeCount count_buffer(std::string_view buffer, CurrentCount& ts, AttributeCount& atr);
 
 /**
- * @brief Verify if index i in list line has a next value.
+ * @brief Count the lines of a buffer one line at a time with updateState().
  * 
  * Detailed documentation for this function is provided in the implementation file.
  * 
- * @see exist_next()
+ * @see count_buffer_by_lines()
  */
-bool exist_next(std::string line, size_t idx);
+AttributeCount count_buffer_by_lines(std::string_view buffer, CurrentCount& ts, AttributeCount& atr);
 
 /**
- * @brief Verify if index i in list line has a prev value.
+ * @brief Update the counting state based on line content.
  * 
  * Detailed documentation for this function is provided in the implementation file.
  * 
- * @see exist_prev()
+ * @see updateState()
  */
- bool exist_prev(std::string line, size_t idx);
+AttributeCount updateState(std::string_view line, CurrentCount &ts);
 
 /**
- * @brief Compare two files for sorting.
+ * @brief Check if a line ends with a backslash that continues it on the next line.
  * 
  * Detailed documentation for this function is provided in the implementation file.
  * 
- * @see compare_files()
+ * @see continues_line()
  */
-bool compare_files(const FileInfo& firstFile, const FileInfo& secondFile, std::optional<sorting_arg> sort_field, bool sort_ascending);
+bool continues_line(std::string_view line, size_t from);
 
 /**
- * @brief Check if a quote starts a string literal.
+ * @brief Find where a character literal ends.
  * 
  * Detailed documentation for this function is provided in the implementation file.
  * 
- * @see startLiteral()
+ * @see char_literal_end()
  */
-bool startLiteral(std::string line, char i);
+size_t char_literal_end(std::string_view line, size_t i);
 
 /**
- * @brief Check if a quote ends a string literal.
+ * @brief Find where a raw string literal ends.
  * 
  * Detailed documentation for this function is provided in the implementation file.
  * 
- * @see endLiteral()
+ * @see raw_literal_end()
  */
- bool endLiteral(std::string line, char i);
+size_t raw_literal_end(std::string_view line, size_t from, std::string_view delimiter);
 
 /**
- * @brief Count total lines in a file.
+ * @brief Compare two files for sorting.
  * 
  * Detailed documentation for this function is provided in the implementation file.
  * 
- * @see countTotalLines()
+ * @see compare_files()
+ */
+bool compare_files(const FileInfo& firstFile, const FileInfo& secondFile, std::optional<sorting_arg> sort_field, bool sort_ascending);
+
+/**
+ * @brief Compare two files by a list of fields.
+ * 
+ * Detailed documentation for this function is provided in the implementation file.
+ * 
+ * @see compare_files()
  */
-count_t countTotalLines (const std::string& filename);
+bool compare_files(const FileInfo& firstFile, const FileInfo& secondFile, const std::vector<sorting_arg>& sort_fields, bool sort_ascending);
 
 /**
  * @brief Determine language by file extension.
@@ -267,6 +498,15 @@ lang_type_e return_language_by_extension (const std::string& filename);
  */
 std::string language_to_string (lang_type_e lang_type);
 
+/**
+ * @brief Name of a language, without building a string.
+ * 
+ * Detailed documentation for this function is provided in the implementation file.
+ * 
+ * @see language_name()
+ */
+std::string_view language_name (lang_type_e lang_type);
+
 /**
  * @brief Calculate percentage string.
  * 
@@ -292,7 +532,7 @@ std::string value_with_percent(count_t value, count_t total);
  * 
  * @see ltrim()
  */
-inline std::string ltrim(const std::string& s, const char* t = " \t\n\r\f\v");
+inline std::string_view ltrim(std::string_view s, const char* t = " \t\n\r\f\v");
 
 /**
  * @brief Trim whitespace from right of string.
@@ -301,7 +541,7 @@ inline std::string ltrim(const std::string& s, const char* t = " \t\n\r\f\v");
  * 
  * @see rtrim()
  */
-inline std::string rtrim(const std::string& s, const char* t = " \t\n\r\f\v");
+inline std::string_view rtrim(std::string_view s, const char* t = " \t\n\r\f\v");
 
 /**
  * @brief Trim whitespace from both ends of string.
@@ -310,7 +550,7 @@ inline std::string rtrim(const std::string& s, const char* t = " \t\n\r\f\v");
  * 
  * @see trim()
  */
-inline std::string trim(const std::string& s, const char* t = " \t\n\r\f\v");
+inline std::string_view trim(std::string_view s, const char* t = " \t\n\r\f\v");
 
 /**
  * @brief Collect files from directories based on options.
@@ -321,6 +561,15 @@ inline std::string trim(const std::string& s, const char* t = " \t\n\r\f\v");
  */
 void collect_files(RunningOpt& run_options);
 
+/**
+ * @brief Records in the order they are reported.
+ * 
+ * Detailed documentation for this function is provided in the implementation file.
+ * 
+ * @see sorted_records()
+ */
+std::vector<const FileInfo*> sorted_records(const std::vector<FileInfo>& db, const RunningOpt& run_options);
+
 /**
  * @brief Print summary table of line counts.
  * 
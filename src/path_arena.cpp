@@ -0,0 +1,120 @@
+/*!
+ * @file path_arena.cpp
+ * @description
+ * Implementation of the path arena and of its interning table.
+ */
+
+#include "path_arena.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+/**
+ * @brief Store a path, unless an equal one is stored already.
+ *
+ * @param path The path; it need not outlive the call.
+ *
+ * The table is kept at most half full, so a lookup probes about two
+ * buckets, and the stored hashes settle most of them without comparing
+ * bytes.
+ *
+ * @return The id and the stored copy of the path, and whether it was new.
+ */
+InternedPath PathArena::intern(std::string_view path) {
+  auto hash = static_cast<std::uint32_t>(std::hash<std::string_view>{}(path));
+  std::lock_guard<std::mutex> lock(m_mtx);
+  if ((m_paths.size() + 1) * 2 > m_table.size()) grow_table();
+
+  std::size_t mask = m_table.size() - 1;
+  for (std::size_t bucket = hash & mask;; bucket = (bucket + 1) & mask) {
+    path_id slot = m_table[bucket];
+    if (slot == 0) {
+      auto id = static_cast<path_id>(m_paths.size());
+      std::string_view stored = store(path);
+      m_paths.push_back(stored);
+      m_hashes.push_back(hash);
+      m_table[bucket] = id + 1;
+      return { id, stored, true };
+    }
+    if (m_hashes[slot - 1] == hash && m_paths[slot - 1] == path) return { slot - 1, m_paths[slot - 1], false };
+  }
+}
+
+/**
+ * @brief The path stored under an id.
+ *
+ * @param id An id returned by intern().
+ *
+ * @return The stored copy, NUL-terminated.
+ */
+std::string_view PathArena::path(path_id id) const {
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_paths[id];
+}
+
+/**
+ * @brief Number of distinct paths stored.
+ *
+ * @return The number of ids handed out.
+ */
+std::size_t PathArena::size() const {
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_paths.size();
+}
+
+/**
+ * @brief Bytes held by the arena.
+ *
+ * @return The size of the blocks plus the capacity of the index vectors
+ * and of the interning table.
+ */
+std::size_t PathArena::bytes() const {
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_block_bytes + m_paths.capacity() * sizeof(std::string_view) + m_hashes.capacity() * sizeof(std::uint32_t)
+         + m_table.capacity() * sizeof(path_id);
+}
+
+/**
+ * @brief Copy a path into the blocks.
+ *
+ * @param path The path.
+ *
+ * A path that does not fit in what is left of the last block starts a
+ * new one; a path longer than a block gets a block of its own, so the
+ * bytes of a path are always contiguous.
+ *
+ * @return The stored copy, followed by a NUL.
+ */
+std::string_view PathArena::store(std::string_view path) {
+  std::size_t needed = path.size() + 1;
+  if (needed > m_free) {
+    std::size_t size = std::max(needed, BLOCK_SIZE);
+    m_blocks.push_back(std::make_unique<char[]>(size));
+    m_cursor = m_blocks.back().get();
+    m_free = size;
+    m_block_bytes += size;
+  }
+  char* copy = m_cursor;
+  std::memcpy(copy, path.data(), path.size());
+  copy[path.size()] = '\0';
+  m_cursor += needed;
+  m_free -= needed;
+  return { copy, path.size() };
+}
+
+/**
+ * @brief Double the interning table and place every id again.
+ *
+ * Uses the stored hashes; no path is read.
+ */
+void PathArena::grow_table() {
+  std::vector<path_id> table(m_table.empty() ? 1024 : m_table.size() * 2, 0);
+  std::size_t mask = table.size() - 1;
+  for (std::size_t id{ 0 }; id < m_paths.size(); ++id) {
+    std::size_t bucket = m_hashes[id] & mask;
+    while (table[bucket] != 0) bucket = (bucket + 1) & mask;
+    table[bucket] = static_cast<path_id>(id + 1);
+  }
+  m_table = std::move(table);
+}
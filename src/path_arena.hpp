@@ -0,0 +1,107 @@
+#ifndef PATH_ARENA_HPP
+#define PATH_ARENA_HPP
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+/*!
+ * @file path_arena.hpp
+ * @description
+ * Storage for the paths of a run: each distinct path is copied once into
+ * large blocks, and records refer to it by id or by a view instead of
+ * owning a string each.
+ */
+
+/// @brief Id of an interned path, dense from 0 in interning order.
+using path_id = std::uint32_t;
+
+//== Structs
+
+/**
+ * @struct InternedPath
+ * @brief Result of interning a path.
+ */
+struct InternedPath {
+  path_id id{ 0 };        //!< Id of the path.
+  std::string_view path;  //!< The stored copy, valid as long as the arena.
+  bool inserted{ false }; //!< Whether this call stored it.
+};
+
+//== Classes
+
+/**
+ * @class PathArena
+ * @brief Append-only, de-duplicated path storage.
+ *
+ * Paths are packed into 64 KiB blocks that never move, each one followed
+ * by a NUL so that the stored copy (or any suffix of it) can be handed to
+ * system calls. The interning table is open addressing over the ids, with
+ * the hash of each path kept beside it so that growing the table never
+ * hashes a path again.
+ *
+ * All members may be called from any thread.
+ */
+class PathArena {
+public:
+  PathArena() = default;
+
+  PathArena(const PathArena&) = delete;
+  PathArena& operator=(const PathArena&) = delete;
+
+  /**
+   * @brief Store a path, unless an equal one is stored already.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  InternedPath intern(std::string_view path);
+
+  /**
+   * @brief The path stored under an id.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  std::string_view path(path_id id) const;
+
+  /**
+   * @brief Number of distinct paths stored.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  std::size_t size() const;
+
+  /**
+   * @brief Bytes held by the arena.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  std::size_t bytes() const;
+
+private:
+  /**
+   * @brief Copy a path into the blocks.
+   * @param path The path.
+   * @return The stored copy.
+   */
+  std::string_view store(std::string_view path);
+
+  /**
+   * @brief Double the interning table and place every id again.
+   */
+  void grow_table();
+
+  static constexpr std::size_t BLOCK_SIZE{ 64 * 1024 }; //!< Size of a block (longer paths get their own).
+
+  mutable std::mutex m_mtx;                      //!< Guards everything below.
+  std::vector<std::unique_ptr<char[]>> m_blocks; //!< Path bytes; never move once written.
+  char* m_cursor{ nullptr };                     //!< Next free byte of the last block.
+  std::size_t m_free{ 0 };                       //!< Bytes left in the last block.
+  std::size_t m_block_bytes{ 0 };                //!< Bytes of all the blocks.
+  std::vector<std::string_view> m_paths;         //!< Stored paths, by id.
+  std::vector<std::uint32_t> m_hashes;           //!< Hash of each path, by id.
+  std::vector<path_id> m_table;                  //!< Id + 1 of the path in each bucket, 0 if empty.
+};
+
+#endif
@@ -0,0 +1,146 @@
+/*!
+ * @file record_sort.cpp
+ * @description
+ * Implementation of the multi-key record sort.
+ *
+ * Every key is turned into an unsigned 64-bit integer once per record:
+ * counts and the language are used as they are, file names are replaced
+ * by their rank in a sorted table of the names, and descending keys are
+ * complemented. The records are then ordered by a least significant digit
+ * radix sort, one stable pass per key from the last key to the first, so
+ * the result is ordered by the first key, then the second, and so on. Runs
+ * of full ties are then put in file name order, the order `--top` breaks
+ * ties in (see TopRecords::before()), so that it prints the first rows of
+ * the same table.
+ */
+
+#include "record_sort.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+
+namespace {
+
+/**
+ * @struct KeyedIndex
+ * @brief A record index next to its key, so a radix pass reads one array.
+ */
+struct KeyedIndex {
+  std::uint64_t key;   //!< Sort key.
+  std::uint32_t index; //!< Position of the record in the input.
+};
+
+/**
+ * @brief Rank of each record's file name among all the names.
+ *
+ * Equal names get equal ranks, so the rank orders records exactly like
+ * comparing the strings.
+ */
+std::vector<std::uint64_t> filename_ranks(const std::vector<FileInfo>& db) {
+  std::vector<std::uint32_t> by_name(db.size());
+  std::iota(by_name.begin(), by_name.end(), 0);
+  std::sort(by_name.begin(), by_name.end(), [&db](std::uint32_t a, std::uint32_t b) {
+    return db[a].filename < db[b].filename;
+  });
+
+  std::vector<std::uint64_t> ranks(db.size());
+  std::uint64_t rank{ 0 };
+  for (std::size_t i{ 0 }; i < by_name.size(); ++i) {
+    if (i > 0 && db[by_name[i]].filename != db[by_name[i - 1]].filename) ++rank;
+    ranks[by_name[i]] = rank;
+  }
+  return ranks;
+}
+
+/**
+ * @brief Integer key of a record for a numeric field (or the language).
+ */
+std::uint64_t field_key(const FileInfo& info, sorting_arg field) {
+  switch (field) {
+    case t: return info.type;
+    case c: return info.n_comments;
+    case d: return info.n_doc_comments;
+    case b: return info.n_blank;
+    case s: return info.n_loc;
+    case a: return info.n_lines;
+    default: return 0;
+  }
+}
+
+/**
+ * @brief Stable radix sort of keyed indices, one byte per pass.
+ *
+ * Bytes that are the same in every key are skipped, so small counts only
+ * take one or two passes.
+ */
+void radix_sort(std::vector<KeyedIndex>& items, std::vector<KeyedIndex>& scratch) {
+  if (items.empty()) return;
+  std::uint64_t varying{ 0 };
+  for (const auto& item : items) varying |= item.key ^ items.front().key;
+
+  for (unsigned shift{ 0 }; shift < 64; shift += 8) {
+    if (((varying >> shift) & 0xff) == 0) continue;
+
+    std::size_t offsets[256]{};
+    for (const auto& item : items) ++offsets[(item.key >> shift) & 0xff];
+    std::size_t position{ 0 };
+    for (auto& offset : offsets) {
+      std::size_t count = offset;
+      offset = position;
+      position += count;
+    }
+    for (const auto& item : items) scratch[offsets[(item.key >> shift) & 0xff]++] = item;
+    items.swap(scratch);
+  }
+}
+
+}  // namespace
+
+/**
+ * @brief Stable order of the records by a list of keys.
+ *
+ * @param db The records.
+ * @param keys Fields to sort by, most significant first.
+ * @param sort_ascending Direction, the same for every key.
+ *
+ * @return Indices into `db`, in sorted order. Records equal on every key
+ *         come in ascending file name order (then in their relative order,
+ *         for equal names).
+ */
+std::vector<std::uint32_t> sort_order(const std::vector<FileInfo>& db, const std::vector<sorting_arg>& keys, bool sort_ascending) {
+  std::vector<std::uint32_t> order(db.size());
+  std::iota(order.begin(), order.end(), 0);
+  if (db.size() < 2 || keys.empty()) return order;
+
+  std::vector<std::uint64_t> ranks;
+  if (std::find(keys.begin(), keys.end(), f) != keys.end()) ranks = filename_ranks(db);
+
+  std::vector<KeyedIndex> items(db.size()), scratch(db.size());
+  for (auto key = keys.rbegin(); key != keys.rend(); ++key) {
+    for (std::size_t i{ 0 }; i < order.size(); ++i) {
+      std::uint32_t index = order[i];
+      std::uint64_t value = *key == f ? ranks[index] : field_key(db[index], *key);
+      items[i] = { sort_ascending ? value : ~value, index };
+    }
+    radix_sort(items, scratch);
+    for (std::size_t i{ 0 }; i < order.size(); ++i) order[i] = items[i].index;
+  }
+
+  if (ranks.empty()) { //with `f` among the keys, full ties already share their name
+    auto same_keys = [&db, &keys](std::uint32_t x, std::uint32_t y) {
+      for (sorting_arg key : keys) {
+        if (field_key(db[x], key) != field_key(db[y], key)) return false;
+      }
+      return true;
+    };
+    auto by_name = [&db](std::uint32_t x, std::uint32_t y) { return db[x].filename < db[y].filename; };
+    for (std::size_t begin{ 0 }; begin < order.size();) {
+      std::size_t end{ begin + 1 };
+      while (end < order.size() && same_keys(order[begin], order[end])) ++end;
+      if (end - begin > 1) std::stable_sort(order.begin() + begin, order.begin() + end, by_name);
+      begin = end;
+    }
+  }
+  return order;
+}
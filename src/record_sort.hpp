@@ -0,0 +1,26 @@
+#ifndef RECORD_SORT_HPP
+#define RECORD_SORT_HPP
+#include <cstdint>
+#include <vector>
+
+#include "main.hpp"
+
+/*!
+ * @file record_sort.hpp
+ * @description
+ * Multi-key sort of the records for `-s`/`-S`, done once over precomputed
+ * integer keys instead of through a comparison function.
+ */
+
+//== Functions
+
+/**
+ * @brief Stable order of the records by a list of keys.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see sort_order()
+ */
+std::vector<std::uint32_t> sort_order(const std::vector<FileInfo>& db, const std::vector<sorting_arg>& keys, bool sort_ascending);
+
+#endif
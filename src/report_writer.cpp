@@ -0,0 +1,220 @@
+/*!
+ * @file report_writer.cpp
+ * @description
+ * Implementation of the `--format json|csv|bin` reports.
+ *
+ * Every field is formatted with std::to_chars or copied as is into one
+ * output buffer, allocated once and handed to the stream whenever it
+ * fills up: no iostream manipulators, no locale, no string per cell.
+ *
+ * - json: `{"files": [{"file": ..., "language": ..., "confidence": ...,
+ *   "comments": ..., "doc_comments": ..., "blank": ..., "code": ...,
+ *   "lines": ...}, ...],
+ *   "total": {"files": N, "comments": ..., ...}}`, one file per line.
+ * - csv: a `filename,language,comments,doc_comments,blank,code,lines`
+ *   header, then one row per file (RFC 4180 quoting, no totals row).
+ * - bin: little-endian. Header: the 4 bytes "SLOC", a u32 version and a
+ *   u64 record count. Each record: a u32 name length, the name bytes, a u8
+ *   language (lang_type_e) and five u64 counts (comments, doc comments,
+ *   blank, code, lines).
+ */
+
+#include "report_writer.hpp"
+
+#include <charconv>
+
+#include "language_sniffer.hpp"
+
+namespace {
+
+/**
+ * @brief Append a little-endian unsigned integer of `bytes` bytes.
+ */
+void append_le(std::string& out, std::uint64_t value, int bytes) {
+  for (int i{ 0 }; i < bytes; ++i) {
+    out += static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+}
+
+/**
+ * @brief Hand the buffer to the stream once it is nearly full.
+ *
+ * The margin leaves room for one more record with a reasonably sized name,
+ * so the buffer does not have to grow in the common case.
+ */
+void drain(std::ostream& out, std::string& buffer, bool force = false) {
+  if (force || buffer.size() + 4096 >= REPORT_BUFFER_BYTES) {
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+  }
+}
+
+/**
+ * @brief Append `, "key": value` to a JSON object.
+ */
+void append_json_field(std::string& out, std::string_view key, std::uint64_t value) {
+  out += ", \"";
+  out += key;
+  out += "\": ";
+  append_uint(out, value);
+}
+
+/**
+ * @brief Append the five counts of a record as JSON fields.
+ */
+void append_json_counts(std::string& out, const FileInfo& info) {
+  append_json_field(out, "comments", info.n_comments);
+  append_json_field(out, "doc_comments", info.n_doc_comments);
+  append_json_field(out, "blank", info.n_blank);
+  append_json_field(out, "code", info.n_loc);
+  append_json_field(out, "lines", info.n_lines);
+}
+
+/**
+ * @brief Write the records as one JSON document.
+ */
+void write_json(std::ostream& out, std::string& buffer, const std::vector<const FileInfo*>& records) {
+  FileInfo totals;
+  buffer += "{\"files\": [";
+  for (std::size_t i{ 0 }; i < records.size(); ++i) {
+    const FileInfo& info = *records[i];
+    buffer += i > 0 ? ",\n" : "\n";
+    buffer += "{\"file\": ";
+    append_json_string(buffer, info.filename);
+    buffer += ", \"language\": ";
+    append_json_string(buffer, language_name(info.type));
+    buffer += ", \"confidence\": ";
+    append_json_string(buffer, confidence_name(info.confidence));
+    append_json_counts(buffer, info);
+    buffer += '}';
+
+    totals.n_comments += info.n_comments;
+    totals.n_doc_comments += info.n_doc_comments;
+    totals.n_blank += info.n_blank;
+    totals.n_loc += info.n_loc;
+    totals.n_lines += info.n_lines;
+    drain(out, buffer);
+  }
+  buffer += "\n], \"total\": {\"files\": ";
+  append_uint(buffer, records.size());
+  append_json_counts(buffer, totals);
+  buffer += "}}\n";
+}
+
+/**
+ * @brief Write the records as CSV.
+ */
+void write_csv(std::ostream& out, std::string& buffer, const std::vector<const FileInfo*>& records) {
+  buffer += "filename,language,comments,doc_comments,blank,code,lines\n";
+  for (const FileInfo* record : records) {
+    const FileInfo& info = *record;
+    append_csv_field(buffer, info.filename);
+    buffer += ',';
+    append_csv_field(buffer, language_name(info.type));
+    for (count_t value : { info.n_comments, info.n_doc_comments, info.n_blank, info.n_loc, info.n_lines }) {
+      buffer += ',';
+      append_uint(buffer, value);
+    }
+    buffer += '\n';
+    drain(out, buffer);
+  }
+}
+
+/**
+ * @brief Write the records in the binary layout.
+ */
+void write_bin(std::ostream& out, std::string& buffer, const std::vector<const FileInfo*>& records) {
+  buffer.append(REPORT_BIN_MAGIC, sizeof(REPORT_BIN_MAGIC));
+  append_le(buffer, REPORT_BIN_VERSION, 4);
+  append_le(buffer, records.size(), 8);
+  for (const FileInfo* record : records) {
+    const FileInfo& info = *record;
+    append_le(buffer, info.filename.size(), 4);
+    buffer += info.filename;
+    append_le(buffer, info.type, 1);
+    for (count_t value : { info.n_comments, info.n_doc_comments, info.n_blank, info.n_loc, info.n_lines }) {
+      append_le(buffer, value, 8);
+    }
+    drain(out, buffer);
+  }
+}
+
+}  // namespace
+
+/**
+ * @brief Append an unsigned integer in decimal.
+ *
+ * @param out Destination.
+ * @param value The number.
+ */
+void append_uint(std::string& out, std::uint64_t value) {
+  char digits[20];
+  auto result = std::to_chars(digits, digits + sizeof(digits), value);
+  out.append(digits, result.ptr);
+}
+
+/**
+ * @brief Append a string as a quoted JSON string.
+ *
+ * @param out Destination.
+ * @param text The string (bytes above 0x7f are copied as is).
+ */
+void append_json_string(std::string& out, std::string_view text) {
+  static constexpr char HEX[] = "0123456789abcdef";
+  out += '"';
+  for (char ch : text) {
+    if (ch == '"' || ch == '\\') {
+      out += '\\';
+      out += ch;
+    } else if (static_cast<unsigned char>(ch) < 0x20) {
+      out += "\\u00";
+      out += HEX[static_cast<unsigned char>(ch) >> 4];
+      out += HEX[static_cast<unsigned char>(ch) & 0xf];
+    } else {
+      out += ch;
+    }
+  }
+  out += '"';
+}
+
+/**
+ * @brief Append a CSV field, quoted when it has to be.
+ *
+ * @param out Destination.
+ * @param text The field.
+ *
+ * Fields with a comma, a quote or a line break are put between quotes,
+ * with their quotes doubled (RFC 4180).
+ */
+void append_csv_field(std::string& out, std::string_view text) {
+  if (text.find_first_of(",\"\r\n") == std::string_view::npos) {
+    out += text;
+    return;
+  }
+  out += '"';
+  for (char ch : text) {
+    if (ch == '"') out += '"';
+    out += ch;
+  }
+  out += '"';
+}
+
+/**
+ * @brief Write the records of a run in a machine-readable format.
+ *
+ * @param out Destination stream (opened in binary mode for FORMAT_BIN).
+ * @param records The records, in the order they are reported.
+ * @param format FORMAT_JSON, FORMAT_CSV or FORMAT_BIN; the table is
+ *               printed by print_summary() instead.
+ */
+void write_report(std::ostream& out, const std::vector<const FileInfo*>& records, output_format_e format) {
+  std::string buffer;
+  buffer.reserve(REPORT_BUFFER_BYTES);
+  switch (format) {
+    case FORMAT_JSON: write_json(out, buffer, records); break;
+    case FORMAT_CSV: write_csv(out, buffer, records); break;
+    case FORMAT_BIN: write_bin(out, buffer, records); break;
+    case FORMAT_TABLE: break;
+  }
+  drain(out, buffer, true);
+}
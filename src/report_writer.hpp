@@ -0,0 +1,67 @@
+#ifndef REPORT_WRITER_HPP
+#define REPORT_WRITER_HPP
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "main.hpp"
+
+/*!
+ * @file report_writer.hpp
+ * @description
+ * Machine-readable reports of `--format json|csv|bin`, and the helpers that
+ * format their fields without iostreams.
+ */
+
+//== Constants
+
+/// @brief Report bytes gathered before each write to the output stream.
+constexpr std::size_t REPORT_BUFFER_BYTES{ 1024 * 1024 };
+
+/// @brief First bytes of a `--format bin` report.
+constexpr char REPORT_BIN_MAGIC[4]{ 'S', 'L', 'O', 'C' };
+
+/// @brief Layout version of a `--format bin` report.
+constexpr std::uint32_t REPORT_BIN_VERSION{ 1 };
+
+//== Functions
+
+/**
+ * @brief Append an unsigned integer in decimal.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see append_uint()
+ */
+void append_uint(std::string& out, std::uint64_t value);
+
+/**
+ * @brief Append a string as a quoted JSON string.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see append_json_string()
+ */
+void append_json_string(std::string& out, std::string_view text);
+
+/**
+ * @brief Append a CSV field, quoted when it has to be.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see append_csv_field()
+ */
+void append_csv_field(std::string& out, std::string_view text);
+
+/**
+ * @brief Write the records of a run in a machine-readable format.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see write_report()
+ */
+void write_report(std::ostream& out, const std::vector<const FileInfo*>& records, output_format_e format);
+
+#endif
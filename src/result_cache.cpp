@@ -0,0 +1,380 @@
+/*!
+ * @file result_cache.cpp
+ * @description
+ * Implementation of the persistent result cache and of its binary format.
+ *
+ * The cache file starts with an 8-byte magic string (which also encodes the
+ * format version), the CLASSIFIER_VERSION the counts were made with and
+ * the number of entries, followed by the entries:
+ *
+ *     u32 path length, path bytes,
+ *     i64 mtime (ns), u64 size, u64 content hash, u8 language, u8 confidence,
+ *     u64 blank, comments, doc comments, loc, lines
+ *
+ * Integers are stored in the byte order of the machine; a cache file is
+ * not meant to be shared between machines.
+ *
+ * Files that turned out not to be source code are kept too, with the
+ * UNDEF language, so the next run skips them without reading them. Files
+ * that no longer exist are dropped over the next saves: each save checks a
+ * slice of the entries (see prune_slice()).
+ */
+
+#include "result_cache.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "file_reader.hpp"
+#include "language_registry.hpp"
+
+namespace {
+
+/// @brief Magic string at the start of a cache file (last char is the version).
+constexpr char MAGIC[8] = { 'S', 'L', 'O', 'C', 'C', 'C', 'H', '3' };
+
+/// @brief Entries whose file is checked for existence at each save, at most.
+constexpr std::size_t PRUNE_SLICE{ 1024 };
+
+/**
+ * @class ByteWriter
+ * @brief Appends fixed-size values to a byte string.
+ */
+class ByteWriter {
+public:
+  template <typename T>
+  void put(const T& value) {
+    m_out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+  void put_bytes(std::string_view bytes) { m_out.append(bytes.data(), bytes.size()); }
+  const std::string& str() const { return m_out; }
+
+private:
+  std::string m_out; //!< Bytes written so far.
+};
+
+/**
+ * @class ByteReader
+ * @brief Reads fixed-size values from a byte string, with bounds checks.
+ */
+class ByteReader {
+public:
+  explicit ByteReader(std::string_view in) : m_in{ in } {}
+
+  template <typename T>
+  bool get(T& value) {
+    if (m_in.size() - m_pos < sizeof(T)) return false;
+    std::memcpy(&value, m_in.data() + m_pos, sizeof(T));
+    m_pos += sizeof(T);
+    return true;
+  }
+  bool get_bytes(std::size_t n, std::string_view& bytes) {
+    if (m_in.size() - m_pos < n) return false;
+    bytes = m_in.substr(m_pos, n);
+    m_pos += n;
+    return true;
+  }
+
+private:
+  std::string_view m_in; //!< Bytes to read.
+  std::size_t m_pos{ 0 }; //!< Read position.
+};
+
+/**
+ * @brief Parse the content of a cache file.
+ *
+ * @param data The file content.
+ * @param entries Map the entries are added to (existing keys are overwritten).
+ *
+ * @return false if the content is not a valid cache; entries may then be partially filled.
+ */
+bool parse_cache(std::string_view data, std::unordered_map<std::string, CacheEntry>& entries) {
+  ByteReader in(data);
+  std::string_view magic;
+  std::uint32_t version{ 0 };
+  std::uint64_t count{ 0 };
+  if (!in.get_bytes(sizeof(MAGIC), magic) || magic != std::string_view(MAGIC, sizeof(MAGIC))) {
+    return false;
+  }
+  if (!in.get(version) || version != CLASSIFIER_VERSION) return false; //counted by another classifier
+  if (!in.get(count)) return false;
+
+  for (std::uint64_t i{ 0 }; i < count; ++i) {
+    std::uint32_t path_len{ 0 };
+    std::string_view path;
+    std::uint8_t type{ 0 };
+    std::uint8_t confidence{ 0 };
+    CacheEntry entry;
+    bool ok = in.get(path_len) && in.get_bytes(path_len, path) && in.get(entry.stamp.mtime_ns)
+              && in.get(entry.stamp.size) && in.get(entry.content_hash) && in.get(type) && in.get(confidence)
+              && in.get(entry.n_blank) && in.get(entry.n_comments) && in.get(entry.n_doc_comments)
+              && in.get(entry.n_loc) && in.get(entry.n_lines);
+    if (!ok) return false;
+    entry.type = type < UNDEF ? static_cast<lang_type_e>(type) : UNDEF;
+    entry.confidence = confidence <= CONFIDENCE_LOW ? static_cast<lang_confidence_e>(confidence) : CONFIDENCE_LOW;
+    entries[std::string(path)] = entry;
+  }
+  return true;
+}
+
+/**
+ * @brief Serialize a set of entries in the cache format.
+ */
+std::string serialize_cache(const std::unordered_map<std::string, CacheEntry>& entries) {
+  ByteWriter out;
+  out.put_bytes(std::string_view(MAGIC, sizeof(MAGIC)));
+  out.put(CLASSIFIER_VERSION);
+  out.put(static_cast<std::uint64_t>(entries.size()));
+  for (const auto& [path, entry] : entries) {
+    out.put(static_cast<std::uint32_t>(path.size()));
+    out.put_bytes(path);
+    out.put(entry.stamp.mtime_ns);
+    out.put(entry.stamp.size);
+    out.put(entry.content_hash);
+    out.put(static_cast<std::uint8_t>(entry.type));
+    out.put(static_cast<std::uint8_t>(entry.confidence));
+    out.put(entry.n_blank);
+    out.put(entry.n_comments);
+    out.put(entry.n_doc_comments);
+    out.put(entry.n_loc);
+    out.put(entry.n_lines);
+  }
+  return out.str();
+}
+
+/**
+ * @brief Drop the entries of files that no longer exist, among a slice of the entries.
+ *
+ * @param entries The entries to prune.
+ * @param keep Entries of files counted in this run, never dropped.
+ * @param seed Picks where the slice starts.
+ *
+ * The cache is shared by every directory the user counts, so checking all
+ * its files would make each save cost a stat() per file ever counted.
+ * Only PRUNE_SLICE entries are checked, starting at a different place at
+ * each save: every entry is looked at now and then, and a small cache is
+ * checked whole.
+ */
+void prune_slice(std::unordered_map<std::string, CacheEntry>& entries, const std::unordered_map<std::string, CacheEntry>& keep,
+                 std::size_t seed) {
+  if (entries.empty()) return;
+  std::size_t length = std::min(entries.size(), PRUNE_SLICE);
+  auto it = std::next(entries.begin(), static_cast<std::ptrdiff_t>(seed % entries.size()));
+  std::vector<std::string> gone;
+  for (std::size_t i{ 0 }; i < length; ++i, ++it) {
+    if (it == entries.end()) it = entries.begin(); //the slice wraps around
+    struct stat st {};
+    if (keep.count(it->first) == 0 && ::stat(it->first.c_str(), &st) != 0 && (errno == ENOENT || errno == ENOTDIR)) {
+      gone.push_back(it->first);
+    }
+  }
+  for (const auto& path : gone) entries.erase(path);
+}
+
+/**
+ * @brief Write a whole buffer to a descriptor.
+ * @return true on success.
+ */
+bool write_all(int fd, const std::string& data) {
+  std::size_t done{ 0 };
+  while (done < data.size()) {
+    ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    done += static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+}  // namespace
+
+/**
+ * @brief The cache file of the user.
+ *
+ * One file for every run of the user, whatever the current directory (it
+ * is keyed by absolute path): `$XDG_CACHE_HOME/sloc/counts`, or
+ * `~/.cache/sloc/counts` when XDG_CACHE_HOME is not set (or not an
+ * absolute path, as the XDG specification asks). Its directory is created
+ * when the cache is first saved.
+ *
+ * @return The path, or an empty string if neither variable is set.
+ */
+std::string ResultCache::default_file() {
+  const char* xdg = std::getenv("XDG_CACHE_HOME");
+  if (xdg != nullptr && xdg[0] == '/') return std::string(xdg) + "/sloc/counts";
+  const char* home = std::getenv("HOME");
+  if (home != nullptr && home[0] != '\0') return std::string(home) + "/.cache/sloc/counts";
+  return {};
+}
+
+/**
+ * @brief Create a cache bound to a file.
+ *
+ * @param path Path of the cache file.
+ * @param verify Also check a hash of the content before trusting an entry.
+ */
+ResultCache::ResultCache(std::string path, bool verify)
+    : m_path{ std::move(path) }, m_verify{ verify } {
+}
+
+/**
+ * @brief Load the entries stored in the cache file, if any.
+ *
+ * A missing, truncated or foreign file is silently treated as an empty cache.
+ */
+void ResultCache::load() {
+  FileBuffer file(m_path);
+  if (!file.ok()) return;
+  if (!parse_cache(file.view(), m_loaded)) m_loaded.clear();
+}
+
+/**
+ * @brief Merge the new entries into the cache file.
+ *
+ * Several sloc processes may share a cache file. A writer takes an exclusive
+ * lock on `<cache>.lock`, re-reads the file (another process may have saved
+ * in the meantime), adds its own entries and writes the result to a
+ * temporary file that is then renamed over the cache. Readers thus always
+ * see a complete file, and concurrent writers do not lose each other's
+ * entries.
+ *
+ * Entries of files outside this run are kept, so a run that skipped load()
+ * (see `--rebuild-cache`) only replaces the entries of the files it counted,
+ * unless their file no longer exists: a slice of the entries is checked at
+ * each save and those are dropped (see prune_slice()), so the cache does
+ * not keep growing with every file ever counted.
+ *
+ * @return true if the cache file was written.
+ */
+bool ResultCache::save() const {
+  std::lock_guard<std::mutex> guard(m_fresh_mtx);
+  if (m_fresh.empty()) return true; //nothing new: leave the file untouched
+
+  std::error_code ec;
+  std::filesystem::create_directories(std::filesystem::path(m_path).parent_path(), ec); //an error shows up below
+  std::string lock_path = m_path + ".lock";
+  int lock_fd = ::open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (lock_fd < 0) return false;
+  ::flock(lock_fd, LOCK_EX);
+
+  entry_map merged = m_loaded;
+  {
+    FileBuffer current(m_path);
+    if (current.ok()) {
+      entry_map on_disk;
+      if (parse_cache(current.view(), on_disk)) {
+        for (auto& [path, entry] : on_disk) merged[path] = entry;
+      }
+    }
+  }
+  prune_slice(merged, m_fresh, static_cast<std::size_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+  for (const auto& [path, entry] : m_fresh) merged[path] = entry;
+
+  std::string tmp_path = m_path + ".tmp." + std::to_string(::getpid());
+  bool ok{ false };
+  int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd >= 0) {
+    ok = write_all(fd, serialize_cache(merged));
+    ok = (::close(fd) == 0) && ok;
+    ok = ok && ::rename(tmp_path.c_str(), m_path.c_str()) == 0;
+    if (!ok) ::unlink(tmp_path.c_str());
+  }
+
+  ::flock(lock_fd, LOCK_UN);
+  ::close(lock_fd);
+  return ok;
+}
+
+/**
+ * @brief Find the counts of a file, if they are still valid.
+ *
+ * @param abs_path Absolute path of the file.
+ * @param stamp Current stamp of the file.
+ *
+ * Only the stamp is compared here; when verification is on, the caller
+ * still has to compare content hashes.
+ *
+ * @return The entry, or nothing if there is none or the file changed.
+ */
+std::optional<CacheEntry> ResultCache::lookup(const std::string& abs_path, const FileStamp& stamp) const {
+  auto it = m_loaded.find(abs_path);
+  if (it == m_loaded.end() || !(it->second.stamp == stamp)) return std::nullopt;
+  if (m_verify && it->second.content_hash == 0) return std::nullopt;
+  return it->second;
+}
+
+/**
+ * @brief Record the counts of a file counted in this run.
+ *
+ * @param abs_path Absolute path of the file.
+ * @param entry Its counts and stamp.
+ *
+ * Safe to call from several threads at once.
+ */
+void ResultCache::store(const std::string& abs_path, const CacheEntry& entry) {
+  std::lock_guard<std::mutex> guard(m_fresh_mtx);
+  m_fresh[abs_path] = entry;
+}
+
+/**
+ * @brief Read the stamp of a file.
+ *
+ * @param filename Path to the file.
+ *
+ * @return Its modification time and size, or nothing if it cannot be stat'ed.
+ */
+std::optional<FileStamp> file_stamp(const std::string& filename) {
+  struct stat st {};
+  if (::stat(filename.c_str(), &st) != 0) return std::nullopt;
+
+  FileStamp stamp;
+  stamp.mtime_ns = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+  stamp.size = static_cast<std::uint64_t>(st.st_size);
+  return stamp;
+}
+
+/**
+ * @brief Fast 64-bit hash of a buffer.
+ *
+ * @param data The bytes to hash.
+ *
+ * Mixes the buffer 8 bytes at a time with multiply/rotate rounds and ends
+ * with the splitmix64 finalizer. Not cryptographic: it only has to notice
+ * that a file changed while keeping the same size and mtime.
+ *
+ * @return The hash, never 0 (0 marks "no hash" in the cache).
+ */
+std::uint64_t content_hash(std::string_view data) {
+  constexpr std::uint64_t K1{ 0x9E3779B97F4A7C15ull };
+  constexpr std::uint64_t K2{ 0xBF58476D1CE4E5B9ull };
+  auto rotl = [](std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+
+  std::uint64_t h = K1 ^ (data.size() * K2);
+  std::size_t i{ 0 };
+  for (; i + 8 <= data.size(); i += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, data.data() + i, 8);
+    h = rotl(h ^ (word * K1), 31) * K2;
+  }
+  std::uint64_t tail{ 0 };
+  if (i < data.size()) std::memcpy(&tail, data.data() + i, data.size() - i);
+  h = rotl(h ^ (tail * K1), 31) * K2;
+
+  h ^= h >> 30;
+  h *= K2;
+  h ^= h >> 27;
+  h *= 0x94D049BB133111EBull;
+  h ^= h >> 31;
+  return h == 0 ? 1 : h;
+}
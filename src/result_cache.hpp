@@ -0,0 +1,140 @@
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "main.hpp"
+
+/*!
+ * @file result_cache.hpp
+ * @description
+ * Persistent cache of per-file counts, so files that did not change since
+ * the previous run are not read again.
+ */
+
+//== Structs
+
+/**
+ * @struct FileStamp
+ * @brief What identifies a version of a file without reading it.
+ */
+struct FileStamp {
+  std::int64_t mtime_ns{ 0 }; //!< Last modification time, in nanoseconds.
+  std::uint64_t size{ 0 };    //!< Size in bytes.
+
+  bool operator==(const FileStamp& other) const {
+    return mtime_ns == other.mtime_ns && size == other.size;
+  }
+};
+
+/**
+ * @struct CacheEntry
+ * @brief Cached counts of one file.
+ */
+struct CacheEntry {
+  FileStamp stamp;                                    //!< Version of the file the counts belong to.
+  std::uint64_t content_hash{ 0 };                    //!< Hash of the content (0 if not computed).
+  lang_type_e type{ UNDEF };                          //!< Language of the file (UNDEF: not source code).
+  lang_confidence_e confidence{ CONFIDENCE_CERTAIN }; //!< How the language was found.
+  count_t n_blank{ 0 };                               //!< # of blank lines.
+  count_t n_comments{ 0 };                            //!< # of comment lines.
+  count_t n_doc_comments{ 0 };                        //!< # of doc comment lines.
+  count_t n_loc{ 0 };                                 //!< # of lines of code.
+  count_t n_lines{ 0 };                               //!< # of lines.
+};
+
+//== Classes
+
+/**
+ * @class ResultCache
+ * @brief Counts of previous runs, keyed by absolute path, mtime and size.
+ *
+ * Entries loaded from disk are only read while files are being counted, and
+ * new entries go to a separate, locked map, so lookups from several threads
+ * never wait on each other.
+ */
+class ResultCache {
+public:
+  /**
+   * @brief The cache file of the user.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  static std::string default_file();
+
+  /**
+   * @brief Create a cache bound to a file.
+   * @param path Path of the cache file.
+   * @param verify Also check a hash of the content before trusting an entry.
+   */
+  explicit ResultCache(std::string path, bool verify = false);
+
+  /**
+   * @brief Load the entries stored in the cache file, if any.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  void load();
+
+  /**
+   * @brief Merge the new entries into the cache file.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  bool save() const;
+
+  /**
+   * @brief Find the counts of a file, if they are still valid.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  std::optional<CacheEntry> lookup(const std::string& abs_path, const FileStamp& stamp) const;
+
+  /**
+   * @brief Record the counts of a file counted in this run.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  void store(const std::string& abs_path, const CacheEntry& entry);
+
+  /// @brief Whether content hashes are computed and checked.
+  bool verify() const { return m_verify; }
+
+  /// @brief Path of the cache file.
+  const std::string& path() const { return m_path; }
+
+private:
+  using entry_map = std::unordered_map<std::string, CacheEntry>;
+
+  std::string m_path;                    //!< Cache file.
+  bool m_verify{ false };                //!< Check content hashes on lookup.
+  entry_map m_loaded;                    //!< Entries read from disk (read-only while counting).
+  entry_map m_fresh;                     //!< Entries of files counted in this run.
+  mutable std::mutex m_fresh_mtx;        //!< Guards m_fresh.
+};
+
+//== Functions
+
+/**
+ * @brief Read the stamp of a file.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see file_stamp()
+ */
+std::optional<FileStamp> file_stamp(const std::string& filename);
+
+/**
+ * @brief Fast 64-bit hash of a buffer.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see content_hash()
+ */
+std::uint64_t content_hash(std::string_view data);
+
+#endif
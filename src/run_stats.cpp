@@ -0,0 +1,251 @@
+/*!
+ * @file run_stats.cpp
+ * @description
+ * Implementation of the run instrumentation and of the `--stats` report.
+ */
+
+#include "run_stats.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include <mutex>
+#include <string_view>
+#include <sys/resource.h>
+
+namespace {
+
+/// @brief Guards g_retired and g_live.
+std::mutex g_counters_mtx;
+/// @brief Counters of the threads that already exited.
+TaskCounters g_retired;
+/// @brief Counters of the threads still running.
+std::vector<const TaskCounters*> g_live;
+
+/**
+ * @struct LocalCounters
+ * @brief Per-thread counters, registered while the thread lives.
+ *
+ * On exit a thread folds its counters into g_retired, so pools can come
+ * and go without the registry growing.
+ */
+struct LocalCounters {
+  TaskCounters counters; //!< Counters of this thread.
+
+  LocalCounters() {
+    std::lock_guard<std::mutex> lock(g_counters_mtx);
+    g_live.push_back(&counters);
+  }
+  ~LocalCounters() {
+    std::lock_guard<std::mutex> lock(g_counters_mtx);
+    g_retired += counters;
+    g_live.erase(std::find(g_live.begin(), g_live.end(), &counters));
+  }
+};
+
+thread_local LocalCounters tl_counters;
+
+/**
+ * @brief Nanoseconds of a timespec.
+ */
+std::uint64_t to_ns(const timespec& ts) {
+  return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(ts.tv_nsec);
+}
+
+/// @brief Nanoseconds to milliseconds.
+double ms(std::uint64_t ns) { return static_cast<double>(ns) / 1e6; }
+
+/// @brief Rate per second of a quantity over a duration (0 for an empty duration).
+double per_second(std::uint64_t amount, std::uint64_t ns) {
+  return ns == 0 ? 0.0 : static_cast<double>(amount) * 1e9 / static_cast<double>(ns);
+}
+
+/**
+ * @brief Peak resident set size divided by the number of files found, in bytes.
+ *
+ * A rough measure of what each file costs: it includes the fixed cost of
+ * the process, which dominates small runs.
+ */
+std::uint64_t peak_rss_per_file(const RunStats& stats) {
+  return stats.walk.files == 0 ? 0 : stats.peak_rss_kb * 1024 / stats.walk.files;
+}
+
+/**
+ * @brief The phase the throughput figures are computed over.
+ *
+ * Walking and counting overlap, so their common phase is the one that
+ * moves the bytes.
+ */
+std::uint64_t counting_wall_ns(const RunStats& stats) {
+  for (const auto& phase : stats.phases) {
+    if (std::string_view(phase.name) == "collect+count") return phase.wall_ns;
+  }
+  return 0;
+}
+
+}  // namespace
+
+/**
+ * @brief Start timing a phase.
+ *
+ * @param stats Where the phase is recorded when the timer stops.
+ * @param name Phase name (a string literal).
+ */
+PhaseTimer::PhaseTimer(RunStats& stats, const char* name)
+    : m_stats{ stats }, m_name{ name }, m_wall_start{ wall_clock_ns() }, m_cpu_start{ cpu_clock_ns() } {
+}
+
+/**
+ * @brief Stop timing and record the phase.
+ */
+PhaseTimer::~PhaseTimer() {
+  m_stats.phases.push_back({ m_name, wall_clock_ns() - m_wall_start, cpu_clock_ns() - m_cpu_start });
+}
+
+/**
+ * @brief Monotonic wall clock, in nanoseconds.
+ *
+ * @return Nanoseconds since an arbitrary point; only differences make sense.
+ */
+std::uint64_t wall_clock_ns() {
+  timespec ts{};
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return to_ns(ts);
+}
+
+/**
+ * @brief CPU time used by the process, in nanoseconds.
+ *
+ * @return User and system time of all threads so far.
+ */
+std::uint64_t cpu_clock_ns() {
+  timespec ts{};
+  ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return to_ns(ts);
+}
+
+/**
+ * @brief Counters of the calling thread.
+ *
+ * Only the calling thread may update them; they are read by
+ * total_counters() once the work is done.
+ *
+ * @return The thread-local counters.
+ */
+TaskCounters& local_counters() {
+  return tl_counters.counters;
+}
+
+/**
+ * @brief Sum of the counters of every thread, past and present.
+ *
+ * Call it when no thread is updating its counters any more (e.g. after
+ * the pool was waited for or destroyed).
+ *
+ * @return The merged counters.
+ */
+TaskCounters total_counters() {
+  std::lock_guard<std::mutex> lock(g_counters_mtx);
+  TaskCounters total = g_retired;
+  for (const TaskCounters* counters : g_live) total += *counters;
+  return total;
+}
+
+/**
+ * @brief Peak resident set size of the process.
+ *
+ * @return The peak, in KiB (0 if unknown).
+ */
+std::uint64_t peak_rss_kb() {
+  rusage usage{};
+  if (::getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+  return static_cast<std::uint64_t>(usage.ru_maxrss) / 1024; //bytes on macOS
+#else
+  return static_cast<std::uint64_t>(usage.ru_maxrss);
+#endif
+}
+
+/**
+ * @brief Write a human readable report.
+ *
+ * @param out Destination stream (stderr, so it never mixes with the table).
+ * @param stats The statistics of the run.
+ *
+ * Throughput is computed over the wall time of the collect+count phase.
+ * Utilization is the busy time of each worker over the lifetime of the pool.
+ */
+void print_stats(std::ostream& out, const RunStats& stats) {
+  std::ios_base::fmtflags flags = out.flags();
+  std::streamsize precision = out.precision();
+  out << std::fixed << std::setprecision(2);
+
+  std::uint64_t total_wall{ 0 }, total_cpu{ 0 };
+  out << "Phase               Wall (ms)     CPU (ms)\n";
+  for (const auto& phase : stats.phases) {
+    out << std::left << std::setw(18) << phase.name << std::right << std::setw(11) << ms(phase.wall_ns)
+        << std::setw(13) << ms(phase.cpu_ns) << "\n";
+    total_wall += phase.wall_ns;
+    total_cpu += phase.cpu_ns;
+  }
+  out << std::left << std::setw(18) << "total" << std::right << std::setw(11) << ms(total_wall)
+      << std::setw(13) << ms(total_cpu) << "\n\n";
+
+  std::uint64_t wall = counting_wall_ns(stats);
+  out << "Directories: " << stats.walk.directories << ", entries: " << stats.walk.entries
+      << ", stat calls: " << stats.walk.stat_calls << ", files found: " << stats.walk.files << "\n";
+  out << "Files read: " << stats.tasks.files_read << ", cache hits: " << stats.tasks.cache_hits
+      << ", bytes read: " << stats.tasks.bytes_read << "\n";
+  out << "Throughput: " << per_second(stats.walk.files, wall) << " files/s, "
+      << per_second(stats.tasks.bytes_read, wall) / 1e6 << " MB/s\n";
+  out << "Busy time: walking " << ms(stats.tasks.walk_ns) << " ms, counting " << ms(stats.tasks.count_ns)
+      << " ms\n";
+  out << "Peak RSS: " << stats.peak_rss_kb << " KiB, " << peak_rss_per_file(stats) << " bytes per file\n";
+  out << "Path arena: " << stats.paths << " paths, " << stats.path_bytes << " bytes\n";
+
+  if (!stats.workers.empty()) {
+    out << "Workers (utilization, tasks):";
+    for (std::size_t i{ 0 }; i < stats.workers.size(); ++i) {
+      double utilization = stats.pool_wall_ns == 0 ? 0.0 : 100.0 * static_cast<double>(stats.workers[i].busy_ns) / static_cast<double>(stats.pool_wall_ns);
+      out << (i % 4 == 0 ? "\n " : "") << " #" << i << " " << std::setprecision(1) << utilization << "% "
+          << stats.workers[i].tasks;
+    }
+    out << "\n";
+  }
+  out.flags(flags);
+  out.precision(precision);
+}
+
+/**
+ * @brief Write the report as a JSON object.
+ *
+ * @param out Destination stream.
+ * @param stats The statistics of the run.
+ *
+ * Times are in nanoseconds and sizes in bytes (KiB for the RSS), so the
+ * blob can be compared across runs without parsing units.
+ */
+void print_stats_json(std::ostream& out, const RunStats& stats) {
+  std::uint64_t wall = counting_wall_ns(stats);
+  out << "{\"phases\": [";
+  for (std::size_t i{ 0 }; i < stats.phases.size(); ++i) {
+    const auto& phase = stats.phases[i];
+    out << (i > 0 ? ", " : "") << "{\"name\": \"" << phase.name << "\", \"wall_ns\": " << phase.wall_ns
+        << ", \"cpu_ns\": " << phase.cpu_ns << "}";
+  }
+  out << "], \"walk\": {\"directories\": " << stats.walk.directories << ", \"entries\": " << stats.walk.entries
+      << ", \"stat_calls\": " << stats.walk.stat_calls << ", \"files\": " << stats.walk.files << "}";
+  out << ", \"files_read\": " << stats.tasks.files_read << ", \"cache_hits\": " << stats.tasks.cache_hits
+      << ", \"bytes_read\": " << stats.tasks.bytes_read;
+  out << ", \"files_per_second\": " << per_second(stats.walk.files, wall)
+      << ", \"mb_per_second\": " << per_second(stats.tasks.bytes_read, wall) / 1e6;
+  out << ", \"walk_busy_ns\": " << stats.tasks.walk_ns << ", \"count_busy_ns\": " << stats.tasks.count_ns;
+  out << ", \"peak_rss_kb\": " << stats.peak_rss_kb << ", \"peak_rss_per_file_bytes\": " << peak_rss_per_file(stats);
+  out << ", \"paths\": " << stats.paths << ", \"path_bytes\": " << stats.path_bytes << ", \"pool_wall_ns\": " << stats.pool_wall_ns;
+  out << ", \"workers\": [";
+  for (std::size_t i{ 0 }; i < stats.workers.size(); ++i) {
+    out << (i > 0 ? ", " : "") << "{\"busy_ns\": " << stats.workers[i].busy_ns
+        << ", \"tasks\": " << stats.workers[i].tasks << "}";
+  }
+  out << "]}\n";
+}
@@ -0,0 +1,179 @@
+#ifndef RUN_STATS_HPP
+#define RUN_STATS_HPP
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/*!
+ * @file run_stats.hpp
+ * @description
+ * Instrumentation of a run: per-phase timings, I/O counters, directory walk
+ * counters and thread pool utilization, reported by `--stats`.
+ *
+ * The counters are always on. They are thread-local (no atomics, no shared
+ * cache lines) and only merged when the report is built, so they cost a
+ * few additions per file.
+ */
+
+//== Structs
+
+/**
+ * @struct WalkStats
+ * @brief What a directory walk cost.
+ */
+struct WalkStats {
+  std::uint64_t directories{ 0 }; //!< Directories listed.
+  std::uint64_t entries{ 0 };     //!< Directory entries read (without "." and "..").
+  std::uint64_t stat_calls{ 0 };  //!< stat/fstatat calls made to classify or size entries.
+  std::uint64_t files{ 0 };       //!< Unique supported files found.
+};
+
+/**
+ * @struct TaskCounters
+ * @brief Work done by one thread (or, once merged, by all of them).
+ */
+struct TaskCounters {
+  std::uint64_t files_read{ 0 }; //!< Files read and counted.
+  std::uint64_t bytes_read{ 0 }; //!< Bytes of those files.
+  std::uint64_t cache_hits{ 0 }; //!< Files whose cached counts were reused.
+  std::uint64_t walk_ns{ 0 };    //!< Time spent listing directories.
+  std::uint64_t count_ns{ 0 };   //!< Time spent reading and counting files.
+
+  TaskCounters& operator+=(const TaskCounters& other) {
+    files_read += other.files_read;
+    bytes_read += other.bytes_read;
+    cache_hits += other.cache_hits;
+    walk_ns += other.walk_ns;
+    count_ns += other.count_ns;
+    return *this;
+  }
+};
+
+/**
+ * @struct WorkerStats
+ * @brief Activity of one pool worker.
+ */
+struct WorkerStats {
+  std::uint64_t busy_ns{ 0 }; //!< Time spent running tasks.
+  std::uint64_t tasks{ 0 };   //!< Tasks run.
+};
+
+/**
+ * @struct PhaseTime
+ * @brief Wall and CPU time of one phase of a run.
+ */
+struct PhaseTime {
+  const char* name{ "" };     //!< Phase name.
+  std::uint64_t wall_ns{ 0 }; //!< Elapsed time.
+  std::uint64_t cpu_ns{ 0 };  //!< CPU time of the whole process (all threads).
+};
+
+/**
+ * @struct RunStats
+ * @brief Everything `--stats` reports.
+ */
+struct RunStats {
+  std::vector<PhaseTime> phases;    //!< Phases, in the order they ran.
+  WalkStats walk;                   //!< Directory walk counters.
+  TaskCounters tasks;               //!< I/O and time counters, merged over threads.
+  std::vector<WorkerStats> workers; //!< One per pool worker (empty without a pool).
+  std::uint64_t pool_wall_ns{ 0 };  //!< Lifetime of the pool, to turn busy time into utilization.
+  std::uint64_t peak_rss_kb{ 0 };   //!< Peak resident set size.
+  std::uint64_t paths{ 0 };         //!< Distinct paths held by the path arena.
+  std::uint64_t path_bytes{ 0 };    //!< Bytes held by the path arena.
+};
+
+//== Classes
+
+/**
+ * @class PhaseTimer
+ * @brief Times a scope and records it as a phase of a run.
+ */
+class PhaseTimer {
+public:
+  /**
+   * @brief Start timing a phase.
+   * @param stats Where the phase is recorded when the timer stops.
+   * @param name Phase name (a string literal).
+   */
+  PhaseTimer(RunStats& stats, const char* name);
+
+  /// @brief Stop timing and record the phase.
+  ~PhaseTimer();
+
+  PhaseTimer(const PhaseTimer&) = delete;
+  PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+  RunStats& m_stats;          //!< Destination.
+  const char* m_name;         //!< Phase name.
+  std::uint64_t m_wall_start; //!< Wall clock at start.
+  std::uint64_t m_cpu_start;  //!< CPU clock at start.
+};
+
+//== Functions
+
+/**
+ * @brief Monotonic wall clock, in nanoseconds.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see wall_clock_ns()
+ */
+std::uint64_t wall_clock_ns();
+
+/**
+ * @brief CPU time used by the process, in nanoseconds.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see cpu_clock_ns()
+ */
+std::uint64_t cpu_clock_ns();
+
+/**
+ * @brief Counters of the calling thread.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see local_counters()
+ */
+TaskCounters& local_counters();
+
+/**
+ * @brief Sum of the counters of every thread, past and present.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see total_counters()
+ */
+TaskCounters total_counters();
+
+/**
+ * @brief Peak resident set size of the process.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see peak_rss_kb()
+ */
+std::uint64_t peak_rss_kb();
+
+/**
+ * @brief Write a human readable report.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see print_stats()
+ */
+void print_stats(std::ostream& out, const RunStats& stats);
+
+/**
+ * @brief Write the report as a JSON object.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see print_stats_json()
+ */
+void print_stats_json(std::ostream& out, const RunStats& stats);
+
+#endif
@@ -0,0 +1,129 @@
+/*!
+ * @file scan_simd.cpp
+ * @description
+ * Scalar, SSE2 and AVX2 kernels of find_delimiter(), and the runtime
+ * dispatch that picks the best one the CPU supports.
+ */
+
+#include "scan_simd.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+# define SLOC_X86 1
+# include <immintrin.h>
+#endif
+
+namespace {
+
+/// @brief Signature shared by all the kernels.
+using kernel_t = const char* (*)(const char*, const char*, const DelimiterSet&);
+
+/**
+ * @brief Plain byte-by-byte kernel, used for tails and on non-x86 targets.
+ */
+const char* find_scalar(const char* first, const char* last, const DelimiterSet& set) {
+  for (; first != last; ++first) {
+    if (set.contains(*first)) return first;
+  }
+  return last;
+}
+
+#ifdef SLOC_X86
+
+/**
+ * @brief SSE2 kernel: tests 16 bytes per iteration.
+ *
+ * Only whole blocks inside [first, last) are loaded, so it never reads past
+ * the end of a memory-mapped file.
+ */
+const char* find_sse2(const char* first, const char* last, const DelimiterSet& set) {
+  __m128i needles[DelimiterSet::MAX_SIZE];
+  for (std::size_t k{ 0 }; k < set.size(); ++k) needles[k] = _mm_set1_epi8(set[k]);
+
+  while (last - first >= 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+    __m128i hits = _mm_setzero_si128();
+    for (std::size_t k{ 0 }; k < set.size(); ++k) {
+      hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[k]));
+    }
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+    if (mask != 0) return first + __builtin_ctz(mask);
+    first += 16;
+  }
+  return find_scalar(first, last, set);
+}
+
+/**
+ * @brief AVX2 kernel: tests 32 bytes per iteration.
+ */
+__attribute__((target("avx2"))) const char* find_avx2(const char* first,
+                                                      const char* last,
+                                                      const DelimiterSet& set) {
+  __m256i needles[DelimiterSet::MAX_SIZE];
+  for (std::size_t k{ 0 }; k < set.size(); ++k) needles[k] = _mm256_set1_epi8(set[k]);
+
+  while (last - first >= 32) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+    __m256i hits = _mm256_setzero_si256();
+    for (std::size_t k{ 0 }; k < set.size(); ++k) {
+      hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, needles[k]));
+    }
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+    if (mask != 0) return first + __builtin_ctz(mask);
+    first += 32;
+  }
+  return find_sse2(first, last, set);
+}
+
+#endif
+
+/**
+ * @brief Pick the widest kernel supported by the running CPU.
+ */
+kernel_t select_kernel() {
+#ifdef SLOC_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return find_avx2;
+  return find_sse2;
+#else
+  return find_scalar;
+#endif
+}
+
+/// @brief The kernel in use, resolved once on first call.
+kernel_t active_kernel() {
+  static const kernel_t kernel = select_kernel();
+  return kernel;
+}
+
+}  // namespace
+
+/**
+ * @brief Find the first byte of a range that belongs to a delimiter set.
+ *
+ * @param first Start of the range.
+ * @param last One past the end of the range.
+ * @param set Bytes to look for.
+ *
+ * Dispatches at runtime to the AVX2 kernel when the CPU has it, otherwise to
+ * SSE2 (always present on x86-64), or to a scalar loop on other targets.
+ *
+ * @return Pointer to the first delimiter, or `last` if there is none.
+ */
+const char* find_delimiter(const char* first, const char* last, const DelimiterSet& set) {
+  return active_kernel()(first, last, set);
+}
+
+/**
+ * @brief Name of the kernel picked by the runtime dispatch.
+ *
+ * @return "avx2", "sse2" or "scalar".
+ */
+const char* simd_kernel_name() {
+  kernel_t kernel = active_kernel();
+#ifdef SLOC_X86
+  if (kernel == find_avx2) return "avx2";
+  if (kernel == find_sse2) return "sse2";
+#endif
+  (void)kernel;
+  return "scalar";
+}
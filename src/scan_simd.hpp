@@ -0,0 +1,83 @@
+#ifndef SCAN_SIMD_HPP
+#define SCAN_SIMD_HPP
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/*!
+ * @file scan_simd.hpp
+ * @description
+ * Vectorized search for the bytes that can change the state of the line
+ * classifier, so long runs of plain code or comment text are skipped in
+ * 16/32-byte blocks instead of one character at a time.
+ */
+
+//== Classes
+
+/**
+ * @class DelimiterSet
+ * @brief A small set of bytes (at most MAX_SIZE) to look for in a buffer.
+ */
+class DelimiterSet {
+public:
+  /// @brief Maximum number of distinct bytes in a set.
+  static constexpr std::size_t MAX_SIZE{ 8 };
+
+  /// @brief An empty set.
+  constexpr DelimiterSet() = default;
+
+  /**
+   * @brief Build the set from the bytes of a string.
+   * @param bytes The delimiters (extra bytes beyond MAX_SIZE are ignored).
+   */
+  constexpr DelimiterSet(std::string_view bytes) {
+    for (char ch : bytes) {
+      if (m_size == MAX_SIZE) break;
+      m_bytes[m_size++] = ch;
+    }
+  }
+
+  /// @brief Number of bytes in the set.
+  constexpr std::size_t size() const { return m_size; }
+
+  /// @brief The i-th byte of the set.
+  constexpr char operator[](std::size_t i) const { return m_bytes[i]; }
+
+  /// @brief Whether a byte belongs to the set.
+  constexpr bool contains(char ch) const {
+    for (std::size_t i{ 0 }; i < m_size; ++i) {
+      if (m_bytes[i] == ch) return true;
+    }
+    return false;
+  }
+
+private:
+  std::array<char, MAX_SIZE> m_bytes{}; //!< The bytes of the set.
+  std::size_t m_size{ 0 };              //!< How many bytes are in use.
+};
+
+/// @brief Bytes that may matter to the C/C++ line classifier.
+constexpr DelimiterSet SOURCE_DELIMITERS{ "/*\"'\\R\n" };
+
+//== Functions
+
+/**
+ * @brief Find the first byte of a range that belongs to a delimiter set.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see find_delimiter()
+ */
+const char* find_delimiter(const char* first, const char* last, const DelimiterSet& set);
+
+/**
+ * @brief Name of the kernel picked by the runtime dispatch.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see simd_kernel_name()
+ */
+const char* simd_kernel_name();
+
+#endif
@@ -0,0 +1,153 @@
+/*!
+ * @file stream_output.cpp
+ * @description
+ * Implementation of the `--stream` record writer.
+ *
+ * TSV output starts with a header line and ends with a totals line, both
+ * starting with '#'; tabs, newlines and backslashes in file names are
+ * escaped as `\t`, `\n` and `\\`. NDJSON output has one object per file
+ * (with the confidence of its language, see lang_confidence_e) and a last
+ * `{"total": ...}` object.
+ */
+
+#include "stream_output.hpp"
+
+#include "language_sniffer.hpp"
+#include "report_writer.hpp"
+#include "run_stats.hpp"
+
+namespace {
+
+/**
+ * @brief Append a file name escaped for a TSV field.
+ */
+void append_tsv_escaped(std::string& out, std::string_view text) {
+  for (char ch : text) {
+    switch (ch) {
+    case '\t': out += "\\t"; break;
+    case '\n': out += "\\n"; break;
+    case '\r': out += "\\r"; break;
+    case '\\': out += "\\\\"; break;
+    default: out += ch;
+    }
+  }
+}
+
+}  // namespace
+
+/**
+ * @brief Prepare a stream.
+ *
+ * @param out Destination.
+ * @param format Record format.
+ */
+RecordStream::RecordStream(std::ostream& out, stream_format_e format)
+    : m_out{ out }, m_format{ format }, m_last_flush_ns{ wall_clock_ns() } {
+  m_buffer.reserve(FLUSH_BYTES + 1024);
+}
+
+/**
+ * @brief Write the header, if the format has one.
+ *
+ * The header is flushed right away, so a consumer knows the columns
+ * before the first file is counted.
+ */
+void RecordStream::begin() {
+  std::lock_guard<std::mutex> lock(m_mtx);
+  if (m_format == STREAM_TSV) {
+    m_buffer += "#filename\tlanguage\tcomments\tdoc_comments\tblank\tcode\tlines\n";
+  }
+  flush();
+}
+
+/**
+ * @brief Write the record of a counted file.
+ *
+ * @param info The file and its counts.
+ *
+ * Only the running totals are kept; the record itself is written out at
+ * the next flush.
+ */
+void RecordStream::write(const FileInfo& info) {
+  std::lock_guard<std::mutex> lock(m_mtx);
+  append_record(&info.filename, language_name(info.type), info);
+
+  ++m_files;
+  m_totals.n_comments += info.n_comments;
+  m_totals.n_doc_comments += info.n_doc_comments;
+  m_totals.n_blank += info.n_blank;
+  m_totals.n_loc += info.n_loc;
+  m_totals.n_lines += info.n_lines;
+
+  if (m_buffer.size() >= FLUSH_BYTES || wall_clock_ns() - m_last_flush_ns >= FLUSH_INTERVAL_NS) {
+    flush();
+  }
+}
+
+/**
+ * @brief Write the totals and flush.
+ *
+ * Call it once every file has been written.
+ */
+void RecordStream::finish() {
+  std::lock_guard<std::mutex> lock(m_mtx);
+  append_record(nullptr, "", m_totals);
+  flush();
+}
+
+/**
+ * @brief Append the fields of a record to the buffer.
+ *
+ * @param name File name, or nullptr for the totals record.
+ * @param language Language name.
+ * @param info Counts.
+ */
+void RecordStream::append_record(const std::string_view* name, std::string_view language, const FileInfo& info) {
+  if (m_format == STREAM_TSV) {
+    if (name != nullptr) {
+      append_tsv_escaped(m_buffer, *name);
+    } else {
+      m_buffer += "#total";
+    }
+    m_buffer += '\t';
+    m_buffer += language;
+    for (count_t value : { info.n_comments, info.n_doc_comments, info.n_blank, info.n_loc, info.n_lines }) {
+      m_buffer += '\t';
+      append_uint(m_buffer, value);
+    }
+  } else {
+    if (name != nullptr) {
+      m_buffer += "{\"file\": ";
+      append_json_string(m_buffer, *name);
+      m_buffer += ", \"language\": ";
+      append_json_string(m_buffer, language);
+      m_buffer += ", \"confidence\": ";
+      append_json_string(m_buffer, confidence_name(info.confidence));
+    } else {
+      m_buffer += "{\"total\": {\"files\": ";
+      append_uint(m_buffer, m_files);
+    }
+    m_buffer += ", \"comments\": ";
+    append_uint(m_buffer, info.n_comments);
+    m_buffer += ", \"doc_comments\": ";
+    append_uint(m_buffer, info.n_doc_comments);
+    m_buffer += ", \"blank\": ";
+    append_uint(m_buffer, info.n_blank);
+    m_buffer += ", \"code\": ";
+    append_uint(m_buffer, info.n_loc);
+    m_buffer += ", \"lines\": ";
+    append_uint(m_buffer, info.n_lines);
+    m_buffer += name != nullptr ? "}" : "}}";
+  }
+  m_buffer += '\n';
+}
+
+/**
+ * @brief Write the buffer out.
+ */
+void RecordStream::flush() {
+  m_out.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+  m_out.flush();
+  m_buffer.clear();
+  m_last_flush_ns = wall_clock_ns();
+}
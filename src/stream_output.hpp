@@ -0,0 +1,88 @@
+#ifndef STREAM_OUTPUT_HPP
+#define STREAM_OUTPUT_HPP
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "main.hpp"
+
+/*!
+ * @file stream_output.hpp
+ * @description
+ * Record-per-file output of `--stream`, written while files are still
+ * being counted.
+ */
+
+//== Classes
+
+/**
+ * @class RecordStream
+ * @brief Writes one record per counted file and keeps only running totals.
+ *
+ * write() may be called from any thread. Records are gathered in a small
+ * buffer that is flushed when it fills up or when some time has passed
+ * since the last flush, so a consumer sees results live without paying a
+ * system call per file.
+ */
+class RecordStream {
+public:
+  /// @brief Flush once the buffer holds this many bytes.
+  static constexpr std::size_t FLUSH_BYTES{ 16 * 1024 };
+  /// @brief Flush when a record arrives this long after the previous flush.
+  static constexpr std::uint64_t FLUSH_INTERVAL_NS{ 100 * 1000 * 1000 };
+
+  /**
+   * @brief Prepare a stream.
+   * @param out Destination.
+   * @param format Record format.
+   */
+  RecordStream(std::ostream& out, stream_format_e format);
+
+  /**
+   * @brief Write the header, if the format has one.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  void begin();
+
+  /**
+   * @brief Write the record of a counted file.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  void write(const FileInfo& info);
+
+  /**
+   * @brief Write the totals and flush.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  void finish();
+
+  /// @brief Number of records written so far.
+  std::uint64_t records() const { return m_files; }
+
+private:
+  /**
+   * @brief Append the fields of a record to the buffer.
+   * @param name File name, or nullptr for the totals record.
+   * @param language Language name.
+   * @param info Counts.
+   */
+  void append_record(const std::string_view* name, std::string_view language, const FileInfo& info);
+
+  /// @brief Write the buffer out.
+  void flush();
+
+  std::ostream& m_out;               //!< Destination.
+  stream_format_e m_format;          //!< Record format.
+  std::mutex m_mtx;                  //!< Guards everything below.
+  std::string m_buffer;              //!< Records not written yet.
+  std::uint64_t m_last_flush_ns{ 0 }; //!< Time of the last flush.
+  std::uint64_t m_files{ 0 };        //!< Records written.
+  FileInfo m_totals;                 //!< Running totals.
+};
+
+#endif
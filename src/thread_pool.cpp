@@ -0,0 +1,199 @@
+/*!
+ * @file thread_pool.cpp
+ * @description
+ * Implementation of the work-stealing thread pool.
+ */
+
+#include "thread_pool.hpp"
+
+namespace {
+/// @brief Pool the current thread works for (nullptr outside any pool).
+thread_local const ThreadPool* tl_pool{ nullptr };
+/// @brief Index of the current thread among the workers of tl_pool.
+thread_local std::size_t tl_worker{ 0 };
+}  // namespace
+
+/**
+ * @brief Start a pool with a given number of workers.
+ *
+ * @param n_threads Number of workers; zero is treated as one.
+ */
+ThreadPool::ThreadPool(std::size_t n_threads) {
+  if (n_threads == 0) n_threads = 1;
+
+  for (std::size_t i{ 0 }; i < n_threads; ++i) {
+    m_queues.push_back(std::make_unique<WorkQueue>());
+  }
+  for (std::size_t i{ 0 }; i < n_threads; ++i) {
+    m_workers.emplace_back([this, i] { worker_loop(i); });
+  }
+}
+
+/**
+ * @brief Wait for the pending tasks and join all workers.
+ */
+ThreadPool::~ThreadPool() {
+  wait();
+  {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_stop = true;
+  }
+  m_work_cv.notify_all();
+  for (auto& worker : m_workers) worker.join();
+}
+
+/**
+ * @brief Queue a task to be run by some worker.
+ *
+ * @param task The task.
+ *
+ * Tasks are dealt round-robin, so consecutive submissions land on
+ * different workers and start (roughly) in submission order.
+ */
+void ThreadPool::submit(task_t task) {
+  std::size_t target;
+  {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    target = m_next_queue;
+    m_next_queue = (m_next_queue + 1) % m_queues.size();
+    ++m_pending;
+    ++m_queued;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_queues[target]->mtx);
+    m_queues[target]->tasks.push_back(std::move(task));
+  }
+  m_work_cv.notify_one();
+}
+
+/**
+ * @brief Block until every submitted task has finished.
+ */
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock(m_mtx);
+  m_done_cv.wait(lock, [this] { return m_pending == 0; });
+}
+
+/**
+ * @brief Run queued tasks until a condition holds.
+ *
+ * @param done Condition to wait for, checked between tasks.
+ *
+ * A worker of this pool starts with its own queue; any other thread just
+ * steals from all the queues. When there is nothing left to take, the
+ * missing tasks are running elsewhere, so the caller only yields.
+ */
+void ThreadPool::run_until(const std::function<bool()>& done) {
+  std::size_t id = tl_pool == this ? tl_worker : NO_WORKER;
+  task_t task;
+  while (!done()) {
+    if (take_task(id == NO_WORKER ? 0 : id, task)) {
+      execute(task, id);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+/**
+ * @brief Busy time and number of tasks of each worker so far.
+ *
+ * Time a task spends helping in run_until() is part of the enclosing task,
+ * so nested tasks are counted but their time is not counted twice.
+ *
+ * @return One entry per worker.
+ */
+std::vector<WorkerStats> ThreadPool::worker_stats() const {
+  std::vector<WorkerStats> stats;
+  for (const auto& queue : m_queues) {
+    stats.push_back({ queue->busy_ns.load(std::memory_order_relaxed), queue->n_run.load(std::memory_order_relaxed) });
+  }
+  return stats;
+}
+
+/**
+ * @brief Run a task taken from a queue and account for its completion.
+ *
+ * @param task The task; it is released once run.
+ * @param id Index of the worker running it, or NO_WORKER for another thread.
+ *
+ * A worker's busy time is only counted for outermost tasks (see worker_stats()).
+ */
+void ThreadPool::execute(task_t& task, std::size_t id) {
+  thread_local unsigned depth{ 0 };
+  std::uint64_t start = (id != NO_WORKER && depth == 0) ? wall_clock_ns() : 0;
+  ++depth;
+  task();
+  --depth;
+  task = nullptr;
+  if (id != NO_WORKER) {
+    WorkQueue& queue = *m_queues[id];
+    queue.n_run.fetch_add(1, std::memory_order_relaxed);
+    if (start != 0) queue.busy_ns.fetch_add(wall_clock_ns() - start, std::memory_order_relaxed);
+  }
+  if (--m_pending == 0) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_done_cv.notify_all();
+  }
+}
+
+/**
+ * @brief Take a task, first from the worker's own queue, then from the others.
+ *
+ * @param id Index of the worker looking for work.
+ * @param task Where the task taken is stored.
+ *
+ * The owner takes from the front of its queue (oldest, i.e. biggest, first)
+ * while thieves take from the back, so both ends rarely compete.
+ *
+ * @return true if a task was found.
+ */
+bool ThreadPool::take_task(std::size_t id, task_t& task) {
+  {
+    WorkQueue& own = *m_queues[id];
+    std::lock_guard<std::mutex> lock(own.mtx);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.front());
+      own.tasks.pop_front();
+      --m_queued;
+      return true;
+    }
+  }
+  for (std::size_t k{ 1 }; k < m_queues.size(); ++k) {
+    WorkQueue& victim = *m_queues[(id + k) % m_queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mtx);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.back());
+      victim.tasks.pop_back();
+      --m_queued;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Loop executed by each worker.
+ *
+ * @param id Index of the worker.
+ *
+ * Runs tasks while there are any to take (stealing if needed), and sleeps
+ * otherwise until more work is submitted or the pool is destroyed.
+ */
+void ThreadPool::worker_loop(std::size_t id) {
+  tl_pool = this;
+  tl_worker = id;
+
+  task_t task;
+  while (true) {
+    if (take_task(id, task)) {
+      execute(task, id);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mtx);
+    if (m_stop) return;
+    m_work_cv.wait(lock, [this] { return m_stop || m_queued != 0; });
+    if (m_stop && m_queued == 0) return;
+  }
+}
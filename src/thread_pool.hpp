@@ -0,0 +1,123 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "run_stats.hpp"
+
+/*!
+ * @file thread_pool.hpp
+ * @description
+ * A small work-stealing thread pool used to count several files at once.
+ */
+
+//== Classes
+
+/**
+ * @class ThreadPool
+ * @brief Fixed-size pool of workers, each one with its own task queue.
+ *
+ * Tasks are dealt round-robin to the worker queues. A worker always takes
+ * the oldest task of its own queue and, when it runs dry, steals the newest
+ * task from another worker's queue. Submitting the biggest jobs first thus
+ * makes them start first.
+ */
+class ThreadPool {
+public:
+  /// @brief A unit of work.
+  using task_t = std::function<void()>;
+
+  /**
+   * @brief Start a pool with a given number of workers.
+   * @param n_threads Number of workers (at least one is always created).
+   */
+  explicit ThreadPool(std::size_t n_threads);
+
+  /// @brief Wait for the pending tasks and join all workers.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * @brief Queue a task to be run by some worker.
+   * @param task The task.
+   */
+  void submit(task_t task);
+
+  /// @brief Block until every submitted task has finished.
+  void wait();
+
+  /**
+   * @brief Run queued tasks until a condition holds.
+   * @param done Condition to wait for, checked between tasks.
+   *
+   * Unlike wait(), this may be called from inside a task: the caller keeps
+   * taking (or stealing) work instead of sleeping, so a task can split
+   * itself into sub-tasks and join them without starving the pool.
+   */
+  void run_until(const std::function<bool()>& done);
+
+  /// @brief Number of workers in the pool.
+  std::size_t size() const { return m_workers.size(); }
+
+  /**
+   * @brief Busy time and number of tasks of each worker so far.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  std::vector<WorkerStats> worker_stats() const;
+
+private:
+  /// @brief Per-worker queue of tasks.
+  struct WorkQueue {
+    std::mutex mtx;                       //!< Guards tasks.
+    std::deque<task_t> tasks;             //!< Pending tasks of this worker.
+    std::atomic<std::uint64_t> busy_ns{ 0 }; //!< Time this worker spent running tasks.
+    std::atomic<std::uint64_t> n_run{ 0 };   //!< Tasks this worker ran.
+  };
+
+  /**
+   * @brief Loop executed by each worker.
+   * @param id Index of the worker (and of its own queue).
+   */
+  void worker_loop(std::size_t id);
+
+  /**
+   * @brief Take a task, first from the worker's own queue, then from the others.
+   * @param id Index of the worker looking for work.
+   * @param task Where the task taken is stored.
+   * @return true if a task was found.
+   */
+  bool take_task(std::size_t id, task_t& task);
+
+  /**
+   * @brief Run a task taken from a queue and account for its completion.
+   * @param task The task.
+   * @param id Index of the worker running it, or NO_WORKER for another thread.
+   */
+  void execute(task_t& task, std::size_t id);
+
+  /// @brief Worker index of threads that do not belong to the pool.
+  static constexpr std::size_t NO_WORKER{ static_cast<std::size_t>(-1) };
+
+  std::vector<std::unique_ptr<WorkQueue>> m_queues; //!< One queue per worker.
+  std::vector<std::thread> m_workers;               //!< The worker threads.
+  std::mutex m_mtx;                                 //!< Guards the wake-up/done conditions.
+  std::condition_variable m_work_cv;                //!< Signals new work or shutdown.
+  std::condition_variable m_done_cv;                //!< Signals that all work is done.
+  std::atomic<std::size_t> m_pending{ 0 };          //!< Tasks submitted but not finished.
+  std::atomic<std::size_t> m_queued{ 0 };           //!< Tasks sitting in some queue.
+  std::size_t m_next_queue{ 0 };                    //!< Round-robin cursor for submit().
+  bool m_stop{ false };                             //!< Tells workers to exit.
+};
+
+#endif
@@ -0,0 +1,87 @@
+/*!
+ * @file top_records.cpp
+ * @description
+ * Implementation of the `--top K` selection.
+ */
+
+#include "top_records.hpp"
+
+#include <algorithm>
+#include <utility>
+
+/// @brief Records reserved up front; with a bigger K, the heap grows with the files offered.
+constexpr std::size_t INITIAL_RESERVE{ 1024 };
+
+/**
+ * @brief Prepare an empty selection.
+ *
+ * @param k Number of records to keep.
+ * @param sort_fields Fields to sort by, most significant first.
+ * @param sort_ascending Sort direction.
+ *
+ * Room for at most INITIAL_RESERVE records is reserved in advance:
+ * `--top` takes any K, which may be far more than the files counted.
+ */
+TopRecords::TopRecords(std::size_t k, std::vector<sorting_arg> sort_fields, bool sort_ascending)
+    : m_k{ k }, m_sort_fields{ std::move(sort_fields) }, m_sort_ascending{ sort_ascending } {
+  m_heap.reserve(std::min(k, INITIAL_RESERVE));
+}
+
+/**
+ * @brief Whether `a` is printed before `b`.
+ *
+ * @param a First record.
+ * @param b Second record.
+ *
+ * The order of compare_files(), with ties broken by file name.
+ */
+bool TopRecords::before(const FileInfo& a, const FileInfo& b) const {
+  if (compare_files(a, b, m_sort_fields, m_sort_ascending)) return true;
+  if (compare_files(b, a, m_sort_fields, m_sort_ascending)) return false;
+  return a.filename < b.filename;
+}
+
+/**
+ * @brief Consider a counted file.
+ *
+ * @param info The file and its counts.
+ *
+ * May be called from any thread. The record, and its file name, are
+ * copied only if it makes the cut.
+ */
+void TopRecords::offer(const FileInfo& info) {
+  auto order = [this](const Record& a, const Record& b) { return before(a.view(), b.view()); };
+  std::lock_guard<std::mutex> lock(m_mtx);
+  ++m_seen;
+  if (m_heap.size() < m_k) {
+    m_heap.push_back({ info, std::string{ info.filename } });
+    std::push_heap(m_heap.begin(), m_heap.end(), order);
+  } else if (m_k > 0 && before(info, m_heap.front().view())) {
+    std::pop_heap(m_heap.begin(), m_heap.end(), order);
+    m_heap.back().info = info;
+    m_heap.back().name = info.filename;
+    std::push_heap(m_heap.begin(), m_heap.end(), order);
+  }
+}
+
+/**
+ * @brief The retained records, in sort order.
+ *
+ * @param paths Arena receiving the file names of the records.
+ *
+ * Call it once every file has been offered; the selection is left empty.
+ *
+ * @return At most K records, the first one to be printed first.
+ */
+std::vector<FileInfo> TopRecords::take(PathArena& paths) {
+  std::lock_guard<std::mutex> lock(m_mtx);
+  std::sort_heap(m_heap.begin(), m_heap.end(), [this](const Record& a, const Record& b) { return before(a.view(), b.view()); });
+  std::vector<FileInfo> out;
+  out.reserve(m_heap.size());
+  for (const auto& record : m_heap) {
+    out.push_back(record.info);
+    out.back().filename = paths.intern(record.name).path;
+  }
+  m_heap.clear();
+  return out;
+}
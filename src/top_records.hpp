@@ -0,0 +1,91 @@
+#ifndef TOP_RECORDS_HPP
+#define TOP_RECORDS_HPP
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "main.hpp"
+#include "path_arena.hpp"
+
+/*!
+ * @file top_records.hpp
+ * @description
+ * Selection of the first K records of a sort while files are being
+ * counted, for `--top K`.
+ */
+
+//== Classes
+
+/**
+ * @class TopRecords
+ * @brief Keeps the K records that come first in a sort order.
+ *
+ * The retained records form a bounded heap whose root is the one that would
+ * be printed last, so a new record either is dropped after one comparison
+ * or replaces the root in O(log K). Memory and sorting cost depend on K,
+ * not on the number of files counted.
+ *
+ * Records that compare equal are told apart by file name, so which of them
+ * make the cut does not depend on the order they were counted in.
+ *
+ * Offered records only borrow their file name, so a retained record keeps
+ * its own copy until take() interns it.
+ */
+class TopRecords {
+public:
+  /**
+   * @brief Prepare an empty selection.
+   * @param k Number of records to keep.
+   * @param sort_fields Fields to sort by, most significant first.
+   * @param sort_ascending Sort direction.
+   */
+  TopRecords(std::size_t k, std::vector<sorting_arg> sort_fields, bool sort_ascending);
+
+  /**
+   * @brief Consider a counted file.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  void offer(const FileInfo& info);
+
+  /**
+   * @brief The retained records, in sort order.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  std::vector<FileInfo> take(PathArena& paths);
+
+  /// @brief Number of records offered so far.
+  std::uint64_t seen() const { return m_seen; }
+
+private:
+  /// @brief A retained record and the file name it owns.
+  struct Record {
+    FileInfo info;    //!< Counts; its file name is not used.
+    std::string name; //!< File name.
+
+    /// @brief The record, naming its own copy of the file name.
+    FileInfo view() const {
+      FileInfo out{ info };
+      out.filename = name;
+      return out;
+    }
+  };
+
+  /**
+   * @brief Whether `a` is printed before `b`.
+   * @param a First record.
+   * @param b Second record.
+   */
+  bool before(const FileInfo& a, const FileInfo& b) const;
+
+  std::size_t m_k;                        //!< Records to keep.
+  std::vector<sorting_arg> m_sort_fields; //!< Fields to sort by.
+  bool m_sort_ascending;                  //!< Sort direction.
+  std::mutex m_mtx;                       //!< Guards everything below.
+  std::vector<Record> m_heap;             //!< Retained records, a heap on before().
+  std::uint64_t m_seen{ 0 };              //!< Records offered.
+};
+
+#endif
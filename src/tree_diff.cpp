@@ -0,0 +1,284 @@
+/*!
+ * @file tree_diff.cpp
+ * @description
+ * Listing and pairing of the snapshots of `--diff`, the per-file diffs,
+ * and the table of changed lines.
+ */
+
+#include "tree_diff.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+
+#include "dir_walker.hpp"
+#include "language_registry.hpp"
+#include "language_sniffer.hpp"
+#include "run_stats.hpp"
+#include "thread_pool.hpp"
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief List the files of both snapshots and pair them.
+ *
+ * @param old_side The old snapshot, as given on the command line.
+ * @param new_side The new snapshot.
+ *
+ * A side naming an existing directory is walked recursively; one naming a
+ * regular file is that file alone, and can only be compared with another
+ * file; anything else must be a revision of the repository holding the
+ * current directory (with the syntax of `--git`). Only the files that may
+ * be source code are listed: those of a known language, and those without
+ * an extension, whose content decides. Both lists are sorted by path and
+ * merged into the pairs.
+ */
+TreeDiff::TreeDiff(const std::string& old_side, const std::string& new_side) {
+  if (!list(old_side, m_old) || !list(new_side, m_new)) return;
+  if (m_old.single != m_new.single) {
+    m_error = "a single file can only be compared with another file";
+    return;
+  }
+  if (m_old.single) {
+    m_pairs.push_back({ 0, 0 });
+    return;
+  }
+
+  std::size_t i{ 0 }, j{ 0 };
+  while (i < m_old.files.size() || j < m_new.files.size()) {
+    if (j == m_new.files.size() || (i < m_old.files.size() && m_old.files[i].path < m_new.files[j].path)) {
+      m_pairs.push_back({ i++, NONE });
+    } else if (i == m_old.files.size() || m_new.files[j].path < m_old.files[i].path) {
+      m_pairs.push_back({ NONE, j++ });
+    } else {
+      m_pairs.push_back({ i++, j++ });
+    }
+  }
+}
+
+TreeDiff::~TreeDiff() = default;
+
+/**
+ * @brief List the files of a snapshot.
+ *
+ * @param spec The snapshot, as given on the command line.
+ * @param side Receives the files.
+ *
+ * Directories are walked with a DirectoryWalker, whose counting function
+ * only finds the language (reading the head of the files without a known
+ * extension), so that files found not to be source code are left out as
+ * in a normal run. Revisions are listed from their tree, and the language
+ * of a blob without a known extension is found from its content later.
+ *
+ * @return false (with m_error set) if it names nothing readable.
+ */
+bool TreeDiff::list(const std::string& spec, Side& side) {
+  std::error_code ec;
+  fs::file_status status = fs::status(spec, ec);
+  auto by_path = [](const SideFile& a, const SideFile& b) { return a.path < b.path; };
+
+  if (fs::is_regular_file(status)) {
+    side.single = true;
+    side.files.push_back({ spec, m_names.intern(spec).path, {}, language_of_file(spec) });
+    return true;
+  }
+
+  if (fs::is_directory(status)) {
+    DirectoryWalker walker(nullptr, true, [](std::string_view path) {
+      FileInfo info(path);
+      info.type = language_of_file(std::string{ path });
+      return info;
+    }, m_names);
+    walker.add_directory(spec);
+    for (const auto& info : walker.files()) {
+      std::string_view path = info.filename.substr(spec.size());
+      while (!path.empty() && path.front() == '/') path.remove_prefix(1);
+      side.files.push_back({ std::string{ path }, info.filename, {}, info.type });
+    }
+    std::sort(side.files.begin(), side.files.end(), by_path);
+    return true;
+  }
+
+  if (!m_repo) m_repo = std::make_unique<GitRepository>(".");
+  if (!m_repo->ok()) {
+    m_error = "\"" + spec + "\" is neither a file nor a directory, and the current directory is not inside a git repository";
+    return false;
+  }
+  ObjectId commit;
+  if (!m_repo->resolve(spec, commit)) {
+    m_error = "\"" + spec + "\" is neither a file, a directory nor a known revision";
+    return false;
+  }
+  std::vector<GitEntry> entries;
+  if (!m_repo->list_tree(commit, [](std::string_view) { return true; }, entries)) {
+    m_error = "unable to read the files of \"" + spec + "\" in the git repository";
+    return false;
+  }
+  side.revision = true;
+  for (auto& entry : entries) {
+    if (!may_be_source(entry.path)) continue;
+    lang_type_e type = language_by_file_name(entry.path);
+    side.files.push_back({ std::move(entry.path), {}, entry.id, type });
+  }
+  std::sort(side.files.begin(), side.files.end(), by_path);
+  return true;
+}
+
+/**
+ * @brief Read the content of a file of a snapshot.
+ *
+ * @param side The snapshot.
+ * @param file The file.
+ * @param blob Holds the content of a blob.
+ * @param buffer Holds the content of a file on disk.
+ *
+ * Unreadable files are taken as empty, as when counting. The file and its
+ * bytes go to the thread's TaskCounters.
+ *
+ * @return The content, valid as long as `blob` and `buffer`.
+ */
+std::string_view TreeDiff::load(const Side& side, const SideFile& file, std::string& blob, std::optional<FileBuffer>& buffer) const {
+  std::string_view content;
+  if (side.revision) {
+    git_object_e type{ GIT_NONE };
+    if (m_repo->read_object(file.blob, type, blob) && type == GIT_BLOB) content = blob;
+  } else {
+    buffer.emplace(std::string{ file.source });
+    if (buffer->ok()) content = buffer->view();
+  }
+  TaskCounters& counters = local_counters();
+  ++counters.files_read;
+  counters.bytes_read += content.size();
+  return content;
+}
+
+/**
+ * @brief Diff every pair of files.
+ *
+ * @param pool Pool to diff the pairs on, or nullptr to diff them in turn.
+ *
+ * Two blobs with the same id are unchanged without being read. Otherwise
+ * both versions are read, and if they differ, each is classified line by
+ * line with the scanner of its language (see classify_language()), the
+ * lines are diffed (see diff_lines()), and the classes of the lines of
+ * each hunk give the delta counts (see count_delta()). A file that is
+ * only on one side is entirely added or removed. The language comes from
+ * the name, or else from the content of the newest version; files that
+ * are not source code are left out.
+ *
+ * @return One FileDelta per changed source file, sorted by path.
+ */
+std::vector<FileDelta> TreeDiff::compare(ThreadPool* pool) {
+  enum outcome_e : std::uint8_t { SKIPPED, UNCHANGED, CHANGED };
+  std::vector<FileDelta> deltas(m_pairs.size());
+  std::vector<outcome_e> outcomes(m_pairs.size(), SKIPPED);
+
+  auto diff_pair = [this, &deltas, &outcomes](std::size_t index) {
+    const Pair& pair = m_pairs[index];
+    const SideFile* old_file = pair.old_file != NONE ? &m_old.files[pair.old_file] : nullptr;
+    const SideFile* new_file = pair.new_file != NONE ? &m_new.files[pair.new_file] : nullptr;
+    const SideFile& newest = new_file != nullptr ? *new_file : *old_file;
+    lang_type_e type = newest.type;
+    if (old_file != nullptr && new_file != nullptr && m_old.revision && m_new.revision && old_file->blob == new_file->blob
+        && type != UNDEF) {
+      outcomes[index] = UNCHANGED;
+      return;
+    }
+
+    std::string old_blob, new_blob;
+    std::optional<FileBuffer> old_buffer, new_buffer;
+    std::string_view old_text = old_file != nullptr ? load(m_old, *old_file, old_blob, old_buffer) : std::string_view{};
+    std::string_view new_text = new_file != nullptr ? load(m_new, *new_file, new_blob, new_buffer) : std::string_view{};
+    if (type == UNDEF) type = sniff_language((new_file != nullptr ? new_text : old_text).substr(0, SNIFF_BYTES)).type;
+    if (type == UNDEF) return;
+    if (old_file != nullptr && new_file != nullptr && old_text == new_text) {
+      outcomes[index] = UNCHANGED;
+      return;
+    }
+
+    std::vector<std::uint8_t> old_classes, new_classes;
+    classify_language(type, old_text, old_classes);
+    classify_language(type, new_text, new_classes);
+    std::vector<Hunk> hunks = diff_lines(split_lines(old_text), split_lines(new_text));
+
+    FileDelta& delta = deltas[index];
+    delta.filename = newest.path;
+    delta.type = type;
+    delta.status = old_file == nullptr ? DELTA_ADDED : new_file == nullptr ? DELTA_REMOVED : DELTA_MODIFIED;
+    delta.counts = count_delta(hunks, old_classes, new_classes);
+    outcomes[index] = CHANGED;
+  };
+
+  if (pool != nullptr) {
+    for (std::size_t index{ 0 }; index < m_pairs.size(); ++index) pool->submit([&diff_pair, index] { diff_pair(index); });
+    pool->wait();
+  } else {
+    for (std::size_t index{ 0 }; index < m_pairs.size(); ++index) diff_pair(index);
+  }
+
+  std::vector<FileDelta> changed;
+  m_unchanged = 0;
+  for (std::size_t index{ 0 }; index < m_pairs.size(); ++index) {
+    if (outcomes[index] == CHANGED) changed.push_back(deltas[index]);
+    m_unchanged += outcomes[index] == UNCHANGED;
+  }
+  return changed;
+}
+
+/**
+ * @brief Print the table of changed lines.
+ *
+ * @param deltas The changed files, as returned by TreeDiff::compare().
+ * @param unchanged Number of unchanged source files.
+ *
+ * Same layout as print_summary(), with a status column, and each count
+ * written as `+added -removed ~modified`. The SUM row adds up every file.
+ */
+void print_delta_summary(const std::vector<FileDelta>& deltas, std::size_t unchanged) {
+  if (deltas.empty()) {
+    std::cout << "No changed files (" << unchanged << " unchanged).\n";
+    return;
+  }
+
+  auto cell = [](const LineDelta& delta) {
+    return "+" + std::to_string(delta.added) + " -" + std::to_string(delta.removed) + " ~" + std::to_string(delta.modified);
+  };
+  constexpr const char* STATUS_NAMES[] = { "added", "removed", "modified" };
+
+  std::size_t n_status[3]{};
+  DeltaCount total;
+  std::size_t filename_width{ 20 };
+  std::size_t count_width{ 14 };
+  for (const auto& delta : deltas) {
+    ++n_status[delta.status];
+    total += delta.counts;
+    filename_width = std::max(filename_width, delta.filename.size());
+  }
+  for (const LineDelta* field : { &total.com, &total.dox, &total.blank, &total.loc, &total.lines }) {
+    count_width = std::max(count_width, cell(*field).size() + 2); //the totals are the widest cells
+  }
+
+  std::cout << "Files changed: " << deltas.size() << " (" << n_status[DELTA_ADDED] << " added, " << n_status[DELTA_REMOVED]
+            << " removed, " << n_status[DELTA_MODIFIED] << " modified), " << unchanged << " unchanged\n";
+
+  std::string separator(filename_width + 1 + 14 + 10 + 5 * count_width, '-');
+  auto row = [&](std::string_view name, std::string_view language, std::string_view status, const DeltaCount& counts) {
+    std::cout << std::left << std::setw(filename_width + 1) << name << std::setw(14) << language << std::setw(10) << status
+              << std::setw(count_width) << cell(counts.com) << std::setw(count_width) << cell(counts.dox)
+              << std::setw(count_width) << cell(counts.blank) << std::setw(count_width) << cell(counts.loc)
+              << cell(counts.lines) << "\n";
+  };
+
+  std::cout << separator << "\n";
+  std::cout << std::left << std::setw(filename_width + 1) << "Filename" << std::setw(14) << "Language" << std::setw(10) << "Status"
+            << std::setw(count_width) << "Comments" << std::setw(count_width) << "Doc Comments" << std::setw(count_width) << "Blank"
+            << std::setw(count_width) << "Code" << "# of lines\n";
+  std::cout << separator << "\n";
+  for (const auto& delta : deltas) row(delta.filename, language_name(delta.type), STATUS_NAMES[delta.status], delta.counts);
+  if (deltas.size() > 1) {
+    std::cout << separator << "\n";
+    row("SUM", "", "", total);
+  }
+  std::cout << separator << "\n";
+}
@@ -0,0 +1,156 @@
+#ifndef TREE_DIFF_HPP
+#define TREE_DIFF_HPP
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "file_reader.hpp"
+#include "git_repo.hpp"
+#include "line_diff.hpp"
+#include "main.hpp"
+#include "path_arena.hpp"
+
+/*!
+ * @file tree_diff.hpp
+ * @description
+ * `--diff A B`: pair the source files of two snapshots (directories, git
+ * revisions or single files) by path and count the lines that changed
+ * between them, by kind.
+ */
+
+//== Enums
+
+/**
+ * @enum delta_status_e
+ * @brief What happened to a file between the two snapshots.
+ */
+enum delta_status_e : std::uint8_t {
+  DELTA_ADDED = 0, //!< Only in the new snapshot.
+  DELTA_REMOVED,   //!< Only in the old snapshot.
+  DELTA_MODIFIED,  //!< In both, with a different content.
+};
+
+//== Structs
+
+/**
+ * @struct FileDelta
+ * @brief The changes of one file.
+ */
+struct FileDelta {
+  std::string_view filename;               //!< Path within the snapshots (owned by the TreeDiff).
+  lang_type_e type{ UNDEF };               //!< Language of the file.
+  delta_status_e status{ DELTA_MODIFIED }; //!< Added, removed or modified.
+  DeltaCount counts;                       //!< Changed lines, by kind.
+};
+
+//== Classes
+
+/**
+ * @class TreeDiff
+ * @brief The two snapshots of `--diff`, and how to compare them.
+ *
+ * Each side is a directory (walked recursively), a single file, or else
+ * a revision of the git repository of the current directory, read from
+ * the object database without a checkout. Files are paired by their path
+ * relative to the directory or to the top of the repository.
+ */
+class TreeDiff {
+public:
+  /**
+   * @brief List the files of both snapshots and pair them.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  TreeDiff(const std::string& old_side, const std::string& new_side);
+
+  ~TreeDiff();
+
+  TreeDiff(const TreeDiff&) = delete;
+  TreeDiff& operator=(const TreeDiff&) = delete;
+
+  /// @brief Whether both snapshots could be listed; see error() otherwise.
+  bool ok() const { return m_error.empty(); }
+
+  /// @brief What went wrong, for a message after "Sorry, ".
+  const std::string& error() const { return m_error; }
+
+  /// @brief Number of paths found in either snapshot.
+  std::size_t paths() const { return m_pairs.size(); }
+
+  /// @brief Source files found in both snapshots with the same content (after compare()).
+  std::size_t unchanged() const { return m_unchanged; }
+
+  /**
+   * @brief Diff every pair of files.
+   *
+   * Detailed documentation for this function is provided in the implementation file.
+   */
+  std::vector<FileDelta> compare(ThreadPool* pool);
+
+private:
+  /// @brief A file of a snapshot.
+  struct SideFile {
+    std::string path;          //!< Path within the snapshot, '/'-separated.
+    std::string_view source;   //!< Path to open (in a directory or a single file), empty for a blob.
+    ObjectId blob;             //!< Blob holding the content (in a revision).
+    lang_type_e type{ UNDEF }; //!< Language, if known from the listing (UNDEF: from the content).
+  };
+
+  /// @brief One of the two snapshots.
+  struct Side {
+    bool revision{ false };      //!< Whether the files come from a git revision.
+    bool single{ false };        //!< Whether it is a single file.
+    std::vector<SideFile> files; //!< Its files, sorted by path.
+  };
+
+  /**
+   * @brief List the files of a snapshot.
+   * @param spec The snapshot, as given on the command line.
+   * @param side Receives the files.
+   * @return false (with m_error set) if it names nothing readable.
+   */
+  bool list(const std::string& spec, Side& side);
+
+  /**
+   * @brief Read the content of a file of a snapshot.
+   * @param side The snapshot.
+   * @param file The file.
+   * @param blob Holds the content of a blob.
+   * @param buffer Holds the content of a file on disk.
+   * @return The content (empty if unreadable).
+   */
+  std::string_view load(const Side& side, const SideFile& file, std::string& blob, std::optional<FileBuffer>& buffer) const;
+
+  static constexpr std::size_t NONE{ static_cast<std::size_t>(-1) }; //!< A file missing from one side.
+
+  /// @brief The files of a path on each side.
+  struct Pair {
+    std::size_t old_file{ NONE }; //!< Index in m_old.files, or NONE.
+    std::size_t new_file{ NONE }; //!< Index in m_new.files, or NONE.
+  };
+
+  PathArena m_names;                      //!< Paths of the files on disk.
+  std::unique_ptr<GitRepository> m_repo;  //!< Repository of the revisions, opened on first use.
+  Side m_old;                             //!< Old snapshot.
+  Side m_new;                             //!< New snapshot.
+  std::vector<Pair> m_pairs;              //!< Every path, sorted.
+  std::size_t m_unchanged{ 0 };           //!< Unchanged source files seen by compare().
+  std::string m_error;                    //!< Why listing failed, empty on success.
+};
+
+//== Functions
+
+/**
+ * @brief Print the table of changed lines.
+ *
+ * Detailed documentation for this function is provided in the implementation file.
+ *
+ * @see print_delta_summary()
+ */
+void print_delta_summary(const std::vector<FileDelta>& deltas, std::size_t unchanged);
+
+#endif
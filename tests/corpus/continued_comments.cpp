@@ -0,0 +1,12 @@
+int before = 0;
+
+// a comment \
+continued on this line
+int code = 1;
+/// a doc comment \
+  continued too
+//! another doc comment
+// a backslash followed by spaces \   
+still the comment
+// but a backslash in the middle \ does not continue
+int done = 2;
@@ -0,0 +1,9 @@
+// Digit separators are not character literals.
+long million = 1'000'000;
+int mask = 0b1010'1010;
+unsigned hex = 0xFF'FF;
+double pi = 3.141'592;
+char quote = '"'; int after_quote = 1'0;
+
+/** Doc comment after the separators. */
+long big = 1'000;
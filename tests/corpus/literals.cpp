@@ -0,0 +1,14 @@
+#include <cstdio>
+
+char quote = '"';
+char backslash = '\\';
+const char* ends_with_backslash = "a\\"; // a comment after it
+const char* escaped_quote = "say \"hi\" // not a comment";
+const char* not_a_comment = "/* still a string */";
+const char* continued = "first half \
+second half"; int after = 0;
+
+/* a "quote" in a comment */
+int x = 1; /* and a ' in another */
+const char* empty = "";
+char single = '\'';
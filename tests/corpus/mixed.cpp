@@ -0,0 +1,11 @@
+/**
+ * @brief Doc comment block.
+ */
+int main(){ /// trailing doc comment
+    /* block */ int x = 0; // and a line comment
+
+    /*
+       multi-line comment
+
+    */
+    return x; /*! doc */ }
@@ -0,0 +1,16 @@
+#include <string>
+
+// Raw strings end only at their own delimiter.
+const char* a = R"(no "escape" \ here)";
+const char* b = R"x(
+  a ")" does not end it, nor )y" or )"
+  /* not a comment */
+  // nor this
+)x";
+int after_b = 1;
+
+const char* c = u8R"--(one line)--"; int after_c = 2;
+const char* d = LR"(
+)"; /* a comment after it */
+
+auto e = R"delim(")delim"; // a quote inside
@@ -0,0 +1,198 @@
+/*!
+ * @file count_daemon_tests.cpp
+ * @description
+ * The daemon of `--daemon` (CountDaemon) serving a scratch directory:
+ * after batches of added, removed and rewritten files, the records it
+ * answers with must be those on disk, and each sorted view it keeps must
+ * be in the order a full sort gives.
+ */
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/main.hpp"
+#include "../src/count_daemon.hpp"
+#include "../src/record_sort.hpp"
+#include "test_main.hpp"
+
+namespace {
+
+/// @brief A row of a `--format csv` answer: the name, the language, then the counts.
+using Row = std::vector<std::string>;
+
+/**
+ * @brief Send a request to the daemon and return its answer.
+ *
+ * query_daemon() prints the answer; the standard output is redirected
+ * meanwhile.
+ */
+std::string query(const std::string& socket_path, const std::string& request) {
+  std::ostringstream answer;
+  std::streambuf* stdout_buffer = std::cout.rdbuf(answer.rdbuf());
+  std::string error;
+  bool ok = query_daemon(socket_path, request, error);
+  std::cout.rdbuf(stdout_buffer);
+  return ok ? answer.str() : "error: " + error + answer.str();
+}
+
+/// @brief Rows of a CSV answer without its header; the test names need no quoting.
+std::vector<Row> read_rows(const std::string& csv) {
+  std::vector<Row> rows;
+  std::istringstream lines(csv);
+  std::string line;
+  std::getline(lines, line); //header
+  while (std::getline(lines, line)) {
+    Row row;
+    std::istringstream fields(line);
+    for (std::string field; std::getline(fields, field, ',');) row.push_back(field);
+    rows.push_back(row);
+  }
+  return rows;
+}
+
+/// @brief The language named in a report.
+lang_type_e language_of(const std::string& name) {
+  for (int type{ C }; type < UNDEF; ++type) {
+    if (language_name(static_cast<lang_type_e>(type)) == name) return static_cast<lang_type_e>(type);
+  }
+  return UNDEF;
+}
+
+/**
+ * @brief The rows in the order of a full sort: a stable sort on the keys, then on the name.
+ *
+ * @param rows Rows of `files --format csv`, which must have 7 fields each.
+ */
+std::vector<Row> sorted_rows(const std::vector<Row>& rows, const std::vector<sorting_arg>& keys, bool ascending) {
+  std::vector<FileInfo> db;
+  for (const Row& row : rows) {
+    FileInfo info(row[0], language_of(row[1]), std::stoull(row[4]), std::stoull(row[2]), std::stoull(row[5]), std::stoull(row[6]));
+    info.n_doc_comments = std::stoull(row[3]);
+    db.push_back(info);
+  }
+  std::vector<std::size_t> order(db.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](std::size_t x, std::size_t y) {
+    if (compare_files(db[x], db[y], keys, ascending)) return true;
+    if (compare_files(db[y], db[x], keys, ascending)) return false;
+    return db[x].filename < db[y].filename;
+  });
+  std::vector<Row> sorted;
+  for (std::size_t index : order) sorted.push_back(rows[index]);
+  return sorted;
+}
+
+/// @brief A random source file with few distinct counts, so that records tie.
+std::string make_source(std::mt19937& random, bool python) {
+  std::string text;
+  for (std::size_t i = random() % 4; i > 0; --i) text += python ? "x = 1\n" : "int x;\n";
+  for (std::size_t i = random() % 3; i > 0; --i) text += python ? "# note\n" : "// note\n";
+  for (std::size_t i = python ? 0 : random() % 2; i > 0; --i) text += "/// doc\n";
+  for (std::size_t i = random() % 2; i > 0; --i) text += "\n";
+  return text;
+}
+
+/// @brief A sort order kept by the daemon, and its request.
+struct ViewCase {
+  std::string request;           //!< `-s`/`-S` and the keys.
+  std::vector<sorting_arg> keys; //!< Sort keys.
+  bool ascending;                //!< Sort direction.
+};
+
+/**
+ * @brief Sorted views after batches of added, removed and rewritten files.
+ *
+ * Each view is asked for before the first batch, so that every later
+ * answer comes from a view the batches updated in place.
+ */
+void views_test(TestReport& report) {
+  ScratchDir dir("daemon"), socket_dir("daemon_socket");
+  std::string socket_path = (socket_dir.path() / "socket").string();
+  std::mt19937 random(20251021);
+  std::map<std::string, std::string> files; //name, content; as the daemon should see them
+  std::size_t serial{ 0 };
+  auto add = [&] {
+    bool python = random() % 3 == 0;
+    std::string name = "f" + std::to_string(serial++) + (python ? ".py" : ".cpp");
+    files[name] = make_source(random, python);
+    dir.write(name, files[name]);
+  };
+  for (std::size_t i{ 0 }; i < 40; ++i) add();
+
+  RunningOpt options;
+  options.directory_list = { dir.path().string() };
+  options.jobs = 2;
+  CountDaemon daemon(socket_path);
+  daemon.start(options, nullptr, nullptr);
+  if (!report.check(daemon.ok(), "daemon not started: " + daemon.error())) return;
+  std::thread server([&daemon] { daemon.serve(); });
+
+  const std::vector<ViewCase> views = {
+    { "-s c", { c }, true },
+    { "-S b,f", { b, f }, false },
+    { "-s t,b,d", { t, b, d }, true },
+    { "-S a,s", { a, s }, false },
+  };
+  for (const ViewCase& view : views) query(socket_path, "files " + view.request);
+
+  for (std::size_t batch{ 0 }; batch <= 30; ++batch) {
+    if (batch > 0) {
+      for (std::size_t edit = 1 + random() % 6; edit > 0; --edit) {
+        if (files.empty()) {
+          add();
+          continue;
+        }
+        auto victim = files.begin();
+        std::advance(victim, random() % files.size());
+        switch (random() % 3) {
+        case 0:
+          add();
+          break;
+        case 1:
+          std::filesystem::remove(dir.path() / victim->first);
+          files.erase(victim);
+          break;
+        default:
+          victim->second = make_source(random, victim->first.back() == 'y');
+          dir.write(victim->first, victim->second);
+        }
+      }
+    }
+
+    std::string label = "batch " + std::to_string(batch);
+    std::vector<Row> rows = read_rows(query(socket_path, "files --format csv"));
+    std::vector<std::string> names, expected_names;
+    for (const Row& row : rows) names.push_back(row.size() == 7 ? std::filesystem::path(row[0]).filename().string() : "?");
+    for (const auto& file : files) expected_names.push_back(file.first);
+    std::sort(names.begin(), names.end());
+    if (!report.check(names == expected_names, label + ": " + std::to_string(names.size()) + " records for "
+                                                 + std::to_string(expected_names.size()) + " files"))
+      break;
+    for (const ViewCase& view : views) {
+      std::vector<Row> answer = read_rows(query(socket_path, "files " + view.request + " --format csv"));
+      report.check(answer == sorted_rows(rows, view.keys, view.ascending), label + ", files " + view.request + ": out of order");
+    }
+  }
+
+  query(socket_path, "shutdown");
+  server.join();
+}
+
+}  // namespace
+
+/**
+ * @brief Tests of the daemon of `--daemon`.
+ *
+ * @param tests Receives the tests.
+ */
+void add_count_daemon_tests(std::vector<TestCase>& tests) {
+  tests.push_back({ "daemon/views", views_test });
+}
@@ -0,0 +1,222 @@
+/*!
+ * @file git_repo_tests.cpp
+ * @description
+ * The git reader of `--git` (GitRepository) checked against git itself,
+ * on a fixture repository built by the git binary: index versions 2 and
+ * 4, revisions with `~`, `^` and `^N` through loose, packed and symbolic
+ * refs, annotated tags, trees and blobs, loose and packed.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/main.hpp"
+#include "../src/git_repo.hpp"
+#include "test_main.hpp"
+
+namespace {
+
+/// @brief Lower-case hex name of an object.
+std::string hex(const ObjectId& id) {
+  static constexpr char DIGITS[] = "0123456789abcdef";
+  std::string text;
+  for (std::uint8_t byte : id.bytes) {
+    text += DIGITS[byte >> 4];
+    text += DIGITS[byte & 0xf];
+  }
+  return text;
+}
+
+/**
+ * @class Fixture
+ * @brief A repository built by the git binary, away from the configuration of the user.
+ */
+class Fixture {
+public:
+  Fixture() : m_dir("git") {}
+
+  /// @brief Top of the work tree.
+  std::string top() const { return m_dir.path().string(); }
+
+  /// @brief Write a file of the work tree.
+  void write(const std::string& name, const std::string& content) const { m_dir.write(name, content); }
+
+  /**
+   * @brief Run git in the work tree.
+   * @param args Arguments, quoted for the shell.
+   * @param output Receives what git printed on stdout, if not null.
+   * @return Whether git succeeded.
+   */
+  bool git(const std::string& args, std::string* output = nullptr) const {
+    std::string out_file = (m_dir.path() / ".git-output").string();
+    std::string command = "cd '" + top() + "' && HOME='" + top() + "' GIT_CONFIG_NOSYSTEM=1 GIT_CONFIG_GLOBAL=/dev/null '"
+                          + std::string(SLOC_TEST_GIT) + "' -c user.name=sloc -c user.email=sloc@example.com"
+                          + " -c init.defaultBranch=main -c commit.gpgsign=false -c tag.gpgsign=false -c gc.auto=0 "
+                          + args + " > '" + out_file + "' 2>/dev/null";
+    bool ok = std::system(command.c_str()) == 0;
+    if (output != nullptr) {
+      std::ifstream in(out_file, std::ios::binary);
+      std::ostringstream text;
+      text << in.rdbuf();
+      *output = text.str();
+    }
+    std::remove(out_file.c_str());
+    return ok;
+  }
+
+  /// @brief What `git rev-parse --verify -q` says a revision is, or "" if nothing.
+  std::string rev_parse(const std::string& rev) const {
+    std::string out;
+    if (!git("rev-parse --verify -q '" + rev + "'", &out)) return {};
+    while (!out.empty() && out.back() == '\n') out.pop_back();
+    return out;
+  }
+
+private:
+  ScratchDir m_dir; //!< The work tree.
+};
+
+/**
+ * @brief Build the history of the fixture.
+ *
+ * Three commits on main, one of them merging a side branch, an annotated
+ * tag, a symlink, a path with a space, a deleted file and an executable
+ * file. The first commits are packed and their refs moved to packed-refs;
+ * the last ones stay loose.
+ */
+bool build_history(const Fixture& repo) {
+  repo.write("a.cpp", "int a = 0;\n");
+  repo.write("src/b.py", "b = 1\n");
+  repo.write("dir with space/c.h", "// c\n");
+  repo.write("run.sh", "#!/bin/sh\necho run\n");
+  bool ok = repo.git("init -q") && repo.git("add .") && repo.git("update-index --chmod=+x run.sh")
+            && repo.git("commit -q -m one") && repo.git("tag -a v1 -m 'version 1'") && repo.git("checkout -q -b side");
+  repo.write("side.go", "package side\n");
+  ok = ok && repo.git("add side.go") && repo.git("commit -q -m side") && repo.git("checkout -q main");
+  repo.write("a.cpp", "int a = 0;\nint a2 = 2;\n");
+  repo.write("d.rs", "fn d() {}\n");
+  ok = ok && repo.git("rm -q src/b.py") && repo.git("add a.cpp d.rs") && repo.git("commit -q -m two")
+       && repo.git("gc -q");
+  repo.write("a.cpp", "int a = 0;\nint a2 = 2;\nint a3 = 3;\n");
+  ok = ok && repo.git("add a.cpp") && repo.git("commit -q -m three")
+       && repo.git("merge -q --no-ff --no-edit side") && repo.git("branch -q old HEAD~2")
+       && std::system(("ln -s a.cpp '" + repo.top() + "/link.cpp'").c_str()) == 0 && repo.git("add link.cpp")
+       && repo.git("commit -q -m link");
+  return ok;
+}
+
+/**
+ * @brief Parse `git ls-files -s -z` or `git ls-tree -r -z`, keeping regular files only.
+ *
+ * @param output What git printed: `<mode> <...> <id><sep><...>\t<path>\0` records.
+ * @param id_field Index of the object name among the space-separated fields.
+ */
+std::vector<std::pair<std::string, std::string>> parse_listing(const std::string& output, std::size_t id_field) {
+  std::vector<std::pair<std::string, std::string>> files;
+  std::size_t begin{ 0 };
+  while (begin < output.size()) {
+    std::size_t end = output.find('\0', begin);
+    if (end == std::string::npos) end = output.size();
+    std::string record = output.substr(begin, end - begin);
+    begin = end + 1;
+    std::size_t tab = record.find('\t');
+    std::istringstream fields(record.substr(0, tab));
+    std::vector<std::string> parts;
+    for (std::string part; fields >> part;) parts.push_back(part);
+    if (tab == std::string::npos || parts.size() <= id_field || parts[0].compare(0, 3, "100") != 0) continue;
+    files.emplace_back(record.substr(tab + 1), parts[id_field]);
+  }
+  return files;
+}
+
+/// @brief Paths and object names of index or tree entries.
+std::vector<std::pair<std::string, std::string>> listing_of(const std::vector<GitEntry>& entries) {
+  std::vector<std::pair<std::string, std::string>> files;
+  for (const auto& entry : entries) files.emplace_back(entry.path, hex(entry.id));
+  return files;
+}
+
+/**
+ * @brief The index, in versions 2 and 4, against `git ls-files -s`.
+ */
+void index_test(TestReport& report) {
+  Fixture repo;
+  if (!report.check(build_history(repo), "the fixture repository could not be built with " + std::string(SLOC_TEST_GIT))) return;
+
+  for (const char* version : { "2", "4" }) {
+    std::string label = std::string("index version ") + version;
+    if (!report.check(repo.git(std::string("update-index --index-version ") + version), label + ": not written by git")) continue;
+    std::string output;
+    repo.git("ls-files -s -z", &output);
+    auto expected = parse_listing(output, 1);
+
+    GitRepository git_repo(repo.top() + "/dir with space");
+    if (!report.check(git_repo.ok(), label + ": repository not found from a sub-directory")) return;
+    std::vector<GitEntry> entries;
+    report.check(git_repo.read_index(entries), label + ": not read");
+    report.check(listing_of(entries) == expected,
+                 label + ": " + std::to_string(entries.size()) + " entries, git has " + std::to_string(expected.size()));
+    for (const auto& entry : entries) {
+      if (entry.path != "a.cpp") continue;
+      git_object_e type{ GIT_NONE };
+      std::string data;
+      report.check(git_repo.read_object(entry.id, type, data) && type == GIT_BLOB
+                     && data == "int a = 0;\nint a2 = 2;\nint a3 = 3;\n",
+                   label + ": blob of a.cpp");
+    }
+  }
+}
+
+/**
+ * @brief Revisions and trees against `git rev-parse` and `git ls-tree`.
+ */
+void revision_test(TestReport& report) {
+  Fixture repo;
+  if (!report.check(build_history(repo), "the fixture repository could not be built with " + std::string(SLOC_TEST_GIT))) return;
+  GitRepository git_repo(repo.top());
+  if (!report.check(git_repo.ok(), "repository not found")) return;
+
+  std::string abbreviated = repo.rev_parse("HEAD~1").substr(0, 7);
+  const std::vector<std::string> revisions = { "HEAD",    "@",      "main", "HEAD~1",     "HEAD^",           "HEAD~2",
+                                               "HEAD~1^2", "HEAD^^2", "HEAD~1^1~1", "HEAD~3", "v1",   "v1~0",
+                                               "side",    "side~1", "old",  "heads/main", "refs/heads/main", "tags/v1",
+                                               abbreviated, abbreviated + "~1" };
+  for (const std::string& rev : revisions) {
+    ObjectId id;
+    std::string expected = repo.rev_parse(rev);
+    bool found = git_repo.resolve(rev, id);
+    report.check(found && hex(id) == expected,
+                 "resolve(\"" + rev + "\"): " + (found ? hex(id) : std::string("nothing")) + ", git says " + expected);
+  }
+  for (const std::string rev : { "nothing", "HEAD~9", "HEAD~1^3", "v2" }) {
+    ObjectId id;
+    report.check(!git_repo.resolve(rev, id), "resolve(\"" + rev + "\") found " + hex(id));
+  }
+
+  for (const std::string rev : { "HEAD", "HEAD~1", "HEAD~2", "v1" }) {
+    ObjectId id;
+    std::vector<GitEntry> entries;
+    bool ok = git_repo.resolve(rev, id) && git_repo.list_tree(id, [](std::string_view) { return true; }, entries);
+    std::string output;
+    repo.git("ls-tree -r -z '" + rev + "'", &output);
+    auto expected = parse_listing(output, 2);
+    report.check(ok && listing_of(entries) == expected, "tree of " + rev + ": " + std::to_string(entries.size())
+                                                          + " files, git has " + std::to_string(expected.size()));
+  }
+}
+
+}  // namespace
+
+/**
+ * @brief Tests of the git reader.
+ *
+ * @param tests Receives the tests.
+ */
+void add_git_repo_tests(std::vector<TestCase>& tests) {
+  tests.push_back({ "git/index", index_test });
+  tests.push_back({ "git/revision", revision_test });
+}
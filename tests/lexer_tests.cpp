@@ -0,0 +1,154 @@
+/*!
+ * @file lexer_tests.cpp
+ * @description
+ * The table-driven C/C++ lexer (count_buffer()) checked against the
+ * per-line reference (count_buffer_by_lines()): on the files of
+ * tests/corpus, whose counts are also known, and on random snippets made
+ * of the pieces that are easy to get wrong.
+ */
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "../src/main.hpp"
+#include "../src/file_reader.hpp"
+#include "test_main.hpp"
+
+namespace {
+
+/**
+ * @struct CorpusFile
+ * @brief A file of tests/corpus and its counts, checked by hand.
+ */
+struct CorpusFile {
+  const char* name;      //!< File name in tests/corpus.
+  AttributeCount counts; //!< Its counts.
+};
+
+/// @brief Text of counts, for failure messages.
+std::string describe(const AttributeCount& counts) {
+  return "lines " + std::to_string(counts.lines) + ", blank " + std::to_string(counts.blank) + ", code "
+         + std::to_string(counts.loc) + ", comments " + std::to_string(counts.com) + ", doc "
+         + std::to_string(counts.dox);
+}
+
+/// @brief Whether two counts are the same.
+bool same(const AttributeCount& a, const AttributeCount& b) {
+  return a.lines == b.lines && a.blank == b.blank && a.loc == b.loc && a.com == b.com && a.dox == b.dox;
+}
+
+/// @brief Counts of a buffer with the lexer, from the start state.
+AttributeCount lexed(std::string_view buffer, CurrentCount& state) {
+  AttributeCount counts;
+  return count_buffer(buffer, state, counts);
+}
+
+/// @brief Counts of a buffer with the per-line reference, from the start state.
+AttributeCount by_lines(std::string_view buffer, CurrentCount& state) {
+  AttributeCount counts;
+  return count_buffer_by_lines(buffer, state, counts);
+}
+
+/**
+ * @brief Check the lexer against the reference on a buffer.
+ *
+ * Both must give the same counts and end in the same state; the lexer must
+ * also give the same counts when the buffer is fed to it in two parts cut
+ * at each line start, the state of the first part carried to the second.
+ */
+void check_buffer(TestReport& report, std::string_view buffer, const std::string& label, bool each_line) {
+  CurrentCount lexer_state, reference_state;
+  AttributeCount expected = by_lines(buffer, reference_state);
+  AttributeCount got = lexed(buffer, lexer_state);
+  report.check(same(got, expected), label + ": lexer gives " + describe(got) + ", reference " + describe(expected));
+  report.check(lexer_state.current_state == reference_state.current_state
+                 && lexer_state.raw_delimiter == reference_state.raw_delimiter,
+               label + ": lexer and reference end in different states");
+  if (!each_line) return;
+
+  for (std::size_t cut = buffer.find('\n'); cut != std::string_view::npos; cut = buffer.find('\n', cut + 1)) {
+    CurrentCount state;
+    AttributeCount parts = lexed(buffer.substr(0, cut + 1), state);
+    parts += lexed(buffer.substr(cut + 1), state);
+    report.check(same(parts, expected), label + ": cut after byte " + std::to_string(cut) + " gives " + describe(parts));
+  }
+}
+
+/**
+ * @brief The lexer against the reference, and both against the known counts, on tests/corpus.
+ *
+ * The files hold raw strings with misleading contents, `'"'`, `"a\\"`,
+ * escaped quotes, backslash-continued strings and `//` comments (with
+ * spaces after the backslash too), digit separators, and code around
+ * block and doc comments.
+ */
+void corpus_test(TestReport& report) {
+  auto counts = [](count_t lines, count_t blank, count_t loc, count_t com, count_t dox) {
+    AttributeCount result;
+    result.lines = lines;
+    result.blank = blank;
+    result.loc = loc;
+    result.com = com;
+    result.dox = dox;
+    return result;
+  };
+  const CorpusFile files[] = {
+    { "raw_strings.cpp", counts(16, 3, 12, 3, 0) },
+    { "literals.cpp", counts(14, 2, 11, 3, 0) },
+    { "continued_comments.cpp", counts(12, 1, 3, 5, 3) },
+    { "digit_separators.cpp", counts(9, 1, 6, 1, 1) },
+    { "mixed.cpp", counts(11, 1, 3, 5, 5) },
+  };
+
+  for (const auto& file : files) {
+    std::string path = std::string(SLOC_TEST_CORPUS) + "/" + file.name;
+    FileBuffer buffer(path);
+    if (!report.check(buffer.ok(), path + ": unreadable")) continue;
+
+    CurrentCount state;
+    AttributeCount got = lexed(buffer.view(), state);
+    report.check(same(got, file.counts), std::string(file.name) + ": " + describe(got) + ", expected " + describe(file.counts));
+    check_buffer(report, buffer.view(), file.name, true);
+  }
+}
+
+/**
+ * @brief The lexer against the reference on random snippets.
+ *
+ * Snippets are drawn, with a fixed seed, from the pieces where the two
+ * are most likely to part ways: quotes, backslashes before newlines,
+ * raw string openers and closers, comment markers and CRLF line ends.
+ */
+void random_test(TestReport& report) {
+  static const std::string_view pieces[] = {
+    "\"", "'", "\\", "\n", "\r\n", "\\\n", "\\  \n", " ", "\t", "a", "R", "1'000", "'\"'", "\"a\\\\\"",
+    "R\"(", ")\"", "R\"x(", ")x\"", "u8R\"--(", ")--\"", "(", ")", "//", "///", "//!", "/*", "/**", "/*!",
+    "*/", "*", "/", "#include <x>", "int x = 0;",
+  };
+  std::mt19937 random(20251018);
+  std::uniform_int_distribution<std::size_t> piece(0, std::size(pieces) - 1);
+  std::uniform_int_distribution<std::size_t> length(1, 24);
+
+  std::string snippet;
+  for (std::size_t i{ 0 }; i < 100000; ++i) {
+    snippet.clear();
+    for (std::size_t n = length(random); n > 0; --n) snippet += pieces[piece(random)];
+    std::size_t failures = report.failures;
+    check_buffer(report, snippet, "snippet " + std::to_string(i), false);
+    if (report.failures > failures && report.failures <= 20) std::cout << "    in: \"" << snippet << "\"\n";
+  }
+}
+
+}  // namespace
+
+/**
+ * @brief Tests of the C/C++ lexer against the per-line reference.
+ *
+ * @param tests Receives the tests.
+ */
+void add_lexer_tests(std::vector<TestCase>& tests) {
+  tests.push_back({ "lexer/corpus", corpus_test });
+  tests.push_back({ "lexer/random", random_test });
+}
@@ -0,0 +1,115 @@
+/*!
+ * @file library_tests.cpp
+ * @description
+ * The API of libsloc (libsloc.hpp), used the way an embedding program
+ * would: through that header and thread_pool.hpp only, with the counts of
+ * the files of tests/corpus, checked by hand, as the reference.
+ */
+
+#include <string>
+#include <vector>
+
+#include "../src/libsloc.hpp"
+#include "../src/thread_pool.hpp"
+#include "test_main.hpp"
+
+#ifdef SLOC_HPP
+#error "libsloc.hpp must not expose main.hpp to the programs that embed the library"
+#endif
+
+namespace {
+
+/// @brief Text of counts, for failure messages.
+std::string describe(const sloc::LineCounts& counts) {
+  return "lines " + std::to_string(counts.lines) + ", blank " + std::to_string(counts.blank) + ", code "
+         + std::to_string(counts.code) + ", comments " + std::to_string(counts.comments) + ", doc "
+         + std::to_string(counts.doc_comments);
+}
+
+/// @brief Whether counts are the ones given.
+bool counts_are(const sloc::LineCounts& counts, sloc::count_t lines, sloc::count_t blank, sloc::count_t code,
+                sloc::count_t comments, sloc::count_t doc_comments) {
+  return counts.lines == lines && counts.blank == blank && counts.code == code && counts.comments == comments
+         && counts.doc_comments == doc_comments;
+}
+
+/// @brief Path of a file of tests/corpus.
+std::string corpus(const char* name) { return std::string(SLOC_TEST_CORPUS) + "/" + name; }
+
+/**
+ * @brief Counts of buffers in several languages, with and without a pool.
+ */
+void buffer_test(TestReport& report) {
+  const std::string cpp = "/// doc\nint a = 0; // note\n\n/* block\n   comment */\nint b = 1;\n";
+  sloc::LineCounts counts = sloc::count_buffer(cpp, sloc::lang_type_e::CPP);
+  report.check(counts_are(counts, 6, 1, 2, 3, 1), "C++ buffer: " + describe(counts));
+
+  ThreadPool pool(2);
+  sloc::LineCounts pooled = sloc::count_buffer(cpp, sloc::lang_type_e::CPP, &pool);
+  report.check(counts_are(pooled, 6, 1, 2, 3, 1), "C++ buffer with a pool: " + describe(pooled));
+
+  const std::string python = "def f():\n    \"\"\"Doc.\"\"\"\n    return 1  # one\n\n# end\n";
+  counts = sloc::count_buffer(python, sloc::lang_type_e::PYTHON);
+  report.check(counts_are(counts, 5, 1, 2, 2, 1), "Python buffer: " + describe(counts));
+
+  counts = sloc::count_buffer(cpp, sloc::lang_type_e::UNDEF);
+  report.check(counts_are(counts, 0, 0, 0, 0, 0), "buffer of no language: " + describe(counts));
+}
+
+/**
+ * @brief Language and counts of files found by name and by content, and of a missing file.
+ */
+void file_test(TestReport& report) {
+  sloc::FileCount file = sloc::count_file(corpus("raw_strings.cpp"));
+  report.check(file.readable && file.type == sloc::lang_type_e::CPP && file.confidence == sloc::lang_confidence_e::CERTAIN,
+               "raw_strings.cpp: not a readable C++ file found by name");
+  report.check(counts_are(file.counts, 16, 3, 12, 3, 0), "raw_strings.cpp: " + describe(file.counts));
+
+  ScratchDir dir("library");
+  file = sloc::count_file(dir.write("script", "#!/usr/bin/env python3\n# comment\n\nprint(1)\n"));
+  report.check(file.readable && file.type == sloc::lang_type_e::PYTHON && file.confidence == sloc::lang_confidence_e::HIGH,
+               "script: not a Python file found by its shebang");
+  report.check(counts_are(file.counts, 4, 1, 1, 2, 0), "script: " + describe(file.counts));
+
+  file = sloc::count_file(dir.write("notes.txt", "plain text\n"));
+  report.check(file.type == sloc::lang_type_e::UNDEF && counts_are(file.counts, 0, 0, 0, 0, 0),
+               "notes.txt: counted as source code");
+
+  file = sloc::count_file((dir.path() / "missing.cpp").string());
+  report.check(!file.readable && counts_are(file.counts, 0, 0, 0, 0, 0), "missing.cpp: readable or counted");
+}
+
+/**
+ * @brief A batch with a missing file, counted in order, with and without a pool.
+ */
+void files_test(TestReport& report) {
+  const std::vector<std::string> paths = { corpus("literals.cpp"), corpus("missing.cpp"), corpus("mixed.cpp"),
+                                           corpus("continued_comments.cpp") };
+  ThreadPool pool(3);
+  for (ThreadPool* with : { static_cast<ThreadPool*>(nullptr), &pool }) {
+    std::string label = with == nullptr ? "without a pool" : "with a pool";
+    std::vector<sloc::FileCount> files = sloc::count_files(paths, with);
+    if (!report.check(files.size() == paths.size(), label + ": " + std::to_string(files.size()) + " results")) continue;
+    report.check(files[0].readable && counts_are(files[0].counts, 14, 2, 11, 3, 0),
+                 label + ": literals.cpp: " + describe(files[0].counts));
+    report.check(!files[1].readable && counts_are(files[1].counts, 0, 0, 0, 0, 0), label + ": missing.cpp is readable");
+    report.check(files[2].readable && counts_are(files[2].counts, 11, 1, 3, 5, 5),
+                 label + ": mixed.cpp: " + describe(files[2].counts));
+    report.check(files[3].readable && counts_are(files[3].counts, 12, 1, 3, 5, 3),
+                 label + ": continued_comments.cpp: " + describe(files[3].counts));
+  }
+  report.check(sloc::count_files({}, &pool).empty(), "empty batch: some results");
+}
+
+}  // namespace
+
+/**
+ * @brief Tests of the API of libsloc.
+ *
+ * @param tests Receives the tests.
+ */
+void add_library_tests(std::vector<TestCase>& tests) {
+  tests.push_back({ "library/buffer", buffer_test });
+  tests.push_back({ "library/file", file_test });
+  tests.push_back({ "library/files", files_test });
+}
@@ -0,0 +1,178 @@
+/*!
+ * @file line_diff_tests.cpp
+ * @description
+ * The line diff of `--diff` (diff_lines()) checked against a brute-force
+ * longest common subsequence on random files over a few distinct lines,
+ * and the pairing of removed and added lines of count_delta().
+ */
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/main.hpp"
+#include "../src/line_diff.hpp"
+#include "test_main.hpp"
+
+namespace {
+
+/// @brief Length of the longest common subsequence of two files, by dynamic programming.
+std::size_t lcs_length(const std::vector<std::string_view>& a, const std::vector<std::string_view>& b) {
+  std::vector<std::size_t> row(b.size() + 1, 0), next(b.size() + 1, 0);
+  for (std::size_t i{ a.size() }; i-- > 0;) {
+    for (std::size_t j{ b.size() }; j-- > 0;) next[j] = a[i] == b[j] ? row[j + 1] + 1 : std::max(row[j], next[j + 1]);
+    std::swap(row, next);
+  }
+  return row[0];
+}
+
+/**
+ * @brief Check that hunks are an edit script from one file to the other.
+ *
+ * The hunks must be in order, not empty, not touching each other, and the
+ * lines between them must be equal on both sides.
+ *
+ * @return An empty string, or what is wrong.
+ */
+std::string script_error(const std::vector<Hunk>& hunks, const std::vector<std::string_view>& a, const std::vector<std::string_view>& b) {
+  std::size_t i{ 0 }, j{ 0 };
+  for (const Hunk& hunk : hunks) {
+    if (hunk.old_begin > hunk.old_end || hunk.new_begin > hunk.new_end || hunk.old_end > a.size() || hunk.new_end > b.size())
+      return "hunk out of range";
+    if (hunk.old_begin == hunk.old_end && hunk.new_begin == hunk.new_end) return "empty hunk";
+    if (hunk.old_begin < i || hunk.new_begin < j) return "hunks out of order";
+    if (hunk.old_begin - i != hunk.new_begin - j) return "kept runs of different lengths";
+    if ((i > 0 || j > 0) && hunk.old_begin == i) return "hunks touching each other";
+    for (; i < hunk.old_begin; ++i, ++j) {
+      if (a[i] != b[j]) return "kept line " + std::to_string(i) + " differs";
+    }
+    i = hunk.old_end;
+    j = hunk.new_end;
+  }
+  if (a.size() - i != b.size() - j) return "kept tails of different lengths";
+  for (; i < a.size(); ++i, ++j) {
+    if (a[i] != b[j]) return "kept line " + std::to_string(i) + " differs";
+  }
+  return {};
+}
+
+/// @brief A random file over `alphabet` distinct lines.
+std::vector<std::string> make_file(std::mt19937& random, std::size_t n, std::size_t alphabet) {
+  std::vector<std::string> lines;
+  for (std::size_t i{ 0 }; i < n; ++i) lines.push_back("line " + std::to_string(random() % alphabet));
+  return lines;
+}
+
+/// @brief A file with random lines replaced, inserted and deleted.
+std::vector<std::string> edit_file(std::mt19937& random, std::vector<std::string> lines, std::size_t edits, std::size_t alphabet) {
+  for (std::size_t e{ 0 }; e < edits; ++e) {
+    std::size_t pos = random() % (lines.size() + 1);
+    std::string line = "line " + std::to_string(random() % alphabet);
+    switch (random() % 3) {
+    case 0:
+      lines.insert(lines.begin() + static_cast<std::ptrdiff_t>(pos), line);
+      break;
+    case 1:
+      if (pos < lines.size()) lines.erase(lines.begin() + static_cast<std::ptrdiff_t>(pos));
+      break;
+    default:
+      if (pos < lines.size()) lines[pos] = line;
+    }
+  }
+  return lines;
+}
+
+/// @brief Views of the lines of a file.
+std::vector<std::string_view> views(const std::vector<std::string>& lines) {
+  return std::vector<std::string_view>(lines.begin(), lines.end());
+}
+
+/**
+ * @brief Check the diff of two files: a valid script that keeps a longest common subsequence.
+ */
+void check_diff(TestReport& report, const std::vector<std::string>& old_file, const std::vector<std::string>& new_file, const std::string& label) {
+  std::vector<std::string_view> a = views(old_file), b = views(new_file);
+  std::vector<Hunk> hunks = diff_lines(a, b);
+  std::string error = script_error(hunks, a, b);
+  if (!report.check(error.empty(), label + ": " + error)) return;
+
+  std::size_t removed{ 0 }, added{ 0 };
+  for (const Hunk& hunk : hunks) {
+    removed += hunk.old_end - hunk.old_begin;
+    added += hunk.new_end - hunk.new_begin;
+  }
+  std::size_t common = lcs_length(a, b);
+  report.check(removed == a.size() - common && added == b.size() - common,
+               label + ": " + std::to_string(removed) + " removed and " + std::to_string(added) + " added lines, the shortest script has "
+                 + std::to_string(a.size() - common) + " and " + std::to_string(b.size() - common));
+
+  DeltaCount delta = count_delta(hunks, std::vector<std::uint8_t>(a.size(), LINE_CODE), std::vector<std::uint8_t>(b.size(), LINE_CODE));
+  report.check(delta.lines.removed + delta.lines.modified == removed && delta.lines.added + delta.lines.modified == added
+                 && delta.loc.removed == delta.lines.removed && delta.loc.added == delta.lines.added
+                 && delta.loc.modified == delta.lines.modified,
+               label + ": delta counts differ from the hunks");
+}
+
+/**
+ * @brief Unrelated random files, and random edits of a file, against the longest common subsequence.
+ */
+void random_test(TestReport& report) {
+  std::mt19937 random(20251020);
+  for (std::size_t alphabet : { 1, 2, 3, 8, 40 }) {
+    for (std::size_t trial{ 0 }; trial < 200; ++trial) {
+      std::vector<std::string> old_file = make_file(random, random() % 30, alphabet);
+      std::vector<std::string> new_file = trial % 2 == 0 ? make_file(random, random() % 30, alphabet)
+                                                         : edit_file(random, old_file, random() % 8, alphabet);
+      std::size_t failures = report.failures;
+      check_diff(report, old_file, new_file,
+                 std::to_string(old_file.size()) + " against " + std::to_string(new_file.size()) + " lines over "
+                   + std::to_string(alphabet) + " distinct ones");
+      if (report.failures != failures) break; //the other trials on this alphabet would only repeat it
+    }
+  }
+
+  for (std::size_t edits : { 1, 10, 100, 600 }) {
+    std::vector<std::string> old_file = make_file(random, 1500, 50);
+    check_diff(report, old_file, edit_file(random, old_file, edits, 50), std::to_string(edits) + " edits of 1500 lines");
+  }
+}
+
+/**
+ * @brief Removed and added lines of each kind paired up within a hunk, against counts by hand.
+ */
+void delta_test(TestReport& report) {
+  //old: code, code, code, blank, comment, code; new: code, code', code', code', code', blank, doc, code
+  const std::vector<std::string> old_file = { "int a;", "int b;", "int c;", "", "// c", "int z;" };
+  const std::vector<std::string> new_file = { "int a;", "int b2;", "int c2;", "int d;", "int e;", "", "/// d", "int z;" };
+  const std::vector<std::uint8_t> old_classes = { LINE_CODE, LINE_CODE, LINE_CODE, LINE_BLANK, LINE_COMMENT, LINE_CODE };
+  const std::vector<std::uint8_t> new_classes = { LINE_CODE, LINE_CODE, LINE_CODE, LINE_CODE,
+                                                  LINE_CODE, LINE_BLANK, LINE_DOC, LINE_CODE };
+  std::vector<Hunk> hunks = diff_lines(views(old_file), views(new_file));
+  if (!report.check(hunks.size() == 2, std::to_string(hunks.size()) + " hunks")) return;
+  report.check(hunks[0].old_begin == 1 && hunks[0].old_end == 3 && hunks[0].new_begin == 1 && hunks[0].new_end == 5, "first hunk");
+  report.check(hunks[1].old_begin == 4 && hunks[1].old_end == 5 && hunks[1].new_begin == 6 && hunks[1].new_end == 7, "second hunk");
+
+  DeltaCount delta = count_delta(hunks, old_classes, new_classes);
+  auto same = [](const LineDelta& got, count_t added, count_t removed, count_t modified) {
+    return got.added == added && got.removed == removed && got.modified == modified;
+  };
+  report.check(same(delta.lines, 2, 0, 3), "all lines");
+  report.check(same(delta.loc, 2, 0, 2), "code lines: 2 rewritten into 4");
+  report.check(same(delta.com, 0, 1, 0), "comment lines: one replaced by a doc line");
+  report.check(same(delta.dox, 1, 0, 0), "doc lines");
+  report.check(same(delta.blank, 0, 0, 0), "blank lines: kept");
+}
+
+}  // namespace
+
+/**
+ * @brief Tests of the line diff and of its delta counts.
+ *
+ * @param tests Receives the tests.
+ */
+void add_line_diff_tests(std::vector<TestCase>& tests) {
+  tests.push_back({ "diff/random", random_test });
+  tests.push_back({ "diff/delta", delta_test });
+}
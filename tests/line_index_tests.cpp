@@ -0,0 +1,174 @@
+/*!
+ * @file line_index_tests.cpp
+ * @description
+ * LineIndex::edit() checked against a LineIndex built afresh from the
+ * edited content, over random edits that open and close comments and
+ * strings, and on its checkpoints, which must hold the state a scan from
+ * the start reaches there.
+ */
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/main.hpp"
+#include "../src/file_reader.hpp"
+#include "../src/line_index.hpp"
+#include "test_main.hpp"
+
+namespace {
+
+/// @brief Size of the contents edited: a dozen checkpoints or so.
+constexpr std::size_t CONTENT_SIZE{ 48 * 1024 };
+
+/// @brief Text of counts, for failure messages.
+std::string describe(const AttributeCount& counts) {
+  return "lines " + std::to_string(counts.lines) + ", blank " + std::to_string(counts.blank) + ", code "
+         + std::to_string(counts.loc) + ", comments " + std::to_string(counts.com) + ", doc "
+         + std::to_string(counts.dox);
+}
+
+/// @brief Whether two counts are the same.
+bool same(const AttributeCount& a, const AttributeCount& b) {
+  return a.lines == b.lines && a.blank == b.blank && a.loc == b.loc && a.com == b.com && a.dox == b.dox;
+}
+
+/// @brief A body repeated up to CONTENT_SIZE.
+std::string repeat(std::string_view body) {
+  std::string content;
+  while (content.size() < CONTENT_SIZE) content += body;
+  return content;
+}
+
+/**
+ * @brief Check an index against one built afresh from its content.
+ *
+ * The line classes, counts and size must be those of the fresh index. The
+ * checkpoints may sit elsewhere, since an edit keeps those past the point
+ * where the state converged, but each must be at a line start, with its
+ * line number and the state a scan from the start has there.
+ */
+bool check_index(TestReport& report, const LineIndex& index, std::string_view content, const std::string& label) {
+  LineIndex fresh(index.type(), content);
+  bool ok = report.check(index.size() == content.size(), label + ": size " + std::to_string(index.size()) + ", content "
+                                                           + std::to_string(content.size()));
+  ok = report.check(same(index.counts(), fresh.counts()),
+                    label + ": edited gives " + describe(index.counts()) + ", fresh " + describe(fresh.counts()))
+       && ok;
+  ok = report.check(index.lines() == fresh.lines(), label + ": line classes differ from a fresh index") && ok;
+
+  const auto& checkpoints = index.checkpoints();
+  if (!report.check(!checkpoints.empty() && checkpoints.front().offset == 0, label + ": no checkpoint at offset 0")) return false;
+  LineState state;
+  std::vector<std::uint8_t> lines;
+  for (std::size_t i{ 1 }; i < checkpoints.size(); ++i) {
+    const LineCheckpoint& checkpoint = checkpoints[i];
+    std::string at = label + ": checkpoint " + std::to_string(i) + " at " + std::to_string(checkpoint.offset);
+    if (!report.check(checkpoint.offset > checkpoints[i - 1].offset && checkpoint.offset < content.size()
+                        && content[checkpoint.offset - 1] == '\n',
+                      at + " is not a line start after the previous one"))
+      return false;
+    classify_language(index.type(), content.substr(checkpoints[i - 1].offset, checkpoint.offset - checkpoints[i - 1].offset),
+                      state, lines);
+    ok = report.check(checkpoint.line == lines.size(),
+                      at + ": line " + std::to_string(checkpoint.line) + ", scan " + std::to_string(lines.size()))
+         && ok;
+    ok = report.check(checkpoint.state.same_as(state), at + ": state differs from a scan from the start") && ok;
+  }
+  return ok;
+}
+
+/**
+ * @brief Apply random edits to a content, checking the index after each.
+ *
+ * Edits are drawn with a fixed seed: a few bytes removed anywhere and
+ * replaced with pieces that open or close comments and strings, so the
+ * state often changes for the rest of the content, or with plain code,
+ * so it often converges right after the edit.
+ */
+void check_edits(TestReport& report, lang_type_e lang_type, std::string content, std::initializer_list<std::string_view> pieces,
+                 const std::string& label, unsigned seed) {
+  const std::vector<std::string_view> choices(pieces);
+  std::mt19937 random(seed);
+  std::uniform_int_distribution<std::size_t> piece(0, choices.size() - 1);
+  std::uniform_int_distribution<std::size_t> count(0, 3);
+  std::uniform_int_distribution<std::size_t> removed(0, 48);
+
+  LineIndex index(lang_type, content);
+  check_index(report, index, content, label + " before any edit");
+  for (std::size_t i{ 0 }; i < 400; ++i) {
+    std::size_t offset = std::uniform_int_distribution<std::size_t>(0, content.size())(random);
+    std::size_t length = std::min(removed(random), content.size() - offset);
+    std::string inserted;
+    for (std::size_t n = count(random); n > 0; --n) inserted += choices[piece(random)];
+
+    content.replace(offset, length, inserted);
+    index.edit(content, offset, length, inserted.size());
+    if (!check_index(report, index, content,
+                     label + " edit " + std::to_string(i) + " (" + std::to_string(length) + " bytes at "
+                       + std::to_string(offset) + " replaced with \"" + inserted + "\")"))
+      return; //the next edits would only repeat the failure
+  }
+}
+
+/**
+ * @brief Random edits of C++ content: the files of tests/corpus repeated.
+ */
+void cpp_test(TestReport& report) {
+  std::string body;
+  for (const char* name : { "raw_strings.cpp", "literals.cpp", "continued_comments.cpp", "digit_separators.cpp", "mixed.cpp" }) {
+    FileBuffer file(std::string(SLOC_TEST_CORPUS) + "/" + name);
+    if (!report.check(file.ok(), std::string(name) + ": unreadable")) return;
+    body += file.view();
+  }
+  check_edits(report, CPP, repeat(body),
+              { "\n", "/*", "*/", "/**", "//", "///", "\\\n", "\"", "'\"'", "R\"x(", ")x\"", "int x = 0;\n", " " }, "C++",
+              20251018);
+}
+
+/**
+ * @brief Random edits of Python content, with docstrings and `#` comments.
+ */
+void python_test(TestReport& report) {
+  check_edits(report, PYTHON, repeat("def f(x):\n    \"\"\"Doc of f.\n\n    More.\n    \"\"\"\n    y = '#'  # note\n\n    return x\n"),
+              { "\n", "\"\"\"", "'''", "#", "\"", "'", "\\\n", "x = 1\n", " " }, "Python", 20251019);
+}
+
+/**
+ * @brief An edit that does not change the state rescans a few checkpoints, not the whole content.
+ */
+void local_test(TestReport& report) {
+  std::string content = repeat("int a = 0; // a\n");
+  LineIndex index(CPP, content);
+  std::size_t offset = content.size() / 2;
+  offset = content.find('\n', offset) + 1;
+  content.insert(offset, "int b = 1;\n");
+  std::size_t scanned = index.edit(content, offset, 0, 11);
+  report.check(scanned <= 3 * LineIndex::CHECKPOINT_SPACING,
+               "one new line of code rescans " + std::to_string(scanned) + " bytes of " + std::to_string(content.size()));
+  check_index(report, index, content, "local edit");
+
+  content.insert(offset, "/*");
+  scanned = index.edit(content, offset, 0, 2);
+  report.check(scanned >= content.size() - offset, "an opened comment only rescans " + std::to_string(scanned) + " bytes");
+  check_index(report, index, content, "opened comment");
+
+  std::string rebuilt = content.substr(0, offset);
+  index.edit(rebuilt, offset, 5, 0); //does not fit the content: rebuilds
+  check_index(report, index, rebuilt, "mismatched edit");
+}
+
+}  // namespace
+
+/**
+ * @brief Tests of the incremental line index.
+ *
+ * @param tests Receives the tests.
+ */
+void add_line_index_tests(std::vector<TestCase>& tests) {
+  tests.push_back({ "line_index/cpp", cpp_test });
+  tests.push_back({ "line_index/python", python_test });
+  tests.push_back({ "line_index/local", local_test });
+}
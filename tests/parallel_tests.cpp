@@ -0,0 +1,114 @@
+/*!
+ * @file parallel_tests.cpp
+ * @description
+ * count_buffer_parallel() checked against a sequential count, on buffers
+ * big enough to be split into chunks and built so that the cuts between
+ * chunks fall inside raw strings, comments and continued literals.
+ */
+
+#include <string>
+#include <string_view>
+
+#include "../src/main.hpp"
+#include "../src/file_reader.hpp"
+#include "../src/thread_pool.hpp"
+#include "test_main.hpp"
+
+namespace {
+
+/// @brief Size of the test buffers: enough for three chunks of at least 4 MiB.
+constexpr std::size_t BUFFER_SIZE{ 12 * 1024 * 1024 + 4096 };
+
+/// @brief Workers of the pool, so the chunks are not capped by the number of cores.
+constexpr std::size_t WORKERS{ 4 };
+
+/**
+ * @brief A buffer made of an opening, repeated body lines up to BUFFER_SIZE, and a closing.
+ */
+std::string build(std::string_view opening, std::string_view body, std::string_view closing) {
+  std::string buffer;
+  buffer.reserve(BUFFER_SIZE + body.size() + closing.size());
+  buffer += opening;
+  while (buffer.size() < BUFFER_SIZE) buffer += body;
+  buffer += closing;
+  return buffer;
+}
+
+/**
+ * @brief Check the parallel count of a buffer against the sequential one.
+ */
+void check_parallel(TestReport& report, const std::string& buffer, const std::string& label) {
+  CurrentCount state;
+  AttributeCount expected;
+  count_buffer(buffer, state, expected);
+
+  ThreadPool pool(WORKERS);
+  AttributeCount got;
+  count_buffer_parallel(buffer, pool, got);
+  report.check(got.lines == expected.lines && got.blank == expected.blank && got.loc == expected.loc
+                 && got.com == expected.com && got.dox == expected.dox,
+               label + ": lines " + std::to_string(got.lines) + "/" + std::to_string(expected.lines) + ", code "
+                 + std::to_string(got.loc) + "/" + std::to_string(expected.loc) + ", comments "
+                 + std::to_string(got.com) + "/" + std::to_string(expected.com) + ", doc " + std::to_string(got.dox)
+                 + "/" + std::to_string(expected.dox) + ", blank " + std::to_string(got.blank) + "/"
+                 + std::to_string(expected.blank));
+}
+
+/**
+ * @brief Cuts inside one raw string spanning the whole buffer.
+ *
+ * Its lines hold false closers, quotes and comment markers. The chunks
+ * after the first start inside it, where the delimiter cannot be guessed.
+ */
+void raw_string_test(TestReport& report) {
+  check_parallel(report, build("int a = 0;\nauto s = R\"x(\n", "text )\" )y\" \" ' /* // \\\n\n", ")x\"; int b = 1; // end\n"),
+                 "raw string");
+  check_parallel(report, build("", "auto s = R\"(one\n  two /* \" \n)\"; // line\n\n", ""), "many raw strings");
+}
+
+/**
+ * @brief Cuts inside block and doc comments spanning the whole buffer.
+ */
+void comment_test(TestReport& report) {
+  check_parallel(report, build("int a = 0; /*\n", " * a \"comment\" with 'quotes' // and R\"(\n\n", "*/ int b = 1;\n"),
+                 "block comment");
+  check_parallel(report, build("/**\n", " * @brief doc \" text\n", " */\nint b = 1;\n"), "doc comment");
+}
+
+/**
+ * @brief Cuts inside `//` comments and string literals continued by backslash-newlines.
+ */
+void continued_test(TestReport& report) {
+  check_parallel(report, build("// a comment \\\n", "still the comment \" /* \\\n", "end\nint b = 1;\n"),
+                 "continued comment");
+  check_parallel(report, build("/// a doc comment \\\n", "still the doc \\\n", "end\nint b = 1;\n"), "continued doc comment");
+  check_parallel(report, build("const char* s = \"a \\\n", "still the string // /* R\"( \\\n", "end\";\nint b = 1;\n"),
+                 "continued string");
+}
+
+/**
+ * @brief Cuts anywhere, in the files of tests/corpus repeated.
+ */
+void corpus_test(TestReport& report) {
+  std::string body;
+  for (const char* name : { "raw_strings.cpp", "literals.cpp", "continued_comments.cpp", "digit_separators.cpp", "mixed.cpp" }) {
+    FileBuffer file(std::string(SLOC_TEST_CORPUS) + "/" + name);
+    if (!report.check(file.ok(), std::string(name) + ": unreadable")) return;
+    body += file.view();
+  }
+  check_parallel(report, build("", body, ""), "corpus");
+}
+
+}  // namespace
+
+/**
+ * @brief Tests of the parallel count of big buffers.
+ *
+ * @param tests Receives the tests.
+ */
+void add_parallel_tests(std::vector<TestCase>& tests) {
+  tests.push_back({ "parallel/raw_string", raw_string_test });
+  tests.push_back({ "parallel/comment", comment_test });
+  tests.push_back({ "parallel/continued", continued_test });
+  tests.push_back({ "parallel/corpus", corpus_test });
+}
@@ -0,0 +1,240 @@
+/*!
+ * @file report_writer_tests.cpp
+ * @description
+ * The `--format json|csv|bin` reports (report_writer.hpp): the escaping of
+ * single fields, and whole reports of files with awkward names read back
+ * with a CSV reader, a JSON string decoder and the binary layout.
+ */
+
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/main.hpp"
+#include "../src/report_writer.hpp"
+#include "test_main.hpp"
+
+namespace {
+
+/// @brief File names with the characters CSV and JSON have to escape.
+const std::vector<std::string> AWKWARD_NAMES = {
+  "plain.cpp",         "with,comma.cpp",        "with\"quote.cpp",      "\"quoted\".cpp", "both,\"of\",them.cpp",
+  "back\\slash.cpp",   "line\nbreak.cpp",       "carriage\rreturn.cpp", "tab\there.cpp",  "bell\x07.cpp",
+  "caf\xc3\xa9.cpp",   ",\"\\,\"\".cpp",
+};
+
+/**
+ * @brief Split CSV text into rows of fields, as RFC 4180 reads it.
+ *
+ * @return The rows, or nothing left if a quoted field is not closed.
+ */
+std::vector<std::vector<std::string>> read_csv(std::string_view text) {
+  std::vector<std::vector<std::string>> rows;
+  std::vector<std::string> row;
+  std::string field;
+  bool quoted{ false };
+  for (std::size_t i{ 0 }; i < text.size(); ++i) {
+    char ch = text[i];
+    if (quoted) {
+      if (ch != '"') field += ch;
+      else if (i + 1 < text.size() && text[i + 1] == '"') field += text[++i];
+      else quoted = false;
+    } else if (ch == '"') {
+      quoted = true;
+    } else if (ch == ',') {
+      row.push_back(field);
+      field.clear();
+    } else if (ch == '\n') {
+      row.push_back(field);
+      field.clear();
+      rows.push_back(row);
+      row.clear();
+    } else {
+      field += ch;
+    }
+  }
+  if (quoted) rows.clear();
+  return rows;
+}
+
+/**
+ * @brief Decode the JSON string starting at a quote.
+ *
+ * @param text JSON text.
+ * @param pos Position of the opening quote; set past the closing one.
+ * @param value Receives the decoded string (only `\u00XX` escapes are expected).
+ *
+ * @return false if the string is not valid JSON (e.g. a raw control character).
+ */
+bool read_json_string(std::string_view text, std::size_t& pos, std::string& value) {
+  value.clear();
+  if (pos >= text.size() || text[pos] != '"') return false;
+  for (++pos; pos < text.size(); ++pos) {
+    char ch = text[pos];
+    if (ch == '"') {
+      ++pos;
+      return true;
+    }
+    if (static_cast<unsigned char>(ch) < 0x20) return false;
+    if (ch != '\\') {
+      value += ch;
+      continue;
+    }
+    if (++pos >= text.size()) return false;
+    if (text[pos] == '"' || text[pos] == '\\' || text[pos] == '/') {
+      value += text[pos];
+    } else if (text[pos] == 'u' && pos + 4 < text.size() && text.substr(pos + 1, 2) == "00") {
+      value += static_cast<char>(std::stoi(std::string(text.substr(pos + 3, 2)), nullptr, 16));
+      pos += 4;
+    } else {
+      return false;
+    }
+  }
+  return false;
+}
+
+/// @brief Records of the awkward names, with distinct counts.
+std::vector<FileInfo> make_records() {
+  std::vector<FileInfo> records;
+  for (std::size_t i{ 0 }; i < AWKWARD_NAMES.size(); ++i) {
+    FileInfo info(AWKWARD_NAMES[i], i % 2 == 0 ? CPP : PYTHON, i, 2 * i, 3 * i, 6 * i + 1);
+    info.n_doc_comments = i + 7;
+    records.push_back(info);
+  }
+  return records;
+}
+
+/// @brief A report of records, as a string.
+std::string report_of(const std::vector<FileInfo>& records, output_format_e format) {
+  std::vector<const FileInfo*> pointers;
+  for (const auto& info : records) pointers.push_back(&info);
+  std::ostringstream out;
+  write_report(out, pointers, format);
+  return out.str();
+}
+
+/**
+ * @brief Single fields, against their expected escaping.
+ */
+void fields_test(TestReport& report) {
+  struct Case {
+    std::string_view text, json, csv;
+  };
+  const Case cases[] = {
+    { "a.cpp", "\"a.cpp\"", "a.cpp" },
+    { "a,b.cpp", "\"a,b.cpp\"", "\"a,b.cpp\"" },
+    { "a\"b.cpp", "\"a\\\"b.cpp\"", "\"a\"\"b.cpp\"" },
+    { "\"", "\"\\\"\"", "\"\"\"\"" },
+    { "a\\b", "\"a\\\\b\"", "a\\b" },
+    { "a\nb", "\"a\\u000ab\"", "\"a\nb\"" },
+    { "a\rb", "\"a\\u000db\"", "\"a\rb\"" },
+    { "a\x1f", "\"a\\u001f\"", "a\x1f" },
+    { "", "\"\"", "" },
+  };
+  for (const auto& test : cases) {
+    std::string json, csv;
+    append_json_string(json, test.text);
+    append_csv_field(csv, test.text);
+    report.check(json == test.json, "JSON of \"" + std::string(test.text) + "\": " + json);
+    report.check(csv == test.csv, "CSV of \"" + std::string(test.text) + "\": " + csv);
+  }
+
+  std::string digits;
+  append_uint(digits, 0);
+  digits += ' ';
+  append_uint(digits, std::numeric_limits<std::uint64_t>::max());
+  report.check(digits == "0 18446744073709551615", "integers: " + digits);
+}
+
+/**
+ * @brief A CSV report read back gives the names and counts of the records.
+ */
+void csv_test(TestReport& report) {
+  std::vector<FileInfo> records = make_records();
+  auto rows = read_csv(report_of(records, FORMAT_CSV));
+  if (!report.check(rows.size() == records.size() + 1, std::to_string(rows.size()) + " rows")) return;
+  report.check(rows[0] == std::vector<std::string>{ "filename", "language", "comments", "doc_comments", "blank", "code", "lines" },
+               "header row");
+  for (std::size_t i{ 0 }; i < records.size(); ++i) {
+    const auto& row = rows[i + 1];
+    const FileInfo& info = records[i];
+    std::string label = "row of \"" + std::string(info.filename) + "\"";
+    if (!report.check(row.size() == 7, label + ": " + std::to_string(row.size()) + " fields")) continue;
+    report.check(row[0] == info.filename, label + ": name read back as \"" + row[0] + "\"");
+    report.check(row[1] == language_name(info.type), label + ": language " + row[1]);
+    report.check(row[2] == std::to_string(info.n_comments) && row[3] == std::to_string(info.n_doc_comments)
+                   && row[4] == std::to_string(info.n_blank) && row[5] == std::to_string(info.n_loc)
+                   && row[6] == std::to_string(info.n_lines),
+                 label + ": counts");
+  }
+}
+
+/**
+ * @brief A JSON report holds valid strings that decode to the names of the records.
+ */
+void json_test(TestReport& report) {
+  std::vector<FileInfo> records = make_records();
+  std::string json = report_of(records, FORMAT_JSON);
+  std::size_t pos{ 0 };
+  for (const auto& info : records) {
+    std::string label = "object of \"" + std::string(info.filename) + "\"";
+    pos = json.find("{\"file\": ", pos);
+    if (!report.check(pos != std::string::npos, label + ": missing")) return;
+    pos += 9;
+    std::string name;
+    if (!report.check(read_json_string(json, pos, name), label + ": invalid JSON string")) return;
+    report.check(name == info.filename, label + ": name read back as \"" + name + "\"");
+    std::string counts = ", \"comments\": " + std::to_string(info.n_comments) + ", \"doc_comments\": "
+                         + std::to_string(info.n_doc_comments) + ", \"blank\": " + std::to_string(info.n_blank)
+                         + ", \"code\": " + std::to_string(info.n_loc) + ", \"lines\": " + std::to_string(info.n_lines) + "}";
+    std::string_view rest = std::string_view(json).substr(pos, json.find('}', pos) + 1 - pos); //the names hold no brace
+    report.check(rest.size() >= counts.size() && rest.substr(rest.size() - counts.size()) == counts, label + ": counts");
+  }
+  report.check(json.find("\"total\": {\"files\": " + std::to_string(records.size())) != std::string::npos, "totals");
+}
+
+/**
+ * @brief A binary report holds the names as they are, after their length.
+ */
+void bin_test(TestReport& report) {
+  std::vector<FileInfo> records = make_records();
+  std::string bin = report_of(records, FORMAT_BIN);
+  auto le = [&bin](std::size_t pos, int bytes) {
+    std::uint64_t value{ 0 };
+    for (int i{ bytes - 1 }; i >= 0; --i) value = (value << 8) | static_cast<unsigned char>(bin[pos + i]);
+    return value;
+  };
+  if (!report.check(bin.size() >= 16 && bin.compare(0, 4, "SLOC") == 0 && le(4, 4) == REPORT_BIN_VERSION
+                      && le(8, 8) == records.size(),
+                    "header"))
+    return;
+  std::size_t pos{ 16 };
+  for (const auto& info : records) {
+    std::string label = "record of \"" + std::string(info.filename) + "\"";
+    std::size_t length = le(pos, 4);
+    if (!report.check(pos + 4 + length + 41 <= bin.size(), label + ": truncated")) return;
+    report.check(bin.compare(pos + 4, length, info.filename) == 0 && length == info.filename.size(), label + ": name");
+    pos += 4 + length;
+    report.check(le(pos, 1) == info.type && le(pos + 1, 8) == info.n_comments && le(pos + 33, 8) == info.n_lines,
+                 label + ": counts");
+    pos += 41;
+  }
+  report.check(pos == bin.size(), "bytes after the last record");
+}
+
+}  // namespace
+
+/**
+ * @brief Tests of the machine-readable reports.
+ *
+ * @param tests Receives the tests.
+ */
+void add_report_writer_tests(std::vector<TestCase>& tests) {
+  tests.push_back({ "report/fields", fields_test });
+  tests.push_back({ "report/csv", csv_test });
+  tests.push_back({ "report/json", json_test });
+  tests.push_back({ "report/bin", bin_test });
+}
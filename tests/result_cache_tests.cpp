@@ -0,0 +1,180 @@
+/*!
+ * @file result_cache_tests.cpp
+ * @description
+ * The persistent result cache (ResultCache): entries reused only for the
+ * same mtime and size, saved and loaded back, merged between processes,
+ * and dropped once their file is deleted.
+ */
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+
+#include "../src/main.hpp"
+#include "../src/result_cache.hpp"
+#include "test_main.hpp"
+
+namespace {
+
+/// @brief An entry with some counts, for a stamp.
+CacheEntry make_entry(const FileStamp& stamp, count_t n_loc) {
+  CacheEntry entry;
+  entry.stamp = stamp;
+  entry.type = CPP;
+  entry.n_blank = 1;
+  entry.n_comments = 2;
+  entry.n_doc_comments = 3;
+  entry.n_loc = n_loc;
+  entry.n_lines = n_loc + 6;
+  return entry;
+}
+
+/**
+ * @brief An entry is reused only when both the mtime and the size match.
+ */
+void lookup_test(TestReport& report) {
+  ScratchDir dir("cache");
+  std::string file = dir.write("a.cpp", "int a = 0;\n");
+  std::string cache_file = (dir.path() / "cache" / "counts").string();
+  std::optional<FileStamp> stamp = file_stamp(file);
+  if (!report.check(stamp.has_value(), "a.cpp: no stamp")) return;
+
+  {
+    ResultCache cache(cache_file);
+    cache.load();
+    report.check(!cache.lookup(file, *stamp).has_value(), "empty cache: hit");
+    cache.store(file, make_entry(*stamp, 42));
+    report.check(cache.save(), "the cache file could not be written in a new directory");
+  }
+
+  ResultCache cache(cache_file);
+  cache.load();
+  std::optional<CacheEntry> hit = cache.lookup(file, *stamp);
+  report.check(hit.has_value() && hit->n_loc == 42 && hit->n_lines == 48 && hit->type == CPP,
+               "same mtime and size: no hit, or other counts");
+
+  FileStamp newer{ *stamp };
+  newer.mtime_ns += 1;
+  report.check(!cache.lookup(file, newer).has_value(), "other mtime: hit");
+  FileStamp bigger{ *stamp };
+  bigger.size += 1;
+  report.check(!cache.lookup(file, bigger).has_value(), "other size: hit");
+  report.check(!cache.lookup((dir.path() / "b.cpp").string(), *stamp).has_value(), "other file: hit");
+
+  ResultCache verified(cache_file, true);
+  verified.load();
+  report.check(!verified.lookup(file, *stamp).has_value(), "entry without a content hash: hit when verifying");
+
+  dir.write("a.cpp", "int a = 0;\nint b = 1;\n");
+  std::optional<FileStamp> rewritten = file_stamp(file);
+  report.check(rewritten.has_value() && !cache.lookup(file, *rewritten).has_value(), "rewritten file: hit");
+}
+
+/**
+ * @brief Saves merge with what other processes saved, and drop deleted files.
+ */
+void save_test(TestReport& report) {
+  ScratchDir dir("cache");
+  std::string kept = dir.write("kept.cpp", "int a = 0;\n");
+  std::string deleted = dir.write("deleted.cpp", "int b = 1;\n");
+  std::string later = dir.write("later.cpp", "int c = 2;\n");
+  std::string cache_file = (dir.path() / "counts").string();
+
+  ResultCache first(cache_file), second(cache_file);
+  first.load();
+  second.load();
+  first.store(kept, make_entry(*file_stamp(kept), 1));
+  first.store(deleted, make_entry(*file_stamp(deleted), 2));
+  second.store(later, make_entry(*file_stamp(later), 3));
+  report.check(first.save() && second.save(), "the cache file could not be written");
+
+  ResultCache merged(cache_file);
+  merged.load();
+  report.check(merged.lookup(kept, *file_stamp(kept)).has_value() && merged.lookup(deleted, *file_stamp(deleted)).has_value()
+                 && merged.lookup(later, *file_stamp(later)).has_value(),
+               "a save lost the entries of another");
+
+  std::string added = dir.write("added.cpp", "int d = 3;\n");
+  FileStamp deleted_stamp = *file_stamp(deleted);
+  std::filesystem::remove(deleted);
+  ResultCache pruning(cache_file);
+  pruning.load();
+  pruning.store(added, make_entry(*file_stamp(added), 4));
+  report.check(pruning.save(), "the cache file could not be written");
+
+  ResultCache pruned(cache_file);
+  pruned.load();
+  report.check(pruned.lookup(kept, *file_stamp(kept)).has_value() && pruned.lookup(later, *file_stamp(later)).has_value()
+                 && pruned.lookup(added, *file_stamp(added)).has_value(),
+               "a save dropped the entry of an existing file");
+  report.check(!pruned.lookup(deleted, deleted_stamp).has_value(), "a save kept the entry of a deleted file");
+}
+
+/**
+ * @brief A save checks a bounded slice of a big cache, and the next saves check the rest.
+ */
+void slice_test(TestReport& report) {
+  ScratchDir dir("cache");
+  std::string cache_file = (dir.path() / "counts").string();
+  std::string file = dir.write("a.cpp", "int a = 0;\n");
+  const FileStamp stamp{ 1, 1 };
+  auto remaining = [&] {
+    ResultCache cache(cache_file);
+    cache.load();
+    std::size_t n{ 0 };
+    for (std::size_t i{ 0 }; i < 3000; ++i) n += cache.lookup((dir.path() / ("gone" + std::to_string(i))).string(), stamp).has_value();
+    return n;
+  };
+
+  ResultCache filling(cache_file);
+  for (std::size_t i{ 0 }; i < 3000; ++i) filling.store((dir.path() / ("gone" + std::to_string(i))).string(), make_entry(stamp, i));
+  report.check(filling.save(), "the cache file could not be written");
+  report.check(remaining() == 3000, "entries counted in the run were dropped");
+
+  std::size_t before{ 3000 };
+  for (std::size_t save{ 0 }; save < 3; ++save) {
+    ResultCache cache(cache_file);
+    cache.load();
+    cache.store(file, make_entry(*file_stamp(file), 1));
+    report.check(cache.save(), "the cache file could not be written");
+    std::size_t after = remaining();
+    std::size_t slice = std::min<std::size_t>(before, 1024); //less one if it held the entry of a.cpp
+    report.check(before - after == slice || before - after + 1 == slice,
+                 "save " + std::to_string(save) + " dropped " + std::to_string(before - after) + " of " + std::to_string(before)
+                   + " entries of deleted files");
+    before = after;
+  }
+  report.check(before == 0, std::to_string(before) + " entries of deleted files left after three saves");
+}
+
+/**
+ * @brief A file that is not a cache of this version is an empty cache.
+ */
+void foreign_test(TestReport& report) {
+  ScratchDir dir("cache");
+  std::string file = dir.write("a.cpp", "int a = 0;\n");
+  std::string cache_file = dir.write("counts", "SLOCCCH2 and then anything");
+  ResultCache cache(cache_file);
+  cache.load();
+  report.check(!cache.lookup(file, *file_stamp(file)).has_value(), "foreign cache file: hit");
+  cache.store(file, make_entry(*file_stamp(file), 5));
+  report.check(cache.save(), "a foreign cache file could not be replaced");
+
+  ResultCache reloaded(cache_file);
+  reloaded.load();
+  report.check(reloaded.lookup(file, *file_stamp(file)).has_value(), "replaced cache file: no hit");
+}
+
+}  // namespace
+
+/**
+ * @brief Tests of the persistent result cache.
+ *
+ * @param tests Receives the tests.
+ */
+void add_result_cache_tests(std::vector<TestCase>& tests) {
+  tests.push_back({ "cache/lookup", lookup_test });
+  tests.push_back({ "cache/save", save_test });
+  tests.push_back({ "cache/slice", slice_test });
+  tests.push_back({ "cache/foreign", foreign_test });
+}
@@ -0,0 +1,115 @@
+/*!
+ * @file test_main.cpp
+ * @description
+ * sloc_tests: runs the tests of the classifiers, see test_main.hpp.
+ */
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+#include "test_main.hpp"
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief Check a condition, and tell what went wrong if it does not hold.
+ *
+ * @param ok The condition.
+ * @param what What was checked, printed on failure.
+ *
+ * @return ok.
+ */
+bool TestReport::check(bool ok, const std::string& what) {
+  ++checks;
+  if (!ok) {
+    ++failures;
+    if (failures <= 20) std::cout << "  FAILED: " << what << "\n"; //the first ones tell enough
+  }
+  return ok;
+}
+
+/**
+ * @brief Create a fresh directory under the temporary directory.
+ *
+ * @param name Prefix of its name, e.g. the name of the test.
+ *
+ * The name also holds the process id and a serial number, so that
+ * concurrent runs and several directories of one test do not collide.
+ */
+ScratchDir::ScratchDir(const std::string& name) {
+  static std::atomic<unsigned> serial{ 0 };
+  m_path = fs::temp_directory_path() / ("sloc_tests_" + name + "_" + std::to_string(getpid()) + "_" + std::to_string(serial++));
+  std::error_code ec;
+  fs::remove_all(m_path, ec);
+  fs::create_directories(m_path, ec);
+}
+
+/**
+ * @brief Remove the directory and everything in it.
+ */
+ScratchDir::~ScratchDir() {
+  std::error_code ec;
+  fs::remove_all(m_path, ec);
+}
+
+/**
+ * @brief Write a file in the directory, creating its parent directories.
+ *
+ * @param name Path of the file, relative to the directory.
+ * @param content Content of the file, which replaces any previous one.
+ *
+ * @return The full path of the file.
+ */
+std::string ScratchDir::write(const std::string& name, std::string_view content) const {
+  fs::path file = m_path / name;
+  std::error_code ec;
+  fs::create_directories(file.parent_path(), ec);
+  std::ofstream out(file, std::ios::binary | std::ios::trunc);
+  out.write(content.data(), static_cast<std::streamsize>(content.size()));
+  return file.string();
+}
+
+/**
+ * @brief Run the tests.
+ *
+ * @param argc Argument count.
+ * @param argv Name prefixes of the tests to run; all of them if none.
+ *
+ * @return 0 if every check held, 1 otherwise.
+ */
+int main(int argc, char* argv[]) {
+  std::vector<TestCase> tests;
+  add_lexer_tests(tests);
+  add_parallel_tests(tests);
+  add_line_index_tests(tests);
+  add_top_records_tests(tests);
+  add_library_tests(tests);
+  add_result_cache_tests(tests);
+  add_report_writer_tests(tests);
+  add_record_sort_tests(tests);
+  add_git_repo_tests(tests);
+  add_line_diff_tests(tests);
+  add_count_daemon_tests(tests);
+
+  std::size_t ran{ 0 }, failed{ 0 };
+  for (const auto& test : tests) {
+    bool selected = argc < 2;
+    for (int i{ 1 }; i < argc; ++i) selected = selected || test.name.rfind(argv[i], 0) == 0;
+    if (!selected) continue;
+
+    TestReport report;
+    test.run(report);
+    ++ran;
+    failed += report.failures > 0;
+    std::cout << (report.failures > 0 ? "FAIL " : "ok   ") << test.name << " (" << report.checks << " checks, "
+              << report.failures << " failed)\n";
+  }
+  if (ran == 0) {
+    std::cout << "No test matches.\n";
+    return 1;
+  }
+  std::cout << ran - failed << " of " << ran << " tests passed.\n";
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#ifndef TEST_MAIN_HPP
+#define TEST_MAIN_HPP
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*!
+ * @file test_main.hpp
+ * @description
+ * A small harness for sloc_tests: each test is a named function that
+ * checks conditions on a TestReport. `sloc_tests [PREFIX...]` runs the
+ * tests whose name starts with one of the prefixes (all of them by
+ * default) and fails if any check failed. Tests that need files on disk
+ * write them to a ScratchDir.
+ */
+
+//== Structs
+
+/**
+ * @struct TestReport
+ * @brief What the checks of one test found.
+ */
+struct TestReport {
+  std::size_t checks{ 0 };   //!< Conditions checked.
+  std::size_t failures{ 0 }; //!< Conditions that did not hold.
+
+  /**
+   * @brief Check a condition, and tell what went wrong if it does not hold.
+   * @param ok The condition.
+   * @param what What was checked, printed on failure.
+   * @return ok.
+   */
+  bool check(bool ok, const std::string& what);
+};
+
+/**
+ * @struct TestCase
+ * @brief A named test.
+ */
+struct TestCase {
+  std::string name;                       //!< Name, as `group/test`.
+  std::function<void(TestReport&)> run;   //!< Runs the checks.
+};
+
+//== Classes
+
+/**
+ * @class ScratchDir
+ * @brief A fresh directory under the temporary directory, removed with its content when destroyed.
+ */
+class ScratchDir {
+public:
+  /**
+   * @brief Create the directory.
+   * @param name Prefix of its name, e.g. the name of the test.
+   */
+  explicit ScratchDir(const std::string& name);
+
+  /// @brief Remove the directory and everything in it.
+  ~ScratchDir();
+
+  ScratchDir(const ScratchDir&) = delete;
+  ScratchDir& operator=(const ScratchDir&) = delete;
+
+  /// @brief Path of the directory.
+  const std::filesystem::path& path() const { return m_path; }
+
+  /**
+   * @brief Write a file in the directory, creating its parent directories.
+   * @param name Path of the file, relative to the directory.
+   * @param content Content of the file.
+   * @return The full path of the file.
+   */
+  std::string write(const std::string& name, std::string_view content) const;
+
+private:
+  std::filesystem::path m_path; //!< The directory.
+};
+
+//== Functions
+
+/**
+ * @brief Tests of the C/C++ lexer against the per-line reference.
+ * @param tests Receives the tests.
+ */
+void add_lexer_tests(std::vector<TestCase>& tests);
+
+/**
+ * @brief Tests of the parallel count of big buffers.
+ * @param tests Receives the tests.
+ */
+void add_parallel_tests(std::vector<TestCase>& tests);
+
+/**
+ * @brief Tests of the incremental line index.
+ * @param tests Receives the tests.
+ */
+void add_line_index_tests(std::vector<TestCase>& tests);
+
+/**
+ * @brief Tests of the `--top K` selection.
+ * @param tests Receives the tests.
+ */
+void add_top_records_tests(std::vector<TestCase>& tests);
+
+/**
+ * @brief Tests of the API of libsloc.
+ * @param tests Receives the tests.
+ */
+void add_library_tests(std::vector<TestCase>& tests);
+
+/**
+ * @brief Tests of the persistent result cache.
+ * @param tests Receives the tests.
+ */
+void add_result_cache_tests(std::vector<TestCase>& tests);
+
+/**
+ * @brief Tests of the machine-readable reports.
+ * @param tests Receives the tests.
+ */
+void add_report_writer_tests(std::vector<TestCase>& tests);
+
+/**
+ * @brief Tests of the multi-key sort of the records.
+ * @param tests Receives the tests.
+ */
+void add_record_sort_tests(std::vector<TestCase>& tests);
+
+/**
+ * @brief Tests of the git reader, on a repository built by git.
+ * @param tests Receives the tests.
+ */
+void add_git_repo_tests(std::vector<TestCase>& tests);
+
+/**
+ * @brief Tests of the line diff and of its delta counts.
+ * @param tests Receives the tests.
+ */
+void add_line_diff_tests(std::vector<TestCase>& tests);
+
+/**
+ * @brief Tests of the daemon of `--daemon`.
+ * @param tests Receives the tests.
+ */
+void add_count_daemon_tests(std::vector<TestCase>& tests);
+
+#endif
@@ -0,0 +1,106 @@
+/*!
+ * @file top_records_tests.cpp
+ * @description
+ * The `--top K` selection (TopRecords) checked against a full sort of the
+ * same records, for a K below, equal to and far above the number of files.
+ */
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/main.hpp"
+#include "../src/path_arena.hpp"
+#include "../src/top_records.hpp"
+#include "test_main.hpp"
+
+namespace {
+
+/**
+ * @brief Records of distinct files with few distinct counts, so that many tie on the sort keys.
+ *
+ * @param names Receives the file names, which the records point into.
+ */
+std::vector<FileInfo> make_records(std::vector<std::string>& names) {
+  std::mt19937 random(20251018);
+  std::uniform_int_distribution<count_t> small(0, 3);
+  names.clear();
+  for (std::size_t i{ 0 }; i < 200; ++i) names.push_back("dir/file" + std::to_string(i * 37 % 200) + ".cpp"); //unique, not in order
+  std::vector<FileInfo> records;
+  for (const auto& name : names) {
+    FileInfo info(name, random() % 2 == 0 ? CPP : PYTHON, small(random), small(random), small(random), 0);
+    info.n_doc_comments = small(random);
+    info.n_lines = info.n_blank + info.n_comments + info.n_loc;
+    records.push_back(info);
+  }
+  return records;
+}
+
+/**
+ * @brief Check the first K records of TopRecords against those of a full sort.
+ */
+void check_top(TestReport& report, const std::vector<FileInfo>& records, std::size_t k, const std::vector<sorting_arg>& keys,
+               bool ascending, const std::string& label) {
+  TopRecords top(k, keys, ascending);
+  for (const auto& info : records) top.offer(info);
+  PathArena paths;
+  std::vector<FileInfo> got = top.take(paths);
+
+  std::vector<FileInfo> expected(records);
+  std::stable_sort(expected.begin(), expected.end(), [&](const FileInfo& x, const FileInfo& y) {
+    if (compare_files(x, y, keys, ascending)) return true;
+    if (compare_files(y, x, keys, ascending)) return false;
+    return x.filename < y.filename;
+  });
+  expected.resize(std::min(k, expected.size()));
+
+  if (!report.check(got.size() == expected.size(),
+                    label + ": " + std::to_string(got.size()) + " records, expected " + std::to_string(expected.size())))
+    return;
+  report.check(top.seen() == records.size(), label + ": " + std::to_string(top.seen()) + " records seen");
+  for (std::size_t i{ 0 }; i < got.size(); ++i) {
+    report.check(got[i].filename == expected[i].filename && got[i].n_loc == expected[i].n_loc
+                   && got[i].n_comments == expected[i].n_comments,
+                 label + ": record " + std::to_string(i) + " is " + std::string(got[i].filename) + ", expected "
+                   + std::string(expected[i].filename));
+  }
+}
+
+/**
+ * @brief K below, at and above the number of records, with several sort keys.
+ *
+ * The largest K is the largest `--top` accepts, which must neither
+ * allocate room for K records nor return more records than offered.
+ */
+void selection_test(TestReport& report) {
+  std::vector<std::string> names;
+  std::vector<FileInfo> records = make_records(names);
+  for (std::size_t k : { std::size_t{ 1 }, std::size_t{ 10 }, records.size(), std::size_t{ 999999999 } }) {
+    std::string label = "K " + std::to_string(k);
+    check_top(report, records, k, { s }, false, label + ", -S s");
+    check_top(report, records, k, { c, b }, true, label + ", -s c,b");
+    check_top(report, records, k, { t, d, f }, false, label + ", -S t,d,f");
+  }
+}
+
+/**
+ * @brief A K far above the number of records, with no record at all.
+ */
+void empty_test(TestReport& report) {
+  TopRecords top(999999999, { s }, false);
+  PathArena paths;
+  report.check(top.take(paths).empty(), "no record offered, but some taken");
+}
+
+}  // namespace
+
+/**
+ * @brief Tests of the `--top K` selection.
+ *
+ * @param tests Receives the tests.
+ */
+void add_top_records_tests(std::vector<TestCase>& tests) {
+  tests.push_back({ "top/selection", selection_test });
+  tests.push_back({ "top/empty", empty_test });
+}